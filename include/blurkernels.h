@@ -0,0 +1,235 @@
+//+--------------------------------------------------------------------------
+//
+// File:        blurkernels.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    The inner loops of GFXBase::blurRows and blurColumns, run over a
+//    row-major buffer of pixels four bytes at a time instead of a pixel at
+//    a time.  The results match GFXBase's to the bit, since they use the
+//    same arithmetic as spankernels.h.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "spankernels.h"
+
+#ifndef BLUR_KERNELS_MIN_WIDTH
+#define BLUR_KERNELS_MIN_WIDTH 16                       // Narrowest blur worth doing a word at a time
+#endif
+
+// BlurKernels
+//
+// Each step of blurRows scales a pixel by keep, adds what seeped from the one before it, and then adds what seeps
+// from the one after it, all saturating.  What seeps is always worked out from the pixel as it was, so each pixel
+// comes out as min(255, keep * itself + seep * each neighbor), with each product scaled as scale8 does it.  That
+// doesn't depend on the order pixels are done in, so we can do four bytes of the row at once.  What seeps from each
+// word is worked out once and shared by both its neighbors, which only need it shifted by a pixel either way, and
+// the three parts are added with saturation a byte at a time within the word.  Columns are the same sum with the
+// rows above and below, which line up byte for byte, so they need no shifting and are done a strip of words at a
+// time down the whole height.
+//
+// Pixels before first are treated as they are by blurRows:  the one just before it gets what seeps back from
+// first, but isn't scaled, and first gets nothing from it.  Both return false, having done nothing, if the rows
+// aren't word aligned or (for Rows) don't hold a whole number of words, so the caller can do it the slow way.
+// They also decline blurs narrower than BLUR_KERNELS_MIN_WIDTH pixels.  tools/blurbench.cpp finds the word at a
+// time version no faster than a pixel at a time below that, as what each row or strip costs to set up and finish
+// isn't paid back by the few words in between.
+
+class BlurKernels
+{
+    static constexpr size_t   cbPixel    = 3;
+    static constexpr size_t   MaxFirst   = 8;           // Rows patches up to this many pixels before first
+    static constexpr size_t   StripWords = 8;           // Words of each row done at a time by Columns
+    static constexpr uint32_t Unscaled   = 256;         // A multiplier that leaves a byte as it is
+
+    // BlendByte
+    //
+    // min(255, cur * mCur + (a + b) * mSide) for a single byte, each product scaled apart, for the odd bytes at the
+    // edges of what's done a word at a time
+
+    static inline uint8_t BlendByte(uint8_t cur, uint32_t mCur, uint8_t a, uint8_t b, uint32_t mSide)
+    {
+        uint32_t sum = ((cur * mCur) >> 8) + ((a * mSide) >> 8) + ((b * mSide) >> 8);
+        return std::min<uint32_t>(sum, 255);
+    }
+
+    static inline uint32_t Load(const uint8_t * p)
+    {
+        uint32_t w;
+        memcpy(&w, __builtin_assume_aligned(p, 4), sizeof(w));
+        return w;
+    }
+
+    static inline void Store(uint8_t * p, uint32_t w)
+    {
+        memcpy(__builtin_assume_aligned(p, 4), &w, sizeof(w));
+    }
+
+    static bool IsAligned(const uint8_t * p, size_t cbStride)
+    {
+        return (reinterpret_cast<uintptr_t>(p) & 3) == 0 && (cbStride & 3) == 0;
+    }
+
+  public:
+
+    // Rows
+    //
+    // blurRows over width pixels of each of height rows, stride pixels apart
+
+    static bool Rows(uint8_t * pPixels, size_t stride, size_t width, size_t height, size_t first, uint8_t blur_amount)
+    {
+        const size_t cbStride = stride * cbPixel;
+        const size_t cWords   = width * cbPixel / 4;
+
+        if (!IsAligned(pPixels, cbStride) || (width * cbPixel) % 4 != 0 || width < BLUR_KERNELS_MIN_WIDTH || first > MaxFirst)
+            return false;
+        if (first >= width)
+            return true;
+
+        const uint32_t mKeep = SpanKernels::ScaleFor(255 - blur_amount);
+        const uint32_t mSeep = SpanKernels::ScaleFor(blur_amount >> 1);
+
+        for (size_t row = 0; row < height; row++)
+        {
+            uint8_t * pRow = pPixels + row * cbStride;
+
+            // The pixels up to first are done again afterwards, from how they were
+
+            uint8_t before[(MaxFirst + 2) * cbPixel];
+            const size_t cbBefore = std::min(first + 2, width) * cbPixel;
+            if (first)
+                memcpy(before, pRow, cbBefore);
+
+            // What seeps from each word is worked out once, and what reaches a word from a pixel either way
+            // straddles it and the word on that side
+
+            uint32_t cur      = Load(pRow);
+            uint32_t seepPrev = 0;
+            uint32_t seepCur  = SpanKernels::ScaleBytes(cur, mSeep);
+            for (size_t k = 0; k < cWords; k++)
+            {
+                uint32_t next     = k + 1 < cWords ? Load(pRow + (k + 1) * 4) : 0;
+                uint32_t seepNext = SpanKernels::ScaleBytes(next, mSeep);
+                uint32_t left     = (seepPrev >> 8) | (seepCur << 24);
+                uint32_t right    = (seepCur >> 24) | (seepNext << 8);
+                Store(pRow + k * 4, SpanKernels::AddBytes(SpanKernels::AddBytes(SpanKernels::ScaleBytes(cur, mKeep), left), right));
+                cur      = next;
+                seepPrev = seepCur;
+                seepCur  = seepNext;
+            }
+
+            if (first)
+            {
+                memcpy(pRow, before, (first - 1) * cbPixel);
+                for (size_t i = 0; i < cbPixel; i++)
+                {
+                    const size_t iFirst = first * cbPixel + i;
+                    const uint8_t right = iFirst + cbPixel < cbBefore ? before[iFirst + cbPixel] : 0;
+                    pRow[iFirst - cbPixel] = BlendByte(before[iFirst - cbPixel], Unscaled, before[iFirst], 0, mSeep);
+                    pRow[iFirst]           = BlendByte(before[iFirst], mKeep, 0, right, mSeep);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Columns
+    //
+    // blurColumns over width pixels of each of height rows, stride pixels apart
+
+    static bool Columns(uint8_t * pPixels, size_t stride, size_t width, size_t height, size_t first, uint8_t blur_amount)
+    {
+        const size_t cbStride = stride * cbPixel;
+        const size_t cbRow    = width * cbPixel;
+        const size_t cWords   = cbRow / 4;
+
+        if (!IsAligned(pPixels, cbStride) || width < BLUR_KERNELS_MIN_WIDTH)
+            return false;
+        if (first >= height)
+            return true;
+
+        const uint32_t mKeep = SpanKernels::ScaleFor(255 - blur_amount);
+        const uint32_t mSeep = SpanKernels::ScaleFor(blur_amount >> 1);
+
+        // The row above first only gets what seeps up from it, and first gets nothing from above
+
+        if (first)
+        {
+            uint8_t       * pAbove = pPixels + (first - 1) * cbStride;
+            const uint8_t * pFirst = pPixels + first * cbStride;
+            for (size_t k = 0; k < cWords; k++)
+                Store(pAbove + k * 4, SpanKernels::AddBytes(Load(pAbove + k * 4), SpanKernels::ScaleBytes(Load(pFirst + k * 4), mSeep)));
+            for (size_t i = cWords * 4; i < cbRow; i++)
+                pAbove[i] = BlendByte(pAbove[i], Unscaled, 0, pFirst[i], mSeep);
+        }
+
+        // A strip of words at a time down the whole height, keeping what seeps from the row above and the row itself
+        // so each row's is only worked out once, when it's the row below
+
+        for (size_t k0 = 0; k0 < cWords; k0 += StripWords)
+        {
+            const size_t cStrip = std::min(StripWords, cWords - k0);
+            uint32_t seepAbove[StripWords] = { };
+            uint32_t seepCur[StripWords];
+
+            for (size_t k = 0; k < cStrip; k++)
+                seepCur[k] = SpanKernels::ScaleBytes(Load(pPixels + first * cbStride + (k0 + k) * 4), mSeep);
+
+            for (size_t row = first; row < height; row++)
+            {
+                uint8_t       * pRow   = pPixels + row * cbStride + k0 * 4;
+                const uint8_t * pBelow = row + 1 < height ? pRow + cbStride : nullptr;
+
+                for (size_t k = 0; k < cStrip; k++)
+                {
+                    uint32_t seepBelow = pBelow ? SpanKernels::ScaleBytes(Load(pBelow + k * 4), mSeep) : 0;
+                    Store(pRow + k * 4, SpanKernels::AddBytes(SpanKernels::AddBytes(SpanKernels::ScaleBytes(Load(pRow + k * 4), mKeep), seepAbove[k]), seepBelow));
+                    seepAbove[k] = seepCur[k];
+                    seepCur[k]   = seepBelow;
+                }
+            }
+        }
+
+        // Any bytes left over at the end of the rows, one at a time
+
+        for (size_t i = cWords * 4; i < cbRow; i++)
+        {
+            uint8_t above = 0;
+            for (size_t row = first; row < height; row++)
+            {
+                uint8_t * p     = pPixels + row * cbStride + i;
+                uint8_t   cur   = *p;
+                uint8_t   below = row + 1 < height ? p[cbStride] : 0;
+                *p    = BlendByte(cur, mKeep, above, below, mSeep);
+                above = cur;
+            }
+        }
+        return true;
+    }
+};
@@ -28,4 +28,5 @@
 //
 //---------------------------------------------------------------------------
 
-void IRAM_ATTR DrawLoopTaskEntry(void *);
\ No newline at end of file
+void IRAM_ATTR DrawLoopTaskEntry(void *);
+void IRAM_ATTR OutputLoopTaskEntry(void *);
\ No newline at end of file
@@ -58,7 +58,7 @@ void InitEffectsManager();
 void SaveEffectManagerConfig();
 std::shared_ptr<LEDStripEffect> GetSpectrumAnalyzer(CRGB color);
 std::shared_ptr<LEDStripEffect> GetSpectrumAnalyzer(CRGB color, CRGB color2);
-extern DRAM_ATTR std::shared_ptr<GFXBase> g_ptrDevices[NUM_CHANNELS];
+extern DRAM_ATTR std::shared_ptr<DeviceGFX> g_ptrDevices[NUM_CHANNELS];
 LEDStripEffect* CreateEffectFromJSON(const JsonObjectConst& jsonObject);
 
 // EffectManager
@@ -261,7 +261,7 @@ public:
         lastManualColor = color;
 
         #if (USE_MATRIX)
-                GFXBase *pMatrix = (*this)[0].get();
+                DeviceGFX *pMatrix = (*this)[0].get();
                 pMatrix->setPalette(CRGBPalette16(oldColor, color));
                 pMatrix->PausePalette(true);
         #else
@@ -539,10 +539,13 @@ public:
 
         // If a remote control effect is set, we draw that, otherwise we draw the regular effect
 
-        if (_ptrRemoteEffect)
-            _ptrRemoteEffect->Draw();
-        else
-            _vEffects[_iCurrentEffect]->Draw(); // Draw the currently active effect
+        {
+            PROFILE_STAGE(EffectDraw);
+            if (_ptrRemoteEffect)
+                _ptrRemoteEffect->Draw();
+            else
+                _vEffects[_iCurrentEffect]->Draw(); // Draw the currently active effect
+        }
 
         // If we do indeed have multiple effects (BUGBUG what if only a single enabled?) then we
         // fade in and out at the appropriate time based on the time remaining/used by the effect
@@ -577,4 +580,4 @@ public:
     }
 };
 
-extern std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+extern std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
@@ -88,7 +88,7 @@ public:
 
   virtual void Draw()
   {
-    GFXBase * graphics = (GFXBase *) _GFX[0].get();
+    DeviceGFX * graphics = _GFX[0].get();
 
     graphics->DimAll(245);
 
@@ -141,7 +141,7 @@ private:
             }
         }
 
-        void draw(GFXBase * graphics, CRGB colors[SNAKE_LENGTH])
+        void draw(DeviceGFX * graphics, CRGB colors[SNAKE_LENGTH])
         {
             for (uint8_t i = 0; i < SNAKE_LENGTH; i++)
             {
@@ -177,7 +177,7 @@ public:
 
     void start()
     {
-        auto graphics = (GFXBase *)_GFX[0].get();
+        auto graphics = _GFX[0].get();
 
         for (int i = 0; i < snakeCount; i++)
             snakes[i].reset();
@@ -28,6 +28,7 @@
 //
 // History:     Jun-25-2022         Davepl      Based on Aurora
 //              Jul-08-2022         Davepl      Added loop checks
+//              Oct-16-2026         agent       World kept a bit per cell in LifeWorld
 //
 //---------------------------------------------------------------------------
 
@@ -62,37 +63,28 @@
 #ifndef PatternLife_H
 #define PatternLife_H
 
-#include <bitset>
+#include "lifeworld.h"
 
 extern "C" 
 {
     #include "uzlib/src/uzlib.h"
 }
 
-class Cell 
-{
-public:
-  uint8_t alive : 1;
-  uint8_t prev  : 1;
-  uint8_t hue;  
-  uint8_t brightness;
-};
-
 #define CRC_LENGTH std::max(MATRIX_HEIGHT, MATRIX_WIDTH)                           // Depth of loop check buffer
 
 class PatternLife : public LEDStripEffect 
 {
 private:
-    std::unique_ptr<Cell [][MATRIX_HEIGHT]> world;
-    std::unique_ptr<uint32_t []> checksums;
-    int iChecksum = 0;
+    std::unique_ptr<LifeWorld<MATRIX_WIDTH, MATRIX_HEIGHT>> world;
+    std::unique_ptr<uint32_t []> checksums;                                        // Ring of the last CRC_LENGTH generations' CRCs
+    int iChecksum = 0;                                                             // Where the next one goes
     uint32_t bStuckInLoop = 0;
     unsigned int density = 50;
     int cGeneration = 0;
     unsigned long seed;
 
 
-    virtual bool Init(std::shared_ptr<GFXBase> gfx[NUM_CHANNELS])               
+    virtual bool Init(std::shared_ptr<DeviceGFX> gfx[NUM_CHANNELS])               
     {
         LEDStripEffect::Init(gfx);
 
@@ -100,7 +92,7 @@ private:
         // access.  SPI prefers sequential, so just as we don't use it for decompression,
         // we don't use it to hold the Life world either, as it's very random-access.
 
-        world     = std::make_unique<Cell[][MATRIX_HEIGHT]>(MATRIX_WIDTH);
+        world     = std::make_unique<LifeWorld<MATRIX_WIDTH, MATRIX_HEIGHT>>();
         checksums.reset(psram_allocator<uint32_t>().allocate(CRC_LENGTH));
 
         return true;
@@ -157,35 +149,21 @@ private:
             debugI("Randomized Seed: %lu", seed);
         }
 
+        // The cells are filled a column at a time, as they always have been, so that the baked-in seeds
+        // still give the worlds they were picked for
+
         srand(seed);
+        world->Clear();
         for (int i = 0; i < MATRIX_WIDTH; i++) {
             for (int j = 0; j < MATRIX_HEIGHT; j++) {
-                if ((rand() % 100) < density) {
-                    world[i][j].alive = 1;
-                    world[i][j].brightness = 128;
-                }
-                else {
-                    world[i][j].alive = 0;
-                    world[i][j].brightness = 0;
-                }
-                world[i][j].prev = world[i][j].alive;
-                world[i][j].hue = 0;
+                bool bAlive = (rand() % 100) < density;
+                world->Set(i, j, bAlive, bAlive ? 128 : 0);
             }
         }
 
         for (int i = 0; i < CRC_LENGTH; i++)
             checksums[i] = 0xFFFFFFF;
-    }
-
-    int neighbours(int x, int y) {
-        return (world[(x + 1) % MATRIX_WIDTH][y].prev) +
-            (world[x][(y + 1) % MATRIX_HEIGHT].prev) +
-            (world[(x + MATRIX_WIDTH - 1) % MATRIX_WIDTH][y].prev) +
-            (world[x][(y + MATRIX_HEIGHT - 1) % MATRIX_HEIGHT].prev) +
-            (world[(x + 1) % MATRIX_WIDTH][(y + 1) % MATRIX_HEIGHT].prev) +
-            (world[(x + MATRIX_WIDTH - 1) % MATRIX_WIDTH][(y + 1) % MATRIX_HEIGHT].prev) +
-            (world[(x + MATRIX_WIDTH - 1) % MATRIX_WIDTH][(y + MATRIX_HEIGHT - 1) % MATRIX_HEIGHT].prev) +
-            (world[(x + 1) % MATRIX_WIDTH][(y + MATRIX_HEIGHT - 1) % MATRIX_HEIGHT].prev);
+        iChecksum = 0;
     }
 
 public:
@@ -201,15 +179,13 @@ public:
     void Reset()
     {
         randomFillWorld();
-        for (int i = 0; i < CRC_LENGTH; i++)
-            checksums[i] = 0xFFFFFFF;
         cGeneration = 0;
         bStuckInLoop = 0;
     }
 
     virtual void Draw()
     {
-        auto graphics = (GFXBase *) _GFX[0].get();
+        auto graphics = _GFX[0].get();
         
         if (cGeneration == 0) 
             Reset();
@@ -218,34 +194,28 @@ public:
 
         EVERY_N_MILLIS(MILLIS_PER_FRAME)
         {
-            for (int i = 0; i < MATRIX_WIDTH; i++) {
-                for (int j = 0; j < MATRIX_HEIGHT; j++) {
-                    if (world[i][j].brightness > 0)
-                        graphics->leds[graphics->xy(i, j)] += graphics->ColorFromCurrentPalette(world[i][j].hue * 4, world[i][j].brightness);
+            for (int j = 0; j < MATRIX_HEIGHT; j++) {
+                for (int i = 0; i < MATRIX_WIDTH; i++) {
+                    uint8_t brightness = world->Brightness(i, j);
+                    if (brightness > 0)
+                        graphics->leds[graphics->xy(i, j)] += graphics->ColorFromCurrentPalette(world->Hue(i, j) * 4, brightness);
                     else
                         graphics->leds[graphics->xy(i, j)] = CRGB::Black;
                 }
             }
         }
 
-        // We maintain a scrolling window of the last N crcs and if the current crc makes it all
-        // the way down to the bototm half we assume we're stuck in a loop and restart.
-        // We have to first extract the alive bits alone because we don't want the hue and brightness 
-        // data to mess with the CRC.
-
-        bool alive[MATRIX_WIDTH][MATRIX_HEIGHT];
-        for (int i = 0; i < MATRIX_WIDTH; i++) 
-            for (int j = 0; j < MATRIX_HEIGHT; j++) 
-                alive[i][j] = world[i][j].alive;
-
-        auto crc = uzlib_crc32(alive, sizeof(alive), 0xffffffff);
-        for (int i = 0; i < CRC_LENGTH - 1; i++)
-            checksums[i] = checksums[i+1];
-        checksums[CRC_LENGTH - 1] = crc;
+        // We keep a ring of the crcs of the last N generations, and if the current crc turns up among
+        // them we assume we're stuck in a loop and restart.  The world keeps the alive bits apart from
+        // the hue and brightness, so we can crc those alone, packed as they are.
 
+        auto crc = uzlib_crc32(world->Cells(), world->CellsSize(), 0xffffffff);
+        const int iCurrent = iChecksum;
+        checksums[iCurrent] = crc;
+        iChecksum = (iChecksum + 1) % CRC_LENGTH;
 
-        // Look for any occurance of the current CRC in the first half of the window, which would mean
-        // a loop has occured.  If 
+        // Look for any occurance of the current CRC in the earlier generations, newest first, which
+        // would mean a loop has occured.
 
         if (bStuckInLoop)
         {
@@ -260,58 +230,29 @@ public:
             }
             graphics->DimAll(255 - 255*elapsed/resetTime);
 
-            for (int x = 0; x < MATRIX_WIDTH; x++) 
-                for (int y = 0; y < MATRIX_HEIGHT; y++) 
-                        world[x][y].brightness *= 0.9;
+            world->Dim();
             if (elapsed > resetTime)
                 Reset();
         }
         else
         {
-            for (int i = CRC_LENGTH - 2; i >= 0; i--)
+            for (int n = 1; n < CRC_LENGTH; n++)
             {
-                if (checksums[i] == crc)
+                auto past = checksums[(iCurrent + CRC_LENGTH - n) % CRC_LENGTH];
+                if (past == crc)
                 {
                     bStuckInLoop = millis();
                     debugW("Seed: %10lu, Generations: %5d, %s", seed, cGeneration, cGeneration > 3000 ? "Y" : "N");
+                    break;
                 }
-                if (checksums[i] == 0xFFFFFFF)
+                if (past == 0xFFFFFFF)
                     break;
             }
         }
 
         // Birth and death cycle
-        for (int x = 0; x < MATRIX_WIDTH; x++) {
-            for (int y = 0; y < MATRIX_HEIGHT; y++) {
-                // Default is for cell to stay the same
-                if (world[x][y].brightness > 0 && world[x][y].prev == 0)
-                  world[x][y].brightness *= 0.75;
-                  
-                int count = neighbours(x, y);
-                if (count == 3 && world[x][y].prev == 0) {
-                    // A new cell is born
-                    world[x][y].alive = 1;
-                    world[x][y].hue += 1;
-                    world[x][y].brightness = 255;
-                } else if ((count < 2 || count > 3) && world[x][y].prev == 1) {
-                    // Cell dies
-                    world[x][y].alive = 0;
-                    world[x][y].brightness = 0;
-                }
-            }
-        }
-
-        // Copy next generation into place
-
-        int cCount = 0;
 
-        for (int x = 0; x < MATRIX_WIDTH; x++) {
-            for (int y = 0; y < MATRIX_HEIGHT; y++) {
-                if (world[x][y].prev != world[x][y].alive)
-                    cCount++;
-                world[x][y].prev = world[x][y].alive;
-            }
-        }
+        world->Step();
 
         cGeneration++;
     }
@@ -82,7 +82,7 @@ class PatternPulse : public LEDStripEffect
 
     virtual void Draw()
     {
-        auto graphics = (GFXBase *) _GFX[0].get();
+        auto graphics = _GFX[0].get();
 
         graphics->DimAll(245);
 
@@ -71,7 +71,7 @@ public:
 
   virtual void Draw()
   {
-    auto graphics = (GFXBase *)_GFX[0].get();
+    auto graphics = _GFX[0].get();
     graphics->DimAll(254);
 
     for (int offset = 0; offset < MATRIX_CENTER_X; offset++)
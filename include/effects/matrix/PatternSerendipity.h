@@ -102,7 +102,7 @@ public:
     {
     }
 
-    virtual bool Init(std::shared_ptr<GFXBase> gfx[NUM_CHANNELS])   
+    virtual bool Init(std::shared_ptr<DeviceGFX> gfx[NUM_CHANNELS])   
     {
         if (!LEDStripEffect::Init(gfx))
             return false;
@@ -150,7 +150,7 @@ public:
 
     virtual void Draw()
     {
-        auto graphics = (GFXBase *) _GFX[0].get();
+        auto graphics = _GFX[0].get();
 
         // manage the Oszillators
         UpdateTimers();
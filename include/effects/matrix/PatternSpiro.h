@@ -95,7 +95,7 @@ public:
   }
   virtual void Draw()
   {
-    auto graphics = (GFXBase *)_GFX[0].get();
+    auto graphics = _GFX[0].get();
     graphics->DimAll(253);
 
     // effects.ShowFrame();
@@ -98,7 +98,7 @@ public:
 
     virtual void Draw()
     {
-        auto graphics = (GFXBase *) _GFX[0].get();
+        auto graphics = _GFX[0].get();
         int n = 0;
 
         switch (rotation) {
@@ -37,7 +37,7 @@
 
 extern AppTime  g_AppTime;
 extern DRAM_ATTR uint8_t giInfoPage;                   // Which page of the display is being shown
-extern DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+extern DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
 
 #if ENABLE_AUDIO
 
@@ -121,7 +121,7 @@ class VUMeterEffect
     //
     // Draw i-th pixel in row y
 
-    void DrawVUPixels(GFXBase * pGFXChannel, int i, int yVU, int fadeBy = 0, const CRGBPalette16 * pPalette = nullptr)
+    void DrawVUPixels(DeviceGFX * pGFXChannel, int i, int yVU, int fadeBy = 0, const CRGBPalette16 * pPalette = nullptr)
     {
         if (g_Analyzer.MicMode() == PeakData::PCREMOTE)
             pPalette = &vuPaletteBlue;
@@ -141,17 +141,14 @@ class VUMeterEffect
     
   public:
 
-    inline void EraseVUMeter(GFXBase * pGFXChannel, int start, int yVU) const
+    inline void EraseVUMeter(DeviceGFX * pGFXChannel, int start, int yVU) const
     {
         int xHalf = pGFXChannel->width()/2;
-        for (int i = start; i <= xHalf; i++)
-        {
-            pGFXChannel->setPixel(xHalf-i,   yVU, CRGB::Black);
-            pGFXChannel->setPixel(xHalf-1+i,   yVU, CRGB::Black);
-        }
+        pGFXChannel->fillRectangle(0, yVU, xHalf - start + 1, yVU + 1, CRGB::Black);
+        pGFXChannel->fillRectangle(xHalf - 1 + start, yVU, 2 * xHalf, yVU + 1, CRGB::Black);
     }
 
-    void DrawVUMeter(GFXBase * pGFXChannel, int yVU, const CRGBPalette16 * pPalette = nullptr)
+    void DrawVUMeter(DeviceGFX * pGFXChannel, int yVU, const CRGBPalette16 * pPalette = nullptr)
     {
         const int MAX_FADE = 256;
 
@@ -280,15 +277,9 @@ class SpectrumAnalyzerEffect : public LEDStripEffect, virtual public VUMeterEffe
         int yOffset2  = pGFXChannel->height() - value2;
 
         if (_fadeRate == 0)
-        {
-            for (int y = 1; y < yOffset2; y++)
-                for (int x = xOffset; x < xOffset + barWidth; x++)
-                    graphics()->setPixel(x, y, CRGB::Black);
-        }
+            graphics()->fillRectangle(xOffset, 1, xOffset + barWidth, yOffset2, CRGB::Black);
         
-        for (int y = yOffset2; y < pGFXChannel->height(); y++)
-            for (int x = xOffset; x < xOffset + barWidth; x++)
-                graphics()->setPixel(x, y, baseColor);
+        graphics()->fillRectangle(xOffset, yOffset2, xOffset + barWidth, pGFXChannel->height(), baseColor);
         
         const int PeakFadeTime_ms = 1000;
 
@@ -59,7 +59,7 @@ public:
         return true;
     }
 
-    virtual void Draw(std::shared_ptr<GFXBase> pGFX)
+    virtual void Draw(std::shared_ptr<DeviceGFX> pGFX)
     {
         for (float d = 0; d < _size && d + _position < NUM_LEDS; d++)
             pGFX->setPixelsF(_position + d, 1.0, CHSV(_hue + d, 255, 255), true);
@@ -70,7 +70,7 @@ class LaserLineEffect : public BeatEffectBase, public LEDStripEffect
 {
   private:
     std::vector<LaserShot>      _shots;
-    std::shared_ptr<GFXBase>    _gfx;
+    std::shared_ptr<DeviceGFX>    _gfx;
     float                      _defaultSize;
     float                      _defaultSpeed;
 
@@ -105,7 +105,7 @@ class LaserLineEffect : public BeatEffectBase, public LEDStripEffect
         return jsonObject.set(jsonDoc.as<JsonObjectConst>());
     }
 
-    virtual bool Init(std::shared_ptr<GFXBase> gfx[NUM_CHANNELS])   
+    virtual bool Init(std::shared_ptr<DeviceGFX> gfx[NUM_CHANNELS])   
     {
         debugW("Initialized LaserLine Effect");
         _gfx = gfx[0];
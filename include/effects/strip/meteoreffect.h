@@ -56,7 +56,7 @@ public:
     
     }
 
-    virtual void Init(std::shared_ptr<GFXBase> pGFX, size_t meteors = 4, uint size = 4, uint decay = 3, float minSpeed = 0.5, float maxSpeed = 0.5)
+    virtual void Init(std::shared_ptr<DeviceGFX> pGFX, size_t meteors = 4, uint size = 4, uint decay = 3, float minSpeed = 0.5, float maxSpeed = 0.5)
     {
         meteorCount = meteors;
         meteorSize = size;
@@ -89,7 +89,7 @@ public:
         bLeft[iMeteor] = !bLeft[iMeteor];
     }
 
-    virtual void Draw(std::shared_ptr<GFXBase> pGFX)
+    virtual void Draw(std::shared_ptr<DeviceGFX> pGFX)
     {
         static CHSV hsv;
         hsv.val = 255;
@@ -159,7 +159,7 @@ class MeteorEffect : public LEDStripEffect
 {
   private:
     MeteorChannel   _Meteors[NUM_CHANNELS];
-    std::shared_ptr<GFXBase> * _gfx;
+    std::shared_ptr<DeviceGFX> * _gfx;
 
     int             _cMeteors;
     uint8_t         _meteorSize;
@@ -207,7 +207,7 @@ class MeteorEffect : public LEDStripEffect
         return jsonObject.set(jsonDoc.as<JsonObjectConst>());
     }
 
-    virtual bool Init(std::shared_ptr<GFXBase> gfx[NUM_CHANNELS])   
+    virtual bool Init(std::shared_ptr<DeviceGFX> gfx[NUM_CHANNELS])   
     {
         _gfx = gfx;
         if (!LEDStripEffect::Init(gfx))
@@ -71,7 +71,7 @@ class BeatEffectBase
 
     float SecondsSinceLastBeat()
     {
-      return g_AppTime.CurrentTime() - _lastBeat;
+      return g_AppTime.FrameStartTime() - _lastBeat;
     }
 
 
@@ -106,7 +106,7 @@ class BeatEffectBase
               debugV("Beat: elapsed: %0.2lf, range: %0.2lf\n", elapsed, maximum - minimum);
 
               HandleBeat(false, elapsed, maximum - minimum);
-              _lastBeat = g_AppTime.CurrentTime();
+              _lastBeat = g_AppTime.FrameStartTime();
               _samples.clear();
             }
         }
@@ -290,7 +290,7 @@ class DrawableParticle : public Lifespan
   protected:
 
   public:
-     virtual void Render(const std::shared_ptr<GFXBase> _GFX[NUM_CHANNELS]) = 0;
+     virtual void Render(const std::shared_ptr<DeviceGFX> _GFX[NUM_CHANNELS]) = 0;
 };
 
 template <typename Type = DrawableParticle> class ParticleSystem 
@@ -307,7 +307,7 @@ template <typename Type = DrawableParticle> class ParticleSystem
     {
     }
 
-    virtual void Render(const std::shared_ptr<GFXBase> _gfx[NUM_CHANNELS])
+    virtual void Render(const std::shared_ptr<DeviceGFX> _gfx[NUM_CHANNELS])
     {
         debugV("ParticleSystemEffect::Draw for %d particles", _allParticles.size());
 
@@ -345,7 +345,7 @@ class RingParticle : public FadingColoredObject
         debugV("Creating particle at insulator %d", iInsulator);
     }
 
-    virtual void Render(const std::shared_ptr<GFXBase> _GFX[NUM_CHANNELS])
+    virtual void Render(const std::shared_ptr<DeviceGFX> _GFX[NUM_CHANNELS])
     {
         debugV("Particle Render at insulator %d", _iInsulator);
 
@@ -492,7 +492,7 @@ class SpinningPaletteRingParticle : public FadingObject
 { 
   protected:
 
-          std::shared_ptr<GFXBase> * _pGFX;
+          std::shared_ptr<DeviceGFX> * _pGFX;
           int             _iInsulator;
           int             _iRing;
     const CRGBPalette16  _palette;
@@ -514,7 +514,7 @@ class SpinningPaletteRingParticle : public FadingObject
   public:
 
     SpinningPaletteRingParticle(
-                  std::shared_ptr<GFXBase> * pGFX,                  // BUGBUG Remove and use what is passed to Render
+                  std::shared_ptr<DeviceGFX> * pGFX,                  // BUGBUG Remove and use what is passed to Render
                   int                    iInsulator, 
                   int                    iRing, 
                   const CRGBPalette16 & palette, 
@@ -559,7 +559,7 @@ class SpinningPaletteRingParticle : public FadingObject
         _length = g_aRingSizeTable[iRing];    // Length is size of this particular ring
     }
 
-    virtual void Render(const std::shared_ptr<GFXBase> _GFX[NUM_CHANNELS])
+    virtual void Render(const std::shared_ptr<DeviceGFX> _GFX[NUM_CHANNELS])
     {
         debugV("Particle Render at insulator %d", _iInsulator);
 
@@ -622,7 +622,7 @@ class HotWhiteRingParticle : public FadingObject
 { 
   protected:
 
-    std::shared_ptr<GFXBase> * _pGFX;
+    std::shared_ptr<DeviceGFX> * _pGFX;
     int             _iInsulator;
     int             _iRing;
     float           _ignitionTime;
@@ -630,7 +630,7 @@ class HotWhiteRingParticle : public FadingObject
 
   public:
 
-    HotWhiteRingParticle(std::shared_ptr<GFXBase> * pGFX, int iInsulator, int iRing, float ignitionTime = 0.25f, float fadeTime = 1.0f)
+    HotWhiteRingParticle(std::shared_ptr<DeviceGFX> * pGFX, int iInsulator, int iRing, float ignitionTime = 0.25f, float fadeTime = 1.0f)
       :  _pGFX(pGFX),
          _iInsulator(iInsulator),
          _iRing(iRing),
@@ -642,7 +642,7 @@ class HotWhiteRingParticle : public FadingObject
         debugV("Creating particle at insulator %d", iInsulator);
     }
 
-    virtual void Render(const std::shared_ptr<GFXBase> _GFX[NUM_CHANNELS])
+    virtual void Render(const std::shared_ptr<DeviceGFX> _GFX[NUM_CHANNELS])
     {
         debugV("Particle Render at insulator %d", _iInsulator);
 
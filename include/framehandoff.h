@@ -0,0 +1,122 @@
+//+--------------------------------------------------------------------------
+//
+// File:        framehandoff.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Passes finished frames from the draw task to the output task when
+//    PIPELINED_OUTPUT is on, so one frame is being sent to the LEDs while
+//    the next is drawn.  The draw task waits only if the output task
+//    hasn't finished with the frame before.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// FrameHandoff
+//
+// Only ever holds one frame.  The frame itself stays where it was drawn; what's handed over is which buffers to
+// show and how many pixels of them, and the draw task swaps to its other buffers to draw the next one.  Before
+// it can hand that one over it has to wait for the output task to be done with the first, since that's the set
+// it'll draw into after the swap.  So each side only ever waits when it's the faster of the two, and the frame
+// rate comes out at that of the slower rather than of both added together.
+
+class FrameHandoff
+{
+    std::mutex              _mutex;
+    std::condition_variable _cvPending;                 // A frame has been handed over
+    std::condition_variable _cvIdle;                    // The output task has finished with the last one
+    bool                    _bPending = false;          // Handed over and not finished with yet
+    uint16_t                _count    = 0;              // Pixels in the frame handed over
+    uint32_t                _cFrames  = 0;
+    uint32_t                _cWaits   = 0;              // Times the draw task had to wait for the output task
+
+  public:
+
+    // Draw task side
+
+    // WaitUntilIdle
+    //
+    // Blocks until the output task has finished with the last frame handed over, after which the buffers it was
+    // in are the draw task's again
+
+    void WaitUntilIdle()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_bPending)
+        {
+            _cWaits++;
+            _cvIdle.wait(lock, [this] { return !_bPending; });
+        }
+    }
+
+    // Submit
+    //
+    // Hands over a frame of count pixels.  The output task must be idle (WaitUntilIdle), and everything written
+    // to the frame beforehand is visible to it once it wakes.
+
+    void Submit(uint16_t count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bPending = true;
+            _count    = count;
+            _cFrames++;
+        }
+        _cvPending.notify_one();
+    }
+
+    // Output task side
+
+    // WaitForFrame
+    //
+    // Blocks until a frame has been handed over and returns how many pixels it has
+
+    uint16_t WaitForFrame()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cvPending.wait(lock, [this] { return _bPending; });
+        return _count;
+    }
+
+    // Done
+    //
+    // Gives the frame's buffers back to the draw task
+
+    void Done()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bPending = false;
+        }
+        _cvIdle.notify_one();
+    }
+
+    uint32_t FramesHandedOff() const { return _cFrames; }
+    uint32_t DrawWaits()       const { return _cWaits;  }
+};
+
+extern FrameHandoff g_OutputHandoff;
@@ -0,0 +1,239 @@
+//+--------------------------------------------------------------------------
+//
+// File:        framepacer.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Decides when the draw loop starts its next frame.  Local effects are
+//    paced against absolute deadlines on the Timebase clock, so a late
+//    frame doesn't push back every frame after it, and the wait is split
+//    between blocking for scheduler ticks and spinning for the remainder.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "timebase.h"
+#include "telemetry.h"
+
+#if defined(ESP_PLATFORM)
+    #include <freertos/FreeRTOS.h>
+    #include <freertos/task.h>
+#else
+    #include <chrono>
+    #include <thread>
+#endif
+
+#ifndef FRAME_PACER_MAX_BUSY_MS
+#define FRAME_PACER_MAX_BUSY_MS 100                     // Longest the draw loop may go without blocking, for the idle task's sake
+#endif
+
+#ifndef FRAME_PACER_TICK_SLOP_US
+#define FRAME_PACER_TICK_SLOP_US 50                     // How late after a tick edge we may see it, since waking takes a moment
+#endif
+
+// SchedulerClock
+//
+// Where the pacer reads the time and how it blocks:  the Timebase clock and the scheduler's tick.  A build can
+// define FRAME_PACER_CLOCK as a class of its own with the same three members, as tools/pacertest.cpp does to run
+// the pacer on simulated time.
+
+struct SchedulerClock
+{
+    #if defined(ESP_PLATFORM)
+        static constexpr uint64_t usTick = portTICK_PERIOD_MS * 1000;
+
+        static void BlockTicks(uint32_t cTicks)
+        {
+            vTaskDelay(cTicks);
+        }
+    #else
+        // Stands in for the FreeRTOS tick, so that a host build blocks the way the chip does:  ticks fall on whole
+        // multiples of usTick, and blocking for n ticks wakes on the nth edge from now
+
+        static constexpr uint64_t usTick = 1000;
+
+        static void BlockTicks(uint32_t cTicks)
+        {
+            uint64_t usWake = (Timebase::MonotonicMicros() / usTick + cTicks) * usTick;
+            std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(usWake)));
+        }
+    #endif
+
+    static uint64_t Now()
+    {
+        return Timebase::MonotonicMicros();
+    }
+};
+
+#ifndef FRAME_PACER_CLOCK
+#define FRAME_PACER_CLOCK SchedulerClock
+#endif
+
+// FramePacer
+//
+// Each frame has an absolute deadline, and local effects get theirs by adding one frame interval to the last, so
+// time lost in one frame is made up in the next rather than slowly lowering the frame rate.  Waiting is done by
+// blocking for whole scheduler ticks, up to the last tick edge before the deadline, and then spinning for what's
+// left.  We learn where the tick edges fall every time we wake from blocking, since that always happens on one.
+//
+// It also records how far each frame interval it paced came out from the one it was aiming for.
+
+class FramePacer
+{
+    uint64_t            _usDeadline      = 0;           // Deadline of the last local frame
+    uint64_t            _usLastDeadline  = 0;           // Deadline of the last frame of either kind
+    uint64_t            _usLastWake      = 0;           // When we finished waiting for it
+    uint64_t            _usTickEdge      = 0;           // Time of some tick edge, or 0 until we've seen one
+    uint64_t            _usLastBlocked   = 0;           // When we last blocked rather than spun
+    int64_t             _usErrorAverage  = 0;           // Smoothed size of the interval error
+    uint32_t            _usErrorMax      = 0;
+    uint32_t            _cFrames         = 0;
+    uint32_t            _cMissed         = 0;           // Frames whose deadline had already passed when we got to it
+    LatencyHistogram    _errors;                        // Size of the interval error, for each frame
+
+  public:
+
+    using Clock = FRAME_PACER_CLOCK;
+
+    static constexpr uint64_t usTick = Clock::usTick;
+
+    // WaitForLocalFrame
+    //
+    // Waits until it's time for the next frame of an effect that wants framesPerSecond of them, given when the one
+    // just drawn was started.  If we've fallen more than a frame behind (or haven't been drawing local frames at
+    // all), we go back to pacing from that frame instead of rushing through frames to catch up.  Returns how long
+    // we waited, in microseconds.
+
+    uint64_t WaitForLocalFrame(uint32_t framesPerSecond, uint64_t usFrameStart)
+    {
+        uint64_t usInterval = Timebase::MicrosPerSecond / std::max<uint32_t>(framesPerSecond, 1);
+        uint64_t usNow      = Clock::Now();
+
+        _usDeadline += usInterval;
+        if (Timebase::MicrosBetween(_usDeadline, usNow) > (int64_t) usInterval)
+        {
+            _usDeadline     = usFrameStart + usInterval;
+            _usLastDeadline = 0;                        // Don't count the gap as an interval
+        }
+        return WaitUntil(_usDeadline);
+    }
+
+    // WaitUntil
+    //
+    // Waits until usDeadline on the monotonic clock, returning how long that took in microseconds
+
+    uint64_t WaitUntil(uint64_t usDeadline)
+    {
+        uint64_t usStart = Clock::Now();
+        uint64_t usNow   = usStart;
+
+        if (Timebase::MicrosBetween(usNow, usDeadline) < 0)
+            _cMissed++;
+
+        // Block up to the last tick edge before the deadline.  Until we know where the edges are, we can only
+        // count whole ticks from now, which may leave us up to two ticks to spin the first time.  Once we do, an
+        // edge we're within the slop of is taken to have passed already, as we may have seen the edge itself late,
+        // and sleeping one tick short only costs a tick of spinning where sleeping one long would miss the deadline.
+
+        int64_t usLeft = Timebase::MicrosBetween(usNow, usDeadline);
+        if (usLeft >= (int64_t) usTick)
+        {
+            uint32_t cTicks;
+            if (_usTickEdge)
+            {
+                uint64_t usLastEdge = _usTickEdge + (usDeadline - _usTickEdge) / usTick * usTick;
+                cTicks = (usLastEdge - _usTickEdge) / usTick - (usNow + FRAME_PACER_TICK_SLOP_US - _usTickEdge) / usTick;
+            }
+            else
+            {
+                cTicks = usLeft / usTick;
+            }
+
+            if (cTicks > 0)
+            {
+                Block(cTicks);
+                usNow = Clock::Now();
+            }
+        }
+
+        // Spin out the rest.  If that leaves us having gone too long without blocking at all, we block for a tick
+        // anyway, late as it makes this frame, or the idle task would never get to run.
+
+        while (Timebase::MicrosBetween(usNow, usDeadline) > 0)
+            usNow = Clock::Now();
+
+        if (Timebase::MicrosBetween(_usLastBlocked, usNow) > FRAME_PACER_MAX_BUSY_MS * 1000)
+        {
+            Block(1);
+            usNow = Clock::Now();
+        }
+
+        RecordInterval(usDeadline, usNow);
+        return usNow - usStart;
+    }
+
+    // FrameCount, MissedDeadlines, AverageError, MaxError, Errors
+    //
+    // How pacing has gone.  The errors are how far, in microseconds, each paced interval came out from its target,
+    // either way.
+
+    uint32_t FrameCount()      const { return _cFrames;         }
+    uint32_t MissedDeadlines() const { return _cMissed;         }
+    uint32_t AverageError()    const { return _usErrorAverage;  }
+    uint32_t MaxError()        const { return _usErrorMax;      }
+
+    const LatencyHistogram & Errors() const
+    {
+        return _errors;
+    }
+
+  private:
+
+    void Block(uint32_t cTicks)
+    {
+        Clock::BlockTicks(cTicks);
+        _usTickEdge = _usLastBlocked = Clock::Now();
+    }
+
+    void RecordInterval(uint64_t usDeadline, uint64_t usWake)
+    {
+        if (_usLastDeadline)
+        {
+            int64_t  usTarget   = Timebase::MicrosBetween(_usLastDeadline, usDeadline);
+            int64_t  usAchieved = Timebase::MicrosBetween(_usLastWake, usWake);
+            uint32_t usError    = std::min<int64_t>(std::abs(usAchieved - usTarget), UINT32_MAX);
+
+            _errors.Add(usError);
+            _usErrorAverage += ((int64_t) usError - _usErrorAverage) / 16;
+            _usErrorMax      = std::max(_usErrorMax, usError);
+            _cFrames++;
+        }
+        _usLastDeadline = usDeadline;
+        _usLastWake     = usWake;
+    }
+};
+
+extern FramePacer g_FramePacer;
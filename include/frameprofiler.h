@@ -0,0 +1,247 @@
+//+--------------------------------------------------------------------------
+//
+// File:        frameprofiler.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Times each stage of the draw loop in CPU cycles, so that a slow frame
+//    can be pinned on the stage that made it slow.  Build with
+//    ENABLE_FRAME_PROFILER to turn it on; without it, PROFILE_STAGE expands
+//    to nothing at all.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#if defined(ESP_PLATFORM)
+    #include <Arduino.h>
+#else
+    #include <chrono>
+#endif
+
+#ifndef ENABLE_FRAME_PROFILER
+#define ENABLE_FRAME_PROFILER 0
+#endif
+
+#ifndef FRAME_PROFILER_HISTORY
+#define FRAME_PROFILER_HISTORY 128                      // Samples kept per stage for the p99; must be a power of two
+#endif
+
+static_assert((FRAME_PROFILER_HISTORY & (FRAME_PROFILER_HISTORY - 1)) == 0, "FRAME_PROFILER_HISTORY must be a power of two");
+
+// ProfileStage
+//
+// The parts of the draw loop that get timed.  EffectUpdate includes EffectDraw, since the effect is drawn from
+// inside EffectManager::Update, so the difference between the two is what the manager itself costs (fading, mostly).
+// With PIPELINED_OUTPUT, Show is timed on the output task, and OutputWait is how long the draw task waited for it.
+
+enum class ProfileStage : uint8_t
+{
+    MatrixPreDraw,
+    WiFiDraw,
+    EffectUpdate,
+    EffectDraw,
+    VUMeter,
+    Show,
+    MatrixSwap,
+    OutputWait,
+    Count
+};
+
+// ProfileStats
+//
+// What GetStats reports for one stage.  Min, average and max are since the last Reset; the p99 is over the last
+// FRAME_PROFILER_HISTORY times the stage ran.
+
+struct ProfileStats
+{
+    const char *    name;
+    uint32_t        count;
+    float           minUs;
+    float           avgUs;
+    float           p99Us;
+    float           maxUs;
+};
+
+// FrameProfiler
+//
+// Keeps a ring of recent samples and running totals for every stage.  Each stage is only ever recorded by one
+// task, which only touches that stage's counters, so there are no locks; the web server and debug console read
+// the counters from other tasks and may see one sample half-way in, which is fine for what they're used for.
+
+class FrameProfiler
+{
+    struct StageData
+    {
+        uint32_t    samples[FRAME_PROFILER_HISTORY];
+        uint32_t    count;
+        uint32_t    minCycles;
+        uint32_t    maxCycles;
+        uint64_t    totalCycles;
+    };
+
+    StageData _stages[(size_t) ProfileStage::Count];
+
+  public:
+
+    FrameProfiler()
+    {
+        Reset();
+    }
+
+    // Cycles, CyclesPerMicrosecond
+    //
+    // The CPU's cycle counter, which is one register read, and how fast it runs.  It's per core and wraps every
+    // 18 seconds or so at 240MHz, which is fine for timing stages within tasks that are pinned to one core.  A
+    // host build uses nanoseconds instead.
+
+    #if defined(ESP_PLATFORM)
+        static inline uint32_t Cycles()
+        {
+            return ESP.getCycleCount();
+        }
+
+        static uint32_t CyclesPerMicrosecond()
+        {
+            return ESP.getCpuFreqMHz();
+        }
+    #else
+        static inline uint32_t Cycles()
+        {
+            return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static uint32_t CyclesPerMicrosecond()
+        {
+            return 1000;
+        }
+    #endif
+
+    static const char * StageName(ProfileStage stage)
+    {
+        static const char * const names[] =
+        {
+            "MatrixPreDraw",
+            "WiFiDraw",
+            "EffectUpdate",
+            "EffectDraw",
+            "VUMeter",
+            "Show",
+            "MatrixSwap",
+            "OutputWait"
+        };
+        static_assert(std::size(names) == (size_t) ProfileStage::Count, "One name per stage");
+        return names[(size_t) stage];
+    }
+
+    // Record
+    //
+    // Adds one run of a stage that took the given number of cycles.  This is all the profiler does on the draw
+    // loop's time, so it's kept to a store and a few compares.
+
+    inline void Record(ProfileStage stage, uint32_t cycles)
+    {
+        StageData & data = _stages[(size_t) stage];
+        data.samples[data.count & (FRAME_PROFILER_HISTORY - 1)] = cycles;
+        data.count++;
+        data.totalCycles += cycles;
+        if (cycles < data.minCycles)
+            data.minCycles = cycles;
+        if (cycles > data.maxCycles)
+            data.maxCycles = cycles;
+    }
+
+    void Reset()
+    {
+        for (auto & data : _stages)
+        {
+            data.count       = 0;
+            data.minCycles   = UINT32_MAX;
+            data.maxCycles   = 0;
+            data.totalCycles = 0;
+        }
+    }
+
+    // GetStats
+    //
+    // Works out the numbers for one stage.  The p99 needs the recent samples in order, so we sort a copy of them
+    // here, on the caller's time rather than the draw loop's.
+
+    ProfileStats GetStats(ProfileStage stage) const
+    {
+        const StageData & data = _stages[(size_t) stage];
+        ProfileStats stats = { StageName(stage), data.count, 0, 0, 0, 0 };
+        if (data.count == 0)
+            return stats;
+
+        uint32_t samples[FRAME_PROFILER_HISTORY];
+        size_t   cSamples = std::min<uint32_t>(data.count, FRAME_PROFILER_HISTORY);
+        std::copy(data.samples, data.samples + cSamples, samples);
+
+        size_t iP99 = cSamples * 99 / 100;
+        std::nth_element(samples, samples + iP99, samples + cSamples);
+
+        const float cyclesPerMicrosecond = CyclesPerMicrosecond();
+        stats.minUs = data.minCycles / cyclesPerMicrosecond;
+        stats.avgUs = data.totalCycles / (float) data.count / cyclesPerMicrosecond;
+        stats.p99Us = samples[iP99] / cyclesPerMicrosecond;
+        stats.maxUs = data.maxCycles / cyclesPerMicrosecond;
+        return stats;
+    }
+};
+
+// ProfileScope
+//
+// Times from its construction to the end of the enclosing block, and records that against its stage
+
+class ProfileScope
+{
+    FrameProfiler &     _profiler;
+    const ProfileStage  _stage;
+    const uint32_t      _start;
+
+  public:
+
+    ProfileScope(FrameProfiler & profiler, ProfileStage stage)
+        : _profiler(profiler), _stage(stage), _start(FrameProfiler::Cycles())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        _profiler.Record(_stage, FrameProfiler::Cycles() - _start);
+    }
+};
+
+#if ENABLE_FRAME_PROFILER
+    extern FrameProfiler g_FrameProfiler;
+
+    #define PROFILE_CONCAT_(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+    #define PROFILE_STAGE(stage) ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(g_FrameProfiler, ProfileStage::stage)
+#else
+    #define PROFILE_STAGE(stage)
+#endif
@@ -64,9 +64,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include "Adafruit_GFX.h"
 #include "pixeltypes.h"
+#include "ledlayout.h"
+#include "spankernels.h"
+#include "blurkernels.h"
+
+// DeviceLayout
+//
+// The layout GFXBase::xy looks pixels up in.  Every device is MATRIX_WIDTH by MATRIX_HEIGHT.
+
+using DeviceLayout = LayoutTable<DEVICE_LAYOUT>;
+
+static_assert(DeviceLayout::Width == MATRIX_WIDTH && DeviceLayout::Height == MATRIX_HEIGHT, "DEVICE_LAYOUT must be MATRIX_WIDTH by MATRIX_HEIGHT");
 
 #if USE_MATRIX
     typedef struct 
@@ -124,10 +138,65 @@ public:
     uint8_t   _eNs_noisesmooth = 0;
     bool      _eNs_isSetupped = false;
 
+protected:
+
+    // How a frame off the wire, a row at a time, maps onto our pixels:  as is, through _wireGather (which says
+    // which wire pixel lands on each of ours, or NoWirePixel for none), or failing that, by calling setPixel for
+    // every pixel as we always used to
+
+    enum class WireLayout : uint8_t { Unknown, Direct, Gather, PerPixel };
+
+    static constexpr uint16_t    NoWirePixel = 0xFFFF;
+    WireLayout                   _wireLayout = WireLayout::Unknown;
+    std::unique_ptr<uint16_t []> _wireGather;
+
+    // GetWireLayout
+    //
+    // Works out the wire layout the first time it's needed, so that a device that never gets a frame over WiFi
+    // never builds the table.  Pixels are visited in the same order fillLeds used to set them, so if xy() ever
+    // maps two to the same LED, the same one still wins.
+
+    WireLayout GetWireLayout()
+    {
+        if (_wireLayout != WireLayout::Unknown)
+            return _wireLayout;
+
+        const size_t count = _width * _height;
+
+        if (DeviceLayout::IsRowMajor)
+            return _wireLayout = WireLayout::Direct;
+
+        if (count >= NoWirePixel)
+            return _wireLayout = WireLayout::PerPixel;
+
+        _wireGather.reset(new (std::nothrow) uint16_t[count]);
+        if (!_wireGather)
+        {
+            debugW("No memory for the wire layout table, so frames will be copied a pixel at a time");
+            return _wireLayout = WireLayout::PerPixel;
+        }
+
+        std::fill_n(_wireGather.get(), count, NoWirePixel);
+        for (size_t x = 0; x < _width; x++)
+        {
+            for (size_t y = 0; y < _height; y++)
+            {
+                size_t i = xy(x, y);
+                if (i < count)
+                    _wireGather[i] = y * _width + x;
+            }
+        }
+        return _wireLayout = WireLayout::Gather;
+    }
+
+public:
+
     GFXBase(int w, int h) : Adafruit_GFX(w, h),
                             _width(w),
                             _height(h)
     {
+        if (w != DeviceLayout::Width || h != DeviceLayout::Height)
+            throw std::runtime_error("GFXBase must be MATRIX_WIDTH by MATRIX_HEIGHT to match DEVICE_LAYOUT");
     }
 
     virtual ~GFXBase()
@@ -207,6 +276,127 @@ public:
         memset(leds, 0, sizeof(CRGB) * _width * _height);
     }
 
+    // Span operations
+    //
+    // Scale, fade, fill, add to or blend into count pixels of leds from start, in the order they are along the
+    // wire, a word at a time through SpanKernels rather than a pixel at a time through setPixel.  Whatever falls
+    // past the end of leds is left out.
+
+    bool ClipSpan(size_t & start, size_t & count) const
+    {
+        const size_t total = _width * _height;
+        if (start >= total)
+            return false;
+        count = std::min(count, total - start);
+        return count > 0;
+    }
+
+    void ScaleSpan(size_t start, size_t count, uint8_t scale)
+    {
+        if (ClipSpan(start, count))
+            SpanKernels::Scale(leds[start].raw, count, scale);
+    }
+
+    void FadeSpan(size_t start, size_t count, uint8_t fadeBy)
+    {
+        ScaleSpan(start, count, 255 - fadeBy);
+    }
+
+    void FillSpan(size_t start, size_t count, CRGB color)
+    {
+        if (ClipSpan(start, count))
+            SpanKernels::Fill(leds[start].raw, count, color.raw);
+    }
+
+    void AddSpan(size_t start, size_t count, CRGB color)
+    {
+        if (ClipSpan(start, count))
+            SpanKernels::Add(leds[start].raw, count, color.raw);
+    }
+
+    void BlendSpan(size_t start, size_t count, CRGB color, fract8 amount)
+    {
+        if (ClipSpan(start, count))
+            SpanKernels::Blend(leds[start].raw, count, color.raw, amount);
+    }
+
+    // ForEachSpanInRectangle
+    //
+    // Calls fn(start, count) for each run of pixels that sit next to each other along the wire, between them
+    // covering x0 <= x < x1 and y0 <= y < y1 clipped to the matrix.  A row-major matrix has a run for each row.
+    // Other layouts are walked down the columns if that's the way the wire runs, as it does for zig-zagged strips,
+    // or across the rows if not, and get runs wherever pixels happen to line up.
+
+    template <typename Fn>
+    void ForEachSpanInRectangle(int x0, int y0, int x1, int y1, Fn fn) const
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, (int) _width);
+        y1 = std::min(y1, (int) _height);
+        if (x0 >= x1 || y0 >= y1)
+            return;
+
+        if constexpr (DeviceLayout::IsRowMajor)
+        {
+            for (int y = y0; y < y1; y++)
+                fn(xy(x0, y), x1 - x0);
+            return;
+        }
+
+        size_t runStart = 0, runEnd = 0;
+        auto visit = [&](size_t i)
+        {
+            if (runEnd > runStart && i == runEnd)
+                runEnd++;
+            else if (runEnd > runStart && i + 1 == runStart)
+                runStart--;
+            else
+            {
+                if (runEnd > runStart)
+                    fn(runStart, runEnd - runStart);
+                runStart = i;
+                runEnd   = i + 1;
+            }
+        };
+
+        const bool bDown = _height > 1 && (xy(0, 1) == xy(0, 0) + 1 || xy(0, 1) + 1 == xy(0, 0));
+        if (bDown)
+        {
+            for (int x = x0; x < x1; x++)
+                for (int y = y0; y < y1; y++)
+                    visit(xy(x, y));
+        }
+        else
+        {
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++)
+                    visit(xy(x, y));
+        }
+        if (runEnd > runStart)
+            fn(runStart, runEnd - runStart);
+    }
+
+    void ScaleRectangle(int x0, int y0, int x1, int y1, uint8_t scale)
+    {
+        ForEachSpanInRectangle(x0, y0, x1, y1, [&](size_t start, size_t count) { ScaleSpan(start, count, scale); });
+    }
+
+    void FadeRectangle(int x0, int y0, int x1, int y1, uint8_t fadeBy)
+    {
+        ScaleRectangle(x0, y0, x1, y1, 255 - fadeBy);
+    }
+
+    void AddRectangle(int x0, int y0, int x1, int y1, CRGB color)
+    {
+        ForEachSpanInRectangle(x0, y0, x1, y1, [&](size_t start, size_t count) { AddSpan(start, count, color); });
+    }
+
+    void BlendRectangle(int x0, int y0, int x1, int y1, CRGB color, fract8 amount)
+    {
+        ForEachSpanInRectangle(x0, y0, x1, y1, [&](size_t start, size_t count) { BlendSpan(start, count, color, amount); });
+    }
+
     // Matrices that are built from individually addressable strips like WS2812b generally
     // follow a boustrophodon layout as follows:
     // 
@@ -224,27 +414,28 @@ public:
     //     |
     //    15 > 16 > 17 > 18 > 19
 
-    inline virtual uint16_t xy(uint16_t x, uint16_t y) const
+    // xy
+    //
+    // Where x, y is in leds, for whatever the layout is (see DEVICE_LAYOUT).  It isn't virtual, and the layout is
+    // worked out when we're compiled, so drawing code calling it for every pixel costs no more than indexing a
+    // table.
+
+    inline uint16_t xy(uint16_t x, uint16_t y) const
     {
-        if (x & 0x01)
-        {
-            // Odd rows run backwards
-            uint8_t reverseY = (_height - 1) - y;
-            return (x * _height) + reverseY;
-        }
-        else
-        {
-            // Even rows run forwards
-            return (x * _height) + y;
-        }
+        return DeviceLayout::XY(x, y);
     }
 
+    // getPixel
+    //
+    // Only checks the pixel is there with CHECKED_PIXEL_ACCESS (see globals.h)
+
     virtual CRGB getPixel(int16_t i) const 
     {
-        if (i >= 0 && i < _width * _height)
-            return leds[i];
-        else
-            throw std::runtime_error("Pixel out of range in getPixel(x)");
+        #if CHECKED_PIXEL_ACCESS
+            if (i < 0 || i >= _width * _height)
+                throw std::runtime_error("Pixel out of range in getPixel(x)");
+        #endif
+        return leds[i];
     }
 
     virtual void addColor(int16_t i, CRGB c)
@@ -255,11 +446,11 @@ public:
 
     inline virtual CRGB getPixel(int16_t x, int16_t y) const
     {
-        if (x >= 0 && x < _width && y >= 0 && y < _height)
-            return getPixel(xy(x, y));
-        else
-            throw std::runtime_error("Pixel out of range in getPixel(x,y)");
-
+        #if CHECKED_PIXEL_ACCESS
+            if (x < 0 || x >= _width || y < 0 || y >= _height)
+                throw std::runtime_error("Pixel out of range in getPixel(x,y)");
+        #endif
+        return getPixel(xy(x, y));
     }
 
     inline virtual void drawPixel(int16_t x, int16_t y, CRGB color)
@@ -274,18 +465,94 @@ public:
         //setPixel(x, y, color);
     }
 
+    // IsWireLayout
+    //
+    // Whether our pixels are laid out as they come off the wire, a row at a time, so a frame can be used as is
+
+    bool IsWireLayout()
+    {
+        return GetWireLayout() == WireLayout::Direct;
+    }
+
     inline virtual void fillLeds(const CRGB *pLEDs)
     {
-        // A mesmerizer panel has the same layout as in memory, so we can memcpy.  Others may require transposition,
-        // so we do it the "slow" way for other matrices
+        // A frame in the same layout as ours (a mesmerizer panel, or any plain strip) is a memcpy.  Others need
+        // rearranging, which is a gather through the table GetWireLayout builds.
 
-        #if MESMERIZER
-            memcpy(leds, pLEDs, sizeof(CRGB) * _width * _height);
-        #else
-            for (int x=0; x < _width; x++)
-                for (int y = 0; y < _height; y++)
-                    setPixel(x, y, pLEDs[y * _width + x]);
-        #endif
+        const size_t count = _width * _height;
+        switch (GetWireLayout())
+        {
+            case WireLayout::Direct:
+                memcpy(leds, pLEDs, sizeof(CRGB) * count);
+                break;
+
+            case WireLayout::Gather:
+                for (size_t i = 0; i < count; i++)
+                    if (_wireGather[i] != NoWirePixel)
+                        leds[i] = pLEDs[_wireGather[i]];
+                break;
+
+            default:
+                for (int x=0; x < _width; x++)
+                    for (int y = 0; y < _height; y++)
+                        setPixel(x, y, pLEDs[y * _width + x]);
+                break;
+        }
+    }
+
+    // BlendPixel
+    //
+    // Mixes weight/256ths of b with the rest of a, so a weight of 256 gives exactly b
+
+    static inline CRGB BlendPixel(const CRGB & a, const CRGB & b, uint16_t weight)
+    {
+        const uint16_t inverse = 256 - weight;
+        return CRGB((a.r * inverse + b.r * weight) >> 8,
+                    (a.g * inverse + b.g * weight) >> 8,
+                    (a.b * inverse + b.b * weight) >> 8);
+    }
+
+    // BlendLeds
+    //
+    // BlendPixel over a whole run of pixels, reading both sources and writing the output in a single pass.  It
+    // works on bytes rather than CRGBs, so the loop has no per-channel shuffling for the compiler to undo.
+
+    static inline void BlendLeds(CRGB * pOut, const CRGB * pA, const CRGB * pB, size_t count, uint16_t weight)
+    {
+        const uint16_t inverse = 256 - weight;
+        uint8_t       * pDest = reinterpret_cast<uint8_t *>(pOut);
+        const uint8_t * pSrcA = reinterpret_cast<const uint8_t *>(pA);
+        const uint8_t * pSrcB = reinterpret_cast<const uint8_t *>(pB);
+
+        for (size_t i = 0; i < count * sizeof(CRGB); i++)
+            pDest[i] = (pSrcA[i] * inverse + pSrcB[i] * weight) >> 8;
+    }
+
+    // fillLedsBlended
+    //
+    // Like fillLeds, but shows a blend of two frames, without first copying either of them anywhere
+
+    inline virtual void fillLedsBlended(const CRGB *pA, const CRGB *pB, uint16_t weight)
+    {
+        const size_t count = _width * _height;
+        switch (GetWireLayout())
+        {
+            case WireLayout::Direct:
+                BlendLeds(leds, pA, pB, count, weight);
+                break;
+
+            case WireLayout::Gather:
+                for (size_t i = 0; i < count; i++)
+                    if (_wireGather[i] != NoWirePixel)
+                        leds[i] = BlendPixel(pA[_wireGather[i]], pB[_wireGather[i]], weight);
+                break;
+
+            default:
+                for (int x=0; x < _width; x++)
+                    for (int y = 0; y < _height; y++)
+                        setPixel(x, y, BlendPixel(pA[y * _width + x], pB[y * _width + x], weight));
+                break;
+        }
     }
 
     virtual inline void setPixel(int16_t x, int16_t y, uint16_t color)
@@ -309,15 +576,25 @@ public:
     // Adafruit_GFX overrride
     virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
     {
-        for (int p = y; p < y + h; p++)
-            setPixel(x, p, color);
+        fillRectangle(x, y, x + 1, y + h, from16Bit(color));
     }
 
     // Adafruit_GFX overrride
     virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
     {
-        for (int p = x; p < x + w; p++)
-            setPixel(p, y, color);
+        fillRectangle(x, y, x + w, y + 1, from16Bit(color));
+    }
+
+    // Adafruit_GFX overrride
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        fillRectangle(x, y, x + w, y + h, from16Bit(color));
+    }
+
+    // Adafruit_GFX overrride
+    virtual void fillScreen(uint16_t color)
+    {
+        FillSpan(0, _width * _height, from16Bit(color));
     }
 
     inline virtual void setPixel(int16_t x, int r, int g, int b)
@@ -347,65 +624,80 @@ public:
     //   We fill one pixel and advance to next pixel
     //   We are now at pixel 5, frac2 = .75
     //   We fill pixel with .75 worth of color
+    //
+    // Where the pixels go and how much of the color each end gets are worked out once, by FractionalSpan (see
+    // spankernels.h), rather than pixel by pixel.
 
     inline void setPixelsF(float fPos, float count, CRGB c, bool bMerge = false)
     {
-        float frac1 = fPos - floor(fPos);                 // eg:   3.25 becomes 0.25
-        float frac2 = fPos + count - floor(fPos + count); // eg:   3.25 + 1.5 yields 4.75 which becomes 0.75
-
-        /* Example:
+        DrawFractionalSpan(FractionalSpan(fPos, count), c, bMerge);
+    }
 
-          Starting at 3.25, draw for 1.5:
-          We start at pixel 3.
-          We fill pixel with .75 worth of color
-          We advance to next pixel
+    // DrawFractionalSpan
+    //
+    // Draws span in c, merging it with what's there if bMerge.  The partial pixels at each end are done on their
+    // own and the whole ones between them in one go, clipped once to our LEDs.
 
-          We fill one pixel and advance to next pixel
+    inline void DrawFractionalSpan(const FractionalSpan & span, CRGB c, bool bMerge)
+    {
+        const int32_t cLEDs = GetLEDCount();
 
-          We are now at pixel 5, frac2 = .75
-          We fill pixel with .75 worth of color
-        */
+        // SpanKernels has to line up with the words before it can do any of them.  tools/fractionalbench.cpp finds
+        // that costs more than it saves on runs shorter than this, which most spans are.
 
-        uint8_t fade1 = (std::max(frac1, 1.0f - count)) * 255; // Fraction is how far past pixel boundary we are (up to our total size) so larger fraction is more dimming
-        uint8_t fade2 = (1.0 - frac2) * 255;                   // Fraction is how far we are poking into this pixel, so larger fraction is less dimming
-        CRGB c1 = c;
-        CRGB c2 = c;
-        c1 = c1.fadeToBlackBy(fade1);
-        c2 = c2.fadeToBlackBy(fade2);
+        constexpr int32_t cMinKernelSpan = 32;
 
-        // These assignments use the + operator of CRGB to merge the colors when requested, and its pretty
-        // naive, just saturating each color element at 255, so the operator could be improved or replaced
-        // if needed...
+        // These use the + operator of CRGB to merge the colors when requested, which just saturates each
+        // color element at 255
 
-        float p = fPos;
-        if (p >= 0 && p < GetLEDCount())
-            for (int i = 0; i < NUM_CHANNELS; i++)
-                leds[(int)p] = bMerge ? leds[(int)p] + c1 : c1;
-                
-        p = fPos + (1.0 - frac1);
-        count -= (1.0 - frac1);
+        auto drawPartial = [&](int32_t i, uint8_t fade)
+        {
+            if (i >= 0 && i < cLEDs)
+            {
+                CRGB part = CRGB(c).fadeToBlackBy(fade);
+                leds[i] = bMerge ? leds[i] + part : part;
+            }
+        };
 
-        // Middle (body) pixels
+        drawPartial(span.head, span.headFade);
 
-        while (count >= 1)
+        int32_t start = span.head + 1;
+        int32_t count = span.bodyCount;
+        if (start < 0)
         {
-            if (p >= 0 && p < GetLEDCount())
-                for (int i = 0; i < NUM_CHANNELS; i++)
-                    leds[(int)p] = bMerge ? leds[(int)p] + c : c;
-            count--;
-            p++;
-        };
+            count += start;
+            start = 0;
+        }
+        count = std::min(count, cLEDs - start);
+        if (count >= cMinKernelSpan)
+        {
+            if (bMerge)
+                SpanKernels::Add(leds[start].raw, count, c.raw);
+            else
+                SpanKernels::Fill(leds[start].raw, count, c.raw);
+        }
+        else if (bMerge)
+        {
+            for (CRGB * p = leds + start; count > 0; count--)
+                *p++ += c;
+        }
+        else if (count > 0)
+        {
+            std::fill_n(leds + start, count, c);
+        }
 
-        // Final pixel, if in bounds
-        if (count > 0)
-            if (p >= 0 && p < GetLEDCount())
-                for (int i = 0; i < NUM_CHANNELS; i++)
-                    leds[(int)p] = bMerge ? leds[(int)p] + c2 : c2;
+        if (span.bTail)
+            drawPartial(span.head + 1 + span.bodyCount, span.tailFade);
     }
 
+    // blurRows: perform a blur1d on each row of a rectangular matrix.  When the rows are laid out one after the
+    // other, BlurKernels does them several bytes at a time, with exactly the same result.
 
     inline void blurRows(CRGB *leds, uint8_t width, uint8_t height, uint8_t first, fract8 blur_amount)
     {
+        if (DeviceLayout::IsRowMajor && BlurKernels::Rows(reinterpret_cast<uint8_t *>(leds), DeviceLayout::Width, width, height, first, blur_amount))
+            return;
+
         // blur rows same as columns, for irregular matrix
         uint8_t keep = 255 - blur_amount;
         uint8_t seep = blur_amount >> 1;
@@ -427,9 +719,12 @@ public:
         }
     }
 
-    // blurColumns: perform a blur1d on each column of a rectangular matrix
+    // blurColumns: perform a blur1d on each column of a rectangular matrix, through BlurKernels as blurRows does
     inline void blurColumns(CRGB *leds, uint8_t width, uint8_t height, uint8_t first, fract8 blur_amount)
     {
+        if (DeviceLayout::IsRowMajor && BlurKernels::Columns(reinterpret_cast<uint8_t *>(leds), DeviceLayout::Width, width, height, first, blur_amount))
+            return;
+
         // blur columns
         uint8_t keep = 255 - blur_amount;
         uint8_t seep = blur_amount >> 1;
@@ -536,9 +831,7 @@ public:
 
     void fillRectangle(int x0, int y0, int x1, int y1, CRGB color)
     {
-        for (int x = x0; x < x1; x++)
-            for (int y = y0; y < y1; y++)
-                drawPixel(x, y, color);
+        ForEachSpanInRectangle(x0, y0, x1, y1, [&](size_t start, size_t count) { FillSpan(start, count, color); });
     }
 
     void setPalette(CRGBPalette16 palette)
@@ -1140,11 +1433,7 @@ public:
 
     void DimAll(uint8_t value)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            // if ((leds[i].r != 255) || (leds[i].g != 255) || (leds[i].b != 255))           // Don't dim pure white
-            leds[i].nscale8(value);
-        }
+        ScaleSpan(0, NUM_LEDS, value);
     } 
     // write one pixel with the specified color from the current palette to coordinates
     /*
@@ -126,6 +126,10 @@
     #endif
 #endif
 
+#if USE_MATRIX && USESTRIP          // Every channel has to be the same kind of DeviceGFX (see below)
+    #error USE_MATRIX and USESTRIP can't both be set
+#endif
+
 #define XSTR(x) STR(x)              // The defs will generate the stringized version of it
 #if FLASH_VERSION > 99
     #define STR(x) "v"#x
@@ -177,6 +181,7 @@
 // Idle tasks in taskmgr run at IDLE_PRIORITY+1 so you want to be at least +2 
 
 #define DRAWING_PRIORITY        tskIDLE_PRIORITY+7
+#define OUTPUT_PRIORITY         tskIDLE_PRIORITY+7      // Only used with PIPELINED_OUTPUT, and mostly waits on the RMT
 #define SOCKET_PRIORITY         tskIDLE_PRIORITY+6
 #define AUDIOSERIAL_PRIORITY    tskIDLE_PRIORITY+5      // If equal or lower than audio, will produce garbage on serial
 #define NET_PRIORITY            tskIDLE_PRIORITY+4
@@ -201,6 +206,7 @@
 // Drawing must be on Core 1 if using SmartMatrix unless you specify SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1
 
 #define DRAWING_CORE            1  
+#define OUTPUT_CORE             0
 #define NET_CORE                0
 #define AUDIO_CORE              0
 #define AUDIOSERIAL_CORE        1
@@ -1248,6 +1254,94 @@ extern RemoteDebug Debug;           // Let everyone in the project know about it
 #define ENABLE_REMOTE 0
 #endif
 
+// WiFi frame interpolation
+//
+// When two WiFi frames bracket the current time, WIFI_FRAME_INTERPOLATION has the draw loop show a blend of the
+// two, weighted by how far we are between their timestamps, and keep refreshing it at WIFI_INTERPOLATION_FPS
+// until the later one is due.  A sender can then run at a fraction of the display rate and still look smooth.
+
+#ifndef WIFI_FRAME_INTERPOLATION
+#define WIFI_FRAME_INTERPOLATION 0
+#endif
+
+#ifndef WIFI_INTERPOLATION_FPS
+#define WIFI_INTERPOLATION_FPS 60
+#endif
+
+// Device layout
+//
+// How x and y map onto where each pixel is along the wire, as one of the layouts in ledlayout.h, covering
+// MATRIX_WIDTH by MATRIX_HEIGHT.  HUB75 matrices are row-major, and strips zig-zag a column at a time (which for a
+// strip one pixel tall is the same thing).  A project wired some other way, such as panels tiled or turned on their
+// side, can set its own, for example TiledLayout<SerpentineRowLayout<16, 16>, 4, 2> for eight 16x16 panels.
+
+#ifndef DEVICE_LAYOUT
+    #if USE_MATRIX
+        #define DEVICE_LAYOUT RowMajorLayout<MATRIX_WIDTH, MATRIX_HEIGHT>
+    #else
+        #define DEVICE_LAYOUT SerpentineColumnLayout<MATRIX_WIDTH, MATRIX_HEIGHT>
+    #endif
+#endif
+
+// Pipelined output
+//
+// With PIPELINED_OUTPUT, strips get a second set of LED buffers and an output task on OUTPUT_CORE.  The draw task
+// hands each finished frame over to it and goes straight on to drawing the next one into the other set, rather
+// than waiting out FastLED.show() itself.  That costs another NUM_LEDS worth of CRGB per channel.
+
+#ifndef PIPELINED_OUTPUT
+#define PIPELINED_OUTPUT 0
+#endif
+
+#if PIPELINED_OUTPUT && !USESTRIP
+#error PIPELINED_OUTPUT is only for strips; matrices already show one buffer while the next is drawn
+#endif
+
+// Zero-copy WiFi frames
+//
+// With ZERO_COPY_WIFI, a WiFi frame that's already laid out the way a strip's LEDs are (a plain strip always is)
+// isn't copied into the strip's buffer at all:  FastLED is pointed straight at the LEDBuffer it arrived in, and
+// the LEDBuffer is held in its ring until the strip has been shown.  While it's held, a full ring loses the new
+// frame rather than the oldest.  Matrices can't do this, since SmartMatrix owns its buffers, but every build
+// copies a frame in one memcpy (or one gather through a table, if the layout differs) rather than pixel by pixel.
+// The pipelined output task shows from its own front buffer, and PSRAM is too slow for the RMT to read from.
+
+#ifndef ZERO_COPY_WIFI
+#define ZERO_COPY_WIFI 0
+#endif
+
+#if ZERO_COPY_WIFI && (!USESTRIP || PIPELINED_OUTPUT || USE_PSRAM)
+#error ZERO_COPY_WIFI is only for strips without PIPELINED_OUTPUT or USE_PSRAM
+#endif
+
+// Checked pixel access
+//
+// getPixel throws if asked for a pixel that isn't there, which is worth knowing while writing an effect, but costs
+// a compare or two on every read, and for strips the code to format the message.  No shipping effect reads off the
+// edge, since the throw would reboot us, so normal builds just index leds and CHECKED_PIXEL_ACCESS puts the checks
+// back for debugging.  Writes off the edge are clipped either way, as effects draw there on purpose.
+
+#ifndef CHECKED_PIXEL_ACCESS
+#define CHECKED_PIXEL_ACCESS 0
+#endif
+
+// Skipping unchanged frames
+//
+// With SKIP_UNCHANGED_FRAMES, ShowStrip hashes each frame and doesn't send it to the strip (or work out its power
+// draw) if it's the same as the last one sent, which static fills and slow effects do a lot.  The LEDs hold what
+// they were last sent anyway, but we still send the frame at least every SKIP_UNCHANGED_REFRESH_MS in case a
+// glitch on the data line left any of them wrong.  While the strip isn't being refreshed, FastLED's dithering
+// can't move, so a frame dimmed by the fader or brightness may look very slightly different held than it did
+// when it was being sent over and over.
+
+#ifndef SKIP_UNCHANGED_FRAMES
+#define SKIP_UNCHANGED_FRAMES 0
+#endif
+
+#ifndef SKIP_UNCHANGED_REFRESH_MS
+#define SKIP_UNCHANGED_REFRESH_MS 1000
+#endif
+
 // Power Limit
 //
 // The limit, in watts, that the power supply for your project can supply.  If your demands
@@ -1406,6 +1500,11 @@ extern DRAM_ATTR const int g_aRingSizeTable[];
 
 #define WIFI_COMMAND_PIXELDATA64 3             // Wifi command with color data and 64-bit clock vals 
 #define WIFI_COMMAND_PEAKDATA    4             // Wifi command that delivers audio peaks
+#define WIFI_COMMAND_PIXELDELTA64 5            // Wifi command with XOR/RLE color changes against the previous frame
+#define WIFI_COMMAND_PIXELBATCH64 6            // Wifi command with several PIXELDATA64 frames in one packet
+#define WIFI_COMMAND_RGB565DATA64 7            // Wifi command with 16-bit 5:6:5 color data
+#define WIFI_COMMAND_PALETTEDATA64 8           // Wifi command with a palette and 8-bit palette indices
+#define WIFI_COMMAND_RESPONSEVERSION 9         // Wifi command asking for a newer SocketResponse, version in length32
 
 // Final headers
 // 
@@ -1550,16 +1649,19 @@ inline void * PreferPSRAMAlloc(size_t s)
     }
 }
 
+#include "timebase.h"
+
 // AppTime
 //
-// A class that keeps track of the clock, how long the last frame took, calculating FPS, etc.
+// A class that keeps track of the clock, how long the last frame took, calculating FPS, etc.  Frames are timed
+// in Timebase's monotonic microseconds, so the clock being set by NTP never makes a frame look long or short.
 
 class AppTime
 {
   protected:
 
-    float _lastFrame;
-    float _deltaTime;
+    uint64_t _usLastFrame;
+    float    _deltaTime;
   
   public:
 
@@ -1570,47 +1672,50 @@ class AppTime
 
     void NewFrame()
     {
-        timeval tv;
-        gettimeofday(&tv, nullptr);
-        float current = CurrentTime();
-        _deltaTime = current - _lastFrame;
+        uint64_t usCurrent = Timebase::MonotonicMicros();
+        _deltaTime = Timebase::SecondsBetween(_usLastFrame, usCurrent);
 
         // Cap the delta time at one full second
 
         if (_deltaTime > 1.0f)
             _deltaTime = 1.0f;
 
-        _lastFrame = current;
+        _usLastFrame = usCurrent;
     }
 
-    AppTime() : _lastFrame(CurrentTime())
+    AppTime() : _usLastFrame(Timebase::MonotonicMicros())
     {
+        Timebase::SyncToSystemClock();
         NewFrame();
     }
 
-    float FrameStartTime() const
-    {
-        return _lastFrame;
-    }
+    // FrameStartMicros
+    //
+    // Monotonic microseconds (see Timebase) at the start of the current frame
 
-    static float CurrentTime()
+    uint64_t FrameStartMicros() const
     {
-        timeval tv;
-        gettimeofday(&tv, nullptr);
-        return tv.tv_sec + (tv.tv_usec/(float)MICROS_PER_SECOND);
+        return _usLastFrame;
     }
 
-    static float TimeFromTimeval(const timeval & tv)
+    // FrameStartTime
+    //
+    // Seconds since boot at the start of the current frame.  Effects only ever subtract these, and counting from
+    // boot rather than from 1970 keeps a float precise to a few milliseconds even after a day of running.
+
+    float FrameStartTime() const
     {
-        return tv.tv_sec + (tv.tv_usec/(float)MICROS_PER_SECOND);
+        return _usLastFrame / (float) MICROS_PER_SECOND;
     }
 
-    static timeval TimevalFromTime(float t)
+    // CurrentTime
+    //
+    // Wall clock seconds since 1970, for display and for senders.  Anything compared against frame timestamps
+    // should use Timebase::WallMicros instead.
+
+    static double CurrentTime()
     {
-        timeval tv;
-        tv.tv_sec = (long)t;
-        tv.tv_usec = t - tv.tv_sec;
-        return tv;
+        return Timebase::WallMicros() / (double) MICROS_PER_SECOND;
     }
 
     float DeltaTime() const
@@ -1633,7 +1738,7 @@ inline float mapfloat(float x, float in_min, float in_max, float out_min, float
 {
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
-inline uint64_t ULONGFromMemory(uint8_t * payloadData)
+inline uint64_t ULONGFromMemory(const uint8_t * payloadData)
 {
     return  (uint64_t)payloadData[7] << 56  | 
             (uint64_t)payloadData[6] << 48  | 
@@ -1645,7 +1750,7 @@ inline uint64_t ULONGFromMemory(uint8_t * payloadData)
             (uint64_t)payloadData[0];
 }
 
-inline uint32_t DWORDFromMemory(uint8_t * payloadData)
+inline uint32_t DWORDFromMemory(const uint8_t * payloadData)
 {
     return  (uint32_t)payloadData[3] << 24  | 
             (uint32_t)payloadData[2] << 16  | 
@@ -1653,7 +1758,7 @@ inline uint32_t DWORDFromMemory(uint8_t * payloadData)
             (uint32_t)payloadData[0];
 }
 
-inline uint16_t WORDFromMemory(uint8_t * payloadData)
+inline uint16_t WORDFromMemory(const uint8_t * payloadData)
 {
     return  (uint16_t)payloadData[1] << 8   | 
             (uint16_t)payloadData[0];
@@ -1691,17 +1796,34 @@ inline bool CheckBlueBuffer(CRGB * prgb, size_t count)
 
 #include <TJpg_Decoder.h>
 #include "improvserial.h"                       // ImprovSerial impl for setting WiFi credentials over the serial port
+#include "frameprofiler.h"                      // Per-stage timing of the draw loop
+#include "ledlayout.h"                          // Compile-time x, y to pixel index tables
 #include "gfxbase.h"                            // GFXBase drawing interface
 #include "screen.h"                             // LCD/TFT/OLED handling
 #include "socketserver.h"                       // Incoming WiFi data connections
 #include "soundanalyzer.h"                      // for audio sound processing
 #include "ledstripgfx.h"                        // Essential drawing code for strips
 #include "ledmatrixgfx.h"                       // For drawing to HUB75 matrices
+
+// DeviceGFX
+//
+// The GFXBase every channel of this build really is.  Both are final, so the compiler can call their pixel
+// functions directly (and inline them) through a DeviceGFX, where through a GFXBase it has to go via the vtable.
+
+#if USE_MATRIX
+    using DeviceGFX = LEDMatrixGFX;
+#else
+    using DeviceGFX = LEDStripGFX;
+#endif
+
 #include "ledstripeffect.h"                     // Defines base led effect classes
 #include "ntptimeclient.h"                      // setting the system clock from ntp
 #include "effectmanager.h"                      // For g_EffectManagerf
 #include "network.h"                            // Networking 
 #include "ledbuffer.h"                          // Buffer manager for strip
+#include "framepacer.h"                         // Frame deadlines for the draw loop
+#include "framehandoff.h"                       // Draw task to output task, for PIPELINED_OUTPUT
+#include "powerestimator.h"                     // Power draw and limiting for strips
 #include "Bounce2.h"                            // For Bounce button class
 #include "colordata.h"                          // color palettes
 #include "drawing.h"                            // drawing code
@@ -36,6 +36,11 @@
 #include <pixeltypes.h>
 #include <memory>
 #include <iostream>
+#include <mutex>
+#include "spscring.h"
+#include "telemetry.h"
+#include "timebase.h"
+#include "ntptimeclient.h"
 
 extern DRAM_ATTR AppTime g_AppTime;                       
 
@@ -106,31 +111,73 @@ class LEDBuffer
 {
   public:
   
-     std::shared_ptr<GFXBase> _pStrand;
+     std::shared_ptr<DeviceGFX> _pStrand;
+
+     // Size of the PIXELDATA64 header on the wire: command, channel, length, seconds, micros
+
+     static constexpr size_t cbWireHeader = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t);
+
+     // A PIXELDELTA64 packet has the same header, except length32 is the number of bytes of span data, and it's
+     // followed by the seconds and micros of the frame the delta was made against.  Each span after that is a
+     // 16-bit count of unchanged pixels to skip, a 16-bit count of changed pixels, and that many CRGBs that are
+     // XORed into the base frame.
+
+     static constexpr size_t cbDeltaHeader = cbWireHeader + sizeof(uint64_t) + sizeof(uint64_t);
+     static constexpr size_t cbDeltaSpanHeader = sizeof(uint16_t) + sizeof(uint16_t);
+
+     // RGB565DATA64 and PALETTEDATA64 packets have the same header as PIXELDATA64 but carry their pixels more
+     // compactly: as 16-bit 5:6:5 values, or as a CRGBPalette16 followed by one 8-bit palette index per pixel.
+     // They're expanded to CRGBs as they're copied in.
+
+     static constexpr size_t cbPaletteData = 16 * sizeof(CRGB);
+
+    // PixelDataSize
+    //
+    // How many bytes follow the header for a packet of this kind with this many pixels
+
+    static size_t PixelDataSize(uint16_t command16, uint32_t pixelCount)
+    {
+        switch (command16)
+        {
+            case WIFI_COMMAND_RGB565DATA64:
+                return pixelCount * sizeof(uint16_t);
+            case WIFI_COMMAND_PALETTEDATA64:
+                return cbPaletteData + pixelCount;
+            default:
+                return pixelCount * sizeof(CRGB);
+        }
+    }
 
   private:
     
-    std::unique_ptr<CRGB []> _leds;
+    // The pixels live in _storage right behind room for one wire header, so the buffer has exactly the layout
+    // of a PIXELDATA64 packet and a frame can be inflated straight into it
+
+    std::unique_ptr<uint8_t []> _storage;
+    CRGB *              _leds;
     uint32_t            _pixelCount;
-    uint64_t            _timeStampMicroseconds;
-    uint64_t            _timeStampSeconds;
+    uint64_t            _usTimestamp;                   // Wall clock microseconds (see Timebase)
+    unsigned long       _usQueued = 0;                  // micros() when the LEDBufferManager handed it out
    
   public:
 
-    explicit LEDBuffer(std::shared_ptr<GFXBase> pStrand) : 
+    explicit LEDBuffer(std::shared_ptr<DeviceGFX> pStrand) : 
                  _pStrand(pStrand),
                  _pixelCount(0),
-                 _timeStampMicroseconds(0),
-                 _timeStampSeconds(0)
+                 _usTimestamp(0)
     {
+        // One spare byte at the end lets the socket server's inflater run to the end of its stream (see InflateInto)
+
+        const size_t cbStorage = cbWireHeader + NUM_LEDS * sizeof(CRGB) + 1;
+
         #if USE_PSRAM
-            //psram_allocator<CRGB []> alloc = psram_allocator<CRGB []>();
-            // _leds = psram_allocator<CRGB>().allocate(NUM_LEDS);
-            _leds.reset(psram_allocator<CRGB>().allocate(NUM_LEDS));
+            _storage.reset(psram_allocator<uint8_t>().allocate(cbStorage));
         #else
-            _leds = std::make_unique<CRGB []>(NUM_LEDS);
+            _storage = std::make_unique<uint8_t []>(cbStorage);
         #endif
 
+        _leds = reinterpret_cast<CRGB *>(&_storage[cbWireHeader]);
+
         for (int i = 0; i < NUM_LEDS; i++)
             _leds[i] = CRGB::Yellow;
     }
@@ -139,25 +186,43 @@ class LEDBuffer
     {
     }
 
-    uint64_t Seconds()      const  { return _timeStampSeconds;      }
-    uint64_t MicroSeconds() const  { return _timeStampMicroseconds; }
+    uint64_t Timestamp()    const  { return _usTimestamp;           }
     uint32_t Length()       const  { return _pixelCount;            }
 
-    bool IsBufferOlderThan(const timeval & tv) const
+    unsigned long QueuedMicros() const        { return _usQueued; }
+    void SetQueuedMicros(unsigned long us)    { _usQueued = us;   }
+
+    // WireStorage
+    //
+    // The raw header-plus-pixels storage, for callers that want to fill it directly (the socket server
+    // decompresses into it, for example) and then call UpdateFromWireStorage to pick up the header
+
+    uint8_t * WireStorage() const
     {
-        if (Seconds() < tv.tv_sec)
-            return true;
-        
-        if (Seconds() == tv.tv_sec)
-            if (MicroSeconds() < tv.tv_usec)
-                return true;
-        
-        return false;
+        return _storage.get();
     }
 
-    bool UpdateFromWire(uint8_t * payloadData, size_t payloadLength)
+    // Pixels
+    //
+    // Our pixels as they came off the wire, for a strand in the same layout to show directly (see ZERO_COPY_WIFI)
+
+    CRGB * Pixels() const
     {
-        if (payloadLength < 24)                 // Our header size
+        return _leds;
+    }
+
+    bool IsBufferOlderThan(uint64_t usWall) const
+    {
+        return _usTimestamp < usWall;
+    }
+
+    // ParseWireHeader
+    //
+    // Validates the header at the front of a PIXELDATA64 payload and takes its timestamp and length
+
+    bool ParseWireHeader(uint8_t * payloadData, size_t payloadLength)
+    {
+        if (payloadLength < cbWireHeader)       // Our header size
         {
             debugW("Not enough data received to process");
             return false;
@@ -178,38 +243,330 @@ class LEDBuffer
 
         //printf("UpdateFromWire -- Command: %u, Channel: %d, Length: %u, Seconds: %u, Micros: %u\n", command16, channel16, length32, seconds, micros);
 
-        const size_t cbHeader = sizeof(command16) + sizeof(channel16) + sizeof(length32) + sizeof(seconds) + sizeof(micros);
-
-        _timeStampSeconds      = seconds;
-        _timeStampMicroseconds = micros;
-        _pixelCount            = length32;
-
-        if (payloadLength < length32 * sizeof(CRGB) + cbHeader)
+        if (length32 > NUM_LEDS)
         {
-            debugW("command16: %d   length32: %d,  payloadLength: %d\n", command16, length32, payloadLength);
-            debugW("Data size mismatch");
+            debugW("More data than we have LEDs\n");
             return false;
         }
-        if (length32 > NUM_LEDS)
+        if (payloadLength < PixelDataSize(command16, length32) + cbWireHeader)
         {
-            debugW("More data than we have LEDs\n");
+            debugW("command16: %d   length32: %d,  payloadLength: %d\n", command16, length32, payloadLength);
+            debugW("Data size mismatch");
             return false;
         }
-        debugV("PayloadLength: %d, command16: %d, Length32: %d", payloadLength, command16, length32);
-        
-        CRGB * pRGB = reinterpret_cast<CRGB *>(&payloadData[cbHeader]);
 
-        memcpy((void *)_leds.get(), pRGB, length32 * sizeof(CRGB));
+        // Only once the frame is known to be good, so a bad one leaves a queued buffer as it was
+
+        _usTimestamp           = Timebase::FromWire(seconds, micros);
+        _pixelCount            = length32;
+
+        debugV("PayloadLength: %d, command16: %d, Length32: %d", payloadLength, command16, length32);
         debugV("seconds, micros: %llu.%llu", seconds, micros);
+        return true;
+    }
+
+    // UpdateFromWire
+    //
+    // Takes the timestamp and pixels from a PIXELDATA64, RGB565DATA64 or PALETTEDATA64 packet
+
+    bool UpdateFromWire(uint8_t * payloadData, size_t payloadLength)
+    {
+        if (!ParseWireHeader(payloadData, payloadLength))
+            return false;
+
+        const uint8_t * pPixelData = &payloadData[cbWireHeader];
+
+        switch (WORDFromMemory(payloadData))
+        {
+            case WIFI_COMMAND_RGB565DATA64:
+                ExpandRGB565(_leds, pPixelData, _pixelCount);
+                break;
+
+            case WIFI_COMMAND_PALETTEDATA64:
+                ExpandPaletteIndices(_leds, pPixelData, _pixelCount);
+                break;
+
+            default:
+                memcpy((void *)_leds, pPixelData, _pixelCount * sizeof(CRGB));
+                break;
+        }
         debugV("Color0: %08x", (uint32_t) _leds[0]);
         return true;
     }
 
+    // ExpandRGB565
+    //
+    // Expands little-endian 5:6:5 pixels straight into the LEDs, with the same gamma tables as GFXBase::from16Bit
+
+    static void ExpandRGB565(CRGB * pLeds, const uint8_t * pSource, size_t count)
+    {
+        for (size_t i = 0; i < count; i++, pSource += sizeof(uint16_t))
+            pLeds[i] = GFXBase::from16Bit(pSource[0] | pSource[1] << 8);
+    }
+
+    // ExpandPaletteIndices
+    //
+    // Expands palette indices straight into the LEDs.  Each index means what it would to ColorFromPalette with the
+    // CRGBPalette16 that comes first, but rather than blend per pixel we blend all 256 possible colors up front,
+    // so each pixel is a single table lookup.
+
+    static void ExpandPaletteIndices(CRGB * pLeds, const uint8_t * pSource, size_t count)
+    {
+        CRGBPalette16 palette;
+        memcpy((void *)palette.entries, pSource, cbPaletteData);
+        pSource += cbPaletteData;
+
+        CRGB colors[256];
+        for (int i = 0; i < 256; i++)
+            colors[i] = ColorFromPalette(palette, i, 255, LINEARBLEND);
+
+        for (size_t i = 0; i < count; i++)
+            pLeds[i] = colors[pSource[i]];
+    }
+
+    // UpdateFromWireStorage
+    //
+    // Like UpdateFromWire, but for when the packet has already been written into our own WireStorage,
+    // so there's nothing to copy
+
+    bool UpdateFromWireStorage(size_t payloadLength)
+    {
+        return ParseWireHeader(_storage.get(), payloadLength);
+    }
+
+    // ApplyDeltaSpans
+    //
+    // Walks the spans of a PIXELDELTA64 payload and checks that they stay within pixelCount, XORing each one
+    // into pLeds along the way.  Passing nullptr for pLeds makes it a validation pass that changes nothing.
+
+    static bool ApplyDeltaSpans(const uint8_t * pSpans, size_t cbSpans, uint32_t pixelCount, CRGB * pLeds)
+    {
+        size_t iPixel = 0;
+
+        while (cbSpans > 0)
+        {
+            if (cbSpans < cbDeltaSpanHeader)
+            {
+                debugW("Delta frame ends in the middle of a span header");
+                return false;
+            }
+
+            iPixel += WORDFromMemory(&pSpans[0]);
+            size_t cChanged  = WORDFromMemory(&pSpans[2]);
+            size_t cbChanged = cChanged * sizeof(CRGB);
+
+            pSpans  += cbDeltaSpanHeader;
+            cbSpans -= cbDeltaSpanHeader;
+
+            if (iPixel + cChanged > pixelCount || cbChanged > cbSpans)
+            {
+                debugW("Delta span of %u pixels at pixel %u runs past the frame or the payload", cChanged, iPixel);
+                return false;
+            }
+
+            if (pLeds)
+            {
+                uint8_t * pDest = reinterpret_cast<uint8_t *>(&pLeds[iPixel]);
+                for (size_t i = 0; i < cbChanged; i++)
+                    pDest[i] ^= pSpans[i];
+            }
+
+            iPixel  += cChanged;
+            pSpans  += cbChanged;
+            cbSpans -= cbChanged;
+        }
+        return true;
+    }
+
+    // UpdateFromDelta
+    //
+    // Makes this buffer the base frame with a PIXELDELTA64 payload applied on top.  The payload must already
+    // have been validated against the base (see LEDBufferManager::ApplyDeltaFromWire).
+
+    void UpdateFromDelta(const LEDBuffer & base, const uint8_t * payloadData)
+    {
+        _usTimestamp           = Timebase::FromWire(ULONGFromMemory(&payloadData[8]), ULONGFromMemory(&payloadData[16]));
+        _pixelCount            = base._pixelCount;
+
+        if (this != &base)
+            memcpy((void *)_leds, base._leds, _pixelCount * sizeof(CRGB));
+
+        ApplyDeltaSpans(&payloadData[cbDeltaHeader], DWORDFromMemory(&payloadData[4]), _pixelCount, _leds);
+    }
+
+    // DrawBuffer
+    //
+    // Sends our pixels to the strand.  The timestamp is left alone so that the frame can still serve as the
+    // base for a delta frame after it's been drawn.
+
     void DrawBuffer() 
     {
-        _timeStampMicroseconds = 0;
-        _timeStampSeconds      = 0;
-        _pStrand->fillLeds(_leds.get());
+        _pStrand->fillLeds(_leds);
+    }
+
+    // DrawBlended
+    //
+    // Sends the strand a blend of our pixels and those of the next frame, with weight/256ths of the next one
+
+    void DrawBlended(const LEDBuffer & next, uint16_t weight)
+    {
+        _pStrand->fillLedsBlended(_leds, next._leds, weight);
+    }
+};
+
+// LOCKFREE_BUFFER_RING
+//
+// The socket task is the only one that adds frames to an LEDBufferManager and the draw task is the only one
+// that takes them out, so the ring itself needs no lock (see SPSCRing).  Normally g_buffer_mutex is held
+// around both anyway, which lets an incoming frame update the newest buffer in place and lets a full ring
+// throw away its oldest frame to make room.  With LOCKFREE_BUFFER_RING, g_buffer_mutex does nothing and
+// neither task ever waits for the other.  Each frame goes in a buffer of its own, and a frame that arrives
+// when the ring is full is the one that gets dropped.
+
+#ifndef LOCKFREE_BUFFER_RING
+#define LOCKFREE_BUFFER_RING 0
+#endif
+
+#if LOCKFREE_BUFFER_RING
+    struct BufferRingMutex
+    {
+        void lock()     {}
+        void unlock()   {}
+        bool try_lock() { return true; }
+    };
+#else
+    using BufferRingMutex = std::mutex;
+#endif
+
+extern BufferRingMutex g_buffer_mutex;
+
+// ADAPTIVE_BUFFER_DEPTH
+//
+// Each LEDBufferManager works out how many buffers it needs from how early frames arrive and how much that varies
+// (see JitterEstimator), and reports it in SocketResponseV3 so senders can adjust.  With ADAPTIVE_BUFFER_DEPTH it
+// also grows and shrinks its own pool to match, between MIN_BUFFERS and the number it was created with, so it only
+// holds on to the memory for a deep buffer while the network is bad enough to need one.  Resizing moves frames
+// between buffers while both tasks are kept out, so it can't be used with LOCKFREE_BUFFER_RING.
+
+#ifndef ADAPTIVE_BUFFER_DEPTH
+#define ADAPTIVE_BUFFER_DEPTH 0
+#endif
+
+#ifndef JITTER_LEAD_FACTOR
+#define JITTER_LEAD_FACTOR 4                            // How many times the measured jitter to keep in hand
+#endif
+
+#ifndef ADAPTIVE_BUFFER_SHRINK_MS
+#define ADAPTIVE_BUFFER_SHRINK_MS 10000                 // How long the pool must have been too big before it shrinks
+#endif
+
+#if ADAPTIVE_BUFFER_DEPTH && LOCKFREE_BUFFER_RING
+#error ADAPTIVE_BUFFER_DEPTH needs g_buffer_mutex, so it cannot be used with LOCKFREE_BUFFER_RING
+#endif
+
+// JitterEstimator
+//
+// Keeps smoothed figures for the frames arriving on a channel:  how far ahead of its timestamp each one gets here
+// (its lead), how much that varies from frame to frame (the jitter, measured the way RTP does in RFC 3550), and
+// how far apart the timestamps are.  The jitter only uses differences, so it's good whether or not our clock
+// agrees with the sender's, but the lead means nothing until NTP has set ours.  All times are microseconds.
+
+class JitterEstimator
+{
+    uint64_t        _usLastTimestamp = 0;
+    uint64_t        _usLastArrival = 0;
+    bool            _bHaveLast = false;
+    bool            _bHaveLead = false;
+    int64_t         _usLead = 0;
+    int64_t         _usJitter = 0;
+    int64_t         _usInterval = 0;
+
+    // Smooth
+    //
+    // Moves an average 1/16th of the way towards a new sample, as RFC 3550 does for jitter
+
+    static void Smooth(int64_t & average, int64_t sample)
+    {
+        average += (sample - average) / 16;
+    }
+
+  public:
+
+    void AddFrame(uint64_t usTimestamp)
+    {
+        uint64_t usArrival = Timebase::MonotonicMicros();
+
+        if (NTPTimeClient::HasClockBeenSet())
+        {
+            int64_t usLead = Timebase::MicrosBetween(Timebase::WallFromMonotonic(usArrival), usTimestamp);
+            if (_bHaveLead)
+                Smooth(_usLead, usLead);
+            else
+                _usLead = usLead;
+            _bHaveLead = true;
+        }
+
+        // Frames with the same timestamp as the last, or one from well before it, mean the sender has started
+        // over, which says nothing about the network
+
+        int64_t usSpacing = Timebase::MicrosBetween(_usLastTimestamp, usTimestamp);
+        if (_bHaveLast && usSpacing > 0 && usSpacing < MICROS_PER_SECOND)
+        {
+            int64_t usTransit = Timebase::MicrosBetween(_usLastArrival, usArrival) - usSpacing;
+            Smooth(_usJitter, std::abs(usTransit));
+            if (_usInterval == 0)
+                _usInterval = usSpacing;
+            else
+                Smooth(_usInterval, usSpacing);
+        }
+
+        _usLastTimestamp = usTimestamp;
+        _usLastArrival   = usArrival;
+        _bHaveLast       = true;
+    }
+
+    // AverageLead
+    //
+    // How far ahead of their timestamps frames have been arriving; negative if they've been arriving late
+
+    int32_t AverageLead() const
+    {
+        return (int32_t) std::clamp<int64_t>(_usLead, INT32_MIN, INT32_MAX);
+    }
+
+    uint32_t Jitter() const
+    {
+        return _usJitter;
+    }
+
+    uint32_t FrameInterval() const
+    {
+        return _usInterval;
+    }
+
+    // RecommendedLead
+    //
+    // How far ahead of their timestamps the sender should send frames so that hardly any arrive too late:  a
+    // comfortable multiple of the jitter, plus one frame so the draw loop has time to get to it
+
+    uint32_t RecommendedLead() const
+    {
+        return JITTER_LEAD_FACTOR * _usJitter + _usInterval;
+    }
+
+    // RecommendedDepth
+    //
+    // How many buffers it takes to hold every frame that's waiting to be drawn, given the sender's lead (or the
+    // recommended one, if that's longer) and a burst's worth of jitter on top, plus the frame being drawn and the
+    // slot the ring always keeps empty
+
+    size_t RecommendedDepth() const
+    {
+        if (_usInterval == 0)
+            return MIN_BUFFERS;
+
+        int64_t usQueued = std::max<int64_t>(_bHaveLead ? _usLead : 0, RecommendedLead()) + JITTER_LEAD_FACTOR * _usJitter;
+        return std::clamp<int64_t>((usQueued + _usInterval - 1) / _usInterval + 2, MIN_BUFFERS, MAX_BUFFERS);
     }
 };
 
@@ -218,45 +575,71 @@ class LEDBuffer
 // Manages a circular buffer of LEDBuffer objects.  The buffer itself is an array of shared_ptrs to
 // LEDBuffer objects.  The buffer is managed through a unique_ptr.  The LEDBuffer objects are managed
 // through shared_ptrs as they are also returned to callers.
+//
+// The socket task fills a buffer between ReserveBuffer (or GetBufferForTimestamp) and CommitBuffer, and the
+// draw task uses the oldest one between PeekOldestBuffer and ReleaseOldestBuffer.
 
 class LEDBufferManager
 {
-    const std::unique_ptr<std::shared_ptr<LEDBuffer> []> _ppBuffers;          // The circular array of buffer ptrs
-    std::shared_ptr<LEDBuffer>                           _pLastBufferAdded;   // Keeps track of the MRU buffer
-    size_t                                               _iNextBuffer;        // Head pointer index
-    size_t                                               _iLastBuffer;        // Tail pointer index
+    std::unique_ptr<std::shared_ptr<LEDBuffer> []>       _ppBuffers;          // The circular array of buffer ptrs
+    SPSCRing                                             _ring;               // Head and tail indices into it
     uint32_t                                             _cBuffers;           // Number of buffers
+    const uint32_t                                       _cMaxBuffers;        // Most buffers we may grow to
+    std::shared_ptr<DeviceGFX>                             _pGFX;
     float                                               _BufferAgeOldest = 0;
     float                                               _BufferAgeNewest = 0;
+    uint32_t                                             _cDeltasRejected = 0; // Delta frames whose base we didn't have
+    uint32_t                                             _cDroppedLate = 0;   // Frames skipped because a later one was already due
+    uint32_t                                             _cEvicted = 0;       // Frames lost because the ring was full
+    JitterEstimator                                      _jitter;
+    unsigned long                                        _msShrinkCheck = 0;  // When we last found the pool no bigger than needed
+    size_t                                               _cPeakWanted = 0;    // Most buffers needed since then
+    bool                                                 _bHeld = false;      // The oldest buffer is being shown in place
+    bool                                                 _bOldestShown = false; // The oldest buffer has been drawn, blended into the next
+
+    // InitialBufferCount
+    //
+    // An adaptive pool starts small and grows if it has to; otherwise we get every buffer we were given up front
+
+    static uint32_t InitialBufferCount(uint32_t cBuffers)
+    {
+        return ADAPTIVE_BUFFER_DEPTH ? std::min<uint32_t>(cBuffers, MIN_BUFFERS) : cBuffers;
+    }
+
+    std::shared_ptr<LEDBuffer> NewBuffer() const
+    {
+        #if USE_PSRAM
+            return std::allocate_shared<LEDBuffer>(psram_allocator<LEDBuffer>(), _pGFX);
+        #else
+            return std::make_shared<LEDBuffer>(_pGFX);
+        #endif
+    }
    
   public:
 
-    LEDBufferManager(uint32_t cBuffers, std::shared_ptr<GFXBase> pGFX)
-     : _ppBuffers(std::make_unique<std::shared_ptr<LEDBuffer> []>(cBuffers)), // Create the circular array of ptrs
-       _iNextBuffer(0),
-       _iLastBuffer(0),
-       _cBuffers(cBuffers)
+    LEDBufferManager(uint32_t cBuffers, std::shared_ptr<DeviceGFX> pGFX)
+     : _ppBuffers(std::make_unique<std::shared_ptr<LEDBuffer> []>(InitialBufferCount(cBuffers))), // Create the circular array of ptrs
+       _ring(InitialBufferCount(cBuffers)),
+       _cBuffers(InitialBufferCount(cBuffers)),
+       _cMaxBuffers(cBuffers),
+       _pGFX(pGFX)
     {
         // The initializer creates a uniquely owned table of shared pointers.
         // We exclusively can see the table, but the buffer objects it contains
         // are returned back out to callers so they must be shared pointers.
 
         for (int i = 0; i < _cBuffers; i++)
-        {
-            #if USE_PSRAM
-                _ppBuffers[i] = std::allocate_shared<LEDBuffer>(psram_allocator<LEDBuffer>(), pGFX);
-            #else
-                _ppBuffers[i] = std::make_shared<LEDBuffer>(pGFX);
-            #endif
-        }
+            _ppBuffers[i] = NewBuffer();
+
+        _msShrinkCheck = millis();
     }
 
     float AgeOfOldestBuffer()
     {
-        if (false == IsEmpty())
+        auto pOldest = PeekOldestBuffer();
+        if (pOldest)
         {
-            auto pOldest = PeekOldestBuffer();
-            return (pOldest->Seconds() + pOldest->MicroSeconds() / (float) MICROS_PER_SECOND) - g_AppTime.CurrentTime();
+            return Timebase::SecondsBetween(Timebase::WallMicros(), pOldest->Timestamp());
         }
         else
         {
@@ -266,10 +649,10 @@ class LEDBufferManager
 
     float AgeOfNewestBuffer()
     {
-        if (false == IsEmpty())
+        auto pNewest = PeekNewestBuffer();
+        if (pNewest)
         {
-            auto pNewest = PeekNewestBuffer();
-            return (pNewest->Seconds() + pNewest->MicroSeconds() / (float) MICROS_PER_SECOND) - g_AppTime.CurrentTime();
+            return Timebase::SecondsBetween(Timebase::WallMicros(), pNewest->Timestamp());
         }
         else
         {
@@ -285,6 +668,21 @@ class LEDBufferManager
     { 
         return _cBuffers; 
     }
+
+    const JitterEstimator & Jitter() const
+    {
+        return _jitter;
+    }
+
+    uint32_t FramesDroppedLate() const
+    {
+        return _cDroppedLate;
+    }
+
+    uint32_t FramesEvicted() const
+    {
+        return _cEvicted;
+    }
     
     // Depth
     // 
@@ -292,15 +690,12 @@ class LEDBufferManager
 
     size_t Depth() const
     {
-        if (_iNextBuffer < _iLastBuffer)
-            return (_iNextBuffer + _cBuffers - _iLastBuffer);
-        else
-            return _iNextBuffer - _iLastBuffer;
+        return _ring.Depth();
     }
 
     inline bool IsEmpty() const
     {
-        return _iNextBuffer == _iLastBuffer;
+        return _ring.IsEmpty();
     }
 
     // PeekNewestBuffer
@@ -311,64 +706,347 @@ class LEDBufferManager
     {
         if (IsEmpty())
             return nullptr; 
-        return _pLastBufferAdded;
+        return _ppBuffers[_ring.Newest()];
     }
 
-    // GetNewBuffer
+    // ReserveBuffer
     //
-    // Grabs the next buffer in the circle, advancing the tail pointer as well if we've
-    // 'caught up' to the head pointer, which effective throws away that buffer via reuse
+    // Grabs the next buffer in the circle for the caller to fill.  The draw task can't see it until it's passed
+    // to CommitBuffer, so a frame that turns out to be bad can just be abandoned.  If the ring is full, the
+    // oldest frame is thrown away to make room, or with LOCKFREE_BUFFER_RING (where only the draw task may
+    // take frames out) or while the oldest is held, nullptr is returned and the new frame is the one that's lost.
 
-    std::shared_ptr<LEDBuffer> GetNewBuffer()
+    std::shared_ptr<LEDBuffer> ReserveBuffer()
     {
-        auto pResult = _ppBuffers[_iNextBuffer++];
+        #if ADAPTIVE_BUFFER_DEPTH
+            AdjustPoolSize();
+        #endif
 
-        if (IsEmpty())
-            _iLastBuffer++;
+        size_t iSlot;
+        if (!_ring.TryReserve(iSlot))
+        {
+            #if LOCKFREE_BUFFER_RING
+                _cEvicted++;
+                g_Telemetry._cFramesDropped++;
+                return nullptr;
+            #else
+                if (_bHeld)
+                {
+                    _cEvicted++;
+                    g_Telemetry._cFramesDropped++;
+                    return nullptr;
+                }
 
-        _iLastBuffer %= _cBuffers;
-        _iNextBuffer %= _cBuffers;
-        
-        _pLastBufferAdded = pResult;
-        
-        return pResult;
+                // An oldest frame that has already been drawn, blended into the next, isn't lost by dropping it
+
+                if (!_bOldestShown)
+                {
+                    _cEvicted++;
+                    g_Telemetry._cFramesDropped++;
+                }
+                _ring.DropOldest();
+                _bOldestShown = false;
+                _ring.TryReserve(iSlot);
+            #endif
+        }
+        return _ppBuffers[iSlot];
     }
 
-    // GetOldestBuffer
-    // 
-    // Return a pointer to the very oldest buffer, or nullptr if empty
+    // CommitBuffer
+    //
+    // Adds a buffer filled since ReserveBuffer to the ring.  Does nothing for a buffer that's already in it, as
+    // GetBufferForTimestamp hands out when a frame updates the newest one.
 
-    std::shared_ptr<LEDBuffer> GetOldestBuffer() 
+    void CommitBuffer(const std::shared_ptr<LEDBuffer> & pBuffer)
     {
-        if (IsEmpty())
-            return nullptr; 
+        size_t iSlot;
+        if (!pBuffer || !_ring.TryReserve(iSlot) || _ppBuffers[iSlot] != pBuffer)
+            return;
 
-        auto pResult = _ppBuffers[_iLastBuffer];
-        _iLastBuffer++;
-        _iLastBuffer %= _cBuffers;
-        
-        return pResult;
+        pBuffer->SetQueuedMicros(micros());
+        _ring.Commit();
+        _jitter.AddFrame(pBuffer->Timestamp());
+    }
+
+    // GetBufferForTimestamp
+    //
+    // Returns the buffer an incoming frame with this timestamp should be written to, to be passed to CommitBuffer
+    // afterwards.  If the newest buffer already has the same (non-zero) timestamp, the frame is an update to it;
+    // otherwise it's a new buffer.  Updating in place needs g_buffer_mutex to keep the draw task out, so with
+    // LOCKFREE_BUFFER_RING every frame gets a new buffer, and the draw task just ends up drawing the later one.
+    // The same goes for a buffer that's held, since the strip may be showing it without the mutex.
+    // Returns nullptr if a new buffer is needed and the ring has no room.
+
+    std::shared_ptr<LEDBuffer> GetBufferForTimestamp(uint64_t seconds, uint64_t micros)
+    {
+        #if !LOCKFREE_BUFFER_RING
+            auto pNewestBuffer = PeekNewestBuffer();
+            if (pNewestBuffer && !IsHeld(pNewestBuffer) && micros != 0 && pNewestBuffer->Timestamp() == Timebase::FromWire(seconds, micros))
+            {
+                debugV("Updating existing buffer");
+                return pNewestBuffer;
+            }
+        #endif
+
+        debugV("No match so adding new buffer");
+        return ReserveBuffer();
+    }
+
+    // ApplyDeltaFromWire
+    //
+    // Adds a frame made from a PIXELDELTA64 payload applied to the most recently added frame.  The delta names
+    // the timestamp of the frame it was made against, and if that isn't our most recent frame (because one was
+    // lost, or we've only just started) it's refused, so that the connection is dropped and the sender starts
+    // again with a full PIXELDATA64 keyframe.  The most recent frame is used even if it has already been drawn,
+    // as its pixels stay put until the ring wraps around to it again.
+
+    bool ApplyDeltaFromWire(uint8_t * payloadData, size_t payloadLength)
+    {
+        if (payloadLength < LEDBuffer::cbDeltaHeader)
+        {
+            debugW("Not enough data received for a delta frame");
+            return false;
+        }
+
+        uint32_t cbSpans     = DWORDFromMemory(&payloadData[4]);
+        uint64_t seconds     = ULONGFromMemory(&payloadData[8]);
+        uint64_t micros      = ULONGFromMemory(&payloadData[16]);
+        uint64_t baseSeconds = ULONGFromMemory(&payloadData[24]);
+        uint64_t baseMicros  = ULONGFromMemory(&payloadData[32]);
+
+        if (payloadLength < LEDBuffer::cbDeltaHeader + cbSpans)
+        {
+            debugW("Delta frame promises %u bytes of spans but only %u bytes arrived", cbSpans, payloadLength - LEDBuffer::cbDeltaHeader);
+            return false;
+        }
+
+        // Buffers start out with a zero timestamp, which no delta can name, so this also covers having no frames yet
+
+        auto pBase = _ppBuffers[_ring.Newest()];
+        if (pBase->Timestamp() != Timebase::FromWire(baseSeconds, baseMicros) || (baseSeconds == 0 && baseMicros == 0))
+        {
+            _cDeltasRejected++;
+            debugW("Delta frame is against %llu.%06llu which is not our newest frame, so a keyframe is needed", baseSeconds, baseMicros);
+            return false;
+        }
+
+        if (Timebase::FromWire(seconds, micros) == pBase->Timestamp())
+        {
+            debugW("Delta frame has the same timestamp as its base");
+            return false;
+        }
+
+        // Check the spans before taking a buffer, so a bad delta can't leave a half-built frame in the ring
+
+        if (!LEDBuffer::ApplyDeltaSpans(&payloadData[LEDBuffer::cbDeltaHeader], cbSpans, pBase->Length(), nullptr))
+            return false;
+
+        // A delta that arrives when there's no room is lost like any other frame, so the sender's next delta,
+        // made against this one, will be refused and bring a keyframe
+
+        auto pBuffer = ReserveBuffer();
+        if (pBuffer)
+        {
+            pBuffer->UpdateFromDelta(*pBase, payloadData);
+            CommitBuffer(pBuffer);
+        }
+        return true;
+    }
+
+    uint32_t DeltasRejected() const
+    {
+        return _cDeltasRejected;
     }
 
     // PeekOldestBuffer
     //
-    // Take a "peek" at the newest buffer, or nullptr if empty
+    // Take a "peek" at the oldest buffer, or nullptr if empty.  It stays in the ring, so the socket task won't
+    // reuse it, until the draw task is done with it and calls ReleaseOldestBuffer.
 
-    const std::shared_ptr<LEDBuffer> PeekOldestBuffer() const
+    std::shared_ptr<LEDBuffer> PeekOldestBuffer() const
     {
-        if (IsEmpty())
+        size_t iSlot;
+        if (!_ring.TryPeek(iSlot))
             return nullptr; 
         
-        return _ppBuffers[_iLastBuffer];
+        return _ppBuffers[iSlot];
     }
 
-    const std::shared_ptr<LEDBuffer> operator[](size_t index) const
+    // ReleaseOldestBuffer
+    //
+    // Removes the oldest buffer from the ring, handing it back to be reused
+
+    void ReleaseOldestBuffer()
+    {
+        auto pOldest = PeekOldestBuffer();
+        if (!pOldest)
+            return;
+
+        g_Telemetry._queueResidency.Add(micros() - pOldest->QueuedMicros());
+        _ring.Release();
+        _bOldestShown = false;
+    }
+
+    // KeepShownBuffer
+    //
+    // Leaves the oldest buffer, just drawn blended into the next one, in the ring so that it can be blended
+    // from again next frame.  Once the next one is due it goes, but as a frame that was shown, not one dropped.
+
+    void KeepShownBuffer()
+    {
+        _bOldestShown = !IsEmpty();
+    }
+
+    // HoldOldestBuffer
+    //
+    // Keeps the oldest buffer, just drawn, in the ring after all, because the strip is going to show straight
+    // from its pixels (see ZERO_COPY_WIFI).  Nothing may overwrite it until ReleaseHeldBuffer, which frees it
+    // as ReleaseOldestBuffer would have.
+
+    void HoldOldestBuffer()
+    {
+        _bHeld = !IsEmpty();
+    }
+
+    void ReleaseHeldBuffer()
+    {
+        if (!_bHeld)
+            return;
+
+        _bHeld = false;
+        ReleaseOldestBuffer();
+    }
+
+    bool IsHeld(const std::shared_ptr<LEDBuffer> & pBuffer) const
+    {
+        return _bHeld && pBuffer == PeekOldestBuffer();
+    }
+
+    // DiscardLateBuffer
+    //
+    // Removes the oldest buffer because a later one is already due.  Unless it was drawn first (see
+    // KeepShownBuffer), it never reached the strip, so it counts as dropped.
+
+    void DiscardLateBuffer()
     {
         if (IsEmpty())
+            return;
+
+        if (!_bOldestShown)
+        {
+            _cDroppedLate++;
+            g_Telemetry._cFramesDropped++;
+        }
+        ReleaseOldestBuffer();
+    }
+
+    std::shared_ptr<LEDBuffer> operator[](size_t index) const
+    {
+        size_t iSlot;
+        if (!_ring.TryPeek(iSlot, index))
             return nullptr; 
-        size_t i = (_iLastBuffer + index) % _cBuffers;
-        return _ppBuffers[i];
+        return _ppBuffers[iSlot];
     }
-};
 
+  private:
+
+    #if ADAPTIVE_BUFFER_DEPTH
+
+    // AdjustPoolSize
+    //
+    // Grows the pool as soon as the jitter estimate calls for more buffers, or the ring fills up while it's still
+    // settling.  Only shrinks it once it's been bigger than needed for ADAPTIVE_BUFFER_SHRINK_MS, and then only
+    // as far as the most it needed over that time, so a network that comes and goes doesn't keep us reallocating.
+
+    void AdjustPoolSize()
+    {
+        size_t cWanted = std::clamp<size_t>(_jitter.RecommendedDepth(), MIN_BUFFERS, _cMaxBuffers);
+        if (_ring.Depth() + 1 >= _cBuffers)
+            cWanted = std::max<size_t>(cWanted, std::min<size_t>(_cBuffers + 1, _cMaxBuffers));
 
+        if (cWanted >= _cBuffers)
+        {
+            _msShrinkCheck = millis();
+            _cPeakWanted   = 0;
+            if (cWanted > _cBuffers)
+                ResizePool(cWanted);
+            return;
+        }
+
+        _cPeakWanted = std::max(_cPeakWanted, cWanted);
+        if (millis() - _msShrinkCheck >= ADAPTIVE_BUFFER_SHRINK_MS)
+        {
+            ResizePool(_cPeakWanted);
+            _msShrinkCheck = millis();
+            _cPeakWanted   = 0;
+        }
+    }
+
+    // ResizePool
+    //
+    // Rebuilds the ring with a different number of buffers, keeping every frame that's waiting to be drawn and
+    // the newest frame (the base for delta frames) even if it has been.  Buffers not holding either are reused
+    // before any new ones are allocated, and any left over are freed.  Both tasks must be kept out meanwhile,
+    // which g_buffer_mutex does since every caller of ReserveBuffer holds it.
+
+    void ResizePool(size_t cNew)
+    {
+        size_t depth = _ring.Depth();
+
+        if (cNew < _cBuffers)
+        {
+            // Never drop a waiting frame, and leave room for the next one to arrive
+
+            cNew = std::min<size_t>(_cBuffers, std::max(cNew, depth + 2));
+        }
+        else
+        {
+            // Growing is limited to what fits while leaving RESERVE_MEMORY free, as it is at startup
+
+            #if USE_PSRAM
+                size_t cbFree = ESP.getFreePsram();
+            #else
+                size_t cbFree = ESP.getFreeHeap();
+            #endif
+            const size_t cbBuffer = sizeof(LEDBuffer) + LEDBuffer::cbWireHeader + NUM_LEDS * sizeof(CRGB);
+            size_t cAffordable = cbFree > RESERVE_MEMORY ? (cbFree - RESERVE_MEMORY) / cbBuffer : 0;
+            cNew = std::min(cNew, _cBuffers + cAffordable);
+        }
+
+        if (cNew == _cBuffers)
+            return;
+
+        auto ppNew = std::make_unique<std::shared_ptr<LEDBuffer> []>(cNew);
+
+        for (size_t i = 0; i < depth; i++)
+        {
+            size_t iSlot;
+            _ring.TryPeek(iSlot, i);
+            ppNew[i] = std::move(_ppBuffers[iSlot]);
+        }
+
+        // With nothing waiting, the newest frame goes just behind the empty ring's head, where Newest will look
+
+        if (depth == 0)
+            ppNew[cNew - 1] = std::move(_ppBuffers[_ring.Newest()]);
+
+        size_t iSpare = 0;
+        for (size_t i = 0; i < cNew; i++)
+        {
+            if (ppNew[i])
+                continue;
+            while (iSpare < _cBuffers && !_ppBuffers[iSpare])
+                iSpare++;
+            ppNew[i] = iSpare < _cBuffers ? std::move(_ppBuffers[iSpare]) : NewBuffer();
+        }
+
+        debugI("Resizing LED buffer pool from %u to %u buffers (jitter %uus, frames every %uus, lead %dus)",
+               _cBuffers, cNew, _jitter.Jitter(), _jitter.FrameInterval(), _jitter.AverageLead());
+
+        _ppBuffers = std::move(ppNew);
+        _cBuffers  = cNew;
+        _ring.Reset(cNew, depth);
+    }
+
+    #endif
+};
@@ -0,0 +1,198 @@
+//+--------------------------------------------------------------------------
+//
+// File:        ledlayout.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    The ways an x, y position can map to a pixel's place along the wire.
+//    DEVICE_LAYOUT (see globals.h) picks the one a device uses, and the
+//    compiler builds GFXBase::xy's lookup table from it, so drawing
+//    never has to work a position out pixel by pixel.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Each layout has the Width and Height it covers, and a constexpr Index that gives where x, y is along the wire.
+// Index has to cope with positions off the edge, since some effects draw there, but only has to give something
+// that's no worse than what xy() gave them before.
+
+// RowMajorLayout
+//
+// One row after another, all running the same way, as HUB75 panels are
+
+template <uint16_t W, uint16_t H>
+struct RowMajorLayout
+{
+    static constexpr uint16_t Width  = W;
+    static constexpr uint16_t Height = H;
+
+    static constexpr uint16_t Index(uint16_t x, uint16_t y)
+    {
+        return y * W + x;
+    }
+};
+
+// SerpentineColumnLayout
+//
+// One column after another, with every other one running backwards, as strips of WS2812s zig-zagged into a
+// matrix usually are.  A plain strip, one pixel tall, comes out the same as RowMajorLayout.
+
+template <uint16_t W, uint16_t H>
+struct SerpentineColumnLayout
+{
+    static constexpr uint16_t Width  = W;
+    static constexpr uint16_t Height = H;
+
+    static constexpr uint16_t Index(uint16_t x, uint16_t y)
+    {
+        if (x & 0x01)
+            return (x * H) + (H - 1) - y;           // Odd columns run backwards
+        return (x * H) + y;
+    }
+};
+
+// SerpentineRowLayout
+//
+// The same zig-zag, but a row at a time
+
+template <uint16_t W, uint16_t H>
+struct SerpentineRowLayout
+{
+    static constexpr uint16_t Width  = W;
+    static constexpr uint16_t Height = H;
+
+    static constexpr uint16_t Index(uint16_t x, uint16_t y)
+    {
+        if (y & 0x01)
+            return (y * W) + (W - 1) - x;           // Odd rows run backwards
+        return (y * W) + x;
+    }
+};
+
+// RotatedLayout
+//
+// A panel wired as Panel, mounted turned clockwise by QuarterTurns quarter turns.  Turned by one or three, it's
+// as wide as Panel is tall, and the other way around.
+
+template <typename Panel, int QuarterTurns>
+struct RotatedLayout
+{
+    static constexpr bool     Sideways = (QuarterTurns & 1) != 0;
+    static constexpr uint16_t Width    = Sideways ? Panel::Height : Panel::Width;
+    static constexpr uint16_t Height   = Sideways ? Panel::Width  : Panel::Height;
+
+    static constexpr uint16_t Index(uint16_t x, uint16_t y)
+    {
+        switch (QuarterTurns & 3)
+        {
+            case 1:  return Panel::Index(y, Width - 1 - x);
+            case 2:  return Panel::Index(Width - 1 - x, Height - 1 - y);
+            case 3:  return Panel::Index(Height - 1 - y, x);
+            default: return Panel::Index(x, y);
+        }
+    }
+};
+
+// TiledLayout
+//
+// TilesAcross by TilesDown panels, each wired as Panel, chained one after another a row of panels at a time
+
+template <typename Panel, uint16_t TilesAcross, uint16_t TilesDown>
+struct TiledLayout
+{
+    static constexpr uint16_t Width  = Panel::Width  * TilesAcross;
+    static constexpr uint16_t Height = Panel::Height * TilesDown;
+
+    static constexpr uint16_t Index(uint16_t x, uint16_t y)
+    {
+        uint16_t tile = (y / Panel::Height) * TilesAcross + (x / Panel::Width);
+        return tile * (Panel::Width * Panel::Height) + Panel::Index(x % Panel::Width, y % Panel::Height);
+    }
+};
+
+// LayoutTable
+//
+// Looks positions up in a table of Layout::Index built at compile time, unless Layout turns out to be row-major
+// anyway, in which case the multiply and add are quicker than the table and it isn't built.  Positions off the
+// edge aren't in the table, so they still go to Layout::Index.
+
+template <typename Layout>
+class LayoutTable
+{
+  public:
+
+    static constexpr uint16_t Width  = Layout::Width;
+    static constexpr uint16_t Height = Layout::Height;
+    static constexpr size_t   Count  = size_t(Width) * Height;
+
+    static_assert(Count > 0 && Count <= 65536, "A layout has to fit in 16-bit pixel indices");
+
+  private:
+
+    static constexpr bool CheckRowMajor()
+    {
+        for (uint16_t y = 0; y < Height; y++)
+            for (uint16_t x = 0; x < Width; x++)
+                if (Layout::Index(x, y) != y * Width + x)
+                    return false;
+        return true;
+    }
+
+  public:
+
+    static constexpr bool IsRowMajor = CheckRowMajor();
+
+  private:
+
+    struct Table
+    {
+        uint16_t index[IsRowMajor ? 1 : Count];
+    };
+
+    static constexpr Table Build()
+    {
+        Table table = { };
+        if (!IsRowMajor)
+            for (uint16_t y = 0; y < Height; y++)
+                for (uint16_t x = 0; x < Width; x++)
+                    table.index[y * Width + x] = Layout::Index(x, y);
+        return table;
+    }
+
+    static constexpr Table _table = Build();
+
+  public:
+
+    static inline uint16_t XY(uint16_t x, uint16_t y)
+    {
+        if constexpr (IsRowMajor)
+            return y * Width + x;
+        else if (x < Width && y < Height)
+            return _table.index[y * Width + x];
+        else
+            return Layout::Index(x, y);
+    }
+};
@@ -46,7 +46,7 @@
 
 #define COLOR_DEPTH 24 // known working: 24, 48 - If the sketch uses type `rgb24` directly, COLOR_DEPTH must be 24
 
-class LEDMatrixGFX : public GFXBase
+class LEDMatrixGFX final : public GFXBase
 {
 protected:
     String strCaption;
@@ -90,11 +90,6 @@ public:
         matrix.setBrightness(percent);
     }
     
-    inline virtual uint16_t xy(uint16_t x, uint16_t y) const
-    {
-        return y * MATRIX_WIDTH + x;    
-    }
-
     inline void setLeds(CRGB *pLeds)
     {
         leds = pLeds;
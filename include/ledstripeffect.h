@@ -34,7 +34,21 @@
 #include "jsonserializer.h"
 
 extern bool                      g_bUpdateStarted;
-extern DRAM_ATTR std::shared_ptr<GFXBase> g_aptrDevices[NUM_CHANNELS];
+extern DRAM_ATTR std::shared_ptr<DeviceGFX> g_aptrDevices[NUM_CHANNELS];
+
+// ShowStats
+//
+// How many frames were sent to the strip, how many were skipped for being the same as the last one sent (see
+// SKIP_UNCHANGED_FRAMES), and about how much time skipping them saved.  Only the draw task updates these.
+
+struct ShowStats
+{
+    uint32_t    cShown   = 0;
+    uint32_t    cSkipped = 0;
+    uint64_t    usSaved  = 0;
+};
+
+extern ShowStats g_WiFiShowStats;                   // Frames that came over WiFi, which aren't any effect's
 
 // LEDStripEffect
 //
@@ -47,8 +61,9 @@ class LEDStripEffect : public IJSONSerializable
     size_t _cLEDs;
     String _friendlyName;
     int _effectNumber;
+    ShowStats _showStats;
 
-    std::shared_ptr<GFXBase> _GFX[NUM_CHANNELS];
+    std::shared_ptr<DeviceGFX> _GFX[NUM_CHANNELS];
     inline static float randomfloat(float lower, float upper)
     {
         float result = (lower + ((upper - lower) * rand()) / RAND_MAX);
@@ -74,7 +89,7 @@ class LEDStripEffect : public IJSONSerializable
     {
     }
 
-    virtual bool Init(std::shared_ptr<GFXBase> gfx[NUM_CHANNELS])               // There are up to 8 channel in play per effect and when we
+    virtual bool Init(std::shared_ptr<DeviceGFX> gfx[NUM_CHANNELS])               // There are up to 8 channel in play per effect and when we
     {           
         debugV("Init %s", _friendlyName.c_str());                                                    //   start up, we are given copies to their graphics interfaces
         for (int i = 0; i < NUM_CHANNELS; i++)                      //   so that we can call them directly later from other calls
@@ -87,7 +102,7 @@ class LEDStripEffect : public IJSONSerializable
         return true;  
     }
     
-    inline std::shared_ptr<GFXBase> graphics() const
+    inline std::shared_ptr<DeviceGFX> graphics() const
     {
         return _GFX[0];
     }
@@ -117,6 +132,16 @@ class LEDStripEffect : public IJSONSerializable
         return _effectNumber;
     }
 
+    ShowStats & GetShowStats()
+    {
+        return _showStats;
+    }
+
+    const ShowStats & GetShowStats() const
+    {
+        return _showStats;
+    }
+
     virtual size_t DesiredFramesPerSecond() const
     {
         return 30;
@@ -197,6 +222,11 @@ class LEDStripEffect : public IJSONSerializable
 
         for (int n = 0; n < NUM_CHANNELS; n++)
         {            
+            if (everyN == 1)
+            {
+                _GFX[n]->FillSpan(iStart, numToFill, color);
+                continue;
+            }
             for (int i = iStart; i < iStart + numToFill; i+= everyN)
                 _GFX[n]->setPixel(i, color);
                
@@ -258,15 +288,14 @@ class LEDStripEffect : public IJSONSerializable
 
     inline void fadeAllChannelsToBlackBy(uint8_t fadeValue) const
     {
-        for (int i = 0; i < _cLEDs; i++)
-            fadePixelToBlackOnAllChannelsBy(i, fadeValue);
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            _GFX[i]->FadeSpan(0, _cLEDs, fadeValue);
     }
 
     inline void setAllOnAllChannels(uint8_t r, uint8_t g, uint8_t b) const
     {
         for (int n = 0; n < NUM_CHANNELS; n++)    
-            for (int i = 0; i < _cLEDs; i++)
-                _GFX[n]->setPixel(i, r, g, b);
+            _GFX[n]->FillSpan(0, _cLEDs, CRGB(r, g, b));
     }
 
     inline void setPixelOnAllChannels(int i, CRGB c)
@@ -275,10 +304,15 @@ class LEDStripEffect : public IJSONSerializable
             _GFX[j]->setPixel(i, c);
     }
 
+    // setPixelsOnAllChannels
+    //
+    // setPixelsF on every channel, with where the pixels go worked out just once for all of them
+
     inline void setPixelsOnAllChannels(float fPos, float count, CRGB c, bool bMerge = false) const
     {       
+        const FractionalSpan span(fPos, count);
         for (int i = 0; i < NUM_CHANNELS; i++)
-            _GFX[i]->setPixelsF(fPos, count, c, bMerge);
+            _GFX[i]->DrawFractionalSpan(span, c, bMerge);
     }
 
     virtual bool SerializeToJSON(JsonObject& jsonObject) 
@@ -37,9 +37,15 @@
 // 
 // A derivation of GFXBase that adds LED-strip-specific functionality
 
-class LEDStripGFX : public GFXBase 
+class LEDStripGFX final : public GFXBase 
 {
-  
+#if PIPELINED_OUTPUT
+    CRGB * _pFrontBuffer;                               // What the output task is showing, while we draw into leds
+#endif
+#if ZERO_COPY_WIFI
+    CRGB * _pShowFrom = nullptr;                        // A WiFi frame's own pixels, shown instead of leds
+#endif
+
 public:
 
     LEDStripGFX(size_t w, size_t h) : GFXBase(w, h)
@@ -49,6 +55,14 @@ public:
         {
             throw std::runtime_error("Unable to allocate LEDs in LEDStripGFX");
         }
+
+        #if PIPELINED_OUTPUT
+            _pFrontBuffer = static_cast<CRGB *>(calloc(w * h, sizeof(CRGB)));
+            if (!_pFrontBuffer)
+            {
+                throw std::runtime_error("Unable to allocate front LED buffer in LEDStripGFX");
+            }
+        #endif
     }
 
     CRGB * GetLEDBuffer() const
@@ -60,41 +74,124 @@ public:
     {
         free(leds);
         leds = nullptr;
+
+        #if PIPELINED_OUTPUT
+            free(_pFrontBuffer);
+            _pFrontBuffer = nullptr;
+        #endif
+    }
+
+#if PIPELINED_OUTPUT
+
+    CRGB * GetFrontBuffer() const
+    {
+        return _pFrontBuffer;
+    }
+
+    // SwapLEDBuffers
+    //
+    // Makes the frame just drawn the front buffer, for the output task to show, and gives us the old front buffer
+    // to draw the next one into.  Only call this while the output task is idle.  It never copies anything.
+
+    void SwapLEDBuffers()
+    {
+        std::swap(leds, _pFrontBuffer);
+    }
+
+    // PreserveFrontBuffer
+    //
+    // An effect that draws over its last frame rather than starting from scratch (see RequiresfloatBuffering)
+    // needs that frame back after a swap, and this brings it over.  It only reads the front buffer, so it can run
+    // while the output task is showing it.
+
+    void PreserveFrontBuffer()
+    {
+        memcpy(leds, _pFrontBuffer, sizeof(CRGB) * _width * _height);
+    }
+
+#endif
+
+#if ZERO_COPY_WIFI
+
+    // ShowFrom
+    //
+    // Has the next show use pLeds (the pixels of a WiFi frame already in our layout; see IsWireLayout) in place
+    // of leds, which are left as they were.  They must stay put until the strip has been shown, after which
+    // ShowFrom(nullptr) goes back to leds.
+
+    void ShowFrom(CRGB * pLeds)
+    {
+        _pShowFrom = pLeds;
+    }
+
+#endif
+
+    // OutputBuffer
+    //
+    // The pixels the next show will send to the strip
+
+    CRGB * OutputBuffer() const
+    {
+        #if ZERO_COPY_WIFI
+            if (_pShowFrom)
+                return _pShowFrom;
+        #endif
+        return leds;
     }
 
     virtual size_t GetLEDCount() const
     {
         return NUM_LEDS;
     }
-    
-    inline uint16_t getPixelIndex(int16_t x, int16_t y) const
+
+    // HashLeds
+    //
+    // FNV-1a over the first count pixels about to be shown, a word at a time, continuing from hash.  Every step of
+    // it can be undone, so two frames that differ in only one word always hash differently; anything else has a
+    // one in four billion chance of looking unchanged, which SKIP_UNCHANGED_REFRESH_MS puts right soon enough.
+
+    uint32_t HashLeds(size_t count, uint32_t hash = 2166136261u) const
     {
-        if (x & 0x01)
-        {
-          // Odd rows run backwards
-          uint8_t reverseY = (_height - 1) - y;
-          return (x * _height) + reverseY;
-        }
-        else
+        const uint8_t * pBytes = reinterpret_cast<const uint8_t *>(OutputBuffer());
+        const size_t    cBytes = count * sizeof(CRGB);
+        size_t i = 0;
+
+        for (; i + sizeof(uint32_t) <= cBytes; i += sizeof(uint32_t))
         {
-          // Even rows run forwards
-          return (x * _height) + y;
+            uint32_t word;
+            memcpy(&word, pBytes + i, sizeof(word));
+            hash = (hash ^ word) * 16777619u;
         }
+        for (; i < cBytes; i++)
+            hash = (hash ^ pBytes[i]) * 16777619u;
+
+        return hash;
     }
+    
+    inline uint16_t getPixelIndex(int16_t x, int16_t y) const
+    {
+        return xy(x, y);
+    }
+
+    // getPixel
+    //
+    // Only checks the pixel is there with CHECKED_PIXEL_ACCESS (see globals.h)
 
     inline CRGB getPixel(int16_t x) const
     {
-        if (x >= 0 && x < MATRIX_WIDTH * MATRIX_HEIGHT)
-            return leds[x];
-        else
-            throw std::runtime_error(str_sprintf("Invalid index in getPixel: x=%d, NUM_LEDS=%d", x, NUM_LEDS).c_str());
+        #if CHECKED_PIXEL_ACCESS
+            if (x < 0 || x >= MATRIX_WIDTH * MATRIX_HEIGHT)
+                throw std::runtime_error(str_sprintf("Invalid index in getPixel: x=%d, NUM_LEDS=%d", x, NUM_LEDS).c_str());
+        #endif
+        return leds[x];
     }
 
     inline CRGB getPixel(int16_t x, int16_t y) const
     {
-        if (x >= 0 && x < MATRIX_WIDTH && y >= 0 && y < MATRIX_HEIGHT)
-            return leds[xy(x, y)];
-        else
-            throw std::runtime_error(str_sprintf("Invalid index in getPixel: x=%d, y=%d, NUM_LEDS=%d", x, y, NUM_LEDS).c_str());
+        #if CHECKED_PIXEL_ACCESS
+            if (x < 0 || x >= MATRIX_WIDTH || y < 0 || y >= MATRIX_HEIGHT)
+                throw std::runtime_error(str_sprintf("Invalid index in getPixel: x=%d, y=%d, NUM_LEDS=%d", x, y, NUM_LEDS).c_str());
+        #endif
+        return leds[xy(x, y)];
     }
 };
@@ -0,0 +1,223 @@
+//+--------------------------------------------------------------------------
+//
+// File:        lifeworld.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    The world PatternLife plays the Game of Life in.  Each cell is a
+//    single bit, so a whole generation can be worked out 32 cells at a
+//    time, and the hue and brightness each cell is drawn in are kept in
+//    arrays of their own.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// LifeWorld
+//
+// Each row of cells is packed into words, the cell at x in bit x % 32 of word x / 32, and the world wraps around at
+// its edges.  To step a generation, each word of a row is shifted a cell either way, along with the words above and
+// below it, to line up all eight neighbors of its 32 cells, and those eight are added up a bit at a time, as an
+// adder would, to tell which cells have two or three of them.
+//
+// The hue and brightness planes are one byte per cell, row by row.  A cell that's born is drawn at full brightness
+// in the next hue along and one that dies goes dark; nothing else changes them but Dim.  As only the cells that are
+// born or die need touching, they're found a bit at a time in the words that say which ones did.
+
+template <size_t Width, size_t Height>
+class LifeWorld
+{
+    static_assert(Width > 0 && Height > 0, "LifeWorld needs at least one cell");
+
+    static constexpr size_t   WordsPerRow = (Width + 31) / 32;
+    static constexpr size_t   LastBit     = (Width - 1) % 32;                   // Bit the last cell of a row is in
+    static constexpr uint32_t LastMask    = LastBit == 31 ? ~0u : (1u << (LastBit + 1)) - 1;
+
+    using Rows = uint32_t[Height][WordsPerRow];
+
+    Rows    _cells[2] = { };                    // This generation and the next, alternately
+    size_t  _current = 0;
+    uint8_t _hue[Height][Width] = { };
+    uint8_t _brightness[Height][Width] = { };
+
+    // West and East
+    //
+    // Word k of row lined up with the cells to the west (x - 1) and east (x + 1) of its own, wrapping around the
+    // ends of the row
+
+    static inline uint32_t West(const uint32_t * row, size_t k)
+    {
+        return (row[k] << 1) | (k ? row[k - 1] >> 31 : (row[WordsPerRow - 1] >> LastBit) & 1);
+    }
+
+    static inline uint32_t East(const uint32_t * row, size_t k)
+    {
+        return (row[k] >> 1) | (k + 1 < WordsPerRow ? row[k + 1] << 31 : (row[0] & 1) << LastBit);
+    }
+
+    static inline void FullAdd(uint32_t a, uint32_t b, uint32_t c, uint32_t & sum, uint32_t & carry)
+    {
+        sum   = a ^ b ^ c;
+        carry = (a & b) | (c & (a ^ b));
+    }
+
+    // NextWord
+    //
+    // Which of the cells in word k of row live on into the next generation, given the rows above and below it
+
+    static inline uint32_t NextWord(const uint32_t * above, const uint32_t * row, const uint32_t * below, size_t k)
+    {
+        uint32_t onesAbove, twosAbove, onesBelow, twosBelow;
+        FullAdd(West(above, k), above[k], East(above, k), onesAbove, twosAbove);
+        FullAdd(West(below, k), below[k], East(below, k), onesBelow, twosBelow);
+
+        const uint32_t west = West(row, k), east = East(row, k);
+        const uint32_t onesRow = west ^ east, twosRow = west & east;
+
+        uint32_t ones, carry, twos, fours;
+        FullAdd(onesAbove, onesBelow, onesRow, ones, carry);
+        FullAdd(twosAbove, twosBelow, twosRow, twos, fours);
+
+        // carry and the three twos together make up the 2s and 4s; a cell with four or more neighbors dies
+
+        const uint32_t twosBit = twos ^ carry;
+        const uint32_t anyFour = fours | (twos & carry);
+
+        // Three neighbors bring a cell to life, and two keep a live one going
+
+        uint32_t next = twosBit & ~anyFour & (ones | row[k]);
+        return k + 1 < WordsPerRow ? next : next & LastMask;
+    }
+
+    // UpdatePlanes
+    //
+    // Lights and darkens the cells of word k of row y, which were alive where was is set and are alive where now is
+
+    inline void UpdatePlanes(size_t y, size_t k, uint32_t was, uint32_t now)
+    {
+        uint8_t * pBrightness = &_brightness[y][k * 32];
+        uint8_t * pHue        = &_hue[y][k * 32];
+
+        for (uint32_t born = now & ~was; born; born &= born - 1)
+        {
+            const int bit = __builtin_ctz(born);
+            pBrightness[bit] = 255;
+            pHue[bit]++;
+        }
+
+        for (uint32_t died = was & ~now; died; died &= died - 1)
+            pBrightness[__builtin_ctz(died)] = 0;
+    }
+
+  public:
+
+    // Clear
+    //
+    // Kills every cell and darkens the whole world
+
+    void Clear()
+    {
+        memset(_cells[_current], 0, sizeof(Rows));
+        memset(_hue, 0, sizeof(_hue));
+        memset(_brightness, 0, sizeof(_brightness));
+    }
+
+    // Set
+    //
+    // Brings the cell at x, y to life or kills it, drawing it at brightness, which should be 0 for a dead one
+
+    void Set(size_t x, size_t y, bool bAlive, uint8_t brightness)
+    {
+        uint32_t & word = _cells[_current][y][x / 32];
+        const uint32_t bit = 1u << (x % 32);
+        word = bAlive ? word | bit : word & ~bit;
+        _brightness[y][x] = brightness;
+    }
+
+    bool IsAlive(size_t x, size_t y) const
+    {
+        return _cells[_current][y][x / 32] & (1u << (x % 32));
+    }
+
+    uint8_t Hue(size_t x, size_t y) const
+    {
+        return _hue[y][x];
+    }
+
+    uint8_t Brightness(size_t x, size_t y) const
+    {
+        return _brightness[y][x];
+    }
+
+    // Cells and CellsSize
+    //
+    // The packed cells of this generation, for checksums.  Only the cells themselves are in them, not how they're
+    // drawn.
+
+    const uint32_t * Cells() const
+    {
+        return &_cells[_current][0][0];
+    }
+
+    static constexpr size_t CellsSize()
+    {
+        return sizeof(Rows);
+    }
+
+    // Step
+    //
+    // Works out the next generation and makes it this one
+
+    void Step()
+    {
+        const Rows & was = _cells[_current];
+        Rows & now = _cells[_current ^ 1];
+
+        for (size_t y = 0; y < Height; y++)
+        {
+            const uint32_t * above = was[y ? y - 1 : Height - 1];
+            const uint32_t * below = was[y + 1 < Height ? y + 1 : 0];
+            for (size_t k = 0; k < WordsPerRow; k++)
+            {
+                now[y][k] = NextWord(above, was[y], below, k);
+                UpdatePlanes(y, k, was[y][k], now[y][k]);
+            }
+        }
+
+        _current ^= 1;
+    }
+
+    // Dim
+    //
+    // Takes a tenth off the brightness of every cell, as the world fades out before it starts over
+
+    void Dim()
+    {
+        for (auto & row : _brightness)
+            for (auto & brightness : row)
+                brightness = brightness * 9 / 10;
+    }
+};
@@ -37,6 +37,7 @@
 #include <WiFiUdp.h>
 #include <mutex>
 #include "secrets.h"
+#include "timebase.h"
 
 // NTPTimeClient
 //
@@ -158,12 +159,14 @@ class NTPTimeClient
         timeval tvOld;
         gettimeofday(&tvOld, nullptr);
 
-        float dOld = tvOld.tv_sec + (tvOld.tv_usec / (float) MICROS_PER_SECOND);
-        float dNew = tvNew.tv_sec + (tvNew.tv_usec / (float) MICROS_PER_SECOND);
+        // Compared in microseconds, as a float of seconds since 1970 can't see a difference of less than minutes
+
+        double dNew   = Timebase::FromTimeval(tvNew) / (double) MICROS_PER_SECOND;
+        double dDelta = Timebase::MicrosBetween(Timebase::FromTimeval(tvOld), Timebase::FromTimeval(tvNew)) / (double) MICROS_PER_SECOND;
+        double delta  = fabs(dDelta);
 
         // If the clock is off by more than a quarter second, update it
 
-        auto delta = fabs(dNew - dOld);
         if (delta < 0.25)
         {
             debugV("Clock is only off by %lf so not updating the RTC.", delta);
@@ -172,6 +175,7 @@ class NTPTimeClient
         {
             debugV("Adjusting time by %lf to %lf", delta, dNew);
             settimeofday(&tvNew, NULL);                                 // Set the ESP32 rtc.
+            Timebase::SetWallClock(Timebase::FromTimeval(tvNew));       // And move the wall clock by the same step
             time_t newtime = time(NULL);
             debugV("New Time: %s", ctime(&newtime));
         }
@@ -185,7 +189,7 @@ class NTPTimeClient
         debugV("NTP clock: response received, time written to ESP32 rtc: %ld.%ld, DELTA: %lf\n", 
                 tvNew.tv_sec, 
                 tvNew.tv_usec, 
-                dNew - dOld );
+                dDelta );
         
         _bClockSet = true;  // Clock has been set at least once
         
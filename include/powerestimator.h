@@ -0,0 +1,164 @@
+//+--------------------------------------------------------------------------
+//
+// File:        powerestimator.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Works out how much power a frame will draw, and how far to scale its
+//    brightness back to stay within the power supply's limit.  The answer
+//    matches FastLED's power_mgt, but the pixels are summed in one pass,
+//    several bytes at a time, rather than a channel at a time.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "PowerEstimator expects the bytes of a word in little-endian order");
+
+// ColorSums
+//
+// The red, green and blue values of a run of pixels, each added up
+
+struct ColorSums
+{
+    uint32_t red   = 0;
+    uint32_t green = 0;
+    uint32_t blue  = 0;
+    uint32_t count = 0;
+
+    ColorSums & operator+=(const ColorSums & other)
+    {
+        red   += other.red;
+        green += other.green;
+        blue  += other.blue;
+        count += other.count;
+        return *this;
+    }
+};
+
+// PowerEstimator
+//
+// The per-color costs are FastLED's (from power_mgt.cpp, where they're private), so these come out exactly as
+// calculate_unscaled_power_mW and calculate_max_brightness_for_power_mW would.
+
+class PowerEstimator
+{
+    static constexpr uint32_t EvenBytes = 0x00FF00FF;
+
+  public:
+
+    static constexpr uint32_t Red_mW   = 16 * 5;        // 16mA at 5V
+    static constexpr uint32_t Green_mW = 11 * 5;
+    static constexpr uint32_t Blue_mW  = 15 * 5;
+    static constexpr uint32_t Dark_mW  =  1 * 5;        // What a pixel draws when it's off
+    static constexpr uint32_t MCU_mW   = 25 * 5;        // What the board draws
+
+    // SumColors
+    //
+    // Adds up the colors of count pixels of three bytes each (red, green and blue, as CRGB has them).  Four
+    // pixels take three words, and across those three words each byte position always holds the same color, so
+    // we add the words up two bytes at a time in 16-bit lanes, and only sort out which lane was which color at
+    // the end.  A lane can take 257 bytes of 255 before it overflows, so we empty them every 256 groups.
+
+    static ColorSums SumColors(const void * pPixels, size_t count)
+    {
+        const uint8_t * pBytes = static_cast<const uint8_t *>(pPixels);
+        ColorSums sums;
+        sums.count = count;
+
+        size_t cGroups = count / 4;
+        if ((reinterpret_cast<uintptr_t>(pBytes) & 3) != 0)
+            cGroups = 0;                                // Not word aligned, so do them all the slow way below
+
+        uint32_t bytes[3][4] = { };                     // Totals for each byte position of each word in a group
+
+        while (cGroups)
+        {
+            size_t   cBatch = std::min<size_t>(cGroups, 256);
+            uint32_t even[3] = { }, odd[3] = { };
+
+            for (size_t i = 0; i < cBatch; i++, pBytes += 12)
+            {
+                const uint8_t * pAligned = static_cast<const uint8_t *>(__builtin_assume_aligned(pBytes, 4));
+                uint32_t words[3];
+                memcpy(words, pAligned, sizeof(words));
+
+                for (int w = 0; w < 3; w++)
+                {
+                    even[w] += words[w] & EvenBytes;
+                    odd[w]  += (words[w] >> 8) & EvenBytes;
+                }
+            }
+
+            for (int w = 0; w < 3; w++)
+            {
+                bytes[w][0] += even[w] & 0xFFFF;
+                bytes[w][2] += even[w] >> 16;
+                bytes[w][1] += odd[w] & 0xFFFF;
+                bytes[w][3] += odd[w] >> 16;
+            }
+            cGroups -= cBatch;
+        }
+
+        // The words of a group hold R G B R, G B R G, and B R G B
+
+        sums.red   = bytes[0][0] + bytes[0][3] + bytes[1][2] + bytes[2][1];
+        sums.green = bytes[0][1] + bytes[1][0] + bytes[1][3] + bytes[2][2];
+        sums.blue  = bytes[0][2] + bytes[1][1] + bytes[2][0] + bytes[2][3];
+
+        const uint8_t * pEnd = static_cast<const uint8_t *>(pPixels) + count * 3;
+        for (; pBytes < pEnd; pBytes += 3)
+        {
+            sums.red   += pBytes[0];
+            sums.green += pBytes[1];
+            sums.blue  += pBytes[2];
+        }
+        return sums;
+    }
+
+    // UnscaledPower_mW
+    //
+    // What pixels with these sums would draw at full brightness
+
+    static uint32_t UnscaledPower_mW(const ColorSums & sums)
+    {
+        return ((sums.red * Red_mW) >> 8) + ((sums.green * Green_mW) >> 8) + ((sums.blue * Blue_mW) >> 8) + Dark_mW * sums.count;
+    }
+
+    // LimitBrightness
+    //
+    // The brightness to use instead of target_brightness so that pixels drawing total_mW unscaled, plus the board
+    // itself, stay within max_power_mW
+
+    static uint8_t LimitBrightness(uint8_t target_brightness, uint32_t total_mW, uint32_t max_power_mW)
+    {
+        uint32_t requested_power_mW = ((total_mW + MCU_mW) * target_brightness) / 256;
+        if (requested_power_mW <= max_power_mW)
+            return target_brightness;
+        return (target_brightness * max_power_mW) / requested_power_mW;
+    }
+};
@@ -235,7 +235,7 @@ class RemoteControl
         else if (IR_SMOOTH == result)
         {
             g_aptrEffectManager->ClearRemoteColor();
-            g_aptrEffectManager->SetInterval(EffectManager<GFXBase>::csSmoothButtonSpeed);
+            g_aptrEffectManager->SetInterval(EffectManager<DeviceGFX>::csSmoothButtonSpeed);
         }
         else if (IR_STROBE == result)
         {
@@ -33,8 +33,13 @@
 #include <sys/socket.h> 
 #include <stdlib.h> 
 #include <netinet/in.h> 
+#include <fcntl.h>
+#include <sys/select.h>
 #include <string.h> 
+#include <stddef.h>
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <iostream>
 
 #include "ledbuffer.h"
@@ -46,6 +51,7 @@ extern "C"
 
 #define STANDARD_DATA_HEADER_SIZE   24                                              // Size of the header for expanded data
 #define COMPRESSED_HEADER_SIZE      16                                              // Size of the header for compressed data
+#define DELTA_DATA_HEADER_SIZE      40                                              // Standard header plus the base frame's timestamp
 #define LED_DATA_SIZE                3                                              // Data size of an LED (24 bits or 3 bytes)
 
 // We allocate whatever the max packet is, and use it to validate incoming packets, so right now it's set to the maxiumum
@@ -55,6 +61,52 @@ extern "C"
             (STANDARD_DATA_HEADER_SIZE + LED_DATA_SIZE * NUM_LEDS)                  // Header plus 24 bits per actual LED
 
 #define COMPRESSED_HEADER (0x44415645)                                              // asci "DAVE" as header 
+
+// A WIFI_COMMAND_PIXELBATCH64 packet carries several frames, so once compressed it can expand to much more than
+// one frame's worth.  Compressed batches are inflated a frame at a time straight into the LEDBuffers, with LZ77
+// back-references resolved from a dictionary ring, so senders must not use a bigger window than the ring.
+
+#ifndef MAX_BATCH_FRAMES
+#define MAX_BATCH_FRAMES            32                                              // Most frames a batch can carry
+#endif
+
+#ifndef BATCH_DICTIONARY_SIZE
+#define BATCH_DICTIONARY_SIZE       32768                                           // Size of the dictionary ring for compressed batches
+#endif
+
+#define MAXIUMUM_BATCH_SIZE \
+            (STANDARD_DATA_HEADER_SIZE + MAX_BATCH_FRAMES * MAXIUMUM_PACKET_SIZE)   // Batch header plus the most frames it can carry
+
+#ifndef MAX_SOCKET_CONNECTIONS
+#define MAX_SOCKET_CONNECTIONS      4                                               // How many senders can be connected at once
+#endif
+
+#ifndef SOCKET_IDLE_TIMEOUT_MS
+#define SOCKET_IDLE_TIMEOUT_MS      3000                                            // Close a connection that sends nothing for this long
+#endif
+
+#define SOCKET_SELECT_TIMEOUT_MS    100                                             // How long select() waits before we check for timeouts
+
+#ifndef STREAMING_INFLATE
+#define STREAMING_INFLATE           0                                               // Inflate compressed packets while they arrive
+#endif
+
+#define STREAMING_WINDOW_SIZE       256                                             // Compressed bytes read from the socket at a time when streaming
+
+#ifndef STREAMING_WAIT_MS
+#define STREAMING_WAIT_MS           10                                              // Longest a streaming packet may go without data before it's dropped
+#endif
+
+// Optionally, the same packets can also be sent as UDP datagrams to the same port number, and if UDP_MULTICAST_GROUP
+// is defined (as a string like "239.0.0.49") to a multicast group, so that one stream can feed many devices
+
+#ifndef INCOMING_UDP_ENABLED
+#define INCOMING_UDP_ENABLED        0
+#endif
+
+#if INCOMING_UDP_ENABLED
+#include "udpreceiver.h"
+#endif
 bool ProcessIncomingData(uint8_t * payloadData, size_t payloadLength);              // In main file
 
 #if ENABLE_WIFI && INCOMING_WIFI_ENABLED
@@ -86,12 +138,164 @@ static_assert(sizeof(float)  == 4);             // PeakData on wire uses 4 byte
 
 static_assert( sizeof(SocketResponse) == 64, "SocketResponse struct size is not what is expected - check alignment and float size" );            
 
+// SocketResponseV2
+//
+// Sent instead of a SocketResponse to a sender that has asked for it with WIFI_COMMAND_RESPONSEVERSION.  It
+// starts with an ordinary SocketResponse (whose size field then covers the whole thing) so older readers
+// still work, followed by the frame counters and latency histograms from g_Telemetry.  The counts all go up
+// from boot, so a sender wanting rates should difference two responses.
+
+struct SocketResponseV2
+{
+    SocketResponse  base;                                           // 64
+    uint32_t        version;                                        // 4
+    uint32_t        framesLate;                                     // 4
+    uint32_t        framesDropped;                                  // 4
+    uint32_t        bucketCount;                                    // 4
+    uint32_t        receive[TELEMETRY_HISTOGRAM_BUCKETS];           // 64
+    uint32_t        decompress[TELEMETRY_HISTOGRAM_BUCKETS];        // 64
+    uint32_t        queueResidency[TELEMETRY_HISTOGRAM_BUCKETS];    // 64
+    uint32_t        drawToShow[TELEMETRY_HISTOGRAM_BUCKETS];        // 64
+};
+
+static_assert( sizeof(SocketResponseV2) == 336, "SocketResponseV2 struct size is not what is expected - check alignment" );
+
+// SocketResponseV3
+//
+// A SocketResponseV2 followed by what the first channel's LEDBufferManager has worked out about the network (see
+// JitterEstimator), so that a sender can move its lead time towards recommendedLead.  Times are microseconds.
+// Frames dropped late were skipped because a later one was due, and those evicted were lost to a full ring;
+// together they make up the V2 framesDropped, which also counts other channels.
+
+#define SOCKET_RESPONSE_VERSION 3
+
+struct SocketResponseV3
+{
+    SocketResponseV2    v2;                                         // 336
+    int32_t             averageLead;                                // 4
+    uint32_t            jitter;                                     // 4
+    uint32_t            recommendedLead;                            // 4
+    uint32_t            recommendedDepth;                           // 4
+    uint32_t            framesDroppedLate;                          // 4
+    uint32_t            framesEvicted;                              // 4
+};
+
+static_assert( sizeof(SocketResponseV3) == 360, "SocketResponseV3 struct size is not what is expected - check alignment" );
+static_assert( STANDARD_DATA_HEADER_SIZE == LEDBuffer::cbWireHeader, "LEDBuffer wire storage must match the data header size" );
+static_assert( DELTA_DATA_HEADER_SIZE == LEDBuffer::cbDeltaHeader, "LEDBuffer delta parsing must match the delta header size" );
+
 extern AppTime g_AppTime;
 extern std::unique_ptr<LEDBufferManager> g_aptrBufferManager[NUM_CHANNELS];
 extern uint32_t g_FPS;
 extern float g_Brite;
 extern uint32_t g_Watts; 
 
+// SocketConnection
+//
+// State for one connected sender.  Each connection has its own receive buffer and its own count of how far
+// into the current packet it is, so several senders (pixels on one socket, audio peaks on another, for
+// example) can be serviced at once without any of them waiting for the others to disconnect.
+
+struct SocketConnection
+{
+    int                         _socket = -1;
+    std::unique_ptr<uint8_t []> _pBuffer;
+    size_t                      _cbBuffer = 0;
+    size_t                      _cbReceived = 0;
+    unsigned long               _msLastData = 0;
+    unsigned long               _usPacketStart = 0;         // When the first byte of the current packet arrived
+    unsigned long               _usLastPacketTime = 0;      // First byte to processed for the last packet
+    uint32_t                    _cPackets = 0;
+    uint32_t                    _responseVersion = 1;       // Which SocketResponse the sender asked for
+    size_t                      _cbDiscard = 0;             // Bytes of a dropped streaming packet still to be read and thrown away
+
+    bool IsOpen() const
+    {
+        return _socket >= 0;
+    }
+};
+
+// StreamingSource
+//
+// With STREAMING_INFLATE, lets uzlib pull a compressed packet straight off a connection's socket as it needs
+// it, a window at a time, so no more than a window of it is ever held in memory.  The uzlib state must come
+// first, as the read callback only gets a pointer to that.
+
+struct StreamingSource
+{
+    struct uzlib_uncomp d = { 0 };
+    SocketConnection *  _pConn = nullptr;
+    size_t              _cbRemaining = 0;                   // Compressed bytes of the packet still on the socket
+    unsigned long       _usWaited = 0;                      // Time spent waiting since any of them last arrived
+    bool                _bStalled = false;                  // Gave up waiting, so the packet is being dropped
+    uint8_t             _abWindow[STREAMING_WINDOW_SIZE];
+
+    // ReadFromSocket
+    //
+    // uzlib's source_read_cb.  Refills the window with as much of the packet as has arrived, points uzlib's
+    // source at it and returns its first byte.  If nothing has arrived it waits, since the packet is on its
+    // way, but every other connection waits with it, so once STREAMING_WAIT_MS passes with nothing arriving the
+    // packet is taken to have stalled.  Returns -1 if the packet won't finish, or has stalled, in which case
+    // _bStalled is set.  Once the last byte is in, the receive time is
+    // recorded just as it is for a packet received in full.
+
+    static int ReadFromSocket(struct uzlib_uncomp * pd)
+    {
+        auto pSource = reinterpret_cast<StreamingSource *>(pd);
+        auto & conn  = *pSource->_pConn;
+        if (pSource->_cbRemaining == 0)
+            return -1;
+
+        for (;;)
+        {
+            int cbRead = read(conn._socket, pSource->_abWindow, std::min(sizeof(pSource->_abWindow), pSource->_cbRemaining));
+            if (cbRead > 0)
+            {
+                conn._msLastData = millis();
+                pSource->_usWaited = 0;
+                pSource->_cbRemaining -= cbRead;
+                if (pSource->_cbRemaining == 0)
+                    g_Telemetry._receive.Add(micros() - conn._usPacketStart);
+
+                pd->source       = pSource->_abWindow + 1;
+                pd->source_limit = pSource->_abWindow + cbRead;
+                return pSource->_abWindow[0];
+            }
+            if (cbRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                debugW("Connection closed partway through a compressed packet");
+                return -1;
+            }
+
+            const unsigned long usBudget = STREAMING_WAIT_MS * MICROS_PER_MILLI;
+            if (pSource->_usWaited >= usBudget)
+            {
+                pSource->_bStalled = true;
+                return -1;
+            }
+
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(conn._socket, &readSet);
+
+            struct timeval to;
+            to.tv_sec  = (usBudget - pSource->_usWaited) / (MILLIS_PER_SECOND * MICROS_PER_MILLI);
+            to.tv_usec = (usBudget - pSource->_usWaited) % (MILLIS_PER_SECOND * MICROS_PER_MILLI);
+
+            unsigned long usStart = micros();
+            int res = select(conn._socket + 1, &readSet, nullptr, nullptr, &to);
+            pSource->_usWaited += std::max(micros() - usStart, 1UL);
+            if (res < 0)
+            {
+                debugW("Error waiting for the rest of a compressed packet");
+                return -1;
+            }
+        }
+    }
+};
+
+static_assert( offsetof(StreamingSource, d) == 0, "StreamingSource::ReadFromSocket relies on the uzlib state coming first" );
+
 // SocketServer
 //
 // Handles incoming connections from the server and pass the data that comes in 
@@ -104,27 +308,34 @@ private:
     int                    _numLeds;
     int                    _server_fd;
     struct sockaddr_in     _address; 
-    std::unique_ptr<uint8_t []> _pBuffer;
     std::unique_ptr<uint8_t []> _abOutputBuffer;
+    std::unique_ptr<uint8_t []> _pDictionary;                                       // Allocated on the first compressed batch
 
 public:
 
-    size_t              _cbReceived;
+    SocketConnection    _connections[MAX_SOCKET_CONNECTIONS];
+
+    #if INCOMING_UDP_ENABLED
+        UdpReceiver     _udp;
+    #endif
 
     SocketServer(int port, int numLeds) :
         _port(port),
         _numLeds(numLeds),
-        _server_fd(0),
-        _cbReceived(0)
+        _server_fd(0)
     {
-        _abOutputBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE);
+        _abOutputBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE + 1);       // Spare byte for InflateInto
         memset(&_address, 0, sizeof(_address));
     }
 
     void release()
     {
-        _pBuffer.release();
-        _pBuffer = nullptr;
+        for (auto & conn : _connections)
+            CloseConnection(conn);
+
+        #if INCOMING_UDP_ENABLED
+            _udp.release();
+        #endif
 
         if (_server_fd)
         {
@@ -135,10 +346,6 @@ public:
 
     bool begin()
     {
-        _pBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE);
-
-        _cbReceived = 0;
-        
         // Creating socket file descriptor 
 
         if ((_server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) 
@@ -165,318 +372,745 @@ public:
             release();
             return false;
         } 
+        if (false == SetNonBlocking(_server_fd))
+        {
+            debugW("Unable to make server socket non-blocking\n");
+            release();
+            return false;
+        }
+
+        // Not being able to listen for UDP isn't fatal, as TCP still works
+
+        #if INCOMING_UDP_ENABLED
+            #ifdef UDP_MULTICAST_GROUP
+                _udp.begin(_port, UDP_MULTICAST_GROUP);
+            #else
+                _udp.begin(_port, nullptr);
+            #endif
+        #endif
+
         return true;
     }
 
-    void ResetReadBuffer()
-    {   
-        _cbReceived = 0;
+    // ConnectionCount
+    //
+    // Number of senders currently connected
+
+    size_t ConnectionCount() const
+    {
+        size_t count = 0;
+        for (const auto & conn : _connections)
+            if (conn.IsOpen())
+                count++;
+        return count;
+    }
+
+    // SetNonBlocking
+    //
+    // Puts a socket into non-blocking mode so that reads return whatever is available rather than waiting
+
+    static bool SetNonBlocking(int socket)
+    {
+        int flags = fcntl(socket, F_GETFL, 0);
+        if (flags < 0)
+            return false;
+        return fcntl(socket, F_SETFL, flags | O_NONBLOCK) >= 0;
+    }
+
+    void CloseConnection(SocketConnection & conn)
+    {
+        if (conn.IsOpen())
+            close(conn._socket);
+
+        conn._socket     = -1;
+        conn._cbReceived = 0;
+        conn._cPackets   = 0;
+        conn._cbBuffer   = 0;
+        conn._responseVersion = 1;
+        conn._cbDiscard  = 0;
+        conn._pBuffer.reset();
     }
 
-    // ReadUntilNBytesReceived
+    // AcceptNewConnection
     //
-    // Read from the socket until the buffer contains at least cbNeeded bytes
+    // Accepts a pending connection into a free slot, giving it a receive buffer of its own
 
-    bool ReadUntilNBytesReceived(size_t socket, size_t cbNeeded)
+    bool AcceptNewConnection()
     {
-        if (cbNeeded <= _cbReceived)                            // If we already have that many bytes, we're already done
+        auto pSlot = std::find_if(std::begin(_connections), std::end(_connections), [](const SocketConnection & c) { return !c.IsOpen(); });
+        if (pSlot == std::end(_connections))
         {
-            debugV("Already had enough data to satisfy read: requested %d, had %d", cbNeeded, _cbReceived); 
-            return true;
+            debugW("No free connection slots, leaving connection pending");
+            return false;
         }
 
-        // This test caps maximum packet size as a full buffer read of LED data.  If other packets wind up being longer,
-        // the buffer itself and this test might need to change
-        
-        if (cbNeeded > MAXIUMUM_PACKET_SIZE)
+        struct sockaddr_in addr;
+        socklen_t addr_size = sizeof(addr);
+        int new_socket = accept(_server_fd, (struct sockaddr *)&addr, &addr_size);
+        if (new_socket < 0) 
+        { 
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                debugW("Error accepting data!");
+            return false;
+        } 
+
+        // Report where this connection is coming from 
+
+        debugV("Incoming connection from: %s", inet_ntoa(addr.sin_addr));
+
+        if (false == SetNonBlocking(new_socket))
         {
-            debugW("Unexpected request for %d bytes in ReadUntilNBytesReceived\n", cbNeeded);
+            debugW("Unable to make socket non-blocking!");
+            close(new_socket);
             return false;
         }
 
-        do
+        // When streaming, compressed packets never need more than the header in the buffer, so we start small
+        // and only grow it if an uncompressed packet comes along
+
+        pSlot->_socket     = new_socket;
+        pSlot->_cbBuffer   = STREAMING_INFLATE ? STANDARD_DATA_HEADER_SIZE : MAXIUMUM_PACKET_SIZE;
+        pSlot->_pBuffer    = std::make_unique<uint8_t []>(pSlot->_cbBuffer);
+        pSlot->_cbReceived = 0;
+        pSlot->_cPackets   = 0;
+        pSlot->_msLastData = millis();
+        return true;
+    }
+
+    // ExpectedPacketSize
+    //
+    // Looks at whatever of the header has arrived so far and works out how many bytes in total the packet at
+    // the front of the buffer needs.  Until the full header is in, that's just the header size.  Returns 0 if
+    // the header is not one we can accept, in which case the connection should be dropped.  A compressed packet
+    // can be shorter than a data header, so until the first four bytes say which it is we only ask for the
+    // smaller compressed header, as anything more might be the start of the next packet.
+
+    size_t ExpectedPacketSize(const uint8_t * pBuffer, size_t cbReceived) const
+    {
+        if (cbReceived < sizeof(uint32_t))
+            return COMPRESSED_HEADER_SIZE;
+
+        if (DWORDFromMemory(&pBuffer[0]) == COMPRESSED_HEADER)
         {
-            // If we're reading at a point in the buffer more than just the header, we're actually transferring data, so light up the LED
+            if (cbReceived < COMPRESSED_HEADER_SIZE)
+                return COMPRESSED_HEADER_SIZE;
 
-            // Read data from the socket until we have _bcNeeded bytes in the buffer
+            uint32_t compressedSize = DWORDFromMemory(&pBuffer[4]);
+            uint32_t expandedSize   = DWORDFromMemory(&pBuffer[8]);
 
-            int cbRead = read(socket, _pBuffer.get() + _cbReceived, cbNeeded - _cbReceived);
+            if (expandedSize > MAXIUMUM_BATCH_SIZE)
+            {
+                debugE("Expanded packet would be %d but the biggest batch is only %d !!!!\n", expandedSize, MAXIUMUM_BATCH_SIZE);
+                return 0;
+            }
+            if (COMPRESSED_HEADER_SIZE + compressedSize > MAXIUMUM_PACKET_SIZE)
+            {
+                debugW("Compressed packet of %u bytes is larger than our buffer\n", compressedSize);
+                return 0;
+            }
+            return COMPRESSED_HEADER_SIZE + compressedSize;
+        }
 
-            // Restore the old state
+        if (cbReceived < STANDARD_DATA_HEADER_SIZE)
+            return STANDARD_DATA_HEADER_SIZE;
 
-            if (cbRead > 0)
+        uint16_t command16 = WORDFromMemory(&pBuffer[0]);
+        uint32_t length32  = DWORDFromMemory(&pBuffer[4]);
+
+        if (command16 == WIFI_COMMAND_PEAKDATA)
+        {
+            size_t totalExpected = STANDARD_DATA_HEADER_SIZE + length32;
+
+            #if ENABLE_AUDIO
+                uint16_t numbands = WORDFromMemory(&pBuffer[2]);
+                if (numbands != NUM_BANDS)
+                {
+                    debugE("Expecting %d bands but received %d", NUM_BANDS, numbands);
+                    return 0;
+                }
+                if (length32 != numbands * sizeof(float))
+                {
+                    debugE("Expecting %d bytes for %d audio bands, but received %d.  Ensure float size and endianness matches between sender and receiver systems.", totalExpected, NUM_BANDS, length32);
+                    return 0;
+                }
+            #endif
+
+            if (totalExpected > MAXIUMUM_PACKET_SIZE)
             {
-                _cbReceived += cbRead;
+                debugW("Peak data of %u bytes is larger than our buffer\n", totalExpected);
+                return 0;
             }
-            else
+            return totalExpected;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELDATA64 || command16 == WIFI_COMMAND_RGB565DATA64 || command16 == WIFI_COMMAND_PALETTEDATA64)
+        {
+            if (length32 > NUM_LEDS)
             {
-                debugW("ERROR: %d bytes read in ReadUntilNBytesReceived trying to read %d\n", cbRead, cbNeeded-_cbReceived);
-                return false;
+                debugW("More pixels promised (%u) than we have LEDs\n", length32);
+                return 0;
+            }
+
+            size_t totalExpected = STANDARD_DATA_HEADER_SIZE + LEDBuffer::PixelDataSize(command16, length32);
+            if (totalExpected > MAXIUMUM_PACKET_SIZE)
+            {
+                debugW("Too many bytes promised (%u) - more than we can use for our LEDs at max packet (%u)\n", totalExpected, MAXIUMUM_PACKET_SIZE);
+                return 0;
             }
-        } while (_cbReceived < cbNeeded);
+            return totalExpected;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELBATCH64)
+        {
+            // Uncompressed, a batch has to fit in the same buffer as any other packet
+
+            size_t totalExpected = STANDARD_DATA_HEADER_SIZE + length32;
+            if (totalExpected > MAXIUMUM_PACKET_SIZE)
+            {
+                debugW("Uncompressed batch of %u bytes is larger than our buffer\n", totalExpected);
+                return 0;
+            }
+            return totalExpected;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELDELTA64)
+        {
+            // Senders are expected to send a keyframe instead whenever the delta would come out bigger
+
+            size_t totalExpected = DELTA_DATA_HEADER_SIZE + length32;
+            if (totalExpected > MAXIUMUM_PACKET_SIZE)
+            {
+                debugW("Delta frame of %u bytes is larger than our buffer\n", totalExpected);
+                return 0;
+            }
+            return totalExpected;
+        }
+        else if (command16 == WIFI_COMMAND_RESPONSEVERSION)
+        {
+            return STANDARD_DATA_HEADER_SIZE;
+        }
+
+        debugW("Unknown command in packet received: %d\n", command16);
+        return 0;
+    }
+
+    // ProcessPacket
+    //
+    // Called once a complete packet has arrived, either in a connection's buffer or reassembled from UDP.
+    // Dispatches it and, for pixel data, lets the caller know it should send a SocketResponse back.  Returns
+    // false if the packet was bad.
+
+    bool ProcessPacket(uint8_t * pBuffer, size_t cbPacket, bool & bSendResponsePacket)
+    {
+        bSendResponsePacket = false;
+
+        if (DWORDFromMemory(&pBuffer[0]) == COMPRESSED_HEADER)
+        {
+            uint32_t compressedSize = DWORDFromMemory(&pBuffer[4]);
+            uint32_t expandedSize   = DWORDFromMemory(&pBuffer[8]);
+            debugV("Compressed Header: compressedSize: %u, expandedSize: %u", compressedSize, expandedSize);
+
+            // The inflater reads its source strictly front to back, which is the access pattern PSRAM handles
+            // well, so we inflate straight out of the receive buffer rather than staging a copy in regular RAM.
+            // Only the output is read back non-linearly (for LZ77 back-references).
+
+            struct uzlib_uncomp d = { 0 };
+            if (!InitDecompressor(d, &pBuffer[COMPRESSED_HEADER_SIZE], compressedSize))
+                return false;
+
+            unsigned long usStart = micros();
+            bool bResult = ProcessCompressedPacket(d, expandedSize, true, bSendResponsePacket);
+            g_Telemetry._decompress.Add(micros() - usStart);
+            return bResult;
+        }
+
+        uint16_t command16 = WORDFromMemory(&pBuffer[0]);
+
+        if (command16 == WIFI_COMMAND_PEAKDATA)
+        {
+            #if ENABLE_AUDIO
+                debugV("PeakData Header: numbands=%u, length=%u", WORDFromMemory(&pBuffer[2]), DWORDFromMemory(&pBuffer[4]));
+
+                if (false == ProcessIncomingData(pBuffer, cbPacket))
+                    return false;
+            #endif
+            return true;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELDATA64 || command16 == WIFI_COMMAND_RGB565DATA64 || command16 == WIFI_COMMAND_PALETTEDATA64)
+        {
+            debugV("Uncompressed Header: command16=%u, channel16=%u, length=%u", command16, WORDFromMemory(&pBuffer[2]), DWORDFromMemory(&pBuffer[4]));
+
+            // Add it to the buffer ring
+            
+            if (false == ProcessIncomingData(pBuffer, cbPacket))
+                return false;
+
+            bSendResponsePacket = true;
+            return true;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELBATCH64)
+        {
+            debugV("Uncompressed Batch Header: length=%u", DWORDFromMemory(&pBuffer[4]));
+
+            if (false == ProcessIncomingData(pBuffer, cbPacket))
+                return false;
+
+            bSendResponsePacket = true;
+            return true;
+        }
+        else if (command16 == WIFI_COMMAND_PIXELDELTA64)
+        {
+            debugV("Delta Header: channel16=%u, length=%u", WORDFromMemory(&pBuffer[2]), DWORDFromMemory(&pBuffer[4]));
+
+            if (false == ProcessIncomingData(pBuffer, cbPacket))
+                return false;
+
+            bSendResponsePacket = true;
+            return true;
+        }
+        else if (command16 == WIFI_COMMAND_RESPONSEVERSION)
+        {
+            // Only means anything on a connection, where ReadFromConnection has already picked it up
+
+            return true;
+        }
+
+        debugW("Unknown command in packet received: %d\n", command16);
+        return false;
+    }
+
+    // ProcessCompressedPacket
+    //
+    // Inflates and dispatches a compressed packet from a decompressor that's been pointed at its stream.  Pixel
+    // data goes directly into the LEDBuffers if bIntoBuffers is set, which holds g_buffer_mutex while inflating,
+    // so it's only for when the whole stream is already in memory.  Batches always go directly into the buffers
+    // as they're too big for anywhere else, and get acknowledged with a SocketResponse.
+
+    bool ProcessCompressedPacket(struct uzlib_uncomp & d, uint32_t expandedSize, bool bIntoBuffers, bool & bSendResponsePacket)
+    {
+        if (expandedSize < STANDARD_DATA_HEADER_SIZE)
+        {
+            debugW("Compressed payload of %u bytes is too small to hold a data header\n", expandedSize);
+            return false;
+        }
+
+        // Inflate just the data header first, so we know where the rest of the payload belongs
+
+        uint8_t * pHeader = _abOutputBuffer.get();
+        if (!InflateInto(d, pHeader, pHeader, STANDARD_DATA_HEADER_SIZE, expandedSize == STANDARD_DATA_HEADER_SIZE))
+        {
+            debugW("Error decompressing data header\n");
+            return false;
+        }
+
+        uint16_t command16 = WORDFromMemory(pHeader);
+
+        if (command16 == WIFI_COMMAND_PIXELBATCH64)
+        {
+            if (!DecompressBatchIntoBuffers(d, pHeader, expandedSize, !bIntoBuffers))
+                return false;
+            bSendResponsePacket = true;
+            return true;
+        }
+
+        if (expandedSize > MAXIUMUM_PACKET_SIZE)
+        {
+            debugW("Expanded packet of %u bytes is larger than our buffer\n", expandedSize);
+            return false;
+        }
+
+        if (bIntoBuffers && command16 == WIFI_COMMAND_PIXELDATA64)
+            return DecompressPixelsIntoBuffers(d, pHeader, expandedSize);
+
+        if (expandedSize > STANDARD_DATA_HEADER_SIZE && !InflateInto(d, pHeader, pHeader + STANDARD_DATA_HEADER_SIZE, expandedSize - STANDARD_DATA_HEADER_SIZE, true))
+        {
+            debugW("Error decompressing data\n");
+            return false;
+        }
+
+        if (false == ProcessIncomingData(pHeader, expandedSize))
+        {
+            debugW("Error processing data\n");
+            return false;
+        }
         return true;
     }
 
-    // SendResponseToServer
+    // ProcessStreamingPacket
     //
-    // After successfully processing a packet of color data, sends a response back to the server with stats and results
+    // With STREAMING_INFLATE, this is called as soon as the header of a compressed packet is in.  The inflater
+    // reads the rest of the packet from the socket itself as it needs it, a window at a time, so decompression
+    // overlaps the transfer and the connection's own buffer never has to hold more than the header.  While it
+    // does, the other connections wait, so if the sender stops sending for STREAMING_WAIT_MS the packet is
+    // dropped:  whatever frames were already added stay, the rest of its bytes are read and thrown away as
+    // they arrive, and no SocketResponse is sent for it.  Since the draw task can't be left waiting on the
+    // network, pixels are inflated to our output buffer and then copied into the LEDBuffer, rather than inflated
+    // straight into it under g_buffer_mutex, so a dropped packet never leaves a partial frame behind.
+
+    bool ProcessStreamingPacket(SocketConnection & conn, bool & bSendResponsePacket)
+    {
+        uint8_t * pBuffer = conn._pBuffer.get();
+        uint32_t compressedSize = DWORDFromMemory(&pBuffer[4]);
+        uint32_t expandedSize   = DWORDFromMemory(&pBuffer[8]);
+        debugV("Streaming Compressed Header: compressedSize: %u, expandedSize: %u", compressedSize, expandedSize);
 
-    bool SendResponseToServer(int socket, void * pData, size_t cbSize)
+        bSendResponsePacket = false;
+
+        // Whatever arrived behind the compressed header along with it is the start of the stream
+
+        size_t cbHave = std::min<size_t>(conn._cbReceived - COMPRESSED_HEADER_SIZE, compressedSize);
+
+        StreamingSource source;
+        source._pConn       = &conn;
+        source._cbRemaining = compressedSize - cbHave;
+        if (source._cbRemaining == 0)
+            g_Telemetry._receive.Add(micros() - conn._usPacketStart);
+
+        // The decompress time here includes waiting for the packet to arrive, since the two overlap
+
+        unsigned long usStart = micros();
+        bool bResult = InitDecompressor(source.d, &pBuffer[COMPRESSED_HEADER_SIZE], cbHave, StreamingSource::ReadFromSocket)
+                    && ProcessCompressedPacket(source.d, expandedSize, false, bSendResponsePacket);
+        g_Telemetry._decompress.Add(micros() - usStart);
+
+        if (source._bStalled)
+        {
+            debugW("Dropping a compressed packet that stalled with %u of its %u bytes still to come", source._cbRemaining, compressedSize);
+            g_Telemetry._cFramesDropped++;
+            conn._cbDiscard     = source._cbRemaining;
+            bSendResponsePacket = false;
+            return true;
+        }
+        if (!bResult)
+            return false;
+
+        if (source._cbRemaining != 0 || source.d.source != source.d.source_limit)
+        {
+            debugW("Compressed stream ended before the end of its packet\n");
+            return false;
+        }
+        return true;
+    }
+
+    // EnsureBufferSize
+    //
+    // Grows a connection's receive buffer, keeping whatever it already holds
+
+    void EnsureBufferSize(SocketConnection & conn, size_t cbNeeded)
     {
-        // Send a response back to the server 
-        if (cbSize != write(socket, pData, cbSize))
+        if (cbNeeded <= conn._cbBuffer)
+            return;
+
+        auto pNewBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE);
+        memcpy(pNewBuffer.get(), conn._pBuffer.get(), conn._cbReceived);
+        conn._pBuffer  = std::move(pNewBuffer);
+        conn._cbBuffer = MAXIUMUM_PACKET_SIZE;
+    }
+
+    // DiscardFromConnection
+    //
+    // Reads and throws away what's left of a streaming packet that was dropped, a window at a time, so that the
+    // connection picks up again at the start of the next packet.  Returns false if the connection should be closed.
+
+    bool DiscardFromConnection(SocketConnection & conn)
+    {
+        uint8_t abDiscard[STREAMING_WINDOW_SIZE];
+        int cbRead = read(conn._socket, abDiscard, std::min(sizeof(abDiscard), conn._cbDiscard));
+        if (cbRead == 0)
         {
-            debugW("Could not write to socket\n");
+            debugV("Connection closed by sender");
             return false;
         }
+        if (cbRead < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+
+        conn._cbDiscard -= cbRead;
+        conn._msLastData = millis();
         return true;
     }
 
-    // ProcessIncomingConnectionsLoop
+    // ReadFromConnection
     //
-    // Socket server main ProcessIncomingConnectionsLoop - accepts new connections and reads from them, dispatching
-    // data packets into our buffer and closing the socket if anything goes weird.
+    // Called when select() says a connection is readable.  Reads whatever has arrived, but never more than the
+    // current packet needs, so a connection's buffer only ever holds one packet.  Once the packet is complete it
+    // is processed and the buffer is consumed.  Returns false if the connection should be closed.
 
-    int ProcessIncomingConnectionsLoop()
+    bool ReadFromConnection(SocketConnection & conn)
     {
-        if (0 == _server_fd)
+        if (conn._cbDiscard)
+            return DiscardFromConnection(conn);
+
+        size_t cbNeeded = ExpectedPacketSize(conn._pBuffer.get(), conn._cbReceived);
+        if (cbNeeded == 0)
+            return false;
+
+        EnsureBufferSize(conn, cbNeeded);
+
+        int cbRead = read(conn._socket, conn._pBuffer.get() + conn._cbReceived, cbNeeded - conn._cbReceived);
+        if (cbRead == 0)
         {
-            debugW("No _server_fd, returning.");
+            debugV("Connection closed by sender");
+            return false;
+        }
+        if (cbRead < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            debugW("ERROR: %d bytes read in ReadFromConnection trying to read %d\n", cbRead, cbNeeded - conn._cbReceived);
             return false;
         }
 
-        int new_socket = 0;
-        
-        // Accept a new incoming connnection
-        int addrlen = sizeof(_address); 
-        if ((new_socket = accept(_server_fd, (struct sockaddr *)&_address, (socklen_t*)&addrlen))<0) 
-        { 
-            debugW("Error accepting data!");
+        if (conn._cbReceived == 0)
+            conn._usPacketStart = micros();
+
+        conn._cbReceived += cbRead;
+        conn._msLastData = millis();
+
+        // Now that more of the header may be in, we may know that the packet is longer than we thought
+
+        cbNeeded = ExpectedPacketSize(conn._pBuffer.get(), conn._cbReceived);
+        if (cbNeeded == 0)
             return false;
-        } 
 
-        // Report where this connection is coming from 
+        // When streaming, a compressed packet is processed as soon as its header is in, and since nothing past the
+        // header has been asked for yet, the buffer is never grown for it
 
-        struct sockaddr_in addr;
-        socklen_t addr_size = sizeof(struct sockaddr_in);
-        getpeername(new_socket, (struct sockaddr *)&addr, &addr_size);
-        debugV("Incoming connection from: %s", inet_ntoa(addr.sin_addr));
+        bool bStreaming = STREAMING_INFLATE && conn._cbReceived >= COMPRESSED_HEADER_SIZE && DWORDFromMemory(conn._pBuffer.get()) == COMPRESSED_HEADER;
 
-        // Set a timeout of 3 seconds on the socket so we don't permanently hang on a corrupt or partial packet
-               
-        struct timeval to;
-        to.tv_sec = 3;
-        to.tv_usec = 0;
-        if (setsockopt(new_socket,SOL_SOCKET,SO_RCVTIMEO,&to,sizeof(to)) < 0)
+        if (conn._cbReceived < cbNeeded && !bStreaming)
+            return true;
+
+        bool bSendResponsePacket = false;
+        if (bStreaming)
         {
-            debugW("Unable to set read timeout on socket!");
-            close(new_socket);
-            return false;
+            if (false == ProcessStreamingPacket(conn, bSendResponsePacket))
+                return false;
         }
-        
-        do
+        else
         {
-            bool bSendResponsePacket = false;
+            g_Telemetry._receive.Add(micros() - conn._usPacketStart);
 
-             // Read until we have at least enough for the data header 
+            // A sender asks for a newer SocketResponse with a bare header whose length is the version it wants
 
-            if (false == ReadUntilNBytesReceived(new_socket, STANDARD_DATA_HEADER_SIZE))
+            if (WORDFromMemory(conn._pBuffer.get()) == WIFI_COMMAND_RESPONSEVERSION)
             {
-                debugW("Read error in getting header.\n");
-                close(new_socket);
-                ResetReadBuffer();                    
-                return false;
+                conn._responseVersion = DWORDFromMemory(&conn._pBuffer[4]);
+                debugV("Sender asked for response version %u", conn._responseVersion);
             }
 
-            // Now that we have the header we can see how much more data is expected to follow
+            if (false == ProcessPacket(conn._pBuffer.get(), conn._cbReceived, bSendResponsePacket))
+                return false;
+        }
 
-            const uint32_t header  = _pBuffer[3] << 24  | _pBuffer[2] << 16  | _pBuffer[1] << 8  | _pBuffer[0];
-            if (header == COMPRESSED_HEADER)
-            {
-                uint32_t compressedSize = _pBuffer[7] << 24  | _pBuffer[6] << 16  | _pBuffer[5] << 8  | _pBuffer[4];
-                uint32_t expandedSize   = _pBuffer[11] << 24 | _pBuffer[10] << 16 | _pBuffer[9] << 8  | _pBuffer[8];
-                uint32_t reserved       = _pBuffer[15] << 24 | _pBuffer[14] << 16 | _pBuffer[13] << 8 | _pBuffer[12];
-                debugV("Compressed Header: compressedSize: %u, expandedSize: %u, reserved: %u", compressedSize, expandedSize, reserved);
+        // Consume the data by resetting the buffer 
 
-                if (expandedSize > MAXIUMUM_PACKET_SIZE)
-                {
-                    debugE("Expanded packet would be %d but buffer is only %d !!!!\n", expandedSize, MAXIUMUM_PACKET_SIZE);
-                    break;
-                }
+        conn._cbReceived = 0;
+        conn._cPackets++;
+        conn._usLastPacketTime = micros() - conn._usPacketStart;
 
-                if (false == ReadUntilNBytesReceived(new_socket, COMPRESSED_HEADER_SIZE + compressedSize))
-                {
-                    debugW("Could not read compressed data from stream\n");
-                    break;
-                }
-                debugV("Successfuly read %u bytes", COMPRESSED_HEADER_SIZE + compressedSize);
-
-                // If our buffer is in PSRAM it would be expensive to decompress in place, as the SPIRAM doesn't like
-                // non-linear access from what I can tell.  I bet it must send addr+len to request each unique read, so
-                // one big read one time would work best, and we use that to copy it to a regular RAM buffer.
-                
-                #if USE_PSRAM
-                    std::unique_ptr<uint8_t []> _abTempBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE);
-                    memcpy(_abTempBuffer.get(), _pBuffer.get(), MAXIUMUM_PACKET_SIZE);
-                    auto pSourceBuffer = &_abTempBuffer[COMPRESSED_HEADER_SIZE];
-                #else
-                    auto pSourceBuffer = &_pBuffer[COMPRESSED_HEADER_SIZE];
-                #endif
-                
-                if (!DecompressBuffer(pSourceBuffer, compressedSize, _abOutputBuffer.get(), expandedSize))
+        if (bSendResponsePacket)
+        {
+            SocketResponse response = { 
+                                        .size = sizeof(SocketResponse),
+                                        .flashVersion = FLASH_VERSION,
+                                        .currentClock = g_AppTime.CurrentTime(),
+                                        .oldestPacket = g_aptrBufferManager[0]->AgeOfOldestBuffer(),
+                                        .newestPacket = g_aptrBufferManager[0]->AgeOfNewestBuffer(),
+                                        .brightness   = g_Brite,
+                                        .wifiSignal   = (float) WiFi.RSSI(),
+                                        .bufferSize   = g_aptrBufferManager[0]->BufferCount(),
+                                        .bufferPos    = g_aptrBufferManager[0]->Depth(),
+                                        .fpsDrawing   = g_FPS,
+                                        .watts        = g_Watts
+                                    };
+
+            // Each version starts with the one before, so a sender gets the newest it asked for that we know
+
+            if (conn._responseVersion >= 2)
+            {
+                SocketResponseV3 responseV3 = { .v2 = { .base = response } };
+                auto & responseV2 = responseV3.v2;
+                size_t cbResponse = sizeof(SocketResponseV2);
+                responseV2.version = 2;
+
+                if (conn._responseVersion >= 3)
                 {
-                    debugW("Error decompressing data\n");
-                    break;
+                    const auto & bufferManager = *g_aptrBufferManager[0];
+                    const auto & jitter = bufferManager.Jitter();
+                    responseV3.averageLead       = jitter.AverageLead();
+                    responseV3.jitter            = jitter.Jitter();
+                    responseV3.recommendedLead   = jitter.RecommendedLead();
+                    responseV3.recommendedDepth  = jitter.RecommendedDepth();
+                    responseV3.framesDroppedLate = bufferManager.FramesDroppedLate();
+                    responseV3.framesEvicted     = bufferManager.FramesEvicted();
+                    cbResponse = sizeof(SocketResponseV3);
+                    responseV2.version = 3;
                 }
 
-                if (false == ProcessIncomingData(_abOutputBuffer.get(), expandedSize))
-                {
-                    debugW("Error processing data\n");
-                    break;
+                responseV2.base.size     = cbResponse;
+                responseV2.framesLate    = g_Telemetry._cFramesLate;
+                responseV2.framesDropped = g_Telemetry._cFramesDropped;
+                responseV2.bucketCount   = TELEMETRY_HISTOGRAM_BUCKETS;
+                g_Telemetry._receive.CopyTo(responseV2.receive);
+                g_Telemetry._decompress.CopyTo(responseV2.decompress);
+                g_Telemetry._queueResidency.CopyTo(responseV2.queueResidency);
+                g_Telemetry._drawToShow.CopyTo(responseV2.drawToShow);
 
-                }
-                ResetReadBuffer();
+                if (cbResponse != write(conn._socket, &responseV3, cbResponse))
+                    debugW("Unable to send response back to server.");
             }
-            else
-            {
-                // Read the rest of the data
-                uint16_t command16   = WORDFromMemory(&_pBuffer.get()[0]);
+            // I dont think this is fatal, and doesn't affect the read buffer, so content to ignore for now if it happens
+            else if (sizeof(response) != write(conn._socket, &response, sizeof(response)))
+                debugW("Unable to send response back to server.");
+        }
+        return true;
+    }
 
-                if (command16 == WIFI_COMMAND_PEAKDATA)
-                {
-                    #if ENABLE_AUDIO
+    #if INCOMING_UDP_ENABLED
 
-                        uint16_t numbands  = WORDFromMemory(&_pBuffer.get()[2]);
-                        uint32_t length32  = DWORDFromMemory(&_pBuffer.get()[4]);
-                        uint64_t seconds   = ULONGFromMemory(&_pBuffer.get()[8]);
-                        uint64_t micros    = ULONGFromMemory(&_pBuffer.get()[16]);
+    // ReadFromUdp
+    //
+    // Drains the UDP socket, processing each packet as it's completed.  There's no one to send a response to
+    // (and for multicast, many), and a bad packet just gets dropped since there's no connection to close.
 
-                        size_t totalExpected = STANDARD_DATA_HEADER_SIZE + length32;
+    void ReadFromUdp()
+    {
+        uint8_t * pPacket;
+        size_t cbPacket;
 
-                        debugV("PeakData Header: numbands=%u, length=%u, seconds=%llu, micro=%llu", numbands, length32, seconds, micros);
-                        
-                        if (numbands != NUM_BANDS)
-                        {
-                            debugE("Expecting %d bands but received %d", NUM_BANDS, numbands);
-                            break;
-                        }
-                        
-                        if (length32 != numbands * sizeof(float))
-                        {
-                            debugE("Expecting %d bytes for %d audio bands, but received %d.  Ensure float size and endianness matches between sender and receiver systems.", totalExpected, NUM_BANDS, _cbReceived);
-                            break;
-                        }
+        while (_udp.ReceiveDatagram(pPacket, cbPacket))
+        {
+            if (nullptr == pPacket)
+                continue;
 
-                        if (false == ReadUntilNBytesReceived(new_socket, totalExpected))
-                        {
-                            debugE("Error in getting peak data from wifi, could not read the %d bytes", totalExpected);
-                            break;
-                        }
-                        
-                        if (false == ProcessIncomingData(_pBuffer.get(), totalExpected))
-                            break;
-
-                        // Consume the data by resetting the buffer 
-                        debugV("Consuming the data as WIFI_COMMAND_PEAKDATA by setting _cbReceived to from %d down 0.", _cbReceived);
-    
-                    #endif
-                    ResetReadBuffer();
-                    
-                }
-                else if (command16 == WIFI_COMMAND_PIXELDATA64)
-                {
-                    // We know it's pixel data, so we do some validation before calling Process.
+            bool bSendResponsePacket;
+            if (ExpectedPacketSize(pPacket, cbPacket) != cbPacket || false == ProcessPacket(pPacket, cbPacket, bSendResponsePacket))
+                debugW("Dropping bad packet received over UDP\n");
+        }
+    }
 
-                    uint16_t channel16 = WORDFromMemory(&_pBuffer.get()[2]);
-                    uint32_t length32  = DWORDFromMemory(&_pBuffer.get()[4]);
-                    uint64_t seconds   = ULONGFromMemory(&_pBuffer.get()[8]);
-                    uint64_t micros    = ULONGFromMemory(&_pBuffer.get()[16]);
+    #endif
 
-                    debugW("Uncompressed Header: channel16=%u, length=%u, seconds=%llu, micro=%llu", channel16, length32, seconds, micros);
+    // SendResponseToServer
+    //
+    // After successfully processing a packet of color data, sends a response back to the server with stats and results
 
-                    size_t totalExpected = STANDARD_DATA_HEADER_SIZE + length32 * LED_DATA_SIZE;
-                    if (totalExpected > MAXIUMUM_PACKET_SIZE)
-                    {
-                        debugW("Too many bytes promised (%u) - more than we can use for our LEDs at max packet (%u)\n", totalExpected, MAXIUMUM_PACKET_SIZE);
-                        break;
-                    }
+    bool SendResponseToServer(int socket, void * pData, size_t cbSize)
+    {
+        // Send a response back to the server 
+        if (cbSize != write(socket, pData, cbSize))
+        {
+            debugW("Could not write to socket\n");
+            return false;
+        }
+        return true;
+    }
 
-                    debugE("Expecting %d total bytes", totalExpected);
-                    if (false == ReadUntilNBytesReceived(new_socket, totalExpected))
-                    {
-                        debugW("Error in getting pixel data from wifi\n");
-                        break;
-                    }
-                
-                    // Add it to the buffer ring
-                    
-                    if (false == ProcessIncomingData(_pBuffer.get(), totalExpected))
-                    {
-                        break;
-                    }
+    // ProcessIncomingConnectionsLoop
+    //
+    // Socket server main ProcessIncomingConnectionsLoop - waits in select() on the listening socket and on every
+    // open connection at once, accepting new senders while there are free slots and reading from whichever
+    // connections have data.  A connection that sends garbage or goes quiet is closed without disturbing the
+    // others.  Only returns if the listening socket itself fails.
+
+    int ProcessIncomingConnectionsLoop()
+    {
+        if (0 == _server_fd)
+        {
+            debugW("No _server_fd, returning.");
+            return false;
+        }
 
-                    // Consume the data by resetting the buffer 
-                    debugV("Consuming the data as WIFI_COMMAND_PIXELDATA64 by setting _cbReceived to from %d down 0.", _cbReceived);
-                    ResetReadBuffer();
+        for (;;)
+        {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            int maxfd = -1;
 
-                    bSendResponsePacket = true;
-                }
-                else
+            // Only listen for new connections while we have a slot to put them in; otherwise they wait in the backlog
+
+            if (ConnectionCount() < MAX_SOCKET_CONNECTIONS)
+            {
+                FD_SET(_server_fd, &readSet);
+                maxfd = _server_fd;
+            }
+
+            for (const auto & conn : _connections)
+            {
+                if (conn.IsOpen())
                 {
-                    debugW("Unknown command in packet received: %d\n", command16);
-                    break;
+                    FD_SET(conn._socket, &readSet);
+                    maxfd = std::max(maxfd, conn._socket);
                 }
             }
 
-            // If we make it to this point, it should be success, so we consume 
+            #if INCOMING_UDP_ENABLED
+                if (_udp.IsOpen())
+                {
+                    FD_SET(_udp.Socket(), &readSet);
+                    maxfd = std::max(maxfd, _udp.Socket());
+                }
+            #endif
 
-            ResetReadBuffer();
-            delay(1);
+            struct timeval to;
+            to.tv_sec  = 0;
+            to.tv_usec = SOCKET_SELECT_TIMEOUT_MS * MICROS_PER_MILLI;
 
-            if (bSendResponsePacket)
+            int cReady = select(maxfd + 1, &readSet, nullptr, nullptr, &to);
+            if (cReady < 0)
             {
-                SocketResponse response = { 
-                                            .size = sizeof(SocketResponse),
-                                            .flashVersion = FLASH_VERSION,
-                                            .currentClock = g_AppTime.CurrentTime(),
-                                            .oldestPacket = g_aptrBufferManager[0]->AgeOfOldestBuffer(),
-                                            .newestPacket = g_aptrBufferManager[0]->AgeOfNewestBuffer(),
-                                            .brightness   = g_Brite,
-                                            .wifiSignal   = (float) WiFi.RSSI(),
-                                            .bufferSize   = g_aptrBufferManager[0]->BufferCount(),
-                                            .bufferPos    = g_aptrBufferManager[0]->Depth(),
-                                            .fpsDrawing   = g_FPS,
-                                            .watts        = g_Watts
-                                        };
-
-                // I dont think this is fatal, and doesn't affect the read buffer, so content to ignore for now if it happens
-                if (sizeof(response) != write(new_socket, &response, sizeof(response)))
-                    debugW("Unable to send response back to server.");
+                debugW("Error in select on sockets!");
+                release();
+                return false;
             }
-        } while (true);
 
-        close(new_socket);
-        ResetReadBuffer();
-        return false;
+            if (cReady > 0)
+            {
+                if (FD_ISSET(_server_fd, &readSet))
+                    AcceptNewConnection();
+
+                for (auto & conn : _connections)
+                {
+                    if (conn.IsOpen() && FD_ISSET(conn._socket, &readSet))
+                    {
+                        if (false == ReadFromConnection(conn))
+                        {
+                            debugW("Closing socket connection after %u packets\n", conn._cPackets);
+                            CloseConnection(conn);
+                        }
+                    }
+                }
+
+                #if INCOMING_UDP_ENABLED
+                    if (_udp.IsOpen() && FD_ISSET(_udp.Socket(), &readSet))
+                        ReadFromUdp();
+                #endif
+            }
+
+            // Drop connections that have gone quiet so we don't permanently hang on a corrupt or partial packet
+
+            for (auto & conn : _connections)
+            {
+                if (conn.IsOpen() && millis() - conn._msLastData > SOCKET_IDLE_TIMEOUT_MS)
+                {
+                    debugW("Socket connection timed out\n");
+                    CloseConnection(conn);
+                }
+            }
+        }
     }    
 
-    // DecompressBuffer
+    // InitDecompressor
     //
-    // Use unzlib to decompress a memory buffer
+    // Points a uzlib state at a zlib stream in memory and consumes the zlib header.  If pfnReadSource is given,
+    // uzlib calls it for more of the stream once it has used up what's in memory.
 
-    bool DecompressBuffer(const uint8_t * pBuffer, size_t cBuffer, uint8_t * pOutput, size_t expectedOutputSize) const
+    bool InitDecompressor(struct uzlib_uncomp & d, const uint8_t * pBuffer, size_t cBuffer, int (*pfnReadSource)(struct uzlib_uncomp *) = nullptr) const
     {
         debugV("Compressed Data: %02X %02X %02X %02X...", pBuffer[0], pBuffer[1], pBuffer[2], pBuffer[3]);
         
-        struct uzlib_uncomp d = { 0 };
         uzlib_uncompress_init(&d, NULL, 0);
 
         d.source         = pBuffer;
         d.source_limit   = pBuffer + cBuffer;
-        d.source_read_cb = nullptr;
-        d.dest_start     = pOutput;
-        d.dest           = pOutput;
-        d.dest_limit     = pOutput + expectedOutputSize + 1;
+        d.source_read_cb = pfnReadSource;
 
         int res = uzlib_zlib_parse_header(&d);
         if (res < 0)
@@ -484,20 +1118,193 @@ public:
             debugE("ERROR: Cannot parse zlib data header\n");
             return false;
         }
+        return true;
+    }
 
-        res = uzlib_uncompress_chksum(&d);                                          // Expand the data
+    // InflateInto
+    //
+    // Inflates exactly cbOutput more bytes of the stream to pOutput.  Everything from pStart up to pOutput must
+    // already hold the output produced so far, as that's where LZ77 back-references are resolved from.  The
+    // final call lets the inflater run one byte past the end so that it reaches the end of the stream and
+    // verifies the checksum, so the memory behind pOutput + cbOutput must have a spare byte.
+
+    bool InflateInto(struct uzlib_uncomp & d, uint8_t * pStart, uint8_t * pOutput, size_t cbOutput, bool bFinal) const
+    {
+        d.dest_start = pStart;
+        d.dest       = pOutput;
+        d.dest_limit = pOutput + cbOutput + (bFinal ? 1 : 0);
+
+        int res = uzlib_uncompress_chksum(&d);                                      // Expand the data
 
-        if (res != TINF_DONE) {
+        if (res != (bFinal ? TINF_DONE : TINF_OK)) 
+        {
             debugE("Error during decompression after producing %d bytes: %d\n", d.dest - pOutput, res);
             return false;
         }
 
-        if (d.dest - pOutput != expectedOutputSize)
+        if (d.dest - pOutput != cbOutput)
         {
-            debugE("Exepcted it to to decompress to %d but got %d instead\n", expectedOutputSize, d.dest - pOutput);
+            debugE("Exepcted it to to decompress to %d but got %d instead\n", cbOutput, d.dest - pOutput);
             return false;
         }
-        
+        return true;
+    }
+
+    // InflateFrameIntoBuffers
+    //
+    // Given a stream whose PIXELDATA64 header has already been inflated to pHeader, inflates the pixels and adds
+    // the frame to the LEDBuffers of every channel its mask names.  If bLockHeld, the caller holds g_buffer_mutex,
+    // and when the first channel's frame goes in a new buffer the pixels are inflated directly into that buffer's
+    // storage, so the frame is never copied in full.  Otherwise, and whenever the frame is an update to a buffer
+    // the draw task can already see, the pixels are inflated to our output buffer first and only copied in once
+    // they're complete and checked, so a bad frame never touches a visible buffer.  Without the lock, it's only
+    // taken for the copy, so the draw task never waits on the stream (which may be reading from the socket).
+
+    bool InflateFrameIntoBuffers(struct uzlib_uncomp & d, const uint8_t * pHeader, size_t cbFrame, bool bFinal, bool bLockHeld)
+    {
+        uint16_t channel16 = WORDFromMemory(&pHeader[2]);
+        uint32_t length32  = DWORDFromMemory(&pHeader[4]);
+        uint64_t seconds   = ULONGFromMemory(&pHeader[8]);
+        uint64_t micros    = ULONGFromMemory(&pHeader[16]);
+
+        if (length32 > NUM_LEDS || cbFrame != STANDARD_DATA_HEADER_SIZE + length32 * LED_DATA_SIZE)
+        {
+            debugW("Compressed pixel data of %u bytes does not match its header length of %u\n", cbFrame, length32);
+            return false;
+        }
+
+        // Same as ProcessIncomingData:  channel 0 is treated as the mask for the first channel
+
+        if (channel16 == 0)
+            channel16 = 1;
+
+        int iFirstChannel = 0;
+        while (iFirstChannel < NUM_CHANNELS && ((1 << iFirstChannel) & channel16) == 0)
+            iFirstChannel++;
+
+        // With the lock, the first channel's buffer is picked now, so a new one can be inflated into
+
+        std::shared_ptr<LEDBuffer> pFirstBuffer;
+        bool bDirect = false;
+        if (bLockHeld && iFirstChannel < NUM_CHANNELS)
+        {
+            auto & bufferManager = *g_aptrBufferManager[iFirstChannel];
+            pFirstBuffer = bufferManager.GetBufferForTimestamp(seconds, micros);
+            bDirect = pFirstBuffer && pFirstBuffer != bufferManager.PeekNewestBuffer();
+        }
+
+        // The header may already be in our output buffer, hence memmove
+
+        uint8_t * pStorage = bDirect ? pFirstBuffer->WireStorage() : _abOutputBuffer.get();
+        memmove(pStorage, pHeader, STANDARD_DATA_HEADER_SIZE);
+        if (cbFrame > STANDARD_DATA_HEADER_SIZE && !InflateInto(d, pStorage, pStorage + STANDARD_DATA_HEADER_SIZE, cbFrame - STANDARD_DATA_HEADER_SIZE, bFinal))
+        {
+            debugW("Error decompressing pixel data\n");
+            return false;
+        }
+
+        std::unique_lock<BufferRingMutex> guard(g_buffer_mutex, std::defer_lock);
+        if (!bLockHeld)
+            guard.lock();
+
+        for (int iChannel = iFirstChannel, channelMask = 1 << iFirstChannel; iChannel < NUM_CHANNELS; iChannel++, channelMask <<= 1)
+        {
+            if ((channelMask & channel16) == 0)
+                continue;
+
+            auto & bufferManager = *g_aptrBufferManager[iChannel];
+            auto pBuffer = (bLockHeld && iChannel == iFirstChannel) ? pFirstBuffer : bufferManager.GetBufferForTimestamp(seconds, micros);
+            if (pBuffer)
+            {
+                bool bOK = pBuffer->WireStorage() == pStorage ? pBuffer->UpdateFromWireStorage(cbFrame) : pBuffer->UpdateFromWire(pStorage, cbFrame);
+                if (!bOK)
+                    return false;
+            }
+            bufferManager.CommitBuffer(pBuffer);
+        }
+        return true;
+    }
+
+    // DecompressPixelsIntoBuffers
+    //
+    // Inflates the rest of a compressed PIXELDATA64 packet into the LEDBuffers, holding the lock while it does
+
+    bool DecompressPixelsIntoBuffers(struct uzlib_uncomp & d, uint8_t * pHeader, size_t expandedSize)
+    {
+        std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
+        return InflateFrameIntoBuffers(d, pHeader, expandedSize, true, true);
+    }
+
+    // DecompressBatchIntoBuffers
+    //
+    // Given a stream whose PIXELBATCH64 header has already been inflated to pHeader, inflates each of the frames
+    // that follow into the next LEDBuffers.  Since the output ends up scattered across buffers, back-references
+    // are resolved from a dictionary ring rather than from the output.  The whole batch goes in under a single
+    // lock, unless the stream is being read from the socket as we go, in which case each frame is inflated with
+    // no lock held and the lock is only taken to add it, so the draw task never waits on the network.
+
+    bool DecompressBatchIntoBuffers(struct uzlib_uncomp & d, uint8_t * pHeader, size_t expandedSize, bool bLockPerFrame)
+    {
+        if (expandedSize != STANDARD_DATA_HEADER_SIZE + DWORDFromMemory(&pHeader[4]))
+        {
+            debugW("Compressed batch of %u bytes does not match its header length of %u\n", expandedSize, DWORDFromMemory(&pHeader[4]));
+            return false;
+        }
+
+        if (!_pDictionary)
+        {
+            _pDictionary.reset((uint8_t *) PreferPSRAMAlloc(BATCH_DICTIONARY_SIZE));
+            if (!_pDictionary)
+            {
+                debugE("Unable to allocate %u bytes for the batch dictionary\n", BATCH_DICTIONARY_SIZE);
+                return false;
+            }
+        }
+
+        // The batch header was inflated without a ring, so it's put in the ring by hand, and if it ended partway
+        // through a back-reference, the rest of that is now read from the ring too
+
+        memcpy(_pDictionary.get(), pHeader, STANDARD_DATA_HEADER_SIZE);
+        if (d.curlen)
+            d.lzOff += STANDARD_DATA_HEADER_SIZE;
+
+        d.dict_ring = _pDictionary.get();
+        d.dict_size = BATCH_DICTIONARY_SIZE;
+        d.dict_idx  = STANDARD_DATA_HEADER_SIZE;
+
+        std::unique_lock<BufferRingMutex> guard(g_buffer_mutex, std::defer_lock);
+        if (!bLockPerFrame)
+            guard.lock();
+
+        size_t offset = STANDARD_DATA_HEADER_SIZE;
+        for (size_t cFrames = 0; offset < expandedSize; cFrames++)
+        {
+            if (cFrames == MAX_BATCH_FRAMES || expandedSize - offset < STANDARD_DATA_HEADER_SIZE)
+            {
+                debugW("Compressed batch has more than %d frames or ends partway through one\n", MAX_BATCH_FRAMES);
+                return false;
+            }
+
+            uint8_t abFrameHeader[STANDARD_DATA_HEADER_SIZE + 1];                  // Spare byte for InflateInto
+            if (!InflateInto(d, abFrameHeader, abFrameHeader, STANDARD_DATA_HEADER_SIZE, offset + STANDARD_DATA_HEADER_SIZE == expandedSize))
+            {
+                debugW("Error decompressing batch frame header\n");
+                return false;
+            }
+
+            uint32_t length32 = DWORDFromMemory(&abFrameHeader[4]);
+            size_t   cbFrame  = STANDARD_DATA_HEADER_SIZE + length32 * LED_DATA_SIZE;
+            if (WORDFromMemory(abFrameHeader) != WIFI_COMMAND_PIXELDATA64 || length32 > NUM_LEDS || cbFrame > expandedSize - offset)
+            {
+                debugW("Bad frame %u in compressed batch\n", cFrames);
+                return false;
+            }
+
+            if (!InflateFrameIntoBuffers(d, abFrameHeader, cbFrame, offset + cbFrame == expandedSize, !bLockPerFrame))
+                return false;
+
+            offset += cbFrame;
+        }
         return true;
     }
 };
@@ -0,0 +1,274 @@
+//+--------------------------------------------------------------------------
+//
+// File:        spankernels.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Scales, fills, adds to and blends runs of pixels four bytes at a
+//    time, giving the same result to the bit as FastLED's nscale8, CRGB
+//    assignment, += and nblend would on each pixel.  It also works out
+//    which whole pixels a fractional span covers and how much of each end
+//    pixel it lights.  GFXBase's span operations and setPixelsF use it.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "SpanKernels expects the bytes of a word in little-endian order");
+
+#if defined(FASTLED_BLEND_FIXED) && FASTLED_BLEND_FIXED == 0
+#error SpanKernels::Blend does blend8 the way FastLED does with FASTLED_BLEND_FIXED
+#endif
+
+// SpanKernels
+//
+// Pixels are three bytes, so a run of them seldom starts or ends on a word.  The bytes up to the first word boundary
+// and after the last one are done on their own, and the words in between a word at a time, with the color laid out
+// to line up with them:  four pixels take three words, after which the color's bytes repeat.
+
+class SpanKernels
+{
+    static constexpr size_t cbPixel = 3;
+
+    // FastLED's scale8 multiplies by scale + 1 unless it's built the old way, with FASTLED_SCALE8_FIXED at 0
+
+    #if defined(FASTLED_SCALE8_FIXED) && FASTLED_SCALE8_FIXED == 0
+        static constexpr uint32_t ScaleBias = 0;
+    #else
+        static constexpr uint32_t ScaleBias = 1;
+    #endif
+
+    // ForEachWord
+    //
+    // Calls op(bytes, color) for each word of count pixels at pPixels and writes back what it returns, with color
+    // holding the bytes of rgb that go with them.  Bytes before the first word boundary and after the last go
+    // through op one at a time, in the low byte, so op must treat each byte of a word on its own.
+
+    template <typename Op>
+    static inline void ForEachWord(uint8_t * pPixels, size_t count, const uint8_t rgb[cbPixel], Op op)
+    {
+        const size_t cb = count * cbPixel;
+        size_t i = 0;
+
+        const size_t cbHead = std::min(cb, size_t(-reinterpret_cast<uintptr_t>(pPixels) & 3));
+        for (; i < cbHead; i++)
+            pPixels[i] = op(pPixels[i], rgb[i]);
+
+        // The color's bytes over and over, eight of them, so any three words' worth can be shifted out of it
+        // starting from any of its bytes
+
+        const uint64_t color    = rgb[0] | (rgb[1] << 8) | (rgb[2] << 16);
+        const uint64_t repeated = color | (color << 24) | (color << 48);
+        const uint32_t pattern[cbPixel] = { uint32_t(repeated >> (8 * (cbHead % cbPixel))),
+                                            uint32_t(repeated >> (8 * ((cbHead + 1) % cbPixel))),
+                                            uint32_t(repeated >> (8 * ((cbHead + 2) % cbPixel))) };
+
+        // Three words at a time, so the pattern stays in registers, and then whatever whole words are left
+
+        for (; i + 12 <= cb; i += 12)
+        {
+            uint32_t w[cbPixel];
+            memcpy(w, __builtin_assume_aligned(pPixels + i, 4), sizeof(w));
+            w[0] = op(w[0], pattern[0]);
+            w[1] = op(w[1], pattern[1]);
+            w[2] = op(w[2], pattern[2]);
+            memcpy(__builtin_assume_aligned(pPixels + i, 4), w, sizeof(w));
+        }
+
+        for (size_t k = 0; i + 4 <= cb; i += 4, k++)
+        {
+            uint32_t w;
+            memcpy(&w, __builtin_assume_aligned(pPixels + i, 4), sizeof(w));
+            w = op(w, pattern[k]);
+            memcpy(__builtin_assume_aligned(pPixels + i, 4), &w, sizeof(w));
+        }
+
+        for (size_t phase = i % cbPixel; i < cb; i++, phase = phase + 1 < cbPixel ? phase + 1 : 0)
+            pPixels[i] = op(pPixels[i], rgb[phase]);
+    }
+
+  public:
+
+    static constexpr uint32_t EvenBytes = 0x00FF00FF;
+
+    // ScaleBytes
+    //
+    // Each of the four bytes of w multiplied by m (at most 256) and shifted down, as scale8 does with a scale of
+    // m - 1, two at a time in 16-bit lanes where they can't overflow into each other
+
+    static inline uint32_t ScaleBytes(uint32_t w, uint32_t m)
+    {
+        uint32_t even = (((w & EvenBytes) * m) >> 8) & EvenBytes;
+        uint32_t odd  = ((((w >> 8) & EvenBytes) * m) >> 8) & EvenBytes;
+        return even | (odd << 8);
+    }
+
+    // ScaleFor
+    //
+    // The multiplier ScaleBytes needs to do what scale8 does with scale
+
+    static constexpr uint32_t ScaleFor(uint8_t scale)
+    {
+        return scale + ScaleBias;
+    }
+
+    // AddBytes
+    //
+    // qadd8 on each of the four bytes of a and b.  The top bit of each byte is added apart, so no carry crosses
+    // into the next byte, and any byte that carries out of its top bit is set to 255.
+
+    static inline uint32_t AddBytes(uint32_t a, uint32_t b)
+    {
+        constexpr uint32_t LowBits = 0x7F7F7F7F;
+        constexpr uint32_t TopBits = 0x80808080;
+
+        uint32_t low   = (a & LowBits) + (b & LowBits);
+        uint32_t carry = ((a & b) | ((a | b) & low)) & TopBits;
+        uint32_t sum   = low ^ ((a ^ b) & TopBits);
+        return sum | ((carry >> 7) * 0xFF);
+    }
+
+    // BlendBytes
+    //
+    // blend8 on each of the four bytes of a and b, which works out to (a * (256 - amount) + b * (amount + 1)) >> 8.
+    // That never needs more than 16 bits, so it too can be done in two lanes.
+
+    static inline uint32_t BlendBytes(uint32_t a, uint32_t b, uint8_t amount)
+    {
+        const uint32_t mA = 256 - amount;
+        const uint32_t mB = amount + 1;
+
+        uint32_t even = (((a & EvenBytes) * mA + (b & EvenBytes) * mB) >> 8) & EvenBytes;
+        uint32_t odd  = ((((a >> 8) & EvenBytes) * mA + ((b >> 8) & EvenBytes) * mB) >> 8) & EvenBytes;
+        return even | (odd << 8);
+    }
+
+    // Scale
+    //
+    // nscale8 on count pixels
+
+    static void Scale(uint8_t * pPixels, size_t count, uint8_t scale)
+    {
+        const uint8_t none[cbPixel] = { };
+        const uint32_t m = ScaleFor(scale);
+        ForEachWord(pPixels, count, none, [m](uint32_t w, uint32_t) { return ScaleBytes(w, m); });
+    }
+
+    // Fill
+    //
+    // Sets count pixels to rgb
+
+    static void Fill(uint8_t * pPixels, size_t count, const uint8_t rgb[cbPixel])
+    {
+        ForEachWord(pPixels, count, rgb, [](uint32_t, uint32_t color) { return color; });
+    }
+
+    // Add
+    //
+    // Adds rgb to count pixels, saturating, as CRGB's += does
+
+    static void Add(uint8_t * pPixels, size_t count, const uint8_t rgb[cbPixel])
+    {
+        ForEachWord(pPixels, count, rgb, [](uint32_t w, uint32_t color) { return AddBytes(w, color); });
+    }
+
+    // Blend
+    //
+    // Blends amount/255ths of rgb into count pixels, as nblend does
+
+    static void Blend(uint8_t * pPixels, size_t count, const uint8_t rgb[cbPixel], uint8_t amount)
+    {
+        if (amount == 0)
+            return;
+        ForEachWord(pPixels, count, rgb, [amount](uint32_t w, uint32_t color) { return BlendBytes(w, color, amount); });
+    }
+};
+
+// FractionalSpan
+//
+// The pixels GFXBase::setPixelsF covers from pos for count pixels, worked out once rather than as it draws.  The
+// pixel it starts in gets headFade less of the color the further into it the span starts (or the less of it the
+// span reaches), bodyCount whole pixels after that get all of it, and if the span ends part way into the pixel
+// after those, that gets tailFade less of it the less of it the span reaches.
+//
+// The fades are worked out in 16.16 fixed point, which can put them a level away from the float version's.  Which
+// pixels get drawn, though, comes from the same float sums the float version used:  a span that ends within a
+// float's rounding of a pixel edge would otherwise come down on the other side of it now and then, and draw a pixel
+// there that the float version didn't, or leave out one it did.
+
+struct FractionalSpan
+{
+    static constexpr int32_t One      = 1 << 16;
+    static constexpr float   MaxPixel = 32767.0f;  // Keeps positions in 16.16 without overflowing
+
+    int32_t head;                   // Pixel the span starts in
+    int32_t bodyCount;              // Whole pixels after head
+    uint8_t headFade;               // fadeToBlackBy amounts for the partial pixels at each end
+    uint8_t tailFade;
+    bool    bTail;                  // Whether the pixel after the body gets part of the color
+
+    // Floor
+    //
+    // floorf for anything that fits in an int32_t, without the library call floorf is on the chip and on plenty of
+    // PCs
+
+    static inline int32_t Floor(float f)
+    {
+        const int32_t i = static_cast<int32_t>(f);
+        return i - (f < i);
+    }
+
+    // ToFixed
+    //
+    // A float from 0 up to MaxPixel in 16.16, rounded down
+
+    static inline int32_t ToFixed(float f)
+    {
+        return static_cast<int32_t>(f * One);
+    }
+
+    FractionalSpan(float pos, float count)
+    {
+        pos   = std::min(std::max(pos, -MaxPixel), MaxPixel);
+        count = std::min(std::max(count, 0.0f), MaxPixel);
+
+        head = Floor(pos);
+
+        const float frac1 = pos - head;
+        headFade = (std::max(ToFixed(frac1), One - ToFixed(count)) * 255) >> 16;
+
+        // What's left after the head pixel is in double and then float, as the float version had it, and the tail
+        // fade comes from where pos + count lands, which can round to the pixel edge even when that doesn't
+
+        const float remaining = count - (1.0 - frac1);
+        const float end       = pos + count;
+        bodyCount = remaining >= 1.0f ? static_cast<int32_t>(remaining) : 0;
+        bTail     = remaining > bodyCount;
+        tailFade  = ((One - ToFixed(end - Floor(end))) * 255) >> 16;
+    }
+};
+
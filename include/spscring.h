@@ -0,0 +1,172 @@
+//+--------------------------------------------------------------------------
+//
+// File:        spscring.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    The head and tail of a ring with one producer and one consumer, such
+//    as the socket server filling LEDBuffers while the draw loop empties
+//    them.  The slots live wherever the owner keeps them; this only says
+//    which one to write next and which one to read next.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// SPSCRing
+//
+// The producer reserves the slot at the head, fills it, and commits it, which is what makes it visible to the
+// consumer.  The consumer peeks at the slot at the tail, uses it, and releases it, which is what gives it back
+// to the producer.  Each index is only ever written by its own side.  So neither side waits on the other, and
+// a slot is never reused while the consumer is still looking at it.  One slot always stays empty so that a
+// full ring can be told apart from an empty one, which means a ring of N slots holds N - 1 frames.
+
+class SPSCRing
+{
+    size_t              _cSlots;
+    std::atomic<size_t> _iHead { 0 };                   // Next slot the producer will fill; only the producer writes it
+    std::atomic<size_t> _iTail { 0 };                   // Oldest slot the consumer hasn't released; only the consumer writes it
+
+    size_t Next(size_t i) const
+    {
+        return i + 1 == _cSlots ? 0 : i + 1;
+    }
+
+  public:
+
+    explicit SPSCRing(size_t cSlots) : _cSlots(cSlots)
+    {
+    }
+
+    size_t Capacity() const
+    {
+        return _cSlots;
+    }
+
+    // Producer side
+
+    // TryReserve
+    //
+    // Gets the index of the slot to fill next, or returns false if the ring is full.  Reserving again without
+    // committing returns the same slot.
+
+    bool TryReserve(size_t & iSlot) const
+    {
+        size_t iHead = _iHead.load(std::memory_order_relaxed);
+        if (Next(iHead) == _iTail.load(std::memory_order_acquire))
+            return false;
+        iSlot = iHead;
+        return true;
+    }
+
+    // Commit
+    //
+    // Publishes the reserved slot.  Everything written to it beforehand is visible to the consumer once it sees it.
+
+    void Commit()
+    {
+        _iHead.store(Next(_iHead.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    // Newest
+    //
+    // Index of the slot committed most recently, which stays put until the ring wraps around to it again, even
+    // if the consumer has already released it
+
+    size_t Newest() const
+    {
+        size_t iHead = _iHead.load(std::memory_order_acquire);
+        return iHead == 0 ? _cSlots - 1 : iHead - 1;
+    }
+
+    // DropOldest
+    //
+    // Lets the producer make room by throwing away the oldest slot.  That breaks the rule that only the consumer
+    // moves the tail, so it's only safe when something else (a mutex) keeps the consumer out in the meantime.
+
+    bool DropOldest()
+    {
+        size_t iTail = _iTail.load(std::memory_order_relaxed);
+        if (iTail == _iHead.load(std::memory_order_relaxed))
+            return false;
+        _iTail.store(Next(iTail), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+
+    // TryPeek
+    //
+    // Gets the slot that's index places along from the oldest one (which is index 0), or returns false if there
+    // aren't that many in the ring
+
+    bool TryPeek(size_t & iSlot, size_t index = 0) const
+    {
+        size_t iTail = _iTail.load(std::memory_order_acquire);
+        size_t iHead = _iHead.load(std::memory_order_acquire);
+        size_t depth = iHead >= iTail ? iHead - iTail : iHead + _cSlots - iTail;
+        if (index >= depth)
+            return false;
+        iSlot = (iTail + index) % _cSlots;
+        return true;
+    }
+
+    // Release
+    //
+    // Hands the oldest slot back to the producer.  The consumer must be done with it.
+
+    void Release()
+    {
+        size_t iTail = _iTail.load(std::memory_order_relaxed);
+        if (iTail != _iHead.load(std::memory_order_acquire))
+            _iTail.store(Next(iTail), std::memory_order_release);
+    }
+
+    // Either side, or anyone else who just wants to know.  The answer can be out of date by the time it's used.
+
+    size_t Depth() const
+    {
+        size_t iTail = _iTail.load(std::memory_order_acquire);
+        size_t iHead = _iHead.load(std::memory_order_acquire);
+        return iHead >= iTail ? iHead - iTail : iHead + _cSlots - iTail;
+    }
+
+    bool IsEmpty() const
+    {
+        return Depth() == 0;
+    }
+
+    // Reset
+    //
+    // Starts over with a different number of slots, the first depth of which are already full.  The owner moves
+    // its slots to match.  Neither side can be using the ring meanwhile, so this too needs a mutex.
+
+    void Reset(size_t cSlots, size_t depth)
+    {
+        _cSlots = cSlots;
+        _iTail.store(0, std::memory_order_relaxed);
+        _iHead.store(depth, std::memory_order_release);
+    }
+};
@@ -185,6 +185,7 @@ public:
 void IRAM_ATTR ScreenUpdateLoopEntry(void *);
 void IRAM_ATTR AudioSerialTaskEntry(void *);
 void IRAM_ATTR DrawLoopTaskEntry(void *);
+void IRAM_ATTR OutputLoopTaskEntry(void *);
 void IRAM_ATTR AudioSamplerTaskEntry(void *);
 void IRAM_ATTR NetworkHandlingLoopEntry(void *);
 void IRAM_ATTR DebugLoopTaskEntry(void *);
@@ -198,6 +199,7 @@ private:
     TaskHandle_t _taskScreen = nullptr;
     TaskHandle_t _taskSync   = nullptr;
     TaskHandle_t _taskDraw   = nullptr;
+    TaskHandle_t _taskOutput = nullptr;
     TaskHandle_t _taskDebug  = nullptr;
     TaskHandle_t _taskAudio  = nullptr;
     TaskHandle_t _taskNet    = nullptr;
@@ -228,6 +230,14 @@ public:
         xTaskCreatePinnedToCore(DrawLoopTaskEntry, "Draw Loop", STACK_SIZE, nullptr, DRAWING_PRIORITY, &_taskDraw, DRAWING_CORE);    
     }
 
+    void StartOutputThread()
+    {
+        #if PIPELINED_OUTPUT
+            debugW(">> Launching Output Thread");
+            xTaskCreatePinnedToCore(OutputLoopTaskEntry, "Output Loop", STACK_SIZE, nullptr, OUTPUT_PRIORITY, &_taskOutput, OUTPUT_CORE);
+        #endif
+    }
+
     void StartAudioThread()
     {
         #if ENABLE_AUDIO
@@ -0,0 +1,82 @@
+//+--------------------------------------------------------------------------
+//
+// File:        telemetry.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Latency histograms and frame counters for the path WiFi frames take from the socket to
+//    the LEDs, so that senders can see where the time goes (see SocketResponseV2)
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+#ifndef TELEMETRY_LATE_FRAME_MS
+#define TELEMETRY_LATE_FRAME_MS     50                  // A frame drawn this long after its timestamp counts as late
+#endif
+
+#define TELEMETRY_HISTOGRAM_BUCKETS 16
+
+// LatencyHistogram
+//
+// Counts durations in power-of-two buckets of microseconds.  Bucket 0 is anything under 128us, bucket n is from
+// 2^(n+6) up to 2^(n+7) us, and the last bucket takes everything from about two seconds up.  Counts only ever go
+// up, so a reader can difference two snapshots.  Each histogram has only one task adding to it, and each bucket
+// is one aligned 32-bit word, so other tasks can read it without a lock.
+
+class LatencyHistogram
+{
+    volatile uint32_t _buckets[TELEMETRY_HISTOGRAM_BUCKETS] = { 0 };
+
+  public:
+
+    void Add(uint32_t microseconds)
+    {
+        int bucket = (31 - __builtin_clz(microseconds | 1)) - 6;
+        _buckets[std::clamp(bucket, 0, TELEMETRY_HISTOGRAM_BUCKETS - 1)]++;
+    }
+
+    void CopyTo(uint32_t * pBuckets) const
+    {
+        for (int i = 0; i < TELEMETRY_HISTOGRAM_BUCKETS; i++)
+            pBuckets[i] = _buckets[i];
+    }
+};
+
+// Telemetry
+//
+// One of these (g_Telemetry) collects the numbers for the whole frame pipeline
+
+struct Telemetry
+{
+    LatencyHistogram        _receive;                   // First byte of a packet to the last (SocketServer)
+    LatencyHistogram        _decompress;                // Inflating a compressed packet, including the wait for data when streaming
+    LatencyHistogram        _queueResidency;            // Frame added to an LEDBufferManager to taken out again
+    LatencyHistogram        _drawToShow;                // Start of WiFiDraw to the frame being shown (DrawLoopTaskEntry)
+    std::atomic<uint32_t>   _cFramesLate { 0 };         // Frames drawn more than TELEMETRY_LATE_FRAME_MS after their time
+    std::atomic<uint32_t>   _cFramesDropped { 0 };      // Frames that were thrown away without ever being drawn
+};
+
+extern Telemetry g_Telemetry;
@@ -0,0 +1,141 @@
+//+--------------------------------------------------------------------------
+//
+// File:        timebase.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    A 64-bit microsecond clock that only ever counts up, and the offset
+//    that turns it into wall clock time.  A float of seconds since 1970
+//    can only tell times about two minutes apart, so anything scheduled
+//    against frame timestamps works in these integers instead.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sys/time.h>
+
+#if defined(ESP_PLATFORM)
+    #include <esp_timer.h>
+#else
+    #include <chrono>
+#endif
+
+// Timebase
+//
+// Monotonic time is microseconds since boot, and is what intervals are measured in, since nothing can make it
+// jump.  Wall time is microseconds since 1970, as frame timestamps are, and is monotonic time plus an offset.
+// The offset is only changed by SetWallClock (when NTP steps the system clock), so a step moves every wall time
+// by exactly the same amount and never reorders two monotonic ones.
+
+class Timebase
+{
+    static inline std::atomic<int64_t> _usWallOffset { 0 };
+
+  public:
+
+    static constexpr uint64_t MicrosPerSecond = 1000000;
+
+    static uint64_t MonotonicMicros()
+    {
+        #if defined(ESP_PLATFORM)
+            return esp_timer_get_time();
+        #else
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        #endif
+    }
+
+    static uint64_t WallMicros()
+    {
+        return WallFromMonotonic(MonotonicMicros());
+    }
+
+    static uint64_t WallFromMonotonic(uint64_t usMonotonic)
+    {
+        return usMonotonic + _usWallOffset.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t MonotonicFromWall(uint64_t usWall)
+    {
+        return usWall - _usWallOffset.load(std::memory_order_relaxed);
+    }
+
+    // SetWallClock
+    //
+    // Makes the current wall time usWall, or makes usWall the wall time at the monotonic time usMonotonic
+
+    static void SetWallClock(uint64_t usWall)
+    {
+        SetWallClock(usWall, MonotonicMicros());
+    }
+
+    static void SetWallClock(uint64_t usWall, uint64_t usMonotonic)
+    {
+        _usWallOffset.store(usWall - usMonotonic, std::memory_order_relaxed);
+    }
+
+    // SyncToSystemClock
+    //
+    // Takes the wall time from gettimeofday, for whenever something has set the system clock
+
+    static void SyncToSystemClock()
+    {
+        timeval tv;
+        gettimeofday(&tv, nullptr);
+        SetWallClock(FromTimeval(tv));
+    }
+
+    // FromWire
+    //
+    // Turns the seconds and microseconds of a wire timestamp into microseconds, so they can be compared
+    // and subtracted directly
+
+    static constexpr uint64_t FromWire(uint64_t seconds, uint64_t micros)
+    {
+        return seconds * MicrosPerSecond + micros;
+    }
+
+    static uint64_t FromTimeval(const timeval & tv)
+    {
+        return FromWire(tv.tv_sec, tv.tv_usec);
+    }
+
+    // MicrosBetween
+    //
+    // How long from usFrom until usTo, which is negative if usTo came first
+
+    static constexpr int64_t MicrosBetween(uint64_t usFrom, uint64_t usTo)
+    {
+        return (int64_t)(usTo - usFrom);
+    }
+
+    // SecondsBetween
+    //
+    // The same as a float, once the subtraction has been done exactly, for callers that want seconds
+
+    static constexpr float SecondsBetween(uint64_t usFrom, uint64_t usTo)
+    {
+        return MicrosBetween(usFrom, usTo) / (float) MicrosPerSecond;
+    }
+};
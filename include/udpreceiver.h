@@ -0,0 +1,358 @@
+//+--------------------------------------------------------------------------
+//
+// File:        udpreceiver.h
+//
+// NightDriverStrip - (c) 2018 Plummer's Software LLC.  All Rights Reserved.
+//
+// This file is part of the NightDriver software project.
+//
+//    NightDriver is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    NightDriver is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Nightdriver.  It is normally found in copying.txt
+//    If not, see <https://www.gnu.org/licenses/>.
+//
+//
+// Description:
+//
+//    Optional UDP (and multicast) listener that the SocketServer polls alongside its TCP
+//    connections.  Packets are the same ones that come in over TCP, cut into datagrams that
+//    each carry a sequence number and fragment index so they can be put back together.
+//
+// History:     Oct-16-2026         agent       Created
+//---------------------------------------------------------------------------
+#pragma once
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <string.h>
+#include <memory>
+
+// Each datagram starts with a sequence32 that goes up by one per packet, then the fragment index16 and
+// fragment count16, then the size32 of the whole packet.  The rest is that fragment of the packet.  Every
+// fragment but the last must be the same size.
+
+#define UDP_FRAGMENT_HEADER_SIZE    12                                              // Size of the header on each datagram
+#define UDP_MAX_DATAGRAM_SIZE       1472                                            // Biggest datagram that fits in a 1500 byte MTU
+#define UDP_MAX_FRAGMENTS           64                                              // One bit each in UdpReassemblySlot::_received
+
+#ifndef UDP_REASSEMBLY_SLOTS
+#define UDP_REASSEMBLY_SLOTS        2                                               // How many packets can be half-assembled at once
+#endif
+
+#define UDP_SEQUENCE_RESET_WINDOW   1000                                            // A sequence this far behind means the sender restarted
+
+// UdpReassemblySlot
+//
+// One packet in the process of being put back together
+
+struct UdpReassemblySlot
+{
+    std::unique_ptr<uint8_t []> _pBuffer;
+    bool                        _bInUse = false;
+    uint32_t                    _sequence = 0;
+    uint32_t                    _cbPacket = 0;
+    uint32_t                    _cbFragment = 0;            // Size of every fragment but the last, once we know it
+    uint16_t                    _cFragments = 0;
+    uint16_t                    _cReceived = 0;
+    uint64_t                    _received = 0;              // Bitmask of the fragments that have arrived
+};
+
+// UdpReceiver
+//
+// Owns the UDP socket and reassembles the packets that arrive on it.  A packet is only handed out if it's
+// newer than the last one that was, so duplicates and stragglers are dropped rather than queued out of order.
+
+class UdpReceiver
+{
+private:
+
+    int                         _socket = -1;
+    std::unique_ptr<uint8_t []> _abDatagram;
+    UdpReassemblySlot           _slots[UDP_REASSEMBLY_SLOTS];
+    bool                        _bHaveSequence = false;     // Whether _lastSequence and _highestSequence mean anything yet
+    uint32_t                    _lastSequence = 0;          // The last packet handed out
+    uint32_t                    _highestSequence = 0;       // The newest sequence seen in any datagram
+
+public:
+
+    uint32_t                    _cDatagrams = 0;            // Every datagram read
+    uint32_t                    _cBadDatagrams = 0;         // Datagrams with a header that makes no sense
+    uint32_t                    _cDuplicates = 0;           // Fragments we already had
+    uint32_t                    _cLate = 0;                 // Datagrams for packets older than the last one handed out
+    uint32_t                    _cReordered = 0;            // Datagrams that arrived after a newer sequence had been seen
+    uint32_t                    _cLost = 0;                 // Sequences that were skipped over and never handed out
+    uint32_t                    _cPackets = 0;              // Packets handed out
+    uint32_t                    _cReassembled = 0;          // Packets handed out that came in more than one fragment
+
+    int Socket() const
+    {
+        return _socket;
+    }
+
+    bool IsOpen() const
+    {
+        return _socket >= 0;
+    }
+
+    void release()
+    {
+        if (IsOpen())
+            close(_socket);
+        _socket = -1;
+
+        for (auto & slot : _slots)
+        {
+            slot._bInUse = false;
+            slot._pBuffer.reset();
+        }
+        _abDatagram.reset();
+        _bHaveSequence = false;
+    }
+
+    // begin
+    //
+    // Binds the UDP port, joins the multicast group if one is given, and allocates the reassembly buffers
+
+    bool begin(int port, const char * pszMulticastGroup)
+    {
+        if ((_socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+        {
+            debugW("UDP socket error\n");
+            release();
+            return false;
+        }
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port);
+
+        if (bind(_socket, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            debugW("UDP bind failed\n");
+            release();
+            return false;
+        }
+
+        if (pszMulticastGroup && pszMulticastGroup[0])
+        {
+            struct ip_mreq mreq;
+            mreq.imr_multiaddr.s_addr = inet_addr(pszMulticastGroup);
+            mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (setsockopt(_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+            {
+                debugW("Unable to join multicast group %s\n", pszMulticastGroup);
+                release();
+                return false;
+            }
+            debugI("Joined multicast group %s", pszMulticastGroup);
+        }
+
+        int flags = fcntl(_socket, F_GETFL, 0);
+        if (flags < 0 || fcntl(_socket, F_SETFL, flags | O_NONBLOCK) < 0)
+        {
+            debugW("Unable to make UDP socket non-blocking\n");
+            release();
+            return false;
+        }
+
+        // One extra byte so that a datagram too big for us shows up as one rather than being silently cut short
+
+        _abDatagram = std::make_unique<uint8_t []>(UDP_MAX_DATAGRAM_SIZE + 1);
+        for (auto & slot : _slots)
+            slot._pBuffer = std::make_unique<uint8_t []>(MAXIUMUM_PACKET_SIZE);
+
+        return true;
+    }
+
+    // ReceiveDatagram
+    //
+    // Reads one datagram, if there is one.  Returns false once there's nothing left to read.  When the datagram
+    // completes a packet, pPacket and cbPacket describe it; they stay valid until the next call.
+
+    bool ReceiveDatagram(uint8_t *& pPacket, size_t & cbPacket)
+    {
+        pPacket  = nullptr;
+        cbPacket = 0;
+
+        int cbRead = recv(_socket, _abDatagram.get(), UDP_MAX_DATAGRAM_SIZE + 1, 0);
+        if (cbRead < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                debugW("Error %d reading from UDP socket", errno);
+            return false;
+        }
+
+        _cDatagrams++;
+
+        const uint8_t * pDatagram = _abDatagram.get();
+        if (cbRead <= UDP_FRAGMENT_HEADER_SIZE || cbRead > UDP_MAX_DATAGRAM_SIZE)
+        {
+            debugV("Dropping UDP datagram of %d bytes", cbRead);
+            _cBadDatagrams++;
+            return true;
+        }
+
+        uint32_t sequence   = DWORDFromMemory(&pDatagram[0]);
+        uint16_t index      = WORDFromMemory(&pDatagram[4]);
+        uint16_t cFragments = WORDFromMemory(&pDatagram[6]);
+        uint32_t cbTotal    = DWORDFromMemory(&pDatagram[8]);
+        size_t   cbFragment = cbRead - UDP_FRAGMENT_HEADER_SIZE;
+
+        if (cFragments == 0 || cFragments > UDP_MAX_FRAGMENTS || index >= cFragments || cbTotal > MAXIUMUM_PACKET_SIZE)
+        {
+            debugW("Bad UDP fragment header: fragment %u of %u, %u bytes", index, cFragments, cbTotal);
+            _cBadDatagrams++;
+            return true;
+        }
+
+        if (_bHaveSequence)
+        {
+            int32_t ahead = (int32_t)(sequence - _lastSequence);
+            if (ahead <= 0)
+            {
+                if (ahead > -UDP_SEQUENCE_RESET_WINDOW)
+                {
+                    _cLate++;
+                    return true;
+                }
+                debugI("UDP sequence went back from %u to %u, assuming the sender restarted", _lastSequence, sequence);
+                for (auto & slot : _slots)
+                    slot._bInUse = false;
+                _bHaveSequence = false;
+            }
+            else if ((int32_t)(sequence - _highestSequence) < 0)
+            {
+                _cReordered++;
+            }
+        }
+
+        if (!_bHaveSequence || (int32_t)(sequence - _highestSequence) > 0)
+            _highestSequence = sequence;
+
+        UdpReassemblySlot * pSlot = FindSlot(sequence, cFragments, cbTotal);
+        if (nullptr == pSlot)
+            return true;
+
+        if (pSlot->_received & (1ULL << index))
+        {
+            _cDuplicates++;
+            return true;
+        }
+
+        // Every fragment but the last is full size, so the last one tells us what full size is, and any other
+        // fragment has to agree with it
+
+        uint32_t cbFullFragment = cbFragment;
+        if (index == cFragments - 1)
+        {
+            if (cFragments == 1)
+                cbFullFragment = cbTotal;
+            else if (cbFragment >= cbTotal || (cbTotal - cbFragment) % (cFragments - 1) != 0)
+                cbFullFragment = 0;
+            else
+                cbFullFragment = (cbTotal - cbFragment) / (cFragments - 1);
+        }
+
+        if (cbFullFragment == 0 || cbFragment > cbFullFragment || (pSlot->_cbFragment != 0 && pSlot->_cbFragment != cbFullFragment)
+            || (size_t) index * cbFullFragment + cbFragment > cbTotal)
+        {
+            debugW("UDP fragment %u of sequence %u has an inconsistent size of %u", index, sequence, cbFragment);
+            _cBadDatagrams++;
+            return true;
+        }
+
+        pSlot->_cbFragment = cbFullFragment;
+        memcpy(pSlot->_pBuffer.get() + index * cbFullFragment, &pDatagram[UDP_FRAGMENT_HEADER_SIZE], cbFragment);
+        pSlot->_received |= (1ULL << index);
+        pSlot->_cReceived++;
+
+        if (pSlot->_cReceived < pSlot->_cFragments)
+            return true;
+
+        // The packet is complete.  Anything older that's still being assembled can never be handed out now.
+
+        if (_bHaveSequence && sequence - _lastSequence > 1)
+            _cLost += sequence - _lastSequence - 1;
+
+        for (auto & slot : _slots)
+            if (slot._bInUse && (int32_t)(slot._sequence - sequence) <= 0)
+                slot._bInUse = false;
+
+        _lastSequence  = sequence;
+        _bHaveSequence = true;
+        _cPackets++;
+        if (cFragments > 1)
+            _cReassembled++;
+
+        pPacket  = pSlot->_pBuffer.get();
+        cbPacket = cbTotal;
+        return true;
+    }
+
+private:
+
+    // FindSlot
+    //
+    // Finds the slot that's assembling this sequence, or starts a new one.  If every slot is busy, the oldest
+    // packet is given up on, unless this one is older still, in which case it's the one that's dropped.
+
+    UdpReassemblySlot * FindSlot(uint32_t sequence, uint16_t cFragments, uint32_t cbTotal)
+    {
+        UdpReassemblySlot * pFree   = nullptr;
+        UdpReassemblySlot * pOldest = nullptr;
+
+        for (auto & slot : _slots)
+        {
+            if (!slot._bInUse)
+            {
+                pFree = &slot;
+                continue;
+            }
+            if (slot._sequence == sequence)
+            {
+                if (slot._cFragments != cFragments || slot._cbPacket != cbTotal)
+                {
+                    debugW("UDP fragment disagrees with the rest of sequence %u", sequence);
+                    _cBadDatagrams++;
+                    return nullptr;
+                }
+                return &slot;
+            }
+            if (!pOldest || (int32_t)(slot._sequence - pOldest->_sequence) < 0)
+                pOldest = &slot;
+        }
+
+        if (!pFree)
+        {
+            if ((int32_t)(sequence - pOldest->_sequence) < 0)
+            {
+                _cLate++;
+                return nullptr;
+            }
+            debugV("Giving up on UDP sequence %u to make room for %u", pOldest->_sequence, sequence);
+            pFree = pOldest;
+        }
+
+        pFree->_bInUse     = true;
+        pFree->_sequence   = sequence;
+        pFree->_cbPacket   = cbTotal;
+        pFree->_cbFragment = 0;
+        pFree->_cFragments = cFragments;
+        pFree->_cReceived  = 0;
+        pFree->_received   = 0;
+        return pFree;
+    }
+};
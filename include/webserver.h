@@ -138,7 +138,11 @@ class CWebServer
 
         debugV("GetStatistics");
 
-        auto response = new AsyncJsonResponse(false, JSON_BUFFER_BASE_SIZE);
+        #if ENABLE_FRAME_PROFILER
+            auto response = new AsyncJsonResponse(false, JSON_BUFFER_BASE_SIZE + 1024);     // Room for the stage timings
+        #else
+            auto response = new AsyncJsonResponse(false, JSON_BUFFER_BASE_SIZE);
+        #endif
         response->addHeader("Server","NightDriverStrip");
         auto j = response->getRoot();
 
@@ -171,6 +175,30 @@ class CWebServer
         j["CPU_USED_CORE0"]        = g_TaskManager.GetCPUUsagePercent(0);
         j["CPU_USED_CORE1"]        = g_TaskManager.GetCPUUsagePercent(1);
 
+        #if SKIP_UNCHANGED_FRAMES
+            const ShowStats & effectStats = g_aptrEffectManager->GetCurrentEffect()->GetShowStats();
+            j["EFFECT_FRAMES_SHOWN"]   = effectStats.cShown;
+            j["EFFECT_FRAMES_SKIPPED"] = effectStats.cSkipped;
+            j["EFFECT_SKIP_SAVED_MS"]  = (uint32_t)(effectStats.usSaved / 1000);
+            j["WIFI_FRAMES_SHOWN"]     = g_WiFiShowStats.cShown;
+            j["WIFI_FRAMES_SKIPPED"]   = g_WiFiShowStats.cSkipped;
+            j["WIFI_SKIP_SAVED_MS"]    = (uint32_t)(g_WiFiShowStats.usSaved / 1000);
+        #endif
+
+        #if ENABLE_FRAME_PROFILER
+            auto profile = j.createNestedObject("FRAME_PROFILE");
+            for (size_t i = 0; i < (size_t) ProfileStage::Count; i++)
+            {
+                ProfileStats stats = g_FrameProfiler.GetStats((ProfileStage) i);
+                auto stage = profile.createNestedObject(stats.name);
+                stage["COUNT"]  = stats.count;
+                stage["MIN_US"] = stats.minUs;
+                stage["AVG_US"] = stats.avgUs;
+                stage["P99_US"] = stats.p99Us;
+                stage["MAX_US"] = stats.maxUs;
+            }
+        #endif
+
         response->setLength();
         response->addHeader("Access-Control-Allow-Origin", "*");
         pRequest->send(response);
@@ -38,15 +38,28 @@ CRGB g_SinglePixel = CRGB::Blue;
 CLEDController *g_ledSinglePixel;
 
 // The g_buffer_mutex is a global mutex used to protect access while adding or removing frames
-// from the led buffer.
+// from the led buffer (unless LOCKFREE_BUFFER_RING makes it a no-op; see ledbuffer.h)
 
-extern std::mutex g_buffer_mutex;
+extern BufferRingMutex g_buffer_mutex;
 
 DRAM_ATTR std::unique_ptr<LEDBufferManager> g_aptrBufferManager[NUM_CHANNELS];
-DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
 
 float volatile g_FreeDrawTime = 0.0;
 
+DRAM_ATTR FramePacer g_FramePacer;
+
+#if ENABLE_FRAME_PROFILER
+    DRAM_ATTR FrameProfiler g_FrameProfiler;
+#endif
+
+#if PIPELINED_OUTPUT
+    DRAM_ATTR FrameHandoff g_OutputHandoff;
+#endif
+
+DRAM_ATTR ShowStats g_WiFiShowStats;
+volatile uint32_t g_usShowCost = 0;                 // Smoothed time SendToStrip takes, which is what skipping a frame saves
+
 extern uint32_t g_FPS;
 extern AppTime g_AppTime;
 extern bool g_bUpdateStarted;
@@ -87,7 +100,7 @@ void MatrixPreDraw()
             LEDMatrixGFX::backgroundLayer.drawString(MATRIX_WIDTH / 2 - (3 * output.length()), MATRIX_HEIGHT / 2 - 5, rgb24(255, 255, 255), rgb24(0, 0, 0), output.c_str());
         #endif
 
-        GFXBase *graphics = (GFXBase *)(*g_aptrEffectManager)[0].get();
+        DeviceGFX *graphics = (*g_aptrEffectManager)[0].get();
 
         LEDMatrixGFX *pMatrix = (LEDMatrixGFX *)graphics;
         pMatrix->setLeds(LEDMatrixGFX::GetMatrixBackBuffer());
@@ -140,23 +153,26 @@ void MatrixPreDraw()
 
 uint16_t WiFiDraw()
 {
-    std::lock_guard<std::mutex> guard(g_buffer_mutex);
+    std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
 
     uint16_t pixelsDrawn = 0;
     for (int iChannel = 0; iChannel < NUM_CHANNELS; iChannel++)
     {
         
-        timeval tv;
-        gettimeofday(&tv, nullptr);
+        uint64_t usNow = Timebase::WallMicros();
         
-        // Pull buffers out of the queue.  
+        // Pull buffers out of the queue.  Each one stays in the ring while we draw it, so that the socket task
+        // can't reuse it underneath us, and is only released once we're done with it.
 
-        if (false == g_aptrBufferManager[iChannel]->IsEmpty())
+        auto & bufferManager = *g_aptrBufferManager[iChannel];
+        if (false == bufferManager.IsEmpty())
         {
             std::shared_ptr<LEDBuffer> pBuffer;
+            std::shared_ptr<LEDBuffer> pNext;                   // Set when interpolating towards the next frame
+            uint16_t weight = 0;
             if (NTPTimeClient::HasClockBeenSet() == false)
             {
-                pBuffer = g_aptrBufferManager[iChannel]->GetOldestBuffer();
+                pBuffer = bufferManager.PeekOldestBuffer();
             }
             else
             {
@@ -164,18 +180,74 @@ uint16_t WiFiDraw()
                 // written as 'while' it will pull frames until it gets one that is current.
                 // Chew through ALL frames older than now, ignoring all but the last of them
 
-                while (!g_aptrBufferManager[iChannel]->IsEmpty() && g_aptrBufferManager[iChannel]->PeekOldestBuffer()->IsBufferOlderThan(tv))
-                    pBuffer = g_aptrBufferManager[iChannel]->GetOldestBuffer();
+                while (bufferManager[1] && bufferManager[1]->IsBufferOlderThan(usNow))
+                    bufferManager.DiscardLateBuffer();
+
+                pBuffer = bufferManager.PeekOldestBuffer();
+                if (pBuffer && !pBuffer->IsBufferOlderThan(usNow))
+                    pBuffer = nullptr;
+
+                #if WIFI_FRAME_INTERPOLATION
+                    // If the next frame is already here, we're somewhere between the two, so we show a blend
+                    // of them and hang on to this one until the next is due
+
+                    pNext = bufferManager[1];
+                    if (pBuffer && pNext && pNext->Length() == pBuffer->Length())
+                    {
+                        int64_t usSpan = Timebase::MicrosBetween(pBuffer->Timestamp(), pNext->Timestamp());
+                        if (usSpan > 0)
+                            weight = std::clamp<int64_t>(Timebase::MicrosBetween(pBuffer->Timestamp(), usNow) * 256 / usSpan, 0, 256);
+                        else
+                            pNext = nullptr;
+                    }
+                    else
+                    {
+                        pNext = nullptr;
+                    }
+                #endif
+
+                // A frame we only get to well after its time still gets drawn, but counts as late.  One we're
+                // blending from is always between two frames, so it isn't.
+
+                if (pBuffer && !pNext)
+                {
+                    if (Timebase::MicrosBetween(pBuffer->Timestamp(), usNow) > TELEMETRY_LATE_FRAME_MS * MICROS_PER_MILLI)
+                        g_Telemetry._cFramesLate++;
+                }
             }
 
             if (pBuffer)
             {
                 g_usLastWifiDraw = micros();
                 debugV("Calling LEDBuffer::Draw from wire with %d/%d pixels.", pixelsDrawn, NUM_LEDS);
-                pBuffer->DrawBuffer();
+                bool bHeld = false;
+                if (pNext)
+                {
+                    pBuffer->DrawBlended(*pNext, weight);
+                }
+                else
+                {
+                    // A frame already laid out as the strip is can be shown from where it is, so long as it's
+                    // held in the ring until it has been (see ReleaseHeldBuffers)
+
+                    #if ZERO_COPY_WIFI
+                        bHeld = pBuffer->_pStrand->IsWireLayout();
+                        if (bHeld)
+                            ((LEDStripGFX *)pBuffer->_pStrand.get())->ShowFrom(pBuffer->Pixels());
+                    #endif
+
+                    if (!bHeld)
+                        pBuffer->DrawBuffer();
+                }
                 // In case we drew some pixels and then drew 0 due a failure, we want to return a positive
                 // number of pixels drawn so the caller knows we did in fact render.
                 pixelsDrawn += pBuffer->Length();
+                if (bHeld)
+                    bufferManager.HoldOldestBuffer();
+                else if (pNext)
+                    bufferManager.KeepShownBuffer();
+                else
+                    bufferManager.ReleaseOldestBuffer();
             }
         }
     }
@@ -189,7 +261,7 @@ uint16_t WiFiDraw()
 
 uint16_t LocalDraw()
 {
-    GFXBase *graphics = (GFXBase *)(*g_aptrEffectManager)[0].get();
+    DeviceGFX *graphics = (*g_aptrEffectManager)[0].get();
 
     if (nullptr == g_aptrEffectManager)
     {
@@ -202,12 +274,18 @@ uint16_t LocalDraw()
         // If we've never drawn from wifi before, now would also be a good time to local draw
         if (g_usLastWifiDraw == 0 || (micros() - g_usLastWifiDraw > (TIME_BEFORE_LOCAL * MICROS_PER_SECOND)))
         {
-            g_aptrEffectManager->Update(); // Draw the current built in effect
+            {
+                PROFILE_STAGE(EffectUpdate);
+                g_aptrEffectManager->Update(); // Draw the current built in effect
+            }
 
             #if SHOW_VU_METER
                 static auto spectrum = GetSpectrumAnalyzer(0);
                 if (g_aptrEffectManager->IsVUVisible())
+                {
+                    PROFILE_STAGE(VUMeter);
                     ((SpectrumAnalyzerEffect *)spectrum.get())->DrawVUMeter(graphics, 0, g_Analyzer.MicMode() == PeakData::PCREMOTE ? & vuPaletteBlue : &vuPaletteGreen);
+                }
             #endif
 
             debugV("LocalDraw claims to have drawn %d pixels", NUM_LEDS);
@@ -226,11 +304,97 @@ uint16_t LocalDraw()
     return 0;
 }
 
+// SendToStrip
+//
+// Sends the LED buffers FastLED has been given to the strip, and works out the stats that go with showing them.
+// We do the power limiting rather than FastLED, since it would go over every pixel to work out the brightness,
+// and calculate_max_brightness_for_power_mW and calculate_unscaled_power_mW would each go over them again for
+// the stats.  PowerEstimator gets all three from one faster pass over each channel.
+
+void SendToStrip()
+{
+    unsigned long usStart = micros();
+
+    uint32_t total_mW = 0;
+    uint32_t strip_mW = 0;
+    for (int i = 0; i < FastLED.count(); i++)
+    {
+        uint32_t mW = PowerEstimator::UnscaledPower_mW(PowerEstimator::SumColors(FastLED[i].leds(), FastLED[i].size()));
+        total_mW += mW;
+        if (i == 0)
+            strip_mW = mW;
+    }
+
+    {
+        PROFILE_STAGE(Show);
+        FastLED.show(PowerEstimator::LimitBrightness(g_Fader, total_mW, POWER_LIMIT_MW));
+    }
+
+    g_FPS = FastLED.getFPS();
+    g_Brite = 100.0 * PowerEstimator::LimitBrightness(g_Brightness, total_mW, POWER_LIMIT_MW) / 255;
+    g_Watts = strip_mW / 1000; // 1000 for mw->W
+
+    int32_t usCost = micros() - usStart;
+    g_usShowCost = (int32_t) g_usShowCost + (usCost - (int32_t) g_usShowCost) / 16;
+}
+
+#if SKIP_UNCHANGED_FRAMES
+
+// IsFrameUnchanged
+//
+// Hashes what's about to be shown on every channel, along with the fader that FastLED scales it by, and tells
+// whether it's the same as the frame last sent to the strip, recently enough that it doesn't need refreshing yet.
+// If it isn't, it's remembered as the frame last sent, since it's about to be.
+
+bool IsFrameUnchanged(uint16_t numToShow)
+{
+    static uint32_t      lastHash   = 0;
+    static uint16_t      lastCount  = 0;                // None sent yet, and we never send none
+    static unsigned long msLastSent = 0;
+
+    uint32_t hash = (2166136261u ^ g_Fader) * 16777619u;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+        hash = ((LEDStripGFX *)(*g_aptrEffectManager)[i].get())->HashLeds(numToShow, hash);
+
+    unsigned long msNow = millis();
+    if (hash == lastHash && numToShow == lastCount && msNow - msLastSent < SKIP_UNCHANGED_REFRESH_MS)
+        return true;
+
+    lastHash   = hash;
+    lastCount  = numToShow;
+    msLastSent = msNow;
+    return false;
+}
+
+#endif
+
+#if PIPELINED_OUTPUT
+
+// OutputLoopTaskEntry
+//
+// With PIPELINED_OUTPUT, this task sends each frame the draw task hands over to the strip, on the other core,
+// while the draw task gets on with the next one
+
+void IRAM_ATTR OutputLoopTaskEntry(void *)
+{
+    for (;;)
+    {
+        g_OutputHandoff.WaitForFrame();
+        SendToStrip();
+        g_OutputHandoff.Done();
+    }
+}
+
+#endif
+
 // ShowStrip
 //
 // ShowStrip sends the data to the LED strip.  If its fewer than the size of the strip, we only send that many.
+// With PIPELINED_OUTPUT it hands the frame to the output task instead, and bPreserve says whether the effect
+// that drew it will want it again to draw the next one over.  With SKIP_UNCHANGED_FRAMES, a frame the same as the
+// last one sent isn't sent again.  Either way, it's counted in stats.
 
-void ShowStrip(uint16_t numToShow)
+void ShowStrip(uint16_t numToShow, bool bPreserve, ShowStats & stats)
 {
     // If we've drawn anything from either source, we can now show it
 
@@ -243,19 +407,46 @@ void ShowStrip(uint16_t numToShow)
     {
         if (numToShow > 0)
         {
-            debugV("Telling FastLED that we'll be drawing %d pixels\n", numToShow);
-
-            for (int i = 0; i < NUM_CHANNELS; i++)
-            {
-                LEDStripGFX *pStrip = (LEDStripGFX *)(*g_aptrEffectManager)[i].get();
-                FastLED[i].setLeds(pStrip->leds, numToShow);
-            }
+            #if SKIP_UNCHANGED_FRAMES
+                if (IsFrameUnchanged(numToShow))
+                {
+                    debugV("Frame is the same as the last one shown, so not showing it again");
+                    stats.cSkipped++;
+                    stats.usSaved += g_usShowCost;
+                    return;
+                }
+            #endif
 
-            FastLED.show(g_Fader);
+            stats.cShown++;
+            debugV("Telling FastLED that we'll be drawing %d pixels\n", numToShow);
 
-            g_FPS = FastLED.getFPS();
-            g_Brite = 100.0 * calculate_max_brightness_for_power_mW(g_Brightness, POWER_LIMIT_MW) / 255;
-            g_Watts = calculate_unscaled_power_mW(((LEDStripGFX *)(*g_aptrEffectManager)[0].get())->leds, numToShow) / 1000; // 1000 for mw->W
+            #if PIPELINED_OUTPUT
+                {
+                    PROFILE_STAGE(OutputWait);
+                    g_OutputHandoff.WaitUntilIdle();
+                }
+
+                for (int i = 0; i < NUM_CHANNELS; i++)
+                {
+                    LEDStripGFX *pStrip = (LEDStripGFX *)(*g_aptrEffectManager)[i].get();
+                    pStrip->SwapLEDBuffers();
+                    FastLED[i].setLeds(pStrip->GetFrontBuffer(), numToShow);
+                }
+
+                g_OutputHandoff.Submit(numToShow);
+
+                if (bPreserve)
+                    for (int i = 0; i < NUM_CHANNELS; i++)
+                        ((LEDStripGFX *)(*g_aptrEffectManager)[i].get())->PreserveFrontBuffer();
+            #else
+                for (int i = 0; i < NUM_CHANNELS; i++)
+                {
+                    LEDStripGFX *pStrip = (LEDStripGFX *)(*g_aptrEffectManager)[i].get();
+                    FastLED[i].setLeds(pStrip->OutputBuffer(), numToShow);
+                }
+
+                SendToStrip();
+            #endif
         }
         else
         {
@@ -264,11 +455,38 @@ void ShowStrip(uint16_t numToShow)
     }
 }
 
+#if ZERO_COPY_WIFI
+
+// ReleaseHeldBuffers
+//
+// Once the strip has been shown, hands back the WiFi frames it was shown straight from, and points FastLED back
+// at the strips' own buffers, since an LEDBuffer back in the ring can be overwritten (or freed) at any time
+
+void ReleaseHeldBuffers()
+{
+    std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
+
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        LEDStripGFX *pStrip = (LEDStripGFX *)(*g_aptrEffectManager)[i].get();
+        if (pStrip->OutputBuffer() != pStrip->leds)
+        {
+            pStrip->ShowFrom(nullptr);
+            FastLED[i].setLeds(pStrip->leds, FastLED[i].size());
+        }
+        g_aptrBufferManager[i]->ReleaseHeldBuffer();
+    }
+}
+
+#endif
+
 // DelayUntilNextFrame
 //
-// Waits patiently until its time to draw the next frame, up to one second max
+// Waits patiently until its time to draw the next frame.  Local effects are paced to their DesiredFramesPerSecond,
+// and WiFi to when the next buffer is due, by g_FramePacer, which works to absolute deadlines so that the time it
+// takes to draw a frame doesn't come off the frame rate.
 
-void DelayUntilNextFrame(float frameStartTime, uint16_t localPixelsDrawn, uint16_t wifiPixelsDrawn)
+void DelayUntilNextFrame(uint64_t usFrameStart, uint16_t localPixelsDrawn, uint16_t wifiPixelsDrawn)
 {
     // Delay enough to slow down to the desired framerate
 
@@ -276,36 +494,46 @@ void DelayUntilNextFrame(float frameStartTime, uint16_t localPixelsDrawn, uint16
 
     if (localPixelsDrawn > 0)
     {
-        const float minimumFrameTime = 1.0 / g_aptrEffectManager->GetCurrentEffect()->DesiredFramesPerSecond();
-        float elapsed = g_AppTime.CurrentTime() - frameStartTime;
-        if (elapsed < minimumFrameTime)
-        {
-            g_FreeDrawTime = std::min(1.0f, (minimumFrameTime - elapsed));
-            delay(g_FreeDrawTime * MILLIS_PER_SECOND);
-        }
+        uint64_t usWaited = g_FramePacer.WaitForLocalFrame(g_aptrEffectManager->GetCurrentEffect()->DesiredFramesPerSecond(), usFrameStart);
+        g_FreeDrawTime = usWaited / (float) MICROS_PER_SECOND;
     }
     else if (wifiPixelsDrawn > 0)
     {
         // Sleep up to 1/25th second, depending on how far away the next frame we need to service is
 
-        float t = 0.04;
+        uint64_t usNow  = Timebase::MonotonicMicros();
+        uint64_t usNext = usNow + 40 * MICROS_PER_MILLI;
         for (int iChannel = 0; iChannel < NUM_CHANNELS; iChannel++)
         {
             auto pOldest = g_aptrBufferManager[iChannel]->PeekOldestBuffer();
             if (pOldest)
-                t = std::min(t, (pOldest->Seconds() + pOldest->MicroSeconds() / (float) MICROS_PER_SECOND) - g_AppTime.CurrentTime());
+            {
+                uint64_t usDue = Timebase::MonotonicFromWall(pOldest->Timestamp());
+
+                #if WIFI_FRAME_INTERPOLATION
+                    // A frame that's already due and still here is one we're interpolating from, so the next
+                    // blend is due at the interpolation rate rather than when some frame is
+
+                    if (Timebase::MicrosBetween(usDue, usNow) >= 0 && g_aptrBufferManager[iChannel]->Depth() > 1)
+                        usDue = usFrameStart + MICROS_PER_SECOND / WIFI_INTERPOLATION_FPS;
+                #endif
+
+                if (Timebase::MicrosBetween(usDue, usNext) > 0)
+                    usNext = usDue;
+            }
         }
 
-        g_FreeDrawTime = t;
-        if (g_FreeDrawTime > 0.0)
-            delay(g_FreeDrawTime * MILLIS_PER_SECOND);
-        else
-            g_FreeDrawTime = 0.0;
+        uint64_t usWaited = g_FramePacer.WaitUntil(usNext);
+        g_FreeDrawTime = usWaited / (float) MICROS_PER_SECOND;
     }
     else
     {
         debugV("Nothing drawn this pass because neither wifi nor local rendered a frame");
-        // Nothing drawn this pass - check back soon
+
+        // Nothing drawn this pass - check back soon.  We near-busy-wait so that we are continually checking the
+        // clock for a packet whose time has come.  yield() alone did not solve it, likely since our priority is
+        // higher than the idle task so you can still starve the watchdog if you're always busy.
+
         g_FreeDrawTime = .001;
         delay(1);
     }
@@ -373,7 +601,7 @@ void IRAM_ATTR DrawLoopTaskEntry(void *)
 
     PrepareOnboardPixel();
 
-    GFXBase *graphics = (GFXBase *)(*g_aptrEffectManager)[0].get();
+    DeviceGFX *graphics = (*g_aptrEffectManager)[0].get();
     graphics->Setup();
 
 #if USE_MATRIX
@@ -400,14 +628,21 @@ void IRAM_ATTR DrawLoopTaskEntry(void *)
 
         uint16_t localPixelsDrawn   = 0;
         uint16_t wifiPixelsDrawn    = 0;
-        float frameStartTime       = g_AppTime.FrameStartTime();
+        uint64_t usFrameStart       = g_AppTime.FrameStartMicros();
+        unsigned long usDrawStart   = micros();
 
         #if USE_MATRIX
+        {
+            PROFILE_STAGE(MatrixPreDraw);
             MatrixPreDraw();
+        }
         #endif
 
         if (WiFi.isConnected())
+        {
+            PROFILE_STAGE(WiFiDraw);
             wifiPixelsDrawn = WiFiDraw();
+        }
 
         // If we didn't draw now, and it's been a while since we did, and we have at least one local effect, then draw the local effect instead
 
@@ -417,6 +652,7 @@ void IRAM_ATTR DrawLoopTaskEntry(void *)
         #if USE_MATRIX
             if (wifiPixelsDrawn + localPixelsDrawn > 0)
             {
+                PROFILE_STAGE(MatrixSwap);
                 LEDMatrixGFX::MatrixSwapBuffers(g_aptrEffectManager->GetCurrentEffect()->RequiresfloatBuffering(), pMatrix->GetCaptionTransparency() > 0);
                 FastLED.countFPS();
                 g_FPS = FastLED.getFPS();
@@ -424,18 +660,30 @@ void IRAM_ATTR DrawLoopTaskEntry(void *)
         #endif
         #if USESTRIP
             if (wifiPixelsDrawn)
-                ShowStrip(wifiPixelsDrawn);
+            {
+                ShowStrip(wifiPixelsDrawn, false, g_WiFiShowStats);
+            }
             else if (localPixelsDrawn)
-                ShowStrip(localPixelsDrawn);
+            {
+                auto pEffect = g_aptrEffectManager->GetCurrentEffect();
+                ShowStrip(localPixelsDrawn, pEffect->RequiresfloatBuffering(), pEffect->GetShowStats());
+            }
         #endif
 
+        if (wifiPixelsDrawn)
+            g_Telemetry._drawToShow.Add(micros() - usDrawStart);
+
         // If the module has onboard LEDs, we support a couple of different types, and we set it to be the same as whatever
         // is on LED #0 of Channel #0.
 
         ShowOnboardPixel();
         ShowOnboardRGBLED();
 
-        DelayUntilNextFrame(frameStartTime, localPixelsDrawn, wifiPixelsDrawn);
+        #if ZERO_COPY_WIFI
+            ReleaseHeldBuffers();
+        #endif
+
+        DelayUntilNextFrame(usFrameStart, localPixelsDrawn, wifiPixelsDrawn);
 
         // Once an OTA flash update has started, we don't want to hog the CPU or it goes quite slowly,
         // so we'll slow down to share the CPU a bit once the update has begun
@@ -443,10 +691,10 @@ void IRAM_ATTR DrawLoopTaskEntry(void *)
         if (g_bUpdateStarted)
             delay(100);
 
-        // If we didn't draw anything, we near-busy-wait so that we are continually checking the clock for an packet
-        // whose time has come.  yield() alone did not solve it, likely since our priority is higher than the idle
-        // task so you can still starve the watchdog if you're always busy
+        // DelayUntilNextFrame always blocks now and then (see FramePacer), but without pacing nothing else does
 
-        delay(1);
+        #if MILLIS_PER_FRAME != 0
+            delay(1);
+        #endif
     }
 }
@@ -31,7 +31,7 @@
 #include "SPIFFS.h"
 #include "effectdependencies.h"
 
-extern DRAM_ATTR std::shared_ptr<GFXBase> g_aptrDevices[NUM_CHANNELS];
+extern DRAM_ATTR std::shared_ptr<DeviceGFX> g_aptrDevices[NUM_CHANNELS];
 
 #if USE_MATRIX
     volatile long PatternSubscribers::cSubscribers;
@@ -659,7 +659,7 @@ size_t CreateDefaultEffects(std::unique_ptr<EffectPointerArray>& pEffectList)
     return ARRAYSIZE(defaultEffects);
 }
 
-extern DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+extern DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
 DRAM_ATTR size_t g_EffectsManagerJSONBufferSize = 0;
 
 // InitEffectsManager
@@ -720,7 +720,7 @@ void InitEffectsManager()
     {
         debugI("Creating EffectManager from JSON config");
 
-        g_aptrEffectManager = std::make_unique<EffectManager<GFXBase>>(pJsonDoc->as<JsonObjectConst>(), g_aptrDevices);
+        g_aptrEffectManager = std::make_unique<EffectManager<DeviceGFX>>(pJsonDoc->as<JsonObjectConst>(), g_aptrDevices);
 
         if (g_aptrEffectManager->EffectCount() == 0)
         {
@@ -738,7 +738,7 @@ void InitEffectsManager()
         std::unique_ptr<EffectPointerArray> defaultEffects;
         size_t effectCount = CreateDefaultEffects(defaultEffects);
 
-        g_aptrEffectManager = std::make_unique<EffectManager<GFXBase>>(defaultEffects, effectCount, g_aptrDevices);
+        g_aptrEffectManager = std::make_unique<EffectManager<DeviceGFX>>(defaultEffects, effectCount, g_aptrDevices);
     }
 
     if (false == g_aptrEffectManager->Init())
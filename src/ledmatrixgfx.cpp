@@ -33,8 +33,8 @@
 #include "effects/matrix/Vector.h"
 
 extern DRAM_ATTR AppTime g_AppTime; // Keeps track of frame times
-extern DRAM_ATTR std::shared_ptr<GFXBase> g_aptrDevices[NUM_CHANNELS];
-extern DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+extern DRAM_ATTR std::shared_ptr<DeviceGFX> g_aptrDevices[NUM_CHANNELS];
+extern DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
 
 #if USE_MATRIX
 
@@ -190,11 +190,12 @@ DRAM_ATTR WiFiUDP g_Udp;
 DRAM_ATTR uint32_t g_FPS = 0;                                                       // Our global framerate
 DRAM_ATTR bool g_bUpdateStarted = false;                                            // Has an OTA update started?
 DRAM_ATTR AppTime g_AppTime;                                                        // Keeps track of frame times
+DRAM_ATTR Telemetry g_Telemetry;                                                    // Latency histograms for WiFi frames
 DRAM_ATTR bool NTPTimeClient::_bClockSet = false;                                   // Has our clock been set by SNTP?
 
-extern DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;       // The one and only global effect manager
+extern DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;       // The one and only global effect manager
 
-DRAM_ATTR std::shared_ptr<GFXBase> g_aptrDevices[NUM_CHANNELS];                     // The array of GFXBase devices (each strip channel, for example)
+DRAM_ATTR std::shared_ptr<DeviceGFX> g_aptrDevices[NUM_CHANNELS];                     // The array of GFXBase devices (each strip channel, for example)
 DRAM_ATTR std::mutex NTPTimeClient::_clockMutex;                                    // Clock guard mutex for SNTP client
 DRAM_ATTR RemoteDebug Debug;                                                        // Instance of our telnet debug server
 
@@ -464,6 +465,7 @@ Bounce2::Button Button2;
 // DebugLoopTaskEntry           - Run a little debug console accessible via telnet and serial
 // ScreenUpdateLoopEntry        - Displays stats on the attached OLED/TFT screen about drawing, network, etc
 // DrawLoopTaskEntry            - Handles drawing from local or wifi data
+// OutputLoopTaskEntry          - Sends frames to the strip while the next is drawn, with PIPELINED_OUTPUT
 // RemoteLoop                   - Handles the remote control loop
 // NetworkHandlingLoopEntry     - Connects to WiFi, handles reconnects, OTA updates, web server
 // SocketServerTaskEntry        - Creates the socket and listens for incoming wifi color data
@@ -680,7 +682,11 @@ void setup()
         cBuffers = MAX_BUFFERS;
     }
 
-    debugW("Reserving %d LED buffers for a total of %d bytes...", cBuffers, memtoalloc * cBuffers);
+    #if ADAPTIVE_BUFFER_DEPTH
+        debugW("Allowing up to %d LED buffers for a total of %d bytes...", cBuffers, memtoalloc * cBuffers);
+    #else
+        debugW("Reserving %d LED buffers for a total of %d bytes...", cBuffers, memtoalloc * cBuffers);
+    #endif
 
     for (int iChannel = 0; iChannel < NUM_CHANNELS; iChannel++)
         g_aptrBufferManager[iChannel] = std::make_unique<LEDBufferManager>(cBuffers, g_aptrDevices[iChannel]);
@@ -750,9 +756,7 @@ void setup()
             FastLED.addLeds<WS2812B, LED_PIN0, COLOR_ORDER>(g_aptrDevices[7].get()->leds,g_aptrDevices[7].get()->GetLEDCount());
         #endif
            
-        #ifdef POWER_LIMIT_MW
-            set_max_power_in_milliwatts(POWER_LIMIT_MW);                // Set brightness limit
-        #endif
+        // POWER_LIMIT_MW is applied by SendToStrip, so FastLED doesn't need to know about it
 
             g_Brightness = 255;
             
@@ -814,6 +818,7 @@ void setup()
 
     debugI("Launching Drawing:");
     debugE("Heap before launch: %s", heap_caps_check_integrity_all(true) ? "PASS" : "FAIL");
+    g_TaskManager.StartOutputThread();
     g_TaskManager.StartDrawThread();
     CheckHeap();
 
@@ -45,7 +45,7 @@ DRAM_ATTR ESP_WiFiManager g_WifiManager("NightDriverWiFi");
 
 extern DRAM_ATTR std::unique_ptr<LEDBufferManager> g_aptrBufferManager[NUM_CHANNELS];
 
-std::mutex g_buffer_mutex;
+BufferRingMutex g_buffer_mutex;
 String WiFi_ssid;
 String WiFi_password;
 
@@ -78,13 +78,40 @@ extern uint32_t g_FPS;
             debugI("%sdB:%s\n",String(WiFi.RSSI()).substring(1).c_str(), WiFi.isConnected() ? WiFi.localIP().toString().c_str() : "None");
             debugI("BUFR:%02d/%02d [%dfps]\n", g_aptrBufferManager[0]->Depth(), g_aptrBufferManager[0]->BufferCount(), g_FPS);
             debugI("DATA:%+04.2lf-%+04.2lf\n", g_aptrBufferManager[0]->AgeOfOldestBuffer(), g_aptrBufferManager[0]->AgeOfNewestBuffer());
+            debugI("Delta frames rejected for want of a keyframe: %u\n", g_aptrBufferManager[0]->DeltasRejected());
+            debugI("Frames late: %u, dropped: %u\n", g_Telemetry._cFramesLate.load(), g_Telemetry._cFramesDropped.load());
+            debugI("Pacing: %u frames, %u missed deadlines, interval error avg %uus, max %uus\n",
+                   g_FramePacer.FrameCount(), g_FramePacer.MissedDeadlines(), g_FramePacer.AverageError(), g_FramePacer.MaxError());
+            #if PIPELINED_OUTPUT
+                debugI("Output: %u frames handed off, draw task waited for the output task %u times\n",
+                       g_OutputHandoff.FramesHandedOff(), g_OutputHandoff.DrawWaits());
+            #endif
+            for (int iChannel = 0; iChannel < NUM_CHANNELS; iChannel++)
+            {
+                const auto & bufferManager = *g_aptrBufferManager[iChannel];
+                const auto & jitter = bufferManager.Jitter();
+                debugI("Channel %d: lead %dus, jitter %uus, frames every %uus, recommend lead %uus and %u buffers, dropped late: %u, evicted: %u\n",
+                       iChannel, jitter.AverageLead(), jitter.Jitter(), jitter.FrameInterval(), jitter.RecommendedLead(), jitter.RecommendedDepth(),
+                       bufferManager.FramesDroppedLate(), bufferManager.FramesEvicted());
+            }
 
             #if ENABLE_AUDIO
                 debugI("g_Analyzer._VU: %.2f, g_Analyzer._MinVU: %.2f, g_Analyzer.g_Analyzer._PeakVU: %.2f, g_Analyzer.gVURatio: %.2f", g_Analyzer._VU, g_Analyzer._MinVU, g_Analyzer._PeakVU, g_Analyzer._VURatio);
             #endif
 
             #if INCOMING_WIFI_ENABLED
-                debugI("Socket Buffer _cbReceived: %d", g_SocketServer._cbReceived);
+                for (size_t i = 0; i < MAX_SOCKET_CONNECTIONS; i++)
+                {
+                    const auto & conn = g_SocketServer._connections[i];
+                    if (conn.IsOpen())
+                        debugI("Socket %d: _cbReceived: %d, Packets: %u, Last packet took: %luus", i, conn._cbReceived, conn._cPackets, conn._usLastPacketTime);
+                }
+
+                #if INCOMING_UDP_ENABLED
+                    const auto & udp = g_SocketServer._udp;
+                    debugI("UDP: Datagrams: %u, Packets: %u, Reassembled: %u, Lost: %u, Reordered: %u, Late: %u, Duplicates: %u, Bad: %u",
+                           udp._cDatagrams, udp._cPackets, udp._cReassembled, udp._cLost, udp._cReordered, udp._cLate, udp._cDuplicates, udp._cBadDatagrams);
+                #endif
             #endif
 
             // Print out a buffer log with timestamps and deltas 
@@ -93,11 +120,126 @@ extern uint32_t g_FPS;
             {
                 auto pBufferManager = g_aptrBufferManager[0].get();
                 std::shared_ptr<LEDBuffer> pBuffer = (*pBufferManager)[i];
-                float t = pBuffer->Seconds() + (float) pBuffer->MicroSeconds() / MICROS_PER_SECOND;
-                debugI("Frame: %03d, Clock: %lf, Offset: %lf", i, t, g_AppTime.CurrentTime() - t);
+                double t = pBuffer->Timestamp() / (double) MICROS_PER_SECOND;
+                debugI("Frame: %03d, Clock: %lf, Offset: %lf", i, t, Timebase::SecondsBetween(pBuffer->Timestamp(), Timebase::WallMicros()));
             }
 
         }
+        else if (str.equalsIgnoreCase("blendbench"))
+        {
+            // Times the blend that WIFI_FRAME_INTERPOLATION does for each frame, for some common strip and matrix
+            // sizes, both fused into the output and as a copy of the first frame followed by a blend over it
+
+            const size_t sizes[] = { 144, 1024, 64 * 32, NUM_LEDS };
+            const size_t maxSize = *std::max_element(std::begin(sizes), std::end(sizes));
+            const int    passes  = 100;
+
+            auto pA   = std::make_unique<CRGB []>(maxSize);
+            auto pB   = std::make_unique<CRGB []>(maxSize);
+            auto pOut = std::make_unique<CRGB []>(maxSize);
+            for (size_t i = 0; i < maxSize; i++)
+            {
+                pA[i] = CHSV(i, 255, 255);
+                pB[i] = CHSV(i + 128, 255, 128);
+            }
+
+            for (size_t count : sizes)
+            {
+                unsigned long usStart = micros();
+                for (int pass = 0; pass < passes; pass++)
+                    GFXBase::BlendLeds(pOut.get(), pA.get(), pB.get(), count, pass * 256 / passes);
+                unsigned long usFused = micros() - usStart;
+
+                usStart = micros();
+                for (int pass = 0; pass < passes; pass++)
+                {
+                    memcpy(pOut.get(), pA.get(), count * sizeof(CRGB));
+                    nblend(pOut.get(), pB.get(), count, pass * 255 / passes);
+                }
+                unsigned long usTwoPass = micros() - usStart;
+
+                debugI("%5u LEDs: fused blend %.1fus per frame, copy then nblend %.1fus per frame", count, usFused / (float) passes, usTwoPass / (float) passes);
+            }
+        }
+        else if (str.equalsIgnoreCase("powerbench"))
+        {
+            // Times working out a frame's power draw and power-limited brightness the way SendToStrip used to,
+            // with FastLED going over the pixels once to limit the brightness and once more for the stats, against
+            // PowerEstimator's single pass
+
+            const size_t sizes[] = { 144, 1024, 2048, NUM_LEDS };
+            const size_t maxSize = *std::max_element(std::begin(sizes), std::end(sizes));
+            const int    passes  = 100;
+
+            auto pLeds = std::make_unique<CRGB []>(maxSize);
+            for (size_t i = 0; i < maxSize; i++)
+                pLeds[i] = CHSV(i, 255 - i % 64, i * 7);
+
+            volatile uint8_t brightness;                // So the brightness isn't optimized away
+
+            for (size_t count : sizes)
+            {
+                uint32_t mWOld = 0, mWNew = 0;
+
+                unsigned long usStart = micros();
+                for (int pass = 0; pass < passes; pass++)
+                {
+                    uint32_t total_mW = calculate_unscaled_power_mW(pLeds.get(), count) + PowerEstimator::MCU_mW;
+                    uint32_t requested_mW = total_mW * g_Fader / 256;
+                    brightness = requested_mW > POWER_LIMIT_MW ? g_Fader * POWER_LIMIT_MW / requested_mW : g_Fader;
+                    mWOld = calculate_unscaled_power_mW(pLeds.get(), count);
+                }
+                unsigned long usTwoPass = micros() - usStart;
+
+                usStart = micros();
+                for (int pass = 0; pass < passes; pass++)
+                {
+                    mWNew = PowerEstimator::UnscaledPower_mW(PowerEstimator::SumColors(pLeds.get(), count));
+                    brightness = PowerEstimator::LimitBrightness(g_Fader, mWNew, POWER_LIMIT_MW);
+                }
+                unsigned long usFused = micros() - usStart;
+
+                debugI("%5u LEDs: two passes %.1fus per frame, fused %.1fus per frame, %s\n", count, usTwoPass / (float) passes,
+                       usFused / (float) passes, mWOld == mWNew ? "same result" : "RESULTS DIFFER");
+            }
+        }
+        #if SKIP_UNCHANGED_FRAMES
+            else if (str.equalsIgnoreCase("skipstats"))
+            {
+                // How many frames each effect (and WiFi) had sent to the strip, how many were skipped because
+                // they hadn't changed, and about how long sending those would have taken
+
+                auto report = [](const char * pszName, const ShowStats & stats)
+                {
+                    uint32_t cTotal = stats.cShown + stats.cSkipped;
+                    if (cTotal)
+                        debugI("%-32s shown %8u  skipped %8u (%5.1f%%)  saved %8.1fms\n", pszName, stats.cShown, stats.cSkipped,
+                               100.0f * stats.cSkipped / cTotal, stats.usSaved / 1000.0f);
+                };
+
+                report("WiFi", g_WiFiShowStats);
+                auto ppEffects = g_aptrEffectManager->EffectsList();
+                for (size_t i = 0; i < g_aptrEffectManager->EffectCount(); i++)
+                    report(ppEffects[i]->FriendlyName().c_str(), ppEffects[i]->GetShowStats());
+            }
+        #endif
+        #if ENABLE_FRAME_PROFILER
+            else if (str.equalsIgnoreCase("profile"))
+            {
+                debugI("Draw loop stage timings (p99 over the last %d runs of each):\n", FRAME_PROFILER_HISTORY);
+                for (size_t i = 0; i < (size_t) ProfileStage::Count; i++)
+                {
+                    ProfileStats stats = g_FrameProfiler.GetStats((ProfileStage) i);
+                    debugI("%-14s runs %8u  min %8.1fus  avg %8.1fus  p99 %8.1fus  max %8.1fus\n",
+                           stats.name, stats.count, stats.minUs, stats.avgUs, stats.p99Us, stats.maxUs);
+                }
+            }
+            else if (str.equalsIgnoreCase("profilereset"))
+            {
+                g_FrameProfiler.Reset();
+                debugI("Draw loop stage timings reset\n");
+            }
+        #endif
     }
 #endif
 
@@ -295,6 +437,42 @@ void IRAM_ATTR RemoteLoopEntry(void *)
     
 #endif
 
+// AddFrameToBuffers
+//
+// Adds a PIXELDATA64 (or RGB565DATA64 or PALETTEDATA64) frame to the buffers of every channel named in its channel mask.  The caller must hold
+// g_buffer_mutex.  A channel whose ring is full (which can only happen with LOCKFREE_BUFFER_RING) just misses the frame.
+
+bool AddFrameToBuffers(uint8_t *payloadData, size_t payloadLength)
+{
+    uint16_t channel16 = WORDFromMemory(&payloadData[2]);
+    uint64_t seconds   = ULONGFromMemory(&payloadData[8]);
+    uint64_t micros    = ULONGFromMemory(&payloadData[16]);
+
+    // Another option here would be to draw on all channels (0xff) instead of just one (0x01) if 0 is specified
+    
+    if (channel16 == 0)
+        channel16 = 1;
+
+    // Go through the channel mask to see which bits are set in the channel16 specifier, and send the data to each and every
+    // channel that matches the mask.  So if the send channel 7, that means the lowest 3 channels will be set.
+
+    for (int iChannel = 0, channelMask = 1; iChannel < NUM_CHANNELS; iChannel++, channelMask <<= 1)
+    {
+        if ((channelMask & channel16) != 0)
+        {
+            debugV("Processing for Channel %d", iChannel);
+            
+            auto pBuffer = g_aptrBufferManager[iChannel]->GetBufferForTimestamp(seconds, micros);
+            if (!pBuffer)
+                continue;
+            if (!pBuffer->UpdateFromWire(payloadData, payloadLength))
+                return false;
+            g_aptrBufferManager[iChannel]->CommitBuffer(pBuffer);
+        }
+    }
+    return true;
+}
+
 // ProcessIncomingData
 //
 // Code that actually handles whatever comes in on the socket.  Must be known good data
@@ -339,9 +517,13 @@ bool ProcessIncomingData(uint8_t *payloadData, size_t payloadLength)
             return true;
         }
         
-        // WIFI_COMMAND_PIXELDATA64 has a header plus length32 CRGBs
+        // WIFI_COMMAND_PIXELDATA64 has a header plus length32 CRGBs, WIFI_COMMAND_RGB565DATA64 has length32 16-bit
+        // colors instead, and WIFI_COMMAND_PALETTEDATA64 has a CRGBPalette16 and length32 palette indices.  The
+        // LEDBuffer expands the compact ones as it copies them in.
         
         case WIFI_COMMAND_PIXELDATA64:
+        case WIFI_COMMAND_RGB565DATA64:
+        case WIFI_COMMAND_PALETTEDATA64:
         {
             uint16_t channel16 = WORDFromMemory(&payloadData[2]);
             uint32_t length32  = DWORDFromMemory(&payloadData[4]);
@@ -355,44 +537,69 @@ bool ProcessIncomingData(uint8_t *payloadData, size_t payloadLength)
                    seconds, 
                    micros);
 
-            // Another option here would be to draw on all channels (0xff) instead of just one (0x01) if 0 is specified
-            
-            if (channel16 == 0)
-                channel16 = 1;
-
-            // Go through the channel mask to see which bits are set in the channel16 specifier, and send the data to each and every
-            // channel that matches the mask.  So if the send channel 7, that means the lowest 3 channels will be set.
-
-            std::lock_guard<std::mutex> guard(g_buffer_mutex);
+            std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
 
             //if (!heap_caps_check_integrity_all(true))
             //    debugW("### Corrupt heap detected in WIFI_COMMAND_PIXELDATA64");
 
+            return AddFrameToBuffers(payloadData, payloadLength);
+        }
+
+        // WIFI_COMMAND_PIXELBATCH64 has a header whose length32 is the number of bytes of PIXELDATA64 frames that
+        // follow it, and they're all added to the buffers under a single lock
+
+        case WIFI_COMMAND_PIXELBATCH64:
+        {
+            uint32_t length32 = DWORDFromMemory(&payloadData[4]);
+            if (payloadLength < STANDARD_DATA_HEADER_SIZE + length32)
+            {
+                debugW("Batch promises %u bytes of frames but only %u arrived", length32, payloadLength - STANDARD_DATA_HEADER_SIZE);
+                return false;
+            }
+
+            std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
+
+            size_t offset = STANDARD_DATA_HEADER_SIZE;
+            size_t end    = STANDARD_DATA_HEADER_SIZE + length32;
+            for (int cFrames = 0; offset < end; cFrames++)
+            {
+                uint8_t * pFrame = payloadData + offset;
+                if (cFrames == MAX_BATCH_FRAMES || end - offset < STANDARD_DATA_HEADER_SIZE || WORDFromMemory(pFrame) != WIFI_COMMAND_PIXELDATA64)
+                {
+                    debugW("Bad frame %d in batch", cFrames);
+                    return false;
+                }
+
+                uint32_t frameLength = DWORDFromMemory(&pFrame[4]);
+                size_t   cbFrame     = STANDARD_DATA_HEADER_SIZE + frameLength * LED_DATA_SIZE;
+                if (frameLength > NUM_LEDS || cbFrame > end - offset || !AddFrameToBuffers(pFrame, cbFrame))
+                    return false;
+
+                offset += cbFrame;
+            }
+            return true;
+        }
+
+        // WIFI_COMMAND_PIXELDELTA64 has a header, the timestamp of the frame it's a delta against, and then
+        // length32 bytes of XOR spans (see LEDBuffer::cbDeltaHeader)
+
+        case WIFI_COMMAND_PIXELDELTA64:
+        {
+            uint16_t channel16 = WORDFromMemory(&payloadData[2]);
+
+            debugV("ProcessIncomingData -- Delta Channel: %u, Length: %u", channel16, DWORDFromMemory(&payloadData[4]));
+
+            if (channel16 == 0)
+                channel16 = 1;
+
+            std::lock_guard<BufferRingMutex> guard(g_buffer_mutex);
+
             for (int iChannel = 0, channelMask = 1; iChannel < NUM_CHANNELS; iChannel++, channelMask <<= 1)
             {
                 if ((channelMask & channel16) != 0)
                 {
-                    debugV("Processing for Channel %d", iChannel);
-                    
-                    bool bDone = false;
-                    if (!g_aptrBufferManager[iChannel]->IsEmpty())
-                    {
-                        auto pNewestBuffer = g_aptrBufferManager[iChannel]->PeekNewestBuffer();
-                        if (micros != 0 && pNewestBuffer->MicroSeconds() == micros && pNewestBuffer->Seconds() == seconds)
-                        {
-                            debugV("Updating existing buffer");
-                            if (!pNewestBuffer->UpdateFromWire(payloadData, payloadLength))
-                                return false;
-                            bDone = true;
-                        }
-                    }
-                    if (!bDone)
-                    {
-                        debugV("No match so adding new buffer");
-                        auto pNewBuffer = g_aptrBufferManager[iChannel]->GetNewBuffer();
-                        if (!pNewBuffer->UpdateFromWire(payloadData, payloadLength))
-                            return false;
-                    }
+                    if (!g_aptrBufferManager[iChannel]->ApplyDeltaFromWire(payloadData, payloadLength))
+                        return false;
                 }
             }
             return true;
@@ -30,7 +30,7 @@
 
 #include "globals.h"
 
-extern DRAM_ATTR std::unique_ptr<EffectManager<GFXBase>> g_aptrEffectManager;
+extern DRAM_ATTR std::unique_ptr<EffectManager<DeviceGFX>> g_aptrEffectManager;
 
 float g_Brite;
 uint32_t g_Watts;
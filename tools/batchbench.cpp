@@ -0,0 +1,266 @@
+// batchbench.cpp
+//
+// Times what it costs the chip to take compressed frames off the wire, one frame per packet and in
+// PIXELBATCH64 batches of 4, 16 and 32, using the same uzlib and the same dictionary ring that SocketServer does.
+// It's built on a PC, with zlib only there to compress the test frames:
+//
+//   g++ -std=c++17 -O2 -o batchbench tools/batchbench.cpp -lz
+//   ./batchbench [frames]
+//
+// Each batch size is run both ways SocketServer adds frames to the LEDBuffers:  "in place" inflates each frame's
+// pixels straight into the buffer it's going to, as it does when the packet is already in memory, and "copy"
+// inflates them to the output buffer and then copies them in, as it does when streaming.  For each, it prints
+// the CPU time per frame and the frames per second that works out to, along with the compressed bytes per frame
+// and the SocketResponses per frame, since a batch shares one zlib stream and one acknowledgement among all its
+// frames.  The frames that come out are checked against the ones that went in.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+extern "C"
+{
+    #include "../src/uzlib/src/tinflate.c"
+    #include "../src/uzlib/src/tinfzlib.c"
+    #include "../src/uzlib/src/adler32.c"
+    #include "../src/uzlib/src/crc32.c"
+}
+
+using Clock = std::chrono::steady_clock;
+
+// These match socketserver.h
+
+#define WIFI_COMMAND_PIXELDATA64    3
+#define WIFI_COMMAND_PIXELBATCH64   6
+#define STANDARD_DATA_HEADER_SIZE   24
+#define COMPRESSED_HEADER_SIZE      16
+#define COMPRESSED_HEADER           0x44415645
+#define LED_DATA_SIZE               3
+#define MAX_BATCH_FRAMES            32
+#define BATCH_DICTIONARY_SIZE       32768
+
+static const int    cLeds       = 64 * 32;
+static const size_t cbFrame     = STANDARD_DATA_HEADER_SIZE + LED_DATA_SIZE * cLeds;      // MAXIUMUM_PACKET_SIZE
+
+static void PutBytes(std::vector<uint8_t> & out, uint64_t value, int cb)
+{
+    for (int i = 0; i < cb; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+static uint16_t WORDFromMemory(const uint8_t * p)  { return p[0] | p[1] << 8; }
+static uint32_t DWORDFromMemory(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+
+// Frame
+//
+// The PIXELDATA64 packet for one frame of a plasma-like pattern that moves from frame to frame
+
+static std::vector<uint8_t> Frame(int iFrame)
+{
+    std::vector<uint8_t> packet;
+    PutBytes(packet, WIFI_COMMAND_PIXELDATA64, 2);
+    PutBytes(packet, 1, 2);
+    PutBytes(packet, cLeds, 4);
+    PutBytes(packet, 1700000000 + iFrame / 60, 8);
+    PutBytes(packet, (iFrame % 60) * 16667, 8);
+    for (int i = 0; i < cLeds; i++)
+    {
+        double t = iFrame * 0.05;
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.11 + t)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.07 - t * 1.3)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.05 + t * 0.7)));
+    }
+    return packet;
+}
+
+// Compressed
+//
+// A packet compressed behind a DAVE header, with zlib's default 32K window, which is the most the batch
+// dictionary ring allows
+
+static std::vector<uint8_t> Compressed(const std::vector<uint8_t> & packet)
+{
+    uLongf cbCompressed = compressBound(packet.size());
+    std::vector<uint8_t> compressed(cbCompressed);
+    compress2(compressed.data(), &cbCompressed, packet.data(), packet.size(), Z_BEST_COMPRESSION);
+
+    std::vector<uint8_t> out;
+    PutBytes(out, COMPRESSED_HEADER, 4);
+    PutBytes(out, cbCompressed, 4);
+    PutBytes(out, packet.size(), 4);
+    PutBytes(out, 0x12345678, 4);
+    out.insert(out.end(), compressed.begin(), compressed.begin() + cbCompressed);
+    return out;
+}
+
+// Batch
+//
+// A PIXELBATCH64 packet:  a data header whose length is the size of the frames that follow it
+
+static std::vector<uint8_t> Batch(const std::vector<std::vector<uint8_t>> & frames, size_t iFirst, size_t cFrames)
+{
+    std::vector<uint8_t> packet;
+    PutBytes(packet, WIFI_COMMAND_PIXELBATCH64, 2);
+    PutBytes(packet, 1, 2);
+    PutBytes(packet, cFrames * cbFrame, 4);
+    PutBytes(packet, 0, 16);
+    for (size_t i = iFirst; i < iFirst + cFrames; i++)
+        packet.insert(packet.end(), frames[i].begin(), frames[i].end());
+    return packet;
+}
+
+// InitDecompressor and InflateInto are SocketServer's
+
+static bool InitDecompressor(struct uzlib_uncomp & d, const uint8_t * pBuffer, size_t cBuffer)
+{
+    uzlib_uncompress_init(&d, NULL, 0);
+    d.source         = pBuffer;
+    d.source_limit   = pBuffer + cBuffer;
+    d.source_read_cb = nullptr;
+    return uzlib_zlib_parse_header(&d) >= 0;
+}
+
+static bool InflateInto(struct uzlib_uncomp & d, uint8_t * pStart, uint8_t * pOutput, size_t cbOutput, bool bFinal)
+{
+    d.dest_start = pStart;
+    d.dest       = pOutput;
+    d.dest_limit = pOutput + cbOutput + (bFinal ? 1 : 0);
+
+    int res = uzlib_uncompress_chksum(&d);
+    return res == (bFinal ? TINF_DONE : TINF_OK) && (size_t) (d.dest - pOutput) == cbOutput;
+}
+
+// Receiver
+//
+// Stands in for SocketServer and the LEDBuffer ring it adds frames to.  Each buffer's wire storage has a
+// header's worth of room in front of its pixels, as LEDBuffer's does.
+
+struct Receiver
+{
+    bool                               _bInPlace;
+    std::vector<uint8_t>               _output    = std::vector<uint8_t>(cbFrame + 1);
+    std::vector<uint8_t>               _dictionary = std::vector<uint8_t>(BATCH_DICTIONARY_SIZE);
+    std::vector<std::vector<uint8_t>>  _buffers   = std::vector<std::vector<uint8_t>>(MAX_BATCH_FRAMES, std::vector<uint8_t>(cbFrame + 1));
+    size_t                             _iNext = 0;
+
+    // InflateFrame
+    //
+    // SocketServer::InflateFrameIntoBuffers for one channel, with the header already inflated to pHeader
+
+    bool InflateFrame(struct uzlib_uncomp & d, const uint8_t * pHeader, bool bFinal)
+    {
+        auto & buffer = _buffers[_iNext++ % _buffers.size()];
+        uint8_t * pStorage = _bInPlace ? buffer.data() : _output.data();
+
+        memmove(pStorage, pHeader, STANDARD_DATA_HEADER_SIZE);
+        if (!InflateInto(d, pStorage, pStorage + STANDARD_DATA_HEADER_SIZE, cbFrame - STANDARD_DATA_HEADER_SIZE, bFinal))
+            return false;
+        if (!_bInPlace)
+            memcpy(buffer.data(), pStorage, cbFrame);
+
+        return true;
+    }
+
+    // Packet
+    //
+    // SocketServer::ProcessCompressedPacket for a PIXELDATA64 or PIXELBATCH64, straight out of the receive buffer
+
+    bool Packet(const uint8_t * pPacket)
+    {
+        uint32_t compressedSize = DWORDFromMemory(&pPacket[4]);
+        uint32_t expandedSize   = DWORDFromMemory(&pPacket[8]);
+
+        struct uzlib_uncomp d = { 0 };
+        uint8_t * pHeader = _output.data();
+        if (!InitDecompressor(d, &pPacket[COMPRESSED_HEADER_SIZE], compressedSize) || !InflateInto(d, pHeader, pHeader, STANDARD_DATA_HEADER_SIZE, false))
+            return false;
+
+        if (WORDFromMemory(pHeader) == WIFI_COMMAND_PIXELDATA64)
+            return InflateFrame(d, pHeader, true);
+
+        // SocketServer::DecompressBatchIntoBuffers
+
+        memcpy(_dictionary.data(), pHeader, STANDARD_DATA_HEADER_SIZE);
+        if (d.curlen)
+            d.lzOff += STANDARD_DATA_HEADER_SIZE;
+
+        d.dict_ring = _dictionary.data();
+        d.dict_size = BATCH_DICTIONARY_SIZE;
+        d.dict_idx  = STANDARD_DATA_HEADER_SIZE;
+
+        for (size_t offset = STANDARD_DATA_HEADER_SIZE; offset < expandedSize; offset += cbFrame)
+        {
+            uint8_t abFrameHeader[STANDARD_DATA_HEADER_SIZE + 1];
+            if (!InflateInto(d, abFrameHeader, abFrameHeader, STANDARD_DATA_HEADER_SIZE, false) ||
+                !InflateFrame(d, abFrameHeader, offset + cbFrame == expandedSize))
+                return false;
+        }
+        return true;
+    }
+};
+
+int main(int argc, char * argv[])
+{
+    int cFrames = argc > 1 ? atoi(argv[1]) : 3840;
+    cFrames -= cFrames % MAX_BATCH_FRAMES;
+    if (cFrames <= 0)
+    {
+        fprintf(stderr, "Usage: batchbench [frames]\n");
+        return 1;
+    }
+
+    const int cDistinct = 2 * MAX_BATCH_FRAMES;              // Frames in the loop, about a second of them at 60fps
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < cDistinct; i++)
+        frames.push_back(Frame(i));
+
+    printf("%d frames of %d LEDs, %zu bytes each uncompressed\n", cFrames, cLeds, cbFrame);
+    bool bAllOK = true;
+
+    for (int cBatch : { 1, 4, 16, MAX_BATCH_FRAMES })
+    {
+        std::vector<std::vector<uint8_t>> packets;
+        size_t cbCompressed = 0;
+        for (int i = 0; i < cDistinct; i += cBatch)
+        {
+            packets.push_back(Compressed(cBatch == 1 ? frames[i] : Batch(frames, i, cBatch)));
+            cbCompressed += packets.back().size();
+        }
+
+        double usPerFrame[2];
+        for (bool bInPlace : { true, false })
+        {
+            // Check that every frame comes out as it went in before timing it
+
+            Receiver receiver { bInPlace };
+            for (size_t iPacket = 0; iPacket < packets.size(); iPacket++)
+            {
+                bool bOK = receiver.Packet(packets[iPacket].data());
+                for (int i = 0; bOK && i < cBatch; i++)
+                    bOK = 0 == memcmp(receiver._buffers[(iPacket * cBatch + i) % MAX_BATCH_FRAMES].data(), frames[iPacket * cBatch + i].data(), cbFrame);
+                if (!bOK)
+                {
+                    printf("Batches of %d, %s: frame %zu came out wrong\n", cBatch, bInPlace ? "in place" : "copy", iPacket * cBatch);
+                    bAllOK = false;
+                    break;
+                }
+            }
+
+            auto start = Clock::now();
+            for (int i = 0; i < cFrames / cBatch; i++)
+                receiver.Packet(packets[i % packets.size()].data());
+            usPerFrame[bInPlace] = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / cFrames;
+        }
+
+        printf("Batches of %2d:  %5zu bytes compressed per frame, %.3lf responses per frame;  in place %6.1lfus per frame (%5.0lf fps),  copy %6.1lfus per frame (%5.0lf fps)\n",
+               cBatch, cbCompressed / cDistinct, 1.0 / cBatch, usPerFrame[true], 1e6 / usPerFrame[true], usPerFrame[false], 1e6 / usPerFrame[false]);
+    }
+
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+// blurbench.cpp
+//
+// Checks BlurKernels against GFXBase's blurRows and blurColumns and times the two.  blurkernels.h
+// includes nothing from the project, so it builds with a plain g++:
+//
+//   g++ -std=c++17 -O2 -o blurbench tools/blurbench.cpp
+//   ./blurbench
+//
+// The GFXBase side is a copy of blurRows and blurColumns on a row-major matrix, with CRGB's nscale8 and += done
+// as FastLED does them.  For matrices from 8x8 to 128x64, it checks the two agree to the bit on random frames for
+// every blur amount and several first rows and columns, including a blur of only part of the width, then times
+// rows and columns the way blur2d does them, a pixel at a time against through BlurKernels.  BlurKernels leaves
+// blurs narrower than BLUR_KERNELS_MIN_WIDTH to be done a pixel at a time, so to see how it does on those, build
+// with -DBLUR_KERNELS_MIN_WIDTH=1.  It exits with a non-zero status if any frame differs; the times are only
+// printed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../include/blurkernels.h"
+
+using Clock = std::chrono::steady_clock;
+
+// CRGB
+//
+// Just the parts of FastLED's the blurs use, done the way FastLED does them
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    static uint8_t qadd8(uint8_t i, uint8_t j)
+    {
+        unsigned t = i + j;
+        return t > 255 ? 255 : t;
+    }
+
+    static uint8_t scale8(uint8_t i, uint8_t scale)
+    {
+        return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+    }
+
+    CRGB & operator+=(const CRGB & rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB & nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+};
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be three bytes");
+
+// Matrix
+//
+// A row-major frame of stride by height pixels, with blurRows and blurColumns as GFXBase has them
+
+struct Matrix
+{
+    size_t stride, height;
+    std::vector<CRGB> storage;
+    CRGB * leds;
+
+    Matrix(size_t w, size_t h) : stride(w), height(h), storage(w * h + 2)
+    {
+        leds = storage.data();
+        while (reinterpret_cast<uintptr_t>(leds) & 3)   // Line up on a word as the device's buffers are
+            leds++;
+    }
+
+    uint16_t xy(uint16_t x, uint16_t y) const
+    {
+        return y * stride + x;
+    }
+
+    void blurRows(uint8_t width, uint8_t height, uint8_t first, uint8_t blur_amount)
+    {
+        uint8_t keep = 255 - blur_amount;
+        uint8_t seep = blur_amount >> 1;
+        for (uint8_t row = 0; row < height; row++)
+        {
+            CRGB carryover = { 0, 0, 0 };
+            for (uint8_t i = first; i < width; i++)
+            {
+                CRGB cur = leds[xy(i, row)];
+                CRGB part = cur;
+                part.nscale8(seep);
+                cur.nscale8(keep);
+                cur += carryover;
+                if (i)
+                    leds[xy(i - 1, row)] += part;
+                leds[xy(i, row)] = cur;
+                carryover = part;
+            }
+        }
+    }
+
+    void blurColumns(uint8_t width, uint8_t height, uint8_t first, uint8_t blur_amount)
+    {
+        uint8_t keep = 255 - blur_amount;
+        uint8_t seep = blur_amount >> 1;
+        for (uint8_t col = 0; col < width; ++col)
+        {
+            CRGB carryover = { 0, 0, 0 };
+            for (uint8_t i = first; i < height; ++i)
+            {
+                CRGB cur = leds[xy(col, i)];
+                CRGB part = cur;
+                part.nscale8(seep);
+                cur.nscale8(keep);
+                cur += carryover;
+                if (i)
+                    leds[xy(col, i - 1)] += part;
+                leds[xy(col, i)] = cur;
+                carryover = part;
+            }
+        }
+    }
+
+    uint8_t * Bytes()
+    {
+        return reinterpret_cast<uint8_t *>(leds);
+    }
+};
+
+static void Randomize(Matrix & m, std::mt19937 & random)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    int scale = byte(random);                           // Dim frames as well as bright ones
+    for (size_t i = 0; i < m.stride * m.height; i++)
+        m.leds[i] = { (uint8_t) (byte(random) * scale / 255), (uint8_t) (byte(random) * scale / 255), (uint8_t) (byte(random) * scale / 255) };
+}
+
+int main()
+{
+    std::mt19937 random(12345);
+    int cFailures = 0;
+
+    const size_t sizes[][2] = { { 8, 8 }, { 16, 16 }, { 32, 16 }, { 64, 32 }, { 128, 64 } };
+
+    for (auto [w, h] : sizes)
+    {
+        Matrix expected(w, h), actual(w, h);
+
+        // Agreement
+
+        for (int amount = 0; amount < 256; amount++)
+        {
+            for (size_t first : { 0, 1, 2, 5 })
+            {
+                for (size_t width : { w, w - 4, w - 1 })       // w - 1 leaves part of a word, so Rows declines
+                {
+                    Randomize(expected, random);
+                    memcpy(actual.leds, expected.leds, w * h * sizeof(CRGB));
+
+                    expected.blurRows(width, h, first, amount);
+                    if (!BlurKernels::Rows(actual.Bytes(), w, width, h, first, amount))
+                        actual.blurRows(width, h, first, amount);
+                    expected.blurColumns(width, h, first, amount);
+                    if (!BlurKernels::Columns(actual.Bytes(), w, width, h, first, amount))
+                        actual.blurColumns(width, h, first, amount);
+
+                    if (memcmp(actual.leds, expected.leds, w * h * sizeof(CRGB)))
+                    {
+                        if (cFailures++ < 10)
+                            printf("FAILED: %zux%zu, width %zu, first %zu, amount %d\n", w, h, width, first, amount);
+                    }
+                }
+            }
+        }
+
+        // Speed, of rows and columns apart, as blur2d does them:  through BlurKernels when it takes them, and a
+        // pixel at a time when it declines.  Each is the best of several runs, with the two ways taking turns, so
+        // that whatever else the PC is doing lands on both alike.
+
+        Randomize(expected, random);
+        memcpy(actual.leds, expected.leds, w * h * sizeof(CRGB));
+        const int passes = 1000000 / (w * h);
+        double usBest[4] = { 1e9, 1e9, 1e9, 1e9 };
+
+        auto Time = [&](double & usBest, auto blur)
+        {
+            auto start = Clock::now();
+            for (int pass = 0; pass < passes; pass++)
+                blur();
+            usBest = std::min(usBest, std::chrono::duration<double, std::micro>(Clock::now() - start).count() / passes);
+        };
+
+        for (int run = 0; run < 21; run++)
+        {
+            Time(usBest[0], [&] { expected.blurRows(w, h, 0, 50); });
+            Time(usBest[1], [&] { if (!BlurKernels::Rows(actual.Bytes(), w, w, h, 0, 50)) actual.blurRows(w, h, 0, 50); });
+            Time(usBest[2], [&] { expected.blurColumns(w, h, 1, 50); });
+            Time(usBest[3], [&] { if (!BlurKernels::Columns(actual.Bytes(), w, w, h, 1, 50)) actual.blurColumns(w, h, 1, 50); });
+        }
+
+        printf("%3zux%-3zu rows: per pixel %7.2fus, as blurred %7.2fus (%.2fx)   columns: per pixel %7.2fus, as blurred %7.2fus (%.2fx)%s\n",
+               w, h, usBest[0], usBest[1], usBest[0] / usBest[1], usBest[2], usBest[3], usBest[2] / usBest[3],
+               w < BLUR_KERNELS_MIN_WIDTH ? "  (too narrow for BlurKernels)" : "");
+    }
+
+    printf(cFailures ? "%d frames FAILED\n" : "BlurKernels matched blurRows and blurColumns on every frame\n", cFailures);
+    return cFailures ? 1 : 0;
+}
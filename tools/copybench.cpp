@@ -0,0 +1,207 @@
+// copybench.cpp
+//
+// Measures how long getting a WiFi frame into the LED buffers takes, the way fillLeds used to and the ways it does
+// now.  GFXBase needs the whole project, so this has a cut-down copy of it, built on a PC:
+//
+//   g++ -std=c++17 -O2 -o copybench tools/copybench.cpp
+//   ./copybench
+//
+// The old way is a setPixel call through the vtable for every pixel, with xy() also going through it.  Now a frame
+// already in our layout is one memcpy, one in any other layout is a gather through a table of indices, and with
+// ZERO_COPY_WIFI a strip doesn't copy the frame at all.  It times each for a 64x32 matrix, eight channels of 144
+// LEDs, and a 32x8 matrix made of serpentine strips (the layout that needs the gather), checks the new ways give
+// the same pixels as the old, and exits with a non-zero status if they don't.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct CRGB
+{
+    uint8_t r, g, b;
+};
+
+// Strand
+//
+// Just what fillLeds uses of GFXBase, with xy() as LEDMatrixGFX (row-major) or GFXBase (serpentine columns) has it
+
+class Strand
+{
+  public:
+
+    size_t _width, _height;
+    std::vector<CRGB> leds;
+    std::unique_ptr<uint16_t []> _wireGather;
+
+    static constexpr uint16_t NoWirePixel = 0xFFFF;
+
+    Strand(size_t w, size_t h) : _width(w), _height(h), leds(w * h) { }
+    virtual ~Strand() { }
+
+    virtual uint16_t xy(uint16_t x, uint16_t y) const = 0;
+
+    virtual void setPixel(int16_t x, int16_t y, CRGB color)
+    {
+        if (x >= 0 && x < (int) _width && y >= 0 && y < (int) _height)
+            leds[xy(x, y)] = color;
+    }
+
+    void FillPerPixel(const CRGB * pLEDs)
+    {
+        for (int x = 0; x < (int) _width; x++)
+            for (int y = 0; y < (int) _height; y++)
+                setPixel(x, y, pLEDs[y * _width + x]);
+    }
+
+    bool IsWireLayout() const
+    {
+        for (size_t y = 0; y < _height; y++)
+            for (size_t x = 0; x < _width; x++)
+                if (xy(x, y) != y * _width + x)
+                    return false;
+        return true;
+    }
+
+    void BuildGather()
+    {
+        const size_t count = _width * _height;
+        _wireGather.reset(new uint16_t[count]);
+        std::fill_n(_wireGather.get(), count, NoWirePixel);
+        for (size_t x = 0; x < _width; x++)
+            for (size_t y = 0; y < _height; y++)
+                if (xy(x, y) < count)
+                    _wireGather[xy(x, y)] = y * _width + x;
+    }
+
+    void FillCopy(const CRGB * pLEDs)
+    {
+        memcpy(leds.data(), pLEDs, sizeof(CRGB) * _width * _height);
+    }
+
+    void FillGather(const CRGB * pLEDs)
+    {
+        const size_t count = _width * _height;
+        for (size_t i = 0; i < count; i++)
+            if (_wireGather[i] != NoWirePixel)
+                leds[i] = pLEDs[_wireGather[i]];
+    }
+};
+
+class RowMajor : public Strand
+{
+  public:
+    using Strand::Strand;
+
+    uint16_t xy(uint16_t x, uint16_t y) const override
+    {
+        return y * _width + x;
+    }
+};
+
+class Serpentine : public Strand
+{
+  public:
+    using Strand::Strand;
+
+    uint16_t xy(uint16_t x, uint16_t y) const override
+    {
+        if (x & 0x01)
+            return (x * _height) + (_height - 1) - y;
+        return (x * _height) + y;
+    }
+};
+
+// Made out of line, so the compiler can't see which Strand it is and skip the vtable as it couldn't on the chip
+
+__attribute__((noinline)) static std::unique_ptr<Strand> MakeStrand(bool bSerpentine, size_t w, size_t h)
+{
+    if (bSerpentine)
+        return std::make_unique<Serpentine>(w, h);
+    return std::make_unique<RowMajor>(w, h);
+}
+
+template <typename F>
+static double MicrosPerFrame(F fill, int cFrames)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < cFrames; i++)
+        fill(i);
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / cFrames;
+}
+
+int main()
+{
+    struct Config { const char * name; bool bSerpentine; size_t width, height, channels; };
+    const Config configs[] =
+    {
+        { "64x32 matrix",         false, 64,  32, 1 },
+        { "8 channels x 144",     true,  144, 1,  8 },      // A strip is GFXBase with a height of 1
+        { "32x8 serpentine",      true,  32,  8,  1 },
+    };
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    bool bAllOK = true;
+    const int cFrames = 20000;
+
+    for (const auto & config : configs)
+    {
+        const size_t count = config.width * config.height;
+
+        std::vector<std::unique_ptr<Strand>> strands, expected;
+        std::vector<std::vector<CRGB>> frames(config.channels, std::vector<CRGB>(count));
+        for (size_t c = 0; c < config.channels; c++)
+        {
+            strands.push_back(MakeStrand(config.bSerpentine, config.width, config.height));
+            expected.push_back(MakeStrand(config.bSerpentine, config.width, config.height));
+            for (auto & pixel : frames[c])
+                pixel = { (uint8_t) byte(random), (uint8_t) byte(random), (uint8_t) byte(random) };
+            expected[c]->FillPerPixel(frames[c].data());
+        }
+
+        const bool bDirect = strands[0]->IsWireLayout();
+        if (!bDirect)
+            for (auto & pStrand : strands)
+                pStrand->BuildGather();
+
+        double usOld = MicrosPerFrame([&](int)
+        {
+            for (size_t c = 0; c < config.channels; c++)
+                strands[c]->FillPerPixel(frames[c].data());
+        }, cFrames);
+
+        double usNew = MicrosPerFrame([&](int)
+        {
+            for (size_t c = 0; c < config.channels; c++)
+                bDirect ? strands[c]->FillCopy(frames[c].data()) : strands[c]->FillGather(frames[c].data());
+        }, cFrames);
+
+        for (size_t c = 0; c < config.channels; c++)
+        {
+            if (memcmp(strands[c]->leds.data(), expected[c]->leds.data(), sizeof(CRGB) * count))
+            {
+                printf("FAILED: %s channel %zu differs from the per-pixel copy\n", config.name, c);
+                bAllOK = false;
+            }
+        }
+
+        printf("%-18s %5zu pixels: per-pixel %7.2fus, %-6s %6.2fus (%.0fx faster)", config.name, count * config.channels,
+               usOld, bDirect ? "memcpy" : "gather", usNew, usOld / usNew);
+
+        // A strip in wire layout doesn't copy at all with ZERO_COPY_WIFI, so it saves the whole of the old time
+
+        if (bDirect && config.height == 1)
+            printf(", zero-copy saves all %.2fus", usOld);
+        printf("\n");
+    }
+
+    printf(bAllOK ? "Every layout matched the per-pixel copy\n" : "FAILED\n");
+    return bAllOK ? 0 : 1;
+}
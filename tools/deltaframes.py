@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+
+# Reference encoder for WIFI_COMMAND_PIXELDELTA64 frames, and a quick way to see how much they save.
+#
+# A delta packet is the usual 24 byte data header (command, channel, length, seconds, micros) where length
+# is the number of bytes of span data, followed by the seconds and micros of the frame the delta was made
+# against, and then the spans.  Each span is a 16-bit count of unchanged pixels to skip, a 16-bit count of
+# changed pixels, and then that many RGB triplets that get XORed into the base frame.  All little-endian.
+#
+# The chip only accepts a delta made against the newest frame it has, so a sender should send a normal
+# PIXELDATA64 keyframe when it (re)connects, whenever encode_delta returns None, and every so often anyway.
+#
+# Given a file of raw RGB frames (pixels * 3 bytes each, back to back), running this script prints how big
+# each frame is compressed as a keyframe and as a delta, and checks that every delta decodes back correctly:
+#
+#   python tools/deltaframes.py frames.rgb 1024
+
+import sys
+import zlib
+import struct
+
+WIFI_COMMAND_PIXELDATA64  = 3
+WIFI_COMMAND_PIXELDELTA64 = 5
+
+SPAN_HEADER_SIZE = 4
+MAX_SPAN_LENGTH  = 0xFFFF
+
+def keyframe(pixels, channel, seconds, micros):
+    return struct.pack('<HHIQQ', WIFI_COMMAND_PIXELDATA64, channel, len(pixels) // 3, seconds, micros) + pixels
+
+def spans(previous, current):
+    # Changed runs separated by a single unchanged pixel are merged, as three zero bytes cost less than a
+    # new span header
+    count = len(current) // 3
+    result = []
+    i = 0
+    while i < count:
+        if current[i*3:i*3+3] == previous[i*3:i*3+3]:
+            i += 1
+            continue
+        start = i
+        end = i + 1
+        while end < count and end - start < MAX_SPAN_LENGTH:
+            if current[end*3:end*3+3] != previous[end*3:end*3+3]:
+                end += 1
+            elif end + 1 < count and end + 1 - start < MAX_SPAN_LENGTH and current[end*3+3:end*3+6] != previous[end*3+3:end*3+6]:
+                end += 2
+            else:
+                break
+        result.append((start, end))
+        i = end
+    return result
+
+def encode_delta(previous, current, channel, seconds, micros, base_seconds, base_micros):
+    if len(previous) != len(current):
+        return None
+    body = bytearray()
+    position = 0
+    for start, end in spans(previous, current):
+        # Skips longer than a span header can hold are bridged with empty spans
+        while start - position > MAX_SPAN_LENGTH:
+            body += struct.pack('<HH', MAX_SPAN_LENGTH, 0)
+            position += MAX_SPAN_LENGTH
+        body += struct.pack('<HH', start - position, end - start)
+        body += bytes(a ^ b for a, b in zip(current[start*3:end*3], previous[start*3:end*3]))
+        position = end
+    if len(body) >= len(current):
+        return None
+    return struct.pack('<HHIQQQQ', WIFI_COMMAND_PIXELDELTA64, channel, len(body), seconds, micros, base_seconds, base_micros) + bytes(body)
+
+def decode_delta(previous, packet):
+    frame = bytearray(previous)
+    length = struct.unpack_from('<I', packet, 4)[0]
+    offset = 40
+    position = 0
+    while offset < 40 + length:
+        skip, changed = struct.unpack_from('<HH', packet, offset)
+        offset += SPAN_HEADER_SIZE
+        position += skip
+        for i in range(changed * 3):
+            frame[position * 3 + i] ^= packet[offset + i]
+        offset += changed * 3
+        position += changed
+    return bytes(frame)
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print('Usage: deltaframes.py <raw rgb frame file> <pixels per frame>')
+        sys.exit(1)
+
+    frameSize = int(sys.argv[2]) * 3
+    with open(sys.argv[1], 'rb') as reader:
+        data = reader.read()
+    frames = [data[i:i+frameSize] for i in range(0, len(data) - frameSize + 1, frameSize)]
+
+    totalKey = 0
+    totalSent = 0
+    for i, frame in enumerate(frames):
+        key = len(zlib.compress(keyframe(frame, 1, i, 0)))
+        sent = key
+        if i > 0:
+            delta = encode_delta(frames[i-1], frame, 1, i, 0, i-1, 0)
+            if delta is not None:
+                if decode_delta(frames[i-1], delta) != frame:
+                    print('Frame %d: delta does not decode back to the frame!' % i)
+                    sys.exit(1)
+                sent = min(key, len(zlib.compress(delta)))
+        totalKey += key
+        totalSent += sent
+        print('Frame %5d: keyframe %6d bytes, sent %6d bytes' % (i, key, sent))
+
+    if totalKey > 0:
+        print('%d frames: %d bytes as keyframes, %d bytes with deltas (%.1f%%)' % (len(frames), totalKey, totalSent, 100.0 * totalSent / totalKey))
@@ -0,0 +1,354 @@
+// devirtbench.cpp
+//
+// Times the per-pixel inner loops of effects from the default lists, calling GFXBase's pixel functions as effects
+// used to, through a std::shared_ptr<GFXBase> and the vtable with getPixel checking every read, and as they do
+// now, through a DeviceGFX the compiler knows is final, with getPixel left unchecked as it is unless
+// CHECKED_PIXEL_ACCESS is set.  GFXBase needs the whole project, so the parts the loops use are copied here, built
+// on a PC:
+//
+//   g++ -std=c++17 -O2 -o devirtbench tools/devirtbench.cpp
+//   ./devirtbench
+//
+// Each effect is reduced to the loop that does its per-pixel drawing, at its usual size, with the same random
+// numbers both ways.  The work it does around each call is kept, so the times show what the calls cost next to
+// it rather than on their own.  It exits with a non-zero status if the two ways leave different pixels.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// CRGB
+//
+// Just the parts of FastLED's the loops use, done the way FastLED does them
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    CRGB() : r(0), g(0), b(0) { }
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) { }
+
+    static uint8_t qadd8(uint8_t i, uint8_t j)
+    {
+        unsigned t = i + j;
+        return t > 255 ? 255 : t;
+    }
+
+    static uint8_t scale8(uint8_t i, uint8_t scale)
+    {
+        return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+    }
+
+    CRGB & operator+=(const CRGB & rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB & fadeToBlackBy(uint8_t fade)
+    {
+        r = scale8(r, 255 - fade);
+        g = scale8(g, 255 - fade);
+        b = scale8(b, 255 - fade);
+        return *this;
+    }
+};
+
+static CRGB HeatColor(uint8_t temperature)
+{
+    uint8_t t192 = (temperature * 191) >> 8;
+    uint8_t heatramp = (t192 & 0x3F) << 2;
+    if (t192 & 0x80)
+        return CRGB(255, 255, heatramp);
+    if (t192 & 0x40)
+        return CRGB(255, heatramp, 0);
+    return CRGB(heatramp, 0, 0);
+}
+
+// GFXBase
+//
+// The pixel functions effects call, as GFXBase has them.  CheckedStrip is LEDStripGFX as it was, checking every
+// read and building a message for the throw; DeviceStrip is as it is, final and unchecked.
+
+class GFXBase
+{
+  public:
+    size_t _width, _height;
+    std::vector<CRGB> _storage;
+    CRGB * leds;
+
+    GFXBase(size_t w, size_t h) : _width(w), _height(h), _storage(w * h)
+    {
+        leds = _storage.data();
+    }
+    virtual ~GFXBase() { }
+
+    inline uint16_t xy(uint16_t x, uint16_t y) const
+    {
+        return y * _width + x;
+    }
+
+    virtual CRGB getPixel(int16_t i) const
+    {
+        return leds[i];
+    }
+
+    virtual CRGB getPixel(int16_t x, int16_t y) const
+    {
+        return getPixel(xy(x, y));
+    }
+
+    virtual void setPixel(int x, CRGB color)
+    {
+        if (x >= 0 && x < (int)(_width * _height))
+            leds[x] = color;
+    }
+
+    virtual void setPixel(int16_t x, int16_t y, CRGB color)
+    {
+        if (x >= 0 && x < (int) _width && y >= 0 && y < (int) _height)
+            leds[xy(x, y)] = color;
+    }
+
+    virtual void drawPixel(int16_t x, int16_t y, CRGB color)
+    {
+        leds[xy(x, y)] = color;
+    }
+
+    virtual void addColor(int16_t i, CRGB c)
+    {
+        if (i >= 0 && i < (int)(_width * _height))
+            leds[i] += c;
+    }
+};
+
+class CheckedStrip : public GFXBase
+{
+  public:
+    using GFXBase::GFXBase;
+
+    CRGB getPixel(int16_t x) const override
+    {
+        if (x >= 0 && x < (int)(_width * _height))
+            return leds[x];
+        else
+            throw std::runtime_error("Invalid index in getPixel: x=" + std::to_string(x));
+    }
+
+    CRGB getPixel(int16_t x, int16_t y) const override
+    {
+        if (x >= 0 && x < (int) _width && y >= 0 && y < (int) _height)
+            return leds[xy(x, y)];
+        else
+            throw std::runtime_error("Invalid index in getPixel: x=" + std::to_string(x) + ", y=" + std::to_string(y));
+    }
+};
+
+class DeviceStrip final : public GFXBase
+{
+  public:
+    using GFXBase::GFXBase;
+
+    CRGB getPixel(int16_t x) const override
+    {
+        return leds[x];
+    }
+
+    CRGB getPixel(int16_t x, int16_t y) const override
+    {
+        return leds[xy(x, y)];
+    }
+};
+
+// Made out of line, so the compiler can't see which GFXBase it is and skip the vtable as it couldn't on the chip
+
+__attribute__((noinline)) static std::shared_ptr<GFXBase> MakeChecked(size_t w, size_t h)
+{
+    return std::make_shared<CheckedStrip>(w, h);
+}
+
+__attribute__((noinline)) static std::shared_ptr<DeviceStrip> MakeDevice(size_t w, size_t h)
+{
+    return std::make_shared<DeviceStrip>(w, h);
+}
+
+// Effects
+//
+// The per-pixel loop of each, written once and run through either kind of pointer
+
+struct Random
+{
+    uint32_t state;
+    explicit Random(uint32_t seed) : state(seed) { }
+    uint32_t operator()(uint32_t range) { state = state * 1664525u + 1013904223u; return (state >> 8) % range; }
+};
+
+template <typename G> static void Fire(G & g, Random & random, std::vector<uint8_t> & heat)
+{
+    const int cLEDs = g._width * g._height;
+    for (int i = 0; i < cLEDs; i++)
+        heat[i] = std::max(0, heat[i] - (int) random(4));
+    for (int i = cLEDs - 1; i >= 2; i--)
+        heat[i] = (heat[i - 1] + heat[i - 2] + heat[i - 2]) / 3;
+    if (random(255) < 120)
+        heat[random(8)] = std::min(255, heat[0] + 160 + (int) random(95));
+    for (int i = 0; i < cLEDs; i++)
+        g.setPixel(i, HeatColor(heat[i]));
+}
+
+template <typename G> static void Meteor(G & g, Random & random, std::vector<uint8_t> &)
+{
+    const int cLEDs = g._width * g._height;
+    for (int j = 0; j < cLEDs; j++)
+    {
+        if (random(10) > 5)
+        {
+            CRGB c = g.getPixel(j);
+            c.fadeToBlackBy(20);
+            g.setPixel(j, c);
+        }
+    }
+    for (int m = 0; m < 10; m++)
+    {
+        int pos = random(cLEDs);
+        for (int j = 0; j < 4; j++)
+            if (pos - j >= 0)
+                g.setPixel(pos - j, CRGB(255, 40 * m, 0));
+    }
+}
+
+template <typename G> static void PaletteFill(G & g, Random & random, std::vector<uint8_t> &)
+{
+    const int cLEDs = g._width * g._height;
+    uint8_t hue = random(256);
+    for (int i = 0; i < cLEDs; i++, hue += 3)
+        g.setPixel(i, CRGB(hue, 255 - hue, hue >> 1));
+}
+
+template <typename G> static void Twinkle(G & g, Random & random, std::vector<uint8_t> &)
+{
+    const int cLEDs = g._width * g._height;
+    for (int i = 0; i < cLEDs; i++)
+    {
+        CRGB c = g.getPixel(i);
+        c.fadeToBlackBy(8);
+        g.setPixel(i, c);
+    }
+    for (int s = 0; s < 40; s++)
+        g.addColor(random(cLEDs), CRGB(random(256), random(256), random(256)));
+}
+
+template <typename G> static void Wave(G & g, Random & random, std::vector<uint8_t> &)
+{
+    uint8_t phase = random(256);
+    for (int x = 0; x < (int) g._width; x++)
+    {
+        int n = (int)((sinf((x + phase) * 0.2f) + 1.0f) * (g._height - 1) / 2);
+        for (int y = 0; y < (int) g._height; y++)
+            g.setPixel(x, y, y == n ? CRGB(x * 4, 255, 0) : g.getPixel(x, y).fadeToBlackBy(16));
+    }
+}
+
+template <typename G> static void NoiseSmear(G & g, Random & random, std::vector<uint8_t> &)
+{
+    for (int x = 0; x < (int) g._width; x++)
+        g.setPixel(x, 0, CRGB(random(256), x * 4, 128));
+    for (int y = g._height - 1; y > 0; y--)
+        for (int x = 0; x < (int) g._width; x++)
+            g.setPixel(x, y, g.getPixel(x, y - 1));
+}
+
+template <typename G> static void Spiro(G & g, Random & random, std::vector<uint8_t> &)
+{
+    float t = random(1000) / 100.0f;
+    for (int i = 0; i < 256; i++)
+    {
+        float a = t + i * 0.1f;
+        int x = (int)(g._width / 2 + cosf(a) * (g._width / 2 - 1));
+        int y = (int)(g._height / 2 + sinf(a * 1.3f) * (g._height / 2 - 1));
+        g.drawPixel(x, y, CRGB(i, 255 - i, 64));
+    }
+}
+
+template <typename G> static void SpectrumBars(G & g, Random & random, std::vector<uint8_t> &)
+{
+    const int bars = 16, barWidth = g._width / bars;
+    for (int i = 0; i < bars; i++)
+    {
+        int top = random(g._height);
+        for (int y = 0; y < (int) g._height; y++)
+            for (int x = i * barWidth; x < (i + 1) * barWidth; x++)
+                g.setPixel(x, y, y >= top ? CRGB(i * 16, 255 - i * 16, 64) : g.getPixel(x, y).fadeToBlackBy(40));
+    }
+}
+
+struct Effect
+{
+    const char * name;
+    size_t width, height;
+    void (*checked)(GFXBase &, Random &, std::vector<uint8_t> &);
+    void (*device)(DeviceStrip &, Random &, std::vector<uint8_t> &);
+};
+
+#define EFFECT(name, w, h, fn) { name, w, h, fn<GFXBase>, fn<DeviceStrip> }
+
+int main()
+{
+    const Effect effects[] =
+    {
+        EFFECT("Fire (1152 strip)",             1152,  1, Fire),
+        EFFECT("Meteor (1152 strip)",           1152,  1, Meteor),
+        EFFECT("Palette fill (1152 strip)",     1152,  1, PaletteFill),
+        EFFECT("Twinkle stars (1152 strip)",    1152,  1, Twinkle),
+        EFFECT("Wave (64x32)",                    64, 32, Wave),
+        EFFECT("Noise smearing (64x32)",          64, 32, NoiseSmear),
+        EFFECT("Spiro (64x32)",                   64, 32, Spiro),
+        EFFECT("Spectrum bars (64x32)",           64, 32, SpectrumBars),
+    };
+
+    bool bAllOK = true;
+    double totalOld = 0, totalNew = 0;
+
+    printf("%-28s %10s  %10s\n", "Effect", "Virtual", "DeviceGFX");
+    for (const auto & effect : effects)
+    {
+        std::shared_ptr<GFXBase>     pChecked = MakeChecked(effect.width, effect.height);
+        std::shared_ptr<DeviceStrip> pDevice  = MakeDevice(effect.width, effect.height);
+        std::vector<uint8_t> heatOld(effect.width * effect.height), heatNew(effect.width * effect.height);
+        Random randomOld(12345), randomNew(12345);
+
+        const int frames = 2000;
+
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            effect.checked(*pChecked, randomOld, heatOld);
+        double usOld = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / frames;
+
+        start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            effect.device(*pDevice, randomNew, heatNew);
+        double usNew = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / frames;
+
+        bool bSame = !memcmp(pChecked->leds, pDevice->leds, sizeof(CRGB) * effect.width * effect.height);
+        bAllOK = bAllOK && bSame;
+        totalOld += usOld;
+        totalNew += usNew;
+
+        printf("%-28s %8.2fus  %8.2fus  %4.1fx faster%s\n", effect.name, usOld, usNew, usOld / usNew, bSame ? "" : ", DIFFERENT PIXELS");
+    }
+    printf("%-28s %8.2fus  %8.2fus  %4.1fx faster\n", "All of them", totalOld, totalNew, totalOld / totalNew);
+
+    printf(bAllOK ? "Both ways drew the same pixels\n" : "FAILED\n");
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+// expandbench.cpp
+//
+// Measures what the compact pixel formats cost to expand on the way into an LEDBuffer, against the plain memcpy
+// a PIXELDATA64 frame gets.  LEDBuffer needs FastLED, so this has cut-down copies of the parts it uses, built on
+// a PC:
+//
+//   g++ -std=c++17 -O2 -o expandbench tools/expandbench.cpp -lz
+//   ./expandbench [frames]
+//
+// For a 64x32 matrix it times LEDBuffer::UpdateFromWire's copy for CRGB pixels, ExpandRGB565 through GFXBase's
+// gamma tables, and ExpandPaletteIndices, which blends all 256 colors of the inline palette once and then looks
+// each pixel up.  Palette expansion is also timed the obvious way, with a ColorFromPalette call per pixel, to
+// show what the table saves, and the two are checked to give the same colors.  Alongside the times it prints
+// the bytes each format puts on the wire, before and after compression, for the same moving pattern.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    bool operator==(const CRGB & other) const { return r == other.r && g == other.g && b == other.b; }
+};
+
+static const int cLeds = 64 * 32;
+
+// GFXBase::gamma5 and gamma6, from colordata.cpp
+
+static const uint8_t gamma5[] =
+{
+    0x00, 0x01, 0x02, 0x03, 0x05, 0x07, 0x09, 0x0b,
+    0x0e, 0x11, 0x14, 0x18, 0x1d, 0x22, 0x28, 0x2e,
+    0x36, 0x3d, 0x46, 0x4f, 0x59, 0x64, 0x6f, 0x7c,
+    0x89, 0x97, 0xa6, 0xb6, 0xc7, 0xd9, 0xeb, 0xff
+};
+
+static const uint8_t gamma6[] =
+{
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08,
+    0x09, 0x0a, 0x0b, 0x0d, 0x0e, 0x10, 0x12, 0x13,
+    0x15, 0x17, 0x19, 0x1b, 0x1d, 0x20, 0x22, 0x25,
+    0x27, 0x2a, 0x2d, 0x30, 0x33, 0x37, 0x3a, 0x3e,
+    0x41, 0x45, 0x49, 0x4d, 0x52, 0x56, 0x5b, 0x5f,
+    0x64, 0x69, 0x6e, 0x74, 0x79, 0x7f, 0x85, 0x8b,
+    0x91, 0x97, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0,
+    0xc7, 0xcf, 0xd6, 0xde, 0xe6, 0xee, 0xf7, 0xff
+};
+
+static inline CRGB from16Bit(uint16_t color)
+{
+    return CRGB { gamma5[color >> 11], gamma6[(color >> 5) & 0x3F], gamma5[color & 0x1F] };
+}
+
+// FastLED's scale8 and ColorFromPalette for a CRGBPalette16 with LINEARBLEND at full brightness
+
+static inline uint8_t scale8(uint8_t i, uint8_t scale)
+{
+    return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+}
+
+static CRGB ColorFromPalette(const CRGB * palette, uint8_t index)
+{
+    uint8_t hi4 = index >> 4;
+    uint8_t lo4 = index & 0x0F;
+    CRGB color = palette[hi4];
+    if (lo4)
+    {
+        const CRGB & next = palette[hi4 == 15 ? 0 : hi4 + 1];
+        uint8_t f2 = lo4 << 4;
+        uint8_t f1 = 255 - f2;
+        color.r = scale8(color.r, f1) + scale8(next.r, f2);
+        color.g = scale8(color.g, f1) + scale8(next.g, f2);
+        color.b = scale8(color.b, f1) + scale8(next.b, f2);
+    }
+    return color;
+}
+
+// The ways a frame's pixels get into the LEDs, as LEDBuffer::UpdateFromWire does them
+
+static void CopyCRGB(CRGB * pLeds, const uint8_t * pSource, size_t count)
+{
+    memcpy((void *)pLeds, pSource, count * sizeof(CRGB));
+}
+
+static void ExpandRGB565(CRGB * pLeds, const uint8_t * pSource, size_t count)
+{
+    for (size_t i = 0; i < count; i++, pSource += sizeof(uint16_t))
+        pLeds[i] = from16Bit(pSource[0] | pSource[1] << 8);
+}
+
+static void ExpandPaletteIndices(CRGB * pLeds, const uint8_t * pSource, size_t count)
+{
+    CRGB palette[16];
+    memcpy((void *)palette, pSource, sizeof(palette));
+    pSource += sizeof(palette);
+
+    CRGB colors[256];
+    for (int i = 0; i < 256; i++)
+        colors[i] = ColorFromPalette(palette, i);
+
+    for (size_t i = 0; i < count; i++)
+        pLeds[i] = colors[pSource[i]];
+}
+
+static void ExpandPalettePerPixel(CRGB * pLeds, const uint8_t * pSource, size_t count)
+{
+    CRGB palette[16];
+    memcpy((void *)palette, pSource, sizeof(palette));
+    pSource += sizeof(palette);
+
+    for (size_t i = 0; i < count; i++)
+        pLeds[i] = ColorFromPalette(palette, pSource[i]);
+}
+
+// Payloads
+//
+// The pixel data of one frame of a moving pattern in each format, without the 24-byte header they share
+
+static std::vector<uint8_t> CRGBPayload(int iFrame)
+{
+    std::vector<uint8_t> out;
+    for (int i = 0; i < cLeds; i++)
+    {
+        double t = iFrame * 0.05;
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.11 + t)));
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.07 - t * 1.3)));
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.05 + t * 0.7)));
+    }
+    return out;
+}
+
+static std::vector<uint8_t> RGB565Payload(int iFrame)
+{
+    std::vector<uint8_t> rgb = CRGBPayload(iFrame), out;
+    for (int i = 0; i < cLeds; i++)
+    {
+        uint16_t color = (rgb[i * 3] >> 3) << 11 | (rgb[i * 3 + 1] >> 2) << 5 | rgb[i * 3 + 2] >> 3;
+        out.push_back(color & 0xFF);
+        out.push_back(color >> 8);
+    }
+    return out;
+}
+
+static std::vector<uint8_t> PalettePayload(int iFrame)
+{
+    std::vector<uint8_t> out;
+    for (int i = 0; i < 16; i++)                                // A rainbow, roughly as framesender sends
+    {
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.39)));
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.39 + 2.09)));
+        out.push_back((uint8_t) (127 + 127 * sin(i * 0.39 + 4.19)));
+    }
+    for (int i = 0; i < cLeds; i++)
+        out.push_back((uint8_t) (128 + 127 * sin((i % 64) * 0.1 + (i / 64) * 0.2 + iFrame * 0.05)));
+    return out;
+}
+
+static size_t CompressedSize(const std::vector<uint8_t> & payload)
+{
+    uLongf cbCompressed = compressBound(payload.size());
+    std::vector<uint8_t> compressed(cbCompressed);
+    compress2(compressed.data(), &cbCompressed, payload.data(), payload.size(), Z_BEST_COMPRESSION);
+    return cbCompressed;
+}
+
+int main(int argc, char * argv[])
+{
+    int cFrames = argc > 1 ? atoi(argv[1]) : 20000;
+    if (cFrames <= 0)
+    {
+        fprintf(stderr, "Usage: expandbench [frames]\n");
+        return 1;
+    }
+
+    const int cDistinct = 60;
+    const struct
+    {
+        const char * name;
+        std::vector<uint8_t> (*pfnPayload)(int);
+        void (*pfnExpand)(CRGB *, const uint8_t *, size_t);
+    }
+    formats[] =
+    {
+        { "CRGB copy",            CRGBPayload,    CopyCRGB              },
+        { "RGB565",               RGB565Payload,  ExpandRGB565          },
+        { "Palette, table",       PalettePayload, ExpandPaletteIndices  },
+        { "Palette, per pixel",   PalettePayload, ExpandPalettePerPixel },
+    };
+
+    std::vector<CRGB> leds(cLeds), check(cLeds);
+    bool bAllOK = true;
+    double usCRGB = 0;
+
+    printf("%d frames of %d LEDs:\n", cFrames, cLeds);
+    for (auto & format : formats)
+    {
+        std::vector<std::vector<uint8_t>> payloads;
+        size_t cbCompressed = 0;
+        for (int i = 0; i < cDistinct; i++)
+        {
+            payloads.push_back(format.pfnPayload(i));
+            cbCompressed += CompressedSize(payloads.back());
+        }
+
+        // The palette table has to give exactly what ColorFromPalette would for every pixel
+
+        if (format.pfnExpand == ExpandPaletteIndices)
+        {
+            for (auto & payload : payloads)
+            {
+                ExpandPaletteIndices(leds.data(), payload.data(), cLeds);
+                ExpandPalettePerPixel(check.data(), payload.data(), cLeds);
+                if (leds != check)
+                {
+                    printf("The palette table disagrees with ColorFromPalette\n");
+                    bAllOK = false;
+                    break;
+                }
+            }
+        }
+
+        auto start = Clock::now();
+        for (int i = 0; i < cFrames; i++)
+            format.pfnExpand(leds.data(), payloads[i % cDistinct].data(), cLeds);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / cFrames;
+        if (usCRGB == 0)
+            usCRGB = us;
+
+        printf("  %-19s %6.2lfus per frame (%5.1lfx the copy), %5zu bytes of pixels, %5zu compressed\n",
+               format.name, us, us / usCRGB, payloads[0].size(), cbCompressed / cDistinct);
+    }
+
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+// fractionalbench.cpp
+//
+// Compares setPixelsF as it was, working out each span in floats and drawing it a pixel at a time, with how it is
+// now, through FractionalSpan and DrawFractionalSpan, and times the two.  To build and run it on a PC:
+//
+//   g++ -std=c++17 -O2 -o fractionalbench tools/fractionalbench.cpp
+//   ./fractionalbench
+//
+// The visual check draws spans one at a time, at random fractional positions and lengths (some hanging off either
+// end, and some long enough to go through SpanKernels), each onto a random frame both ways.  They must draw the
+// same pixels, and never differ in them by more than one level in any color, which is what working out the fades
+// in fixed point rather than floats can change.  It then times filling and adding to runs of whole pixels one at a
+// time and through SpanKernels, which is where DrawFractionalSpan's cMinKernelSpan comes from, and finally draws
+// 500 spans a frame on a 1000-LED strip, merging half of them, as a busy star or particle effect does.  Times are
+// the best of several runs, with the two ways taking turns.  It exits with a non-zero status if the check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../include/spankernels.h"
+
+using Clock = std::chrono::steady_clock;
+
+// CRGB
+//
+// Just the parts of FastLED's setPixelsF uses, done the way FastLED does them
+
+struct CRGB
+{
+    union
+    {
+        struct { uint8_t r, g, b; };
+        uint8_t raw[3];
+    };
+
+    CRGB() : r(0), g(0), b(0) { }
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) { }
+
+    static uint8_t qadd8(uint8_t i, uint8_t j)
+    {
+        unsigned t = i + j;
+        return t > 255 ? 255 : t;
+    }
+
+    static uint8_t scale8(uint8_t i, uint8_t scale)
+    {
+        return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+    }
+
+    CRGB operator+(const CRGB & rhs) const
+    {
+        return CRGB(qadd8(r, rhs.r), qadd8(g, rhs.g), qadd8(b, rhs.b));
+    }
+
+    CRGB & operator+=(const CRGB & rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB & fadeToBlackBy(uint8_t fade)
+    {
+        r = scale8(r, 255 - fade);
+        g = scale8(g, 255 - fade);
+        b = scale8(b, 255 - fade);
+        return *this;
+    }
+};
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be three bytes");
+
+const int cLEDs = 1000;
+
+// FloatSetPixelsF
+//
+// setPixelsF as GFXBase had it, on a single channel
+
+static void FloatSetPixelsF(CRGB * leds, float fPos, float count, CRGB c, bool bMerge)
+{
+    float frac1 = fPos - floor(fPos);
+    float frac2 = fPos + count - floor(fPos + count);
+
+    uint8_t fade1 = (std::max(frac1, 1.0f - count)) * 255;
+    uint8_t fade2 = (1.0 - frac2) * 255;
+    CRGB c1 = c;
+    CRGB c2 = c;
+    c1 = c1.fadeToBlackBy(fade1);
+    c2 = c2.fadeToBlackBy(fade2);
+
+    float p = fPos;
+    if (p >= 0 && p < cLEDs)
+        leds[(int)p] = bMerge ? leds[(int)p] + c1 : c1;
+
+    p = fPos + (1.0 - frac1);
+    count -= (1.0 - frac1);
+
+    while (count >= 1)
+    {
+        if (p >= 0 && p < cLEDs)
+            leds[(int)p] = bMerge ? leds[(int)p] + c : c;
+        count--;
+        p++;
+    };
+
+    if (count > 0)
+        if (p >= 0 && p < cLEDs)
+            leds[(int)p] = bMerge ? leds[(int)p] + c2 : c2;
+}
+
+// FixedSetPixelsF
+//
+// setPixelsF as GFXBase has it now, through DrawFractionalSpan
+
+static constexpr int32_t cMinKernelSpan = 32;
+
+static void FixedSetPixelsF(CRGB * leds, float fPos, float count, CRGB c, bool bMerge)
+{
+    const FractionalSpan span(fPos, count);
+
+    auto drawPartial = [&](int32_t i, uint8_t fade)
+    {
+        if (i >= 0 && i < cLEDs)
+        {
+            CRGB part = CRGB(c).fadeToBlackBy(fade);
+            leds[i] = bMerge ? leds[i] + part : part;
+        }
+    };
+
+    drawPartial(span.head, span.headFade);
+
+    int32_t start = span.head + 1;
+    int32_t body  = span.bodyCount;
+    if (start < 0)
+    {
+        body += start;
+        start = 0;
+    }
+    body = std::min(body, cLEDs - start);
+    if (body >= cMinKernelSpan)
+    {
+        if (bMerge)
+            SpanKernels::Add(leds[start].raw, body, c.raw);
+        else
+            SpanKernels::Fill(leds[start].raw, body, c.raw);
+    }
+    else if (bMerge)
+    {
+        for (CRGB * p = leds + start; body > 0; body--)
+            *p++ += c;
+    }
+    else if (body > 0)
+    {
+        std::fill_n(leds + start, body, c);
+    }
+
+    if (span.bTail)
+        drawPartial(span.head + 1 + span.bodyCount, span.tailFade);
+}
+
+struct Span
+{
+    float pos, count;
+    CRGB color;
+    bool bMerge;
+};
+
+static std::vector<Span> RandomSpans(std::mt19937 & random, size_t cSpans, float maxLength = 12.0f)
+{
+    std::uniform_real_distribution<float> position(-10.0f, cLEDs + 10.0f);
+    std::uniform_real_distribution<float> length(0.0f, maxLength);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<Span> spans(cSpans);
+    for (auto & span : spans)
+        span = { position(random), length(random), CRGB(byte(random), byte(random), byte(random)), byte(random) < 128 };
+    return spans;
+}
+
+static void RandomFrame(std::mt19937 & random, std::vector<CRGB> & frame)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto & pixel : frame)
+        pixel = CRGB(byte(random), byte(random), byte(random));
+}
+
+// BestOf
+//
+// The best time of several runs of each of the two ways of doing something, taking turns, in microseconds
+
+template <typename Old, typename New>
+static void BestOf(int cRuns, double & usOld, double & usNew, Old runOld, New runNew)
+{
+    usOld = usNew = 1e9;
+    for (int run = 0; run < cRuns; run++)
+    {
+        auto start = Clock::now();
+        runOld();
+        usOld = std::min(usOld, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+        start = Clock::now();
+        runNew();
+        usNew = std::min(usNew, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+}
+
+int main()
+{
+    std::mt19937 random(12345);
+    std::vector<CRGB> before(cLEDs), floatFrame(cLEDs), fixedFrame(cLEDs);
+
+    // Visual check, a span at a time
+
+    int cSpans = 0, cDifferent = 0, cFailures = 0;
+    for (int pass = 0; pass < 200; pass++)
+    {
+        RandomFrame(random, before);
+        for (const auto & span : RandomSpans(random, 500, pass % 4 ? 12.0f : 100.0f))
+        {
+            floatFrame = before;
+            fixedFrame = before;
+            FloatSetPixelsF(floatFrame.data(), span.pos, span.count, span.color, span.bMerge);
+            FixedSetPixelsF(fixedFrame.data(), span.pos, span.count, span.color, span.bMerge);
+            cSpans++;
+
+            int diff = 0;
+            for (int i = 0; i < cLEDs; i++)
+                for (int ch = 0; ch < 3; ch++)
+                    diff = std::max(diff, abs(floatFrame[i].raw[ch] - fixedFrame[i].raw[ch]));
+
+            if (diff)
+                cDifferent++;
+            if (diff > 1 && cFailures++ < 10)
+                printf("FAILED: span at %.9g for %.9g differs by %d\n", span.pos, span.count, diff);
+        }
+    }
+    printf("%d spans drawn both ways: %d the same, %d with a partial pixel a level apart, %d further apart\n",
+           cSpans, cSpans - cDifferent, cDifferent - cFailures, cFailures);
+
+    // Runs of whole pixels, filled and added to a pixel at a time and through SpanKernels
+
+    CRGB color(10, 200, 77);
+    printf("Whole pixels, a pixel at a time against SpanKernels:\n");
+    for (int count : { 4, 8, 12, 16, 24, 32, 48, 64 })
+    {
+        const int cRuns = 20000;
+        double usFill[2], usAdd[2];
+
+        BestOf(15, usFill[0], usFill[1],
+               [&] { for (int i = 0; i < cRuns; i++) std::fill_n(fixedFrame.data() + i % 900, count, color); },
+               [&] { for (int i = 0; i < cRuns; i++) SpanKernels::Fill(fixedFrame[i % 900].raw, count, color.raw); });
+        BestOf(15, usAdd[0], usAdd[1],
+               [&] { for (int i = 0; i < cRuns; i++) for (CRGB * p = fixedFrame.data() + i % 900, * pEnd = p + count; p < pEnd; p++) *p += color; },
+               [&] { for (int i = 0; i < cRuns; i++) SpanKernels::Add(fixedFrame[i % 900].raw, count, color.raw); });
+
+        printf("  %2d pixels:  fill %5.1fns against %5.1fns (%.2fx),  add %5.1fns against %5.1fns (%.2fx)%s\n", count,
+               usFill[0] * 1000 / cRuns, usFill[1] * 1000 / cRuns, usFill[0] / usFill[1],
+               usAdd[0] * 1000 / cRuns, usAdd[1] * 1000 / cRuns, usAdd[0] / usAdd[1],
+               count >= cMinKernelSpan ? "  (SpanKernels)" : "");
+    }
+
+    // Benchmark, 500 spans a frame
+
+    const int frames = 500;
+    std::vector<std::vector<Span>> work;
+    for (int frame = 0; frame < frames; frame++)
+        work.push_back(RandomSpans(random, 500));
+
+    auto drawFrames = [&](auto setPixelsF, std::vector<CRGB> & frame)
+    {
+        for (const auto & spans : work)
+            for (const auto & span : spans)
+                setPixelsF(frame.data(), span.pos, span.count, span.color, span.bMerge);
+    };
+
+    double usFloat, usFixed;
+    BestOf(10, usFloat, usFixed, [&] { drawFrames(FloatSetPixelsF, floatFrame); }, [&] { drawFrames(FixedSetPixelsF, fixedFrame); });
+    usFloat /= frames;
+    usFixed /= frames;
+
+    printf("500 spans on a %d-LED strip: floats %.1fus, fixed point %.1fus a frame, %.2fx\n", cLEDs, usFloat, usFixed, usFloat / usFixed);
+
+    printf(cFailures ? "%d spans FAILED\n" : "Fixed point drew the same pixels as floats, to within a level\n", cFailures);
+    return cFailures ? 1 : 0;
+}
@@ -0,0 +1,1051 @@
+// framesender.cpp
+//
+// Host-side load generator for the NightDriver socket protocol.  Sends frames to a NightDriver (or to another
+// copy of this tool running with --listen) at a steady rate. It uses the same wire format as the chip:
+// PIXELDATA64, RGB565DATA64, PALETTEDATA64, PIXELDELTA64 and PIXELBATCH64 frames, optionally compressed
+// behind a "DAVE" header, and optionally PEAKDATA as well.  It reports the throughput it achieved and how long
+// each SocketResponse took to come back, along with the buffer and telemetry figures the chip sends in it.
+//
+// Built on Linux with nothing more than zlib:
+//
+//   g++ -std=c++17 -O2 -pthread -o framesender tools/framesender.cpp -lz
+//
+// Then, for example:
+//
+//   ./framesender 192.168.1.50 --leds 1024 --fps 60 --seconds 30
+//   ./framesender 192.168.1.50 --leds 1024 --format delta --compress --response 3
+//   ./framesender 192.168.1.50 --leds 1024 --batch 8 --compress --input frames.rgb
+//
+// To measure the protocol without any hardware, run a receiver in one terminal and the sender in another:
+//
+//   ./framesender --listen
+//   ./framesender 127.0.0.1 --leds 1024 --fps 1000 --frames 10000
+//
+// The receiver parses, inflates and acknowledges packets the way SocketServer does, serving every connection
+// from one select() loop. It does not draw anything, so its acknowledgement latency is the cost of the protocol
+// and the network stack alone.  To see how it shares out between senders, send over several connections at once:
+//
+//   ./framesender 127.0.0.1 --leds 1024 --fps 1000000 --frames 20000 --senders 4
+//
+// Only packets the chip acknowledges are timed.  Those are uncompressed pixel packets of every kind, and
+// batches whether compressed or not.  A recorded --input file is raw RGB frames (leds * 3 bytes each, back
+// to back, as tools/deltaframes.py takes), played in a loop.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// These match globals.h and socketserver.h
+
+#define WIFI_COMMAND_PIXELDATA64        3
+#define WIFI_COMMAND_PEAKDATA           4
+#define WIFI_COMMAND_PIXELDELTA64       5
+#define WIFI_COMMAND_PIXELBATCH64       6
+#define WIFI_COMMAND_RGB565DATA64       7
+#define WIFI_COMMAND_PALETTEDATA64      8
+#define WIFI_COMMAND_RESPONSEVERSION    9
+
+#define STANDARD_DATA_HEADER_SIZE       24
+#define COMPRESSED_HEADER_SIZE          16
+#define DELTA_DATA_HEADER_SIZE          40
+#define COMPRESSED_HEADER               0x44415645
+#define PALETTE_DATA_SIZE               48
+#define SOCKET_RESPONSE_SIZE            64
+#define SOCKET_RESPONSE_V2_SIZE         336
+#define SOCKET_RESPONSE_V3_SIZE         360
+#define TELEMETRY_HISTOGRAM_BUCKETS     16
+#define MAX_SPAN_LENGTH                 0xFFFF
+#define MAX_LISTEN_CONNECTIONS          16
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string host;
+    int         port          = 49152;
+    int         leds          = 144;
+    int         channel       = 1;
+    double      fps           = 30;
+    long        frames        = 0;              // 0 means use seconds instead
+    double      seconds       = 10;
+    double      lead          = 0.5;            // Seconds in the future to timestamp frames
+    std::string format        = "rgb";
+    int         batch         = 1;
+    int         keyframe      = 30;             // Delta mode sends a full frame this often
+    bool        compress      = false;
+    int         bands         = 0;              // Send PEAKDATA with this many bands alongside each frame
+    int         response      = 1;              // SocketResponse version to ask for
+    std::string input;
+    bool        listen        = false;
+    int         senders       = 1;              // Connections to send the same stream over at once
+};
+
+// Little-endian helpers, the same byte order as WORDFromMemory and friends
+
+static void PutWord(std::vector<uint8_t> & out, uint16_t value)
+{
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void PutDWord(std::vector<uint8_t> & out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+
+static void PutULong(std::vector<uint8_t> & out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+
+static uint16_t WORDFromMemory(const uint8_t * p)  { return p[0] | p[1] << 8; }
+static uint32_t DWORDFromMemory(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+static uint64_t ULONGFromMemory(const uint8_t * p) { return DWORDFromMemory(p) | (uint64_t) DWORDFromMemory(p + 4) << 32; }
+
+static double DoubleFromMemory(const uint8_t * p)
+{
+    double value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static void PutHeader(std::vector<uint8_t> & out, uint16_t command16, uint16_t channel16, uint32_t length32, uint64_t usTimestamp)
+{
+    PutWord(out, command16);
+    PutWord(out, channel16);
+    PutDWord(out, length32);
+    PutULong(out, usTimestamp / 1000000);
+    PutULong(out, usTimestamp % 1000000);
+}
+
+static uint64_t WallClockMicros()
+{
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static bool WriteAll(int socket, const uint8_t * p, size_t cb)
+{
+    while (cb > 0)
+    {
+        ssize_t cbWritten = send(socket, p, cb, MSG_NOSIGNAL);
+        if (cbWritten <= 0)
+            return false;
+        p  += cbWritten;
+        cb -= cbWritten;
+    }
+    return true;
+}
+
+static bool ReadAll(int socket, uint8_t * p, size_t cb)
+{
+    while (cb > 0)
+    {
+        ssize_t cbRead = recv(socket, p, cb, 0);
+        if (cbRead <= 0)
+            return false;
+        p  += cbRead;
+        cb -= cbRead;
+    }
+    return true;
+}
+
+// FrameSource
+//
+// Hands out one RGB frame after another, either from a recorded file or from a moving test pattern
+
+class FrameSource
+{
+    std::vector<std::vector<uint8_t>> _recorded;
+    size_t                            _leds;
+    size_t                            _iFrame = 0;
+
+  public:
+
+    FrameSource(size_t leds) : _leds(leds)
+    {
+    }
+
+    bool Load(const std::string & path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        for (size_t offset = 0; offset + _leds * 3 <= data.size(); offset += _leds * 3)
+            _recorded.emplace_back(data.begin() + offset, data.begin() + offset + _leds * 3);
+        return !_recorded.empty();
+    }
+
+    std::vector<uint8_t> Next()
+    {
+        size_t iFrame = _iFrame++;
+        if (!_recorded.empty())
+            return _recorded[iFrame % _recorded.size()];
+
+        // A rainbow that scrolls along the strip, with a dark gap so that deltas have something to skip
+
+        std::vector<uint8_t> frame(_leds * 3);
+        for (size_t i = 0; i < _leds; i++)
+        {
+            if ((i + iFrame) % 64 >= 48)
+                continue;
+            double hue = (i * 4 + iFrame * 2) % 256 / 256.0 * 2 * M_PI;
+            frame[i * 3 + 0] = (uint8_t) (127.5 + 127.5 * sin(hue));
+            frame[i * 3 + 1] = (uint8_t) (127.5 + 127.5 * sin(hue + 2 * M_PI / 3));
+            frame[i * 3 + 2] = (uint8_t) (127.5 + 127.5 * sin(hue + 4 * M_PI / 3));
+        }
+        return frame;
+    }
+
+    bool IsRecorded() const
+    {
+        return !_recorded.empty();
+    }
+};
+
+// Packet builders, one per wire format
+
+static std::vector<uint8_t> PixelPacket(const Options & opt, const std::vector<uint8_t> & frame, uint64_t usTimestamp)
+{
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_PIXELDATA64, opt.channel, frame.size() / 3, usTimestamp);
+    out.insert(out.end(), frame.begin(), frame.end());
+    return out;
+}
+
+static std::vector<uint8_t> RGB565Packet(const Options & opt, const std::vector<uint8_t> & frame, uint64_t usTimestamp)
+{
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_RGB565DATA64, opt.channel, frame.size() / 3, usTimestamp);
+    for (size_t i = 0; i < frame.size(); i += 3)
+        PutWord(out, (frame[i] >> 3) << 11 | (frame[i + 1] >> 2) << 5 | frame[i + 2] >> 3);
+    return out;
+}
+
+// The palette format can't represent an arbitrary frame, so it sends its own pattern: a fixed rainbow palette
+// and indices that scroll through it, which the chip blends between palette entries
+
+static std::vector<uint8_t> PalettePacket(const Options & opt, long iFrame, uint64_t usTimestamp)
+{
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_PALETTEDATA64, opt.channel, opt.leds, usTimestamp);
+    for (int i = 0; i < 16; i++)
+    {
+        double hue = i / 16.0 * 2 * M_PI;
+        out.push_back((uint8_t) (127.5 + 127.5 * sin(hue)));
+        out.push_back((uint8_t) (127.5 + 127.5 * sin(hue + 2 * M_PI / 3)));
+        out.push_back((uint8_t) (127.5 + 127.5 * sin(hue + 4 * M_PI / 3)));
+    }
+    for (int i = 0; i < opt.leds; i++)
+        out.push_back((uint8_t) (i * 4 + iFrame * 2));
+    return out;
+}
+
+// DeltaPacket
+//
+// XOR/RLE spans against the previous frame, as tools/deltaframes.py makes them.  Returns an empty packet if the
+// delta would be no smaller than the frame itself, in which case a keyframe should go instead.
+
+static std::vector<uint8_t> DeltaPacket(const Options & opt, const std::vector<uint8_t> & previous, const std::vector<uint8_t> & frame,
+                                        uint64_t usTimestamp, uint64_t usBaseTimestamp)
+{
+    size_t count = frame.size() / 3;
+    auto changed = [&](size_t i) { return memcmp(&frame[i * 3], &previous[i * 3], 3) != 0; };
+
+    std::vector<uint8_t> body;
+    size_t position = 0;
+    size_t i = 0;
+    while (i < count)
+    {
+        if (!changed(i))
+        {
+            i++;
+            continue;
+        }
+
+        // Runs separated by a single unchanged pixel are merged, as three zero bytes cost less than a span header
+
+        size_t start = i;
+        size_t end   = i + 1;
+        while (end < count && end - start < MAX_SPAN_LENGTH)
+        {
+            if (changed(end))
+                end++;
+            else if (end + 1 < count && end + 1 - start < MAX_SPAN_LENGTH && changed(end + 1))
+                end += 2;
+            else
+                break;
+        }
+
+        while (start - position > MAX_SPAN_LENGTH)
+        {
+            PutWord(body, MAX_SPAN_LENGTH);
+            PutWord(body, 0);
+            position += MAX_SPAN_LENGTH;
+        }
+        PutWord(body, start - position);
+        PutWord(body, end - start);
+        for (size_t b = start * 3; b < end * 3; b++)
+            body.push_back(frame[b] ^ previous[b]);
+
+        position = end;
+        i = end;
+    }
+
+    if (body.size() >= frame.size())
+        return {};
+
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_PIXELDELTA64, opt.channel, body.size(), usTimestamp);
+    PutULong(out, usBaseTimestamp / 1000000);
+    PutULong(out, usBaseTimestamp % 1000000);
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+static std::vector<uint8_t> BatchPacket(const std::vector<std::vector<uint8_t>> & frames)
+{
+    size_t cbFrames = 0;
+    for (const auto & frame : frames)
+        cbFrames += frame.size();
+
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_PIXELBATCH64, 0, cbFrames, 0);
+    for (const auto & frame : frames)
+        out.insert(out.end(), frame.begin(), frame.end());
+    return out;
+}
+
+static std::vector<uint8_t> PeakPacket(const Options & opt, long iFrame, uint64_t usTimestamp)
+{
+    std::vector<uint8_t> out;
+    PutHeader(out, WIFI_COMMAND_PEAKDATA, opt.bands, opt.bands * sizeof(float), usTimestamp);
+    for (int i = 0; i < opt.bands; i++)
+    {
+        float peak = 0.5f + 0.5f * sinf(iFrame * 0.1f + i * 0.4f);
+        uint8_t bytes[sizeof(float)];
+        memcpy(bytes, &peak, sizeof(peak));
+        out.insert(out.end(), bytes, bytes + sizeof(bytes));
+    }
+    return out;
+}
+
+// CompressPacket
+//
+// Wraps a packet in the 16 byte compressed header: magic, compressed size, expanded size and a reserved dword,
+// followed by the zlib stream.  The default 32K window is the most the chip's batch dictionary allows.
+
+static std::vector<uint8_t> CompressPacket(const std::vector<uint8_t> & packet)
+{
+    uLongf cbCompressed = compressBound(packet.size());
+    std::vector<uint8_t> out(COMPRESSED_HEADER_SIZE + cbCompressed);
+    if (Z_OK != compress2(&out[COMPRESSED_HEADER_SIZE], &cbCompressed, packet.data(), packet.size(), Z_BEST_COMPRESSION))
+    {
+        fprintf(stderr, "Unable to compress a packet of %zu bytes\n", packet.size());
+        exit(1);
+    }
+    out.resize(COMPRESSED_HEADER_SIZE + cbCompressed);
+
+    std::vector<uint8_t> header;
+    PutDWord(header, COMPRESSED_HEADER);
+    PutDWord(header, cbCompressed);
+    PutDWord(header, packet.size());
+    PutDWord(header, 0);
+    std::copy(header.begin(), header.end(), out.begin());
+    return out;
+}
+
+// Statistics
+//
+// What the response reader thread learns, shared with the main thread
+
+struct Statistics
+{
+    std::mutex                  _mutex;
+    std::deque<Clock::time_point> _pending;         // Send times of packets still waiting for their response
+    std::vector<double>         _latencies;         // Milliseconds from sending a packet to its response arriving
+    std::vector<uint8_t>        _lastResponse;
+    std::atomic<bool>           _bDone { false };
+};
+
+static void ReadResponses(int socket, Statistics & stats)
+{
+    uint8_t buffer[SOCKET_RESPONSE_V3_SIZE];
+
+    while (!stats._bDone)
+    {
+        // The size field comes first, so we know whether this is a plain response or a newer one
+
+        if (!ReadAll(socket, buffer, sizeof(uint32_t)))
+            break;
+        uint32_t size = DWORDFromMemory(buffer);
+        if (size < SOCKET_RESPONSE_SIZE || size > sizeof(buffer) || !ReadAll(socket, buffer + sizeof(uint32_t), size - sizeof(uint32_t)))
+        {
+            fprintf(stderr, "Bad response of %u bytes\n", size);
+            break;
+        }
+
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> guard(stats._mutex);
+        if (!stats._pending.empty())
+        {
+            stats._latencies.push_back(std::chrono::duration<double, std::milli>(now - stats._pending.front()).count());
+            stats._pending.pop_front();
+        }
+        stats._lastResponse.assign(buffer, buffer + size);
+    }
+}
+
+static double Percentile(std::vector<double> sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t) (fraction * sorted.size()))];
+}
+
+static void PrintResponse(const std::vector<uint8_t> & response)
+{
+    if (response.size() < SOCKET_RESPONSE_SIZE)
+        return;
+
+    const uint8_t * p = response.data();
+    printf("Last response: flash version %u, buffer %u/%u, newest frame %+.3lfs, oldest %+.3lfs, drawing %u fps, %u watts, brightness %.0lf, signal %.0lfdB\n",
+           DWORDFromMemory(p + 4), DWORDFromMemory(p + 52), DWORDFromMemory(p + 48), DoubleFromMemory(p + 24), DoubleFromMemory(p + 16),
+           DWORDFromMemory(p + 56), DWORDFromMemory(p + 60), DoubleFromMemory(p + 32), DoubleFromMemory(p + 40));
+
+    if (response.size() < SOCKET_RESPONSE_V2_SIZE || DWORDFromMemory(p + 64) < 2)
+        return;
+
+    printf("Frames late: %u, dropped: %u\n", DWORDFromMemory(p + 68), DWORDFromMemory(p + 72));
+
+    // Bucket 0 is anything under 128us, and each one after that covers twice the time of the one before
+
+    static const char * stages[] = { "receive", "decompress", "queued", "draw-to-show" };
+    printf("%-14s", "Histogram");
+    for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), b == 0 ? "<0.128" : ">%.4g", (1u << (b + 6)) / 1000.0);
+        printf(" %7s", label);
+    }
+    printf("  (ms)\n");
+    for (int s = 0; s < 4; s++)
+    {
+        printf("%-14s", stages[s]);
+        for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++)
+            printf(" %7u", DWORDFromMemory(p + 80 + (s * TELEMETRY_HISTOGRAM_BUCKETS + b) * sizeof(uint32_t)));
+        printf("\n");
+    }
+
+    if (response.size() < SOCKET_RESPONSE_V3_SIZE || DWORDFromMemory(p + 64) < 3)
+        return;
+
+    printf("Lead %+.3lfms, jitter %.3lfms, recommended lead %.3lfms and %u buffers, dropped late: %u, evicted: %u\n",
+           (int32_t) DWORDFromMemory(p + 336) / 1000.0, DWORDFromMemory(p + 340) / 1000.0, DWORDFromMemory(p + 344) / 1000.0,
+           DWORDFromMemory(p + 348), DWORDFromMemory(p + 352), DWORDFromMemory(p + 356));
+}
+
+static int Connect(const Options & opt)
+{
+    addrinfo hints = {};
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo * pResult = nullptr;
+    if (0 != getaddrinfo(opt.host.c_str(), std::to_string(opt.port).c_str(), &hints, &pResult))
+    {
+        fprintf(stderr, "Unable to resolve %s\n", opt.host.c_str());
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0 || 0 != connect(sock, pResult->ai_addr, pResult->ai_addrlen))
+    {
+        fprintf(stderr, "Unable to connect to %s:%d\n", opt.host.c_str(), opt.port);
+        freeaddrinfo(pResult);
+        return -1;
+    }
+    freeaddrinfo(pResult);
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+// Send
+//
+// The sender proper: paces packets against absolute deadlines so that a slow send doesn't drift the rate.  With
+// --senders, several of these run at once, each on its own connection, and report how many frames they sent.
+
+static std::mutex g_printMutex;
+
+static int Send(const Options & opt, long & cFramesSent, double & secondsSending)
+{
+    cFramesSent    = 0;
+    secondsSending = 0;
+
+    FrameSource source(opt.leds);
+    if (!opt.input.empty() && !source.Load(opt.input))
+    {
+        fprintf(stderr, "No whole frames of %d LEDs in %s\n", opt.leds, opt.input.c_str());
+        return 1;
+    }
+    if (opt.format == "palette" && source.IsRecorded())
+    {
+        fprintf(stderr, "The palette format only sends its own test pattern\n");
+        return 1;
+    }
+    if (opt.batch > 1 && opt.format != "rgb")
+    {
+        fprintf(stderr, "Batches can only carry rgb frames\n");
+        return 1;
+    }
+
+    int sock = Connect(opt);
+    if (sock < 0)
+        return 1;
+
+    if (opt.response > 1)
+    {
+        std::vector<uint8_t> request;
+        PutHeader(request, WIFI_COMMAND_RESPONSEVERSION, 0, opt.response, 0);
+        WriteAll(sock, request.data(), request.size());
+    }
+
+    Statistics stats;
+    std::thread reader(ReadResponses, sock, std::ref(stats));
+
+    const long   totalFrames   = opt.frames > 0 ? opt.frames : (long) (opt.seconds * opt.fps);
+    const auto   frameInterval = std::chrono::duration<double>(1.0 / opt.fps);
+    const auto   start         = Clock::now();
+    const uint64_t usStart     = WallClockMicros() + (uint64_t) (opt.lead * 1000000);
+
+    std::vector<uint8_t> previous;
+    uint64_t usPrevious = 0;
+    long cPackets = 0, cKeyframes = 0, cDeltas = 0;
+    size_t cbSent = 0, cbUncompressed = 0;
+
+    for (long iFrame = 0; iFrame < totalFrames; iFrame += opt.batch)
+    {
+        // Batches go out once per batch, holding the frames for the time they cover
+
+        std::vector<std::vector<uint8_t>> packets;
+        for (int i = 0; i < opt.batch && iFrame + i < totalFrames; i++)
+        {
+            uint64_t usTimestamp = usStart + (uint64_t) ((iFrame + i) * 1000000 / opt.fps);
+            auto frame = source.Next();
+
+            if (opt.format == "rgb565")
+                packets.push_back(RGB565Packet(opt, frame, usTimestamp));
+            else if (opt.format == "palette")
+                packets.push_back(PalettePacket(opt, iFrame + i, usTimestamp));
+            else if (opt.format == "delta")
+            {
+                std::vector<uint8_t> delta;
+                if (!previous.empty() && (iFrame + i) % opt.keyframe != 0)
+                    delta = DeltaPacket(opt, previous, frame, usTimestamp, usPrevious);
+                packets.push_back(delta.empty() ? PixelPacket(opt, frame, usTimestamp) : delta);
+                (delta.empty() ? cKeyframes : cDeltas)++;
+            }
+            else
+                packets.push_back(PixelPacket(opt, frame, usTimestamp));
+
+            previous   = std::move(frame);
+            usPrevious = usTimestamp;
+        }
+
+        std::vector<uint8_t> packet = opt.batch > 1 ? BatchPacket(packets) : packets.front();
+        cbUncompressed += packet.size();
+
+        // Compressed single frames never get a response; compressed batches do
+
+        bool bExpectResponse = !opt.compress || opt.batch > 1;
+        if (opt.compress)
+            packet = CompressPacket(packet);
+
+        if (bExpectResponse)
+        {
+            std::lock_guard<std::mutex> guard(stats._mutex);
+            stats._pending.push_back(Clock::now());
+        }
+        if (!WriteAll(sock, packet.data(), packet.size()))
+        {
+            fprintf(stderr, "Connection lost after %ld packets\n", cPackets);
+            break;
+        }
+        cbSent += packet.size();
+        cPackets++;
+        cFramesSent += packets.size();
+
+        if (opt.bands > 0)
+        {
+            auto peaks = PeakPacket(opt, iFrame, usPrevious);
+            if (!WriteAll(sock, peaks.data(), peaks.size()))
+                break;
+            cbSent += peaks.size();
+        }
+
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(frameInterval * (iFrame + opt.batch)));
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    secondsSending = elapsed;
+
+    // Give the last responses a moment to arrive before we hang up
+
+    for (int i = 0; i < 200; i++)
+    {
+        {
+            std::lock_guard<std::mutex> guard(stats._mutex);
+            if (stats._pending.empty())
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats._bDone = true;
+    shutdown(sock, SHUT_RDWR);
+    reader.join();
+    close(sock);
+
+    std::lock_guard<std::mutex> printGuard(g_printMutex);
+    std::lock_guard<std::mutex> guard(stats._mutex);
+    auto sorted = stats._latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    printf("Sent %ld packets (%ld frames) in %.2lfs: %.1lf frames/s, %.2lf Mbit/s on the wire", cPackets, totalFrames, elapsed,
+           totalFrames / elapsed, cbSent * 8 / elapsed / 1000000);
+    if (opt.compress)
+        printf(", compressed to %.1lf%%", 100.0 * cbSent / std::max<size_t>(1, cbUncompressed));
+    printf("\n");
+    if (opt.format == "delta")
+        printf("Delta frames: %ld, keyframes: %ld\n", cDeltas, cKeyframes);
+
+    if (sorted.empty())
+        printf("No responses%s\n", opt.compress && opt.batch == 1 ? " (compressed frames are not acknowledged)" : "");
+    else
+    {
+        double total = 0;
+        for (double ms : sorted)
+            total += ms;
+        printf("Responses: %zu, %zu missing, latency ms: min %.3lf, avg %.3lf, p50 %.3lf, p95 %.3lf, p99 %.3lf, max %.3lf\n",
+               sorted.size(), stats._pending.size(), sorted.front(), total / sorted.size(), Percentile(sorted, 0.5),
+               Percentile(sorted, 0.95), Percentile(sorted, 0.99), sorted.back());
+    }
+    PrintResponse(stats._lastResponse);
+    return 0;
+}
+
+// HandlePacket
+//
+// The listener is a stand-in for SocketServer: it reads packets the same way, inflates compressed ones, checks their framing and
+// answers with a SocketResponse wherever the chip would.  It keeps no frames, so the buffer figures it reports
+// are only the timestamp of the newest frame seen.
+
+static bool HandlePacket(const uint8_t * pPacket, size_t cbPacket, long & cFrames, uint64_t & usNewest)
+{
+    uint16_t command16 = WORDFromMemory(pPacket);
+    switch (command16)
+    {
+        case WIFI_COMMAND_PIXELBATCH64:
+        {
+            size_t offset = STANDARD_DATA_HEADER_SIZE;
+            while (offset + STANDARD_DATA_HEADER_SIZE <= cbPacket)
+            {
+                if (WORDFromMemory(pPacket + offset) != WIFI_COMMAND_PIXELDATA64)
+                    return false;
+                usNewest = ULONGFromMemory(pPacket + offset + 8) * 1000000 + ULONGFromMemory(pPacket + offset + 16);
+                offset += STANDARD_DATA_HEADER_SIZE + DWORDFromMemory(pPacket + offset + 4) * 3;
+                cFrames++;
+            }
+            return offset == cbPacket;
+        }
+        case WIFI_COMMAND_PIXELDATA64:
+        case WIFI_COMMAND_RGB565DATA64:
+        case WIFI_COMMAND_PALETTEDATA64:
+        case WIFI_COMMAND_PIXELDELTA64:
+            usNewest = ULONGFromMemory(pPacket + 8) * 1000000 + ULONGFromMemory(pPacket + 16);
+            cFrames++;
+            return true;
+        case WIFI_COMMAND_PEAKDATA:
+        case WIFI_COMMAND_RESPONSEVERSION:
+            return true;
+    }
+    fprintf(stderr, "Unknown command %u\n", command16);
+    return false;
+}
+
+// ExpectedPacketSize
+//
+// The same rules as SocketServer::ExpectedPacketSize: how many bytes the packet at the front of the buffer needs,
+// given the cbReceived of it that have arrived, or 0 if its header is bad.  Until the first four bytes say
+// whether it's compressed, it only asks for a compressed header's worth, since a compressed packet can be
+// shorter than a data header and anything more might belong to the next packet.
+
+static size_t ExpectedPacketSize(const uint8_t * pHeader, size_t cbReceived)
+{
+    if (cbReceived < sizeof(uint32_t))
+        return COMPRESSED_HEADER_SIZE;
+
+    if (DWORDFromMemory(pHeader) == COMPRESSED_HEADER)
+        return cbReceived < COMPRESSED_HEADER_SIZE ? COMPRESSED_HEADER_SIZE : COMPRESSED_HEADER_SIZE + DWORDFromMemory(pHeader + 4);
+
+    if (cbReceived < STANDARD_DATA_HEADER_SIZE)
+        return STANDARD_DATA_HEADER_SIZE;
+
+    uint32_t length32 = DWORDFromMemory(pHeader + 4);
+    switch (WORDFromMemory(pHeader))
+    {
+        case WIFI_COMMAND_PIXELDATA64:      return STANDARD_DATA_HEADER_SIZE + length32 * 3;
+        case WIFI_COMMAND_RGB565DATA64:     return STANDARD_DATA_HEADER_SIZE + length32 * 2;
+        case WIFI_COMMAND_PALETTEDATA64:    return STANDARD_DATA_HEADER_SIZE + PALETTE_DATA_SIZE + length32;
+        case WIFI_COMMAND_PIXELDELTA64:     return DELTA_DATA_HEADER_SIZE + length32;
+        case WIFI_COMMAND_PEAKDATA:
+        case WIFI_COMMAND_PIXELBATCH64:     return STANDARD_DATA_HEADER_SIZE + length32;
+        case WIFI_COMMAND_RESPONSEVERSION:  return STANDARD_DATA_HEADER_SIZE;
+    }
+    return 0;
+}
+
+// Connection
+//
+// One sender connected to the listener, with its own buffer and count of how far into its packet it is
+
+struct Connection
+{
+    int                  _socket = -1;
+    std::vector<uint8_t> _packet;
+    size_t               _cbReceived = 0;
+    uint32_t             _responseVersion = 1;
+    long                 _cPackets = 0;
+    long                 _cFrames = 0;
+    size_t               _cbTotal = 0;
+    uint64_t             _usNewest = 0;
+    Clock::time_point    _start;
+};
+
+static bool ProcessPacket(Connection & conn)
+{
+    std::vector<uint8_t> expanded;
+    const uint8_t * pPacket = conn._packet.data();
+    size_t cbPacket = conn._cbReceived;
+
+    bool bCompressed = DWORDFromMemory(pPacket) == COMPRESSED_HEADER;
+    if (bCompressed)
+    {
+        uLongf cbExpanded = DWORDFromMemory(pPacket + 8);
+        expanded.resize(cbExpanded);
+        if (Z_OK != uncompress(expanded.data(), &cbExpanded, pPacket + COMPRESSED_HEADER_SIZE, DWORDFromMemory(pPacket + 4)) || cbExpanded != expanded.size())
+        {
+            fprintf(stderr, "Unable to inflate a compressed packet\n");
+            return false;
+        }
+        pPacket  = expanded.data();
+        cbPacket = cbExpanded;
+    }
+
+    uint16_t command16 = WORDFromMemory(pPacket);
+    if (command16 == WIFI_COMMAND_RESPONSEVERSION)
+        conn._responseVersion = DWORDFromMemory(pPacket + 4);
+
+    if (!HandlePacket(pPacket, cbPacket, conn._cFrames, conn._usNewest))
+    {
+        fprintf(stderr, "Bad packet, closing the connection\n");
+        return false;
+    }
+
+    // Same rule as SocketServer: uncompressed pixels of any kind get a response, and batches always do
+
+    bool bRespond = command16 == WIFI_COMMAND_PIXELBATCH64 ||
+                    (!bCompressed && command16 != WIFI_COMMAND_PEAKDATA && command16 != WIFI_COMMAND_RESPONSEVERSION);
+    if (!bRespond)
+        return true;
+
+    double now = WallClockMicros() / 1000000.0;
+    double age = conn._usNewest / 1000000.0 - now;
+    double fps = conn._cFrames / std::max(0.001, std::chrono::duration<double>(Clock::now() - conn._start).count());
+
+    std::vector<uint8_t> response;
+    uint32_t version = std::min<uint32_t>(conn._responseVersion, 3);
+    PutDWord(response, version >= 3 ? SOCKET_RESPONSE_V3_SIZE : version == 2 ? SOCKET_RESPONSE_V2_SIZE : SOCKET_RESPONSE_SIZE);
+    PutDWord(response, 0);
+    for (double value : { now, age, age, 255.0, 0.0 })
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        PutULong(response, bits);
+    }
+    PutDWord(response, 0);
+    PutDWord(response, 0);
+    PutDWord(response, (uint32_t) fps);
+    PutDWord(response, 0);
+    if (version >= 2)
+    {
+        PutDWord(response, version);
+        PutDWord(response, 0);
+        PutDWord(response, 0);
+        PutDWord(response, TELEMETRY_HISTOGRAM_BUCKETS);
+        response.resize(version >= 3 ? SOCKET_RESPONSE_V3_SIZE : SOCKET_RESPONSE_V2_SIZE);
+    }
+    return WriteAll(conn._socket, response.data(), response.size());
+}
+
+// ReadFromConnection
+//
+// Called when select() says a connection is readable.  Like SocketServer, it never reads past the end of the
+// current packet, and processes the packet once it's all in.  Returns false if the connection should be closed.
+
+static bool ReadFromConnection(Connection & conn)
+{
+    size_t cbNeeded = ExpectedPacketSize(conn._packet.data(), conn._cbReceived);
+    if (cbNeeded == 0)
+    {
+        fprintf(stderr, "Bad header, closing the connection\n");
+        return false;
+    }
+    if (conn._packet.size() < cbNeeded)
+        conn._packet.resize(cbNeeded);
+
+    ssize_t cbRead = recv(conn._socket, conn._packet.data() + conn._cbReceived, cbNeeded - conn._cbReceived, MSG_DONTWAIT);
+    if (cbRead == 0)
+        return false;
+    if (cbRead < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+
+    conn._cbReceived += cbRead;
+    conn._cbTotal    += cbRead;
+
+    cbNeeded = ExpectedPacketSize(conn._packet.data(), conn._cbReceived);
+    if (cbNeeded == 0)
+    {
+        fprintf(stderr, "Bad header, closing the connection\n");
+        return false;
+    }
+    if (conn._cbReceived < cbNeeded)
+        return true;
+
+    conn._cPackets++;
+    bool bOK = ProcessPacket(conn);
+    conn._cbReceived = 0;
+    return bOK;
+}
+
+// Listen
+//
+// Serves up to MAX_LISTEN_CONNECTIONS senders at once from one select() loop, as SocketServer does.  Whenever the
+// last sender hangs up, it prints the combined rate across everyone who was connected since the first arrived,
+// which with --senders on the other end is the multi-sender throughput.
+
+static int Listen(const Options & opt)
+{
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address = {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port        = htons(opt.port);
+    if (0 != bind(server, (sockaddr *) &address, sizeof(address)) || 0 != listen(server, MAX_LISTEN_CONNECTIONS))
+    {
+        fprintf(stderr, "Unable to listen on port %d\n", opt.port);
+        return 1;
+    }
+    printf("Listening on port %d\n", opt.port);
+
+    Connection connections[MAX_LISTEN_CONNECTIONS];
+    int  cOpen = 0, cSession = 0;
+    long cSessionFrames = 0;
+    Clock::time_point sessionStart;
+
+    for (;;)
+    {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        int maxSocket = -1;
+        if (cOpen < MAX_LISTEN_CONNECTIONS)
+        {
+            FD_SET(server, &readSet);
+            maxSocket = server;
+        }
+        for (auto & conn : connections)
+        {
+            if (conn._socket >= 0)
+            {
+                FD_SET(conn._socket, &readSet);
+                maxSocket = std::max(maxSocket, conn._socket);
+            }
+        }
+
+        if (select(maxSocket + 1, &readSet, nullptr, nullptr, nullptr) <= 0)
+            continue;
+
+        if (FD_ISSET(server, &readSet))
+        {
+            int sock = accept(server, nullptr, nullptr);
+            auto pSlot = std::find_if(std::begin(connections), std::end(connections), [](const Connection & c) { return c._socket < 0; });
+            if (sock >= 0 && pSlot != std::end(connections))
+            {
+                setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                *pSlot = Connection();
+                pSlot->_socket = sock;
+                pSlot->_start  = Clock::now();
+                if (cOpen++ == 0)
+                {
+                    sessionStart   = pSlot->_start;
+                    cSession       = 0;
+                    cSessionFrames = 0;
+                }
+                cSession++;
+            }
+            else if (sock >= 0)
+                close(sock);
+        }
+
+        for (auto & conn : connections)
+        {
+            if (conn._socket < 0 || !FD_ISSET(conn._socket, &readSet) || ReadFromConnection(conn))
+                continue;
+
+            double elapsed = std::chrono::duration<double>(Clock::now() - conn._start).count();
+            printf("Connection closed: %ld packets, %ld frames, %zu bytes in %.2lfs (%.1lf frames/s)\n",
+                   conn._cPackets, conn._cFrames, conn._cbTotal, elapsed, conn._cFrames / std::max(0.001, elapsed));
+            close(conn._socket);
+            conn._socket = -1;
+            cSessionFrames += conn._cFrames;
+
+            if (--cOpen == 0 && cSession > 1)
+            {
+                double sessionElapsed = std::chrono::duration<double>(Clock::now() - sessionStart).count();
+                printf("All %d connections: %ld frames in %.2lfs (%.1lf frames/s)\n",
+                       cSession, cSessionFrames, sessionElapsed, cSessionFrames / std::max(0.001, sessionElapsed));
+            }
+        }
+    }
+}
+
+static void Usage()
+{
+    fprintf(stderr,
+        "Usage: framesender <host> [options]\n"
+        "       framesender --listen [--port n]\n"
+        "\n"
+        "  --port n          TCP port (49152)\n"
+        "  --leds n          pixels per frame (144)\n"
+        "  --channel n       channel mask for the frames (1)\n"
+        "  --fps n           frames per second to send (30)\n"
+        "  --frames n        frames to send, or\n"
+        "  --seconds n       how long to send for (10)\n"
+        "  --lead n          seconds in the future to timestamp frames (0.5)\n"
+        "  --format f        rgb, rgb565, palette or delta (rgb)\n"
+        "  --keyframe n      with delta, send a full frame every n frames (30)\n"
+        "  --batch n         send rgb frames n at a time as a PIXELBATCH64 (1)\n"
+        "  --compress        compress every packet\n"
+        "  --peaks n         also send PEAKDATA with n bands for every packet\n"
+        "  --response n      ask for SocketResponse version n (1)\n"
+        "  --input file      raw RGB frames to send instead of the test pattern\n"
+        "  --senders n       send over n connections at once and report the total (1)\n");
+}
+
+int main(int argc, char * argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char *
+        {
+            if (i + 1 >= argc)
+            {
+                Usage();
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if      (arg == "--listen")   opt.listen   = true;
+        else if (arg == "--compress") opt.compress = true;
+        else if (arg == "--port")     opt.port     = atoi(value());
+        else if (arg == "--leds")     opt.leds     = atoi(value());
+        else if (arg == "--channel")  opt.channel  = atoi(value());
+        else if (arg == "--fps")      opt.fps      = atof(value());
+        else if (arg == "--frames")   opt.frames   = atol(value());
+        else if (arg == "--seconds")  opt.seconds  = atof(value());
+        else if (arg == "--lead")     opt.lead     = atof(value());
+        else if (arg == "--format")   opt.format   = value();
+        else if (arg == "--keyframe") opt.keyframe = std::max(1, atoi(value()));
+        else if (arg == "--batch")    opt.batch    = std::max(1, atoi(value()));
+        else if (arg == "--peaks")    opt.bands    = atoi(value());
+        else if (arg == "--response") opt.response = atoi(value());
+        else if (arg == "--input")    opt.input    = value();
+        else if (arg == "--senders")  opt.senders  = std::max(1, atoi(value()));
+        else if (arg[0] != '-' && opt.host.empty())
+            opt.host = arg;
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (opt.listen)
+        return Listen(opt);
+
+    if (opt.host.empty() || opt.leds <= 0 || opt.fps <= 0 ||
+        (opt.format != "rgb" && opt.format != "rgb565" && opt.format != "palette" && opt.format != "delta"))
+    {
+        Usage();
+        return 1;
+    }
+
+    if (opt.senders == 1)
+    {
+        long cFrames;
+        double seconds;
+        return Send(opt, cFrames, seconds);
+    }
+
+    // Each sender sends its own copy of the stream, so the total is how many frames the receiver took in
+
+    std::vector<std::thread> threads;
+    std::vector<long>        frames(opt.senders);
+    std::vector<double>      seconds(opt.senders);
+    std::atomic<int>         cFailed { 0 };
+    for (int i = 0; i < opt.senders; i++)
+        threads.emplace_back([&, i] { if (Send(opt, frames[i], seconds[i]) != 0) cFailed++; });
+    for (auto & thread : threads)
+        thread.join();
+
+    long   cTotal  = 0;
+    double longest = 0;
+    for (int i = 0; i < opt.senders; i++)
+    {
+        cTotal += frames[i];
+        longest = std::max(longest, seconds[i]);
+    }
+    printf("%d senders: %ld frames in %.2lfs, %.1lf frames/s in total\n", opt.senders, cTotal, longest, cTotal / std::max(0.001, longest));
+    return cFailed ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+// inflatebench.cpp
+//
+// Times how a compressed PIXELDATA64 frame gets from the socket server's receive buffer into an LEDBuffer, the
+// way SocketServer used to do it and the way it does now.  It's built on a PC against the same uzlib the chip
+// uses, with zlib only there to compress the test frames:
+//
+//   g++ -std=c++17 -O2 -o inflatebench tools/inflatebench.cpp -lz
+//   ./inflatebench [packets]
+//
+// "Copy" is the old path:  with USE_PSRAM the whole receive buffer was first copied to a freshly allocated
+// staging buffer, then the packet was inflated to the output buffer and its pixels copied from there into the
+// LEDBuffer.  "In place" is the new one:  the 24-byte data header is inflated first, put in front of the
+// LEDBuffer's pixels, and the rest of the stream is inflated straight in behind it.  Both are run over the same
+// frames of a moving pattern, for a 64x32 matrix and a 1200-LED strip, and the pixels they produce are checked
+// against each other.  Bytes copied counts everything moved besides what the inflater itself writes.  PSRAM is
+// slower to copy through than a PC's memory, so on the chip the staging copy costs more than it does here.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+extern "C"
+{
+    #include "../src/uzlib/src/tinflate.c"
+    #include "../src/uzlib/src/tinfzlib.c"
+    #include "../src/uzlib/src/adler32.c"
+    #include "../src/uzlib/src/crc32.c"
+}
+
+using Clock = std::chrono::steady_clock;
+
+// These match socketserver.h
+
+#define WIFI_COMMAND_PIXELDATA64    3
+#define STANDARD_DATA_HEADER_SIZE   24
+#define COMPRESSED_HEADER_SIZE      16
+#define COMPRESSED_HEADER           0x44415645
+#define LED_DATA_SIZE               3
+
+static void PutBytes(std::vector<uint8_t> & out, uint64_t value, int cb)
+{
+    for (int i = 0; i < cb; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+static uint32_t DWORDFromMemory(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+
+// CompressedFrame
+//
+// A PIXELDATA64 packet of a plasma-like pattern that moves from frame to frame, compressed behind a DAVE header
+
+static std::vector<uint8_t> CompressedFrame(int cLeds, int iFrame)
+{
+    std::vector<uint8_t> packet;
+    PutBytes(packet, WIFI_COMMAND_PIXELDATA64, 2);
+    PutBytes(packet, 1, 2);
+    PutBytes(packet, cLeds, 4);
+    PutBytes(packet, 1700000000 + iFrame / 60, 8);
+    PutBytes(packet, (iFrame % 60) * 16667, 8);
+    for (int i = 0; i < cLeds; i++)
+    {
+        double t = iFrame * 0.05;
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.11 + t)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.07 - t * 1.3)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.05 + t * 0.7)));
+    }
+
+    uLongf cbCompressed = compressBound(packet.size());
+    std::vector<uint8_t> compressed(cbCompressed);
+    compress2(compressed.data(), &cbCompressed, packet.data(), packet.size(), Z_BEST_COMPRESSION);
+
+    std::vector<uint8_t> out;
+    PutBytes(out, COMPRESSED_HEADER, 4);
+    PutBytes(out, cbCompressed, 4);
+    PutBytes(out, packet.size(), 4);
+    PutBytes(out, 0x12345678, 4);
+    out.insert(out.end(), compressed.begin(), compressed.begin() + cbCompressed);
+    return out;
+}
+
+// InitDecompressor and InflateInto are SocketServer's
+
+static bool InitDecompressor(struct uzlib_uncomp & d, const uint8_t * pBuffer, size_t cBuffer)
+{
+    uzlib_uncompress_init(&d, NULL, 0);
+    d.source         = pBuffer;
+    d.source_limit   = pBuffer + cBuffer;
+    d.source_read_cb = nullptr;
+    return uzlib_zlib_parse_header(&d) >= 0;
+}
+
+static bool InflateInto(struct uzlib_uncomp & d, uint8_t * pStart, uint8_t * pOutput, size_t cbOutput, bool bFinal)
+{
+    d.dest_start = pStart;
+    d.dest       = pOutput;
+    d.dest_limit = pOutput + cbOutput + (bFinal ? 1 : 0);
+
+    int res = uzlib_uncompress_chksum(&d);
+    return res == (bFinal ? TINF_DONE : TINF_OK) && (size_t) (d.dest - pOutput) == cbOutput;
+}
+
+// CopyPath
+//
+// The old path, from the receive buffer to the LEDBuffer's pixels
+
+static bool CopyPath(const uint8_t * pReceive, size_t cbMaxPacket, uint8_t * pOutput, uint8_t * pLeds, size_t & cbCopied)
+{
+    auto pStaging = std::make_unique<uint8_t []>(cbMaxPacket);
+    memcpy(pStaging.get(), pReceive, cbMaxPacket);
+    cbCopied += cbMaxPacket;
+
+    uint32_t compressedSize = DWORDFromMemory(&pStaging[4]);
+    uint32_t expandedSize   = DWORDFromMemory(&pStaging[8]);
+
+    struct uzlib_uncomp d = { 0 };
+    if (!InitDecompressor(d, &pStaging[COMPRESSED_HEADER_SIZE], compressedSize) || !InflateInto(d, pOutput, pOutput, expandedSize, true))
+        return false;
+
+    size_t cbPixels = DWORDFromMemory(&pOutput[4]) * LED_DATA_SIZE;
+    memcpy(pLeds, pOutput + STANDARD_DATA_HEADER_SIZE, cbPixels);
+    cbCopied += cbPixels;
+    return true;
+}
+
+// InPlacePath
+//
+// The new path, where pStorage is the LEDBuffer's wire storage:  a header's worth of room in front of its pixels
+
+static bool InPlacePath(const uint8_t * pReceive, uint8_t * pOutput, uint8_t * pStorage, size_t & cbCopied)
+{
+    uint32_t compressedSize = DWORDFromMemory(&pReceive[4]);
+    uint32_t expandedSize   = DWORDFromMemory(&pReceive[8]);
+
+    struct uzlib_uncomp d = { 0 };
+    if (!InitDecompressor(d, &pReceive[COMPRESSED_HEADER_SIZE], compressedSize) || !InflateInto(d, pOutput, pOutput, STANDARD_DATA_HEADER_SIZE, false))
+        return false;
+
+    memmove(pStorage, pOutput, STANDARD_DATA_HEADER_SIZE);
+    cbCopied += STANDARD_DATA_HEADER_SIZE;
+    return InflateInto(d, pStorage, pStorage + STANDARD_DATA_HEADER_SIZE, expandedSize - STANDARD_DATA_HEADER_SIZE, true);
+}
+
+int main(int argc, char * argv[])
+{
+    int cPackets = argc > 1 ? atoi(argv[1]) : 2000;
+    if (cPackets <= 0)
+    {
+        fprintf(stderr, "Usage: inflatebench [packets]\n");
+        return 1;
+    }
+
+    const struct { const char * name; int cLeds; } layouts[] =
+    {
+        { "64x32 matrix",    64 * 32 },
+        { "1200-LED strip",  1200    },
+    };
+
+    const int cDistinct = 120;                                  // Frames in the loop, two seconds of them at 60fps
+    bool bAllOK = true;
+
+    for (auto layout : layouts)
+    {
+        const size_t cbMaxPacket = STANDARD_DATA_HEADER_SIZE + LED_DATA_SIZE * layout.cLeds;   // MAXIUMUM_PACKET_SIZE
+
+        std::vector<std::vector<uint8_t>> frames;
+        size_t cbCompressed = 0;
+        for (int i = 0; i < cDistinct; i++)
+        {
+            frames.push_back(CompressedFrame(layout.cLeds, i));
+            cbCompressed += frames.back().size();
+            frames.back().resize(std::max(frames.back().size(), cbMaxPacket));        // The receive buffer is always this big
+        }
+
+        std::vector<uint8_t> output(cbMaxPacket + 1), leds(LED_DATA_SIZE * layout.cLeds);
+        std::vector<uint8_t> storage(cbMaxPacket + 1);
+
+        // Check the two agree before timing them
+
+        for (auto & frame : frames)
+        {
+            size_t cbIgnored = 0;
+            if (!CopyPath(frame.data(), cbMaxPacket, output.data(), leds.data(), cbIgnored) ||
+                !InPlacePath(frame.data(), output.data(), storage.data(), cbIgnored) ||
+                0 != memcmp(leds.data(), storage.data() + STANDARD_DATA_HEADER_SIZE, leds.size()))
+            {
+                printf("%s: the two paths disagree\n", layout.name);
+                bAllOK = false;
+                break;
+            }
+        }
+
+        size_t cbCopyPath = 0, cbInPlacePath = 0;
+
+        auto start = Clock::now();
+        for (int i = 0; i < cPackets; i++)
+            CopyPath(frames[i % cDistinct].data(), cbMaxPacket, output.data(), leds.data(), cbCopyPath);
+        double usCopy = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / cPackets;
+
+        start = Clock::now();
+        for (int i = 0; i < cPackets; i++)
+            InPlacePath(frames[i % cDistinct].data(), output.data(), storage.data(), cbInPlacePath);
+        double usInPlace = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / cPackets;
+
+        printf("%-15s %5d LEDs, %5zu bytes compressed:  copy %7.1lfus, %6zu bytes copied, 1 allocation;  in place %7.1lfus, %3zu bytes copied, no allocations  (%.2lfx)\n",
+               layout.name, layout.cLeds, cbCompressed / cDistinct, usCopy, cbCopyPath / cPackets, usInPlace, cbInPlacePath / cPackets, usCopy / usInPlace);
+    }
+
+    return bAllOK ? 0 : 1;
+}
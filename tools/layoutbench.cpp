@@ -0,0 +1,298 @@
+// layoutbench.cpp
+//
+// Times GFXBase's stream and blur primitives with xy() as it was, a virtual call working out the layout for every
+// pixel, and as it is now, an inline lookup in a table from ledlayout.h.  GFXBase needs the whole project, so the
+// primitives are copied here, built on a PC:
+//
+//   g++ -std=c++17 -O2 -o layoutbench tools/layoutbench.cpp
+//   ./layoutbench
+//
+// It runs them on a 64x32 HUB75 matrix (row-major) and a 144x8 matrix of zig-zagged strips (serpentine columns),
+// and for each checks that the table gives the same index as the old xy() for every pixel and that the primitives
+// leave the same pixels either way.  It exits with a non-zero status if anything differs.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../include/ledlayout.h"
+
+using Clock = std::chrono::steady_clock;
+
+// CRGB
+//
+// Just the parts of FastLED's the primitives use, done the way FastLED does them
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    static uint8_t qadd8(uint8_t i, uint8_t j)
+    {
+        unsigned t = i + j;
+        return t > 255 ? 255 : t;
+    }
+
+    static uint8_t scale8(uint8_t i, uint8_t scale)
+    {
+        return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+    }
+
+    CRGB & operator+=(const CRGB & rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB & nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+};
+
+// OldMatrix, OldStrip
+//
+// xy() as LEDMatrixGFX and GFXBase had it, virtual and worked out from the size each time
+
+class OldGFX
+{
+  public:
+    size_t _width, _height;
+
+    OldGFX(size_t w, size_t h) : _width(w), _height(h) { }
+    virtual ~OldGFX() { }
+    virtual uint16_t xy(uint16_t x, uint16_t y) const = 0;
+};
+
+class OldMatrix : public OldGFX
+{
+  public:
+    using OldGFX::OldGFX;
+
+    uint16_t xy(uint16_t x, uint16_t y) const override
+    {
+        return y * _width + x;
+    }
+};
+
+class OldStrip : public OldGFX
+{
+  public:
+    using OldGFX::OldGFX;
+
+    uint16_t xy(uint16_t x, uint16_t y) const override
+    {
+        if (x & 0x01)
+        {
+            uint8_t reverseY = (_height - 1) - y;
+            return (x * _height) + reverseY;
+        }
+        return (x * _height) + y;
+    }
+};
+
+// Made out of line, so the compiler can't see which OldGFX it is and skip the vtable as it couldn't on the chip
+
+__attribute__((noinline)) static std::unique_ptr<OldGFX> MakeOld(bool bStrip, size_t w, size_t h)
+{
+    if (bStrip)
+        return std::make_unique<OldStrip>(w, h);
+    return std::make_unique<OldMatrix>(w, h);
+}
+
+// Primitives
+//
+// StreamRight, StreamDown, StreamUpAndLeft, blurRows and blurColumns as GFXBase has them, with xy() passed in
+
+template <int W, int H, typename XY>
+static void StreamRight(CRGB * leds, XY xy, uint8_t scale)
+{
+    for (int x = 1; x < W; x++)
+    {
+        for (int y = 0; y < H; y++)
+        {
+            leds[xy(x, y)] += leds[xy(x - 1, y)];
+            leds[xy(x, y)].nscale8(scale);
+        }
+    }
+    for (int y = 0; y < H; y++)
+        leds[xy(0, y)].nscale8(scale);
+}
+
+template <int W, int H, typename XY>
+static void StreamDown(CRGB * leds, XY xy, uint8_t scale)
+{
+    for (int x = 0; x < W; x++)
+    {
+        for (int y = 1; y < H; y++)
+        {
+            leds[xy(x, y)] += leds[xy(x, y - 1)];
+            leds[xy(x, y)].nscale8(scale);
+        }
+    }
+    for (int x = 0; x < W; x++)
+        leds[xy(x, 0)].nscale8(scale);
+}
+
+template <int W, int H, typename XY>
+static void StreamUpAndLeft(CRGB * leds, XY xy, uint8_t scale)
+{
+    for (int x = 0; x < W - 1; x++)
+    {
+        for (int y = H - 2; y >= 0; y--)
+        {
+            leds[xy(x, y)] += leds[xy(x + 1, y + 1)];
+            leds[xy(x, y)].nscale8(scale);
+        }
+    }
+    for (int x = 0; x < W; x++)
+        leds[xy(x, H - 1)].nscale8(scale);
+    for (int y = 0; y < H; y++)
+        leds[xy(W - 1, y)].nscale8(scale);
+}
+
+template <int W, int H, typename XY>
+static void blurRows(CRGB * leds, XY xy, uint8_t first, uint8_t blur_amount)
+{
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    for (uint8_t row = 0; row < H; row++)
+    {
+        CRGB carryover = { 0, 0, 0 };
+        for (uint8_t i = first; i < W; i++)
+        {
+            CRGB cur = leds[xy(i, row)];
+            CRGB part = cur;
+            part.nscale8(seep);
+            cur.nscale8(keep);
+            cur += carryover;
+            if (i)
+                leds[xy(i - 1, row)] += part;
+            leds[xy(i, row)] = cur;
+            carryover = part;
+        }
+    }
+}
+
+template <int W, int H, typename XY>
+static void blurColumns(CRGB * leds, XY xy, uint8_t first, uint8_t blur_amount)
+{
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    for (uint8_t col = 0; col < W; ++col)
+    {
+        CRGB carryover = { 0, 0, 0 };
+        for (uint8_t i = first; i < H; ++i)
+        {
+            CRGB cur = leds[xy(col, i)];
+            CRGB part = cur;
+            part.nscale8(seep);
+            cur.nscale8(keep);
+            cur += carryover;
+            if (i)
+                leds[xy(col, i - 1)] += part;
+            leds[xy(col, i)] = cur;
+            carryover = part;
+        }
+    }
+}
+
+template <int W, int H, typename XY>
+static void RunAll(CRGB * leds, XY xy)
+{
+    StreamRight<W, H>(leds, xy, 200);
+    StreamDown<W, H>(leds, xy, 200);
+    StreamUpAndLeft<W, H>(leds, xy, 200);
+    blurRows<W, H>(leds, xy, 0, 64);
+    blurColumns<W, H>(leds, xy, 1, 64);
+}
+
+template <typename Layout>
+static bool Bench(const char * name, bool bStrip, std::mt19937 & random)
+{
+    constexpr int W = Layout::Width, H = Layout::Height;
+    using Table = LayoutTable<Layout>;
+    auto pOld = MakeOld(bStrip, W, H);
+    bool bOK = true;
+
+    for (int x = 0; x < W; x++)
+        for (int y = 0; y < H; y++)
+            if (Table::XY(x, y) != pOld->xy(x, y))
+                bOK = false;
+
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<CRGB> start(W * H);
+    for (auto & pixel : start)
+        pixel = { (uint8_t) byte(random), (uint8_t) byte(random), (uint8_t) byte(random) };
+
+    auto oldXY = [&](uint16_t x, uint16_t y) { return pOld->xy(x, y); };
+    auto newXY = [](uint16_t x, uint16_t y) { return Table::XY(x, y); };
+
+    std::vector<CRGB> before = start, after = start;
+    const int passes = 5000;
+
+    auto t0 = Clock::now();
+    for (int pass = 0; pass < passes; pass++)
+        RunAll<W, H>(before.data(), oldXY);
+    double usOld = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / passes;
+
+    t0 = Clock::now();
+    for (int pass = 0; pass < passes; pass++)
+        RunAll<W, H>(after.data(), newXY);
+    double usNew = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / passes;
+
+    if (memcmp(before.data(), after.data(), sizeof(CRGB) * W * H))
+        bOK = false;
+
+    printf("%-28s %s: virtual xy %7.2fus, %s %7.2fus per pass (%.1fx faster)%s\n", name, Table::IsRowMajor ? "row-major " : "table     ",
+           usOld, Table::IsRowMajor ? "inline" : "lookup", usNew, usOld / usNew, bOK ? "" : ", DIFFERENT PIXELS");
+    return bOK;
+}
+
+template <typename Layout>
+static bool CheckCoverage(const char * name)
+{
+    using Table = LayoutTable<Layout>;
+    std::vector<int> hits(Table::Count);
+
+    for (uint16_t y = 0; y < Table::Height; y++)
+        for (uint16_t x = 0; x < Table::Width; x++)
+            if (Table::XY(x, y) < Table::Count)
+                hits[Table::XY(x, y)]++;
+
+    for (int cHits : hits)
+    {
+        if (cHits != 1)
+        {
+            printf("FAILED: the %s layout doesn't reach every pixel once\n", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::mt19937 random(12345);
+    bool bAllOK = true;
+
+    bAllOK = Bench<RowMajorLayout<64, 32>>("64x32 matrix", false, random) && bAllOK;
+    bAllOK = Bench<SerpentineColumnLayout<144, 8>>("144x8 serpentine strips", true, random) && bAllOK;
+
+    // The other layouts have nothing to compare against, but should still reach every pixel exactly once
+
+    bAllOK = CheckCoverage<TiledLayout<SerpentineRowLayout<16, 16>, 4, 2>>("tiled") && bAllOK;
+    bAllOK = CheckCoverage<RotatedLayout<SerpentineColumnLayout<8, 32>, 1>>("rotated") && bAllOK;
+
+    printf(bAllOK ? "Every layout matched\n" : "FAILED\n");
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+// lifebench.cpp
+//
+// Checks LifeWorld against the world PatternLife used to keep, a Cell per pixel, and times how many generations a
+// second each can play, loop checks included.  It's built on a PC, since LifeWorld doesn't depend on anything else
+// in the project:
+//
+//   g++ -std=c++17 -O2 -o lifebench tools/lifebench.cpp
+//   ./lifebench
+//
+// The Cell side is a copy of what PatternLife's Draw did each generation:  copy the alive bits out to CRC them,
+// shift the window of CRCs along and look back through it, count each cell's neighbours with eight wrapped lookups,
+// and copy the new generation into place.  The LifeWorld side CRCs the packed cells into a ring and steps.  Both are
+// seeded the way PatternLife seeds them, and for a 64x32 matrix as on the Mesmerizer and sizes that don't fill whole
+// words, they must agree on every cell's life, hue and brightness in every generation, with the world dimmed every
+// so often as it is before a restart.  It exits with a non-zero status if they ever don't.
+//
+// The Cell world faded dead cells by a quarter each generation, but a cell went dark as it died and started out
+// dark if it was dead, so there was never anything to fade.  LifeWorld leaves that out; the comparison shows the
+// difference never shows.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "../include/lifeworld.h"
+
+using Clock = std::chrono::steady_clock;
+
+// uzlib_crc32, as it is in src/uzlib/src/crc32.c
+
+static uint32_t uzlib_crc32(const void * data, unsigned int length, uint32_t crc)
+{
+    static const uint32_t tinf_crc32tab[16] =
+    {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+
+    const unsigned char * buf = (const unsigned char *) data;
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        crc ^= buf[i];
+        crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+        crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+    }
+    return crc;
+}
+
+const unsigned int density = 50;
+
+// CellLife
+//
+// PatternLife's world as it was
+
+class Cell
+{
+public:
+  uint8_t alive : 1;
+  uint8_t prev  : 1;
+  uint8_t hue;
+  uint8_t brightness;
+};
+
+template <int W, int H>
+struct CellLife
+{
+    static constexpr int CRC_LENGTH = std::max(W, H);
+
+    std::unique_ptr<Cell [][H]> world = std::make_unique<Cell[][H]>(W);
+    std::unique_ptr<uint32_t []> checksums = std::make_unique<uint32_t []>(CRC_LENGTH);
+    int cLoops = 0;
+
+    void Seed(unsigned seed)
+    {
+        srand(seed);
+        for (int i = 0; i < W; i++) {
+            for (int j = 0; j < H; j++) {
+                if ((rand() % 100) < (int) density) {
+                    world[i][j].alive = 1;
+                    world[i][j].brightness = 128;
+                }
+                else {
+                    world[i][j].alive = 0;
+                    world[i][j].brightness = 0;
+                }
+                world[i][j].prev = world[i][j].alive;
+                world[i][j].hue = 0;
+            }
+        }
+        for (int i = 0; i < CRC_LENGTH; i++)
+            checksums[i] = 0xFFFFFFF;
+    }
+
+    int neighbours(int x, int y) {
+        return (world[(x + 1) % W][y].prev) +
+            (world[x][(y + 1) % H].prev) +
+            (world[(x + W - 1) % W][y].prev) +
+            (world[x][(y + H - 1) % H].prev) +
+            (world[(x + 1) % W][(y + 1) % H].prev) +
+            (world[(x + W - 1) % W][(y + 1) % H].prev) +
+            (world[(x + W - 1) % W][(y + H - 1) % H].prev) +
+            (world[(x + 1) % W][(y + H - 1) % H].prev);
+    }
+
+    void Dim()
+    {
+        for (int x = 0; x < W; x++)
+            for (int y = 0; y < H; y++)
+                world[x][y].brightness *= 0.9;
+    }
+
+    void Generation()
+    {
+        bool alive[W][H];
+        for (int i = 0; i < W; i++)
+            for (int j = 0; j < H; j++)
+                alive[i][j] = world[i][j].alive;
+
+        auto crc = uzlib_crc32(alive, sizeof(alive), 0xffffffff);
+        for (int i = 0; i < CRC_LENGTH - 1; i++)
+            checksums[i] = checksums[i+1];
+        checksums[CRC_LENGTH - 1] = crc;
+
+        for (int i = CRC_LENGTH - 2; i >= 0; i--)
+        {
+            if (checksums[i] == crc)
+                cLoops++;
+            if (checksums[i] == 0xFFFFFFF)
+                break;
+        }
+
+        for (int x = 0; x < W; x++) {
+            for (int y = 0; y < H; y++) {
+                if (world[x][y].brightness > 0 && world[x][y].prev == 0)
+                  world[x][y].brightness *= 0.75;
+
+                int count = neighbours(x, y);
+                if (count == 3 && world[x][y].prev == 0) {
+                    world[x][y].alive = 1;
+                    world[x][y].hue += 1;
+                    world[x][y].brightness = 255;
+                } else if ((count < 2 || count > 3) && world[x][y].prev == 1) {
+                    world[x][y].alive = 0;
+                    world[x][y].brightness = 0;
+                }
+            }
+        }
+
+        for (int x = 0; x < W; x++)
+            for (int y = 0; y < H; y++)
+                world[x][y].prev = world[x][y].alive;
+    }
+};
+
+// PackedLife
+//
+// PatternLife's world as it is now
+
+template <int W, int H>
+struct PackedLife
+{
+    static constexpr int CRC_LENGTH = std::max(W, H);
+
+    std::unique_ptr<LifeWorld<W, H>> world = std::make_unique<LifeWorld<W, H>>();
+    std::unique_ptr<uint32_t []> checksums = std::make_unique<uint32_t []>(CRC_LENGTH);
+    int iChecksum = 0;
+    int cLoops = 0;
+
+    void Seed(unsigned seed)
+    {
+        srand(seed);
+        world->Clear();
+        for (int i = 0; i < W; i++) {
+            for (int j = 0; j < H; j++) {
+                bool bAlive = (rand() % 100) < (int) density;
+                world->Set(i, j, bAlive, bAlive ? 128 : 0);
+            }
+        }
+        for (int i = 0; i < CRC_LENGTH; i++)
+            checksums[i] = 0xFFFFFFF;
+        iChecksum = 0;
+    }
+
+    void Dim()
+    {
+        world->Dim();
+    }
+
+    void Generation()
+    {
+        auto crc = uzlib_crc32(world->Cells(), world->CellsSize(), 0xffffffff);
+        const int iCurrent = iChecksum;
+        checksums[iCurrent] = crc;
+        iChecksum = (iChecksum + 1) % CRC_LENGTH;
+
+        for (int n = 1; n < CRC_LENGTH; n++)
+        {
+            auto past = checksums[(iCurrent + CRC_LENGTH - n) % CRC_LENGTH];
+            if (past == crc)
+            {
+                cLoops++;
+                break;
+            }
+            if (past == 0xFFFFFFF)
+                break;
+        }
+
+        world->Step();
+    }
+};
+
+// Check
+//
+// Plays both worlds from a few seeds, comparing them after every generation
+
+template <int W, int H>
+static int Check()
+{
+    int cFailures = 0;
+    const unsigned seeds[] = { 130908, 1576, 291864, 241590764, 555109764, 12345 };
+
+    for (unsigned seed : seeds)
+    {
+        CellLife<W, H> before;
+        PackedLife<W, H> after;
+        before.Seed(seed);
+        after.Seed(seed);
+
+        for (int generation = 0; generation < 500 && !cFailures; generation++)
+        {
+            for (int x = 0; x < W; x++)
+            {
+                for (int y = 0; y < H; y++)
+                {
+                    const Cell & cell = before.world[x][y];
+                    if (cell.alive != after.world->IsAlive(x, y) || cell.hue != after.world->Hue(x, y) ||
+                        cell.brightness != after.world->Brightness(x, y))
+                    {
+                        if (cFailures++ < 10)
+                            printf("FAILED: %dx%d from seed %u, generation %d, cell %d, %d\n", W, H, seed, generation, x, y);
+                    }
+                }
+            }
+
+            if (generation % 97 == 96)
+            {
+                before.Dim();
+                after.Dim();
+            }
+            before.Generation();
+            after.Generation();
+        }
+    }
+    return cFailures;
+}
+
+// Time
+//
+// Generations a second each world plays at
+
+template <typename World>
+static double Time(int generations)
+{
+    World world;
+    world.Seed(130908);
+
+    auto start = Clock::now();
+    for (int generation = 0; generation < generations; generation++)
+        world.Generation();
+    return generations / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <int W, int H>
+static void Bench(int generations)
+{
+    double before = Time<CellLife<W, H>>(generations);
+    double after  = Time<PackedLife<W, H>>(generations);
+    printf("%4dx%-4d Cell per pixel %9.0f gen/s, LifeWorld %9.0f gen/s, %.1fx faster\n", W, H, before, after, after / before);
+}
+
+int main()
+{
+    int cFailures = Check<64, 32>() + Check<32, 16>() + Check<37, 19>() + Check<100, 50>() + Check<7, 5>();
+
+    Bench<32, 16>(20000);
+    Bench<64, 32>(5000);
+    Bench<128, 64>(1000);
+    Bench<256, 128>(300);
+
+    printf(cFailures ? "%d cells FAILED\n" : "LifeWorld played every generation just as the Cell world did\n", cFailures);
+    return cFailures ? 1 : 0;
+}
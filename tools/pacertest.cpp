@@ -0,0 +1,160 @@
+// pacertest.cpp
+//
+// Long-run frame rate check for FramePacer, the draw loop's pacing.  The pacer is run on a simulated clock and
+// scheduler tick rather than the PC's own, so every run comes out the same whatever else the PC is doing:
+//
+//   g++ -std=c++17 -O2 -o pacertest tools/pacertest.cpp
+//   ./pacertest [seconds per rate]
+//
+// The simulated tick is 1ms, as the chip's is.  Blocking for n ticks wakes on the nth tick edge from now, plus a
+// wake-up delay of up to 40us, reading the clock takes 1us, and once in a while another task holds on to the CPU
+// for an extra tick before we get it back.  For each of several target rates, a stand-in for the draw loop
+// "draws" for a random part of each frame interval and then lets the pacer wait for the next one.  The same loop
+// is then run with the pacing the draw loop used to have, which slept for the whole milliseconds left in the
+// frame and then one more.  It fails if the pacer's long-run frame rate is more than 0.05% off any target, if it
+// misses a deadline, or if any frame interval comes out more than a tick and a half off.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "../include/timebase.h"
+
+// SimulatedClock
+//
+// Stands in for SchedulerClock.  Time only moves when something reads the clock, blocks or draws.
+
+struct SimulatedClock
+{
+    static constexpr uint64_t usTick      = 1000;
+    static constexpr uint64_t usRead      = 1;              // What reading the clock costs
+    static constexpr uint64_t usWakeMax   = 40;             // Longest it takes to get going again after a tick edge
+    static constexpr int      oddsPreempt = 50;             // One block in this many wakes a tick late
+
+    static inline uint64_t     _usNow = 1000000;
+    static inline std::mt19937 _random { 12345 };
+
+    static uint64_t Now()
+    {
+        _usNow += usRead;
+        return _usNow;
+    }
+
+    static void BlockTicks(uint32_t cTicks)
+    {
+        if (std::uniform_int_distribution<int>(1, oddsPreempt)(_random) == 1)
+            cTicks++;
+        _usNow = (_usNow / usTick + cTicks) * usTick + std::uniform_int_distribution<uint64_t>(0, usWakeMax)(_random);
+    }
+
+    static void Spend(uint64_t us)
+    {
+        _usNow += us;
+    }
+};
+
+#define FRAME_PACER_CLOCK SimulatedClock
+#include "../include/framepacer.h"
+
+FramePacer g_FramePacer;
+
+// How DelayUntilNextFrame used to do it:  delay() the whole milliseconds left, then delay(1) at the end of the loop
+
+static void LegacyDelay(uint64_t usFrameStart, uint32_t framesPerSecond)
+{
+    float minimumFrameTime = 1.0f / framesPerSecond;
+    float elapsed = Timebase::SecondsBetween(usFrameStart, SimulatedClock::Now());
+    if (elapsed < minimumFrameTime)
+    {
+        uint32_t ms = (minimumFrameTime - elapsed) * 1000;
+        if (ms)
+            SimulatedClock::BlockTicks(ms);
+    }
+    SimulatedClock::BlockTicks(1);
+}
+
+// Run
+//
+// Draws frames at framesPerSecond for the given simulated time and returns the frame rate achieved.  For the
+// pacer, it also checks that no deadline was missed and that no interval came out too far off.
+
+static double Run(uint32_t framesPerSecond, double seconds, bool bLegacy, std::mt19937 & random, bool & bOK)
+{
+    FramePacer pacer;
+    uint64_t   usInterval = Timebase::MicrosPerSecond / framesPerSecond;
+    std::uniform_int_distribution<uint64_t> work(usInterval / 10, usInterval / 2);
+
+    uint64_t usStart = SimulatedClock::Now();
+    uint64_t usEnd   = usStart + seconds * Timebase::MicrosPerSecond;
+    uint64_t usFirst = 0;
+    uint64_t usLast  = 0;
+    uint64_t cFrames = 0;
+
+    while (SimulatedClock::Now() < usEnd)
+    {
+        uint64_t usFrameStart = SimulatedClock::Now();
+        if (!usFirst)
+            usFirst = usFrameStart;
+        else
+            cFrames++;
+        usLast = usFrameStart;
+
+        SimulatedClock::Spend(work(random));
+
+        if (bLegacy)
+            LegacyDelay(usFrameStart, framesPerSecond);
+        else
+            pacer.WaitForLocalFrame(framesPerSecond, usFrameStart);
+    }
+
+    double fps = cFrames / Timebase::SecondsBetween(usFirst, usLast);
+    if (bLegacy)
+    {
+        printf("  legacy: %8.3f fps\n", fps);
+        return fps;
+    }
+
+    printf("  paced:  %8.3f fps  interval error avg %5uus  max %6uus  missed %u\n", fps, pacer.AverageError(), pacer.MaxError(), pacer.MissedDeadlines());
+
+    if (std::fabs(fps - framesPerSecond) > framesPerSecond * 0.0005)
+    {
+        printf("  FAILED: paced rate is off by %.3f%%\n", 100.0 * (fps - framesPerSecond) / framesPerSecond);
+        bOK = false;
+    }
+    if (pacer.MissedDeadlines())
+    {
+        printf("  FAILED: %u deadlines were missed\n", pacer.MissedDeadlines());
+        bOK = false;
+    }
+    if (pacer.MaxError() > SimulatedClock::usTick * 3 / 2)
+    {
+        printf("  FAILED: an interval was %uus off\n", pacer.MaxError());
+        bOK = false;
+    }
+    return fps;
+}
+
+int main(int argc, char * argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 60.0;
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "Usage: pacertest [seconds per rate]\n");
+        return 1;
+    }
+
+    std::mt19937 random(12345);
+    bool bOK = true;
+
+    for (uint32_t framesPerSecond : { 24, 30, 60, 120, 144, 240 })
+    {
+        printf("Target %u fps:\n", framesPerSecond);
+        Run(framesPerSecond, seconds, false, random, bOK);
+        Run(framesPerSecond, seconds, true, random, bOK);
+    }
+
+    printf(bOK ? "Paced frame rates were all within 0.05%% of target, with no missed deadlines\n" : "FAILED\n");
+    return bOK ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// pipelinesim.cpp
+//
+// Simulates the draw loop with and without PIPELINED_OUTPUT, with threads standing in for the draw and output
+// tasks.  Build and run it on a PC with:
+//
+//   g++ -std=c++17 -O2 -pthread -o pipelinesim tools/pipelinesim.cpp
+//   ./pipelinesim [seconds per case]
+//
+// Rendering spins, since it's CPU work, and showing sleeps, since on the chip it's the RMT clocking the pixels
+// out while the CPU waits.  For several render and show times, it runs the serial loop the draw task used to
+// have and then the pipelined one, which draws into one of two buffers while the other is shown.  Each frame is
+// filled with its own number, and the output side checks that every frame it's given is whole and comes right
+// after the last, so a buffer reused too early shows up as a torn or skipped frame.  It fails if any frame does.
+// The frame rates are printed alongside the rate of the slower stage alone for comparison, but they depend on how
+// busy the PC is and how promptly it wakes sleeping threads, so they don't decide whether it passes.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../include/framehandoff.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t cPixels = 1024;
+
+// Spin
+//
+// Keeps the CPU busy, but yields as it goes so that on a PC with only one core, the output thread still gets to
+// run the moment it wakes, as it would on the ESP32's other core
+
+static void Spin(std::chrono::microseconds us)
+{
+    auto end = Clock::now() + us;
+    while (Clock::now() < end)
+        std::this_thread::yield();
+}
+
+static void Render(std::vector<uint32_t> & buffer, uint32_t frame, std::chrono::microseconds us)
+{
+    Spin(us);
+    std::fill(buffer.begin(), buffer.end(), frame);
+}
+
+// Show
+//
+// Stands in for FastLED.show, and checks the frame it's given as it goes
+
+static bool Show(const std::vector<uint32_t> & buffer, uint32_t & lastFrame, std::chrono::microseconds us)
+{
+    uint32_t frame = buffer[0];
+    bool bOK = frame == lastFrame + 1;
+    std::this_thread::sleep_for(us / 2);
+    bOK = bOK && std::all_of(buffer.begin(), buffer.end(), [frame](uint32_t pixel) { return pixel == frame; });
+    std::this_thread::sleep_for(us / 2);
+    lastFrame = frame;
+    return bOK;
+}
+
+static double RunSerial(std::chrono::microseconds usRender, std::chrono::microseconds usShow, double seconds, bool & bOK)
+{
+    std::vector<uint32_t> buffer(cPixels);
+    uint32_t frame = 0, lastShown = 0;
+    auto start = Clock::now();
+    auto end   = start + std::chrono::duration<double>(seconds);
+
+    while (Clock::now() < end)
+    {
+        Render(buffer, ++frame, usRender);
+        bOK = Show(buffer, lastShown, usShow) && bOK;
+    }
+    return frame / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// RunPipelined
+//
+// Does what ShowStrip and OutputLoopTaskEntry do with PIPELINED_OUTPUT:  draw into the back buffer, wait for the
+// output side to be idle, swap, hand over the front buffer, and go straight on to the next frame
+
+static double RunPipelined(std::chrono::microseconds usRender, std::chrono::microseconds usShow, double seconds, bool & bOK, uint32_t & cWaits)
+{
+    FrameHandoff handoff;
+    std::vector<uint32_t> buffers[2] = { std::vector<uint32_t>(cPixels), std::vector<uint32_t>(cPixels) };
+    std::vector<uint32_t> * pBack  = &buffers[0];
+    std::vector<uint32_t> * pFront = &buffers[1];
+    bool bOutputOK = true;
+
+    std::thread output([&]
+    {
+        uint32_t lastShown = 0;
+        while (handoff.WaitForFrame())
+        {
+            bOutputOK = Show(*pFront, lastShown, usShow) && bOutputOK;
+            handoff.Done();
+        }
+        handoff.Done();
+    });
+
+    uint32_t frame = 0;
+    auto start = Clock::now();
+    auto end   = start + std::chrono::duration<double>(seconds);
+
+    while (Clock::now() < end)
+    {
+        Render(*pBack, ++frame, usRender);
+        handoff.WaitUntilIdle();
+        std::swap(pBack, pFront);
+        handoff.Submit(cPixels);
+    }
+    handoff.WaitUntilIdle();
+    double fps = frame / std::chrono::duration<double>(Clock::now() - start).count();
+
+    handoff.Submit(0);                                  // A frame of no pixels tells the output thread to stop
+    output.join();
+
+    bOK = bOK && bOutputOK;
+    cWaits = handoff.DrawWaits();
+    return fps;
+}
+
+int main(int argc, char * argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "Usage: pipelinesim [seconds per case]\n");
+        return 1;
+    }
+
+    using us = std::chrono::microseconds;
+    const std::pair<us, us> cases[] =
+    {
+        { us(4000),  us(12000) },                       // Long strip:  showing takes most of the frame
+        { us(8000),  us(8000)  },
+        { us(12000), us(4000)  },                       // Heavy effect on a short strip
+        { us(2000),  us(30000) },                       // About 1000 WS2812s
+    };
+
+    bool bAllOK = true;
+    for (auto [usRender, usShow] : cases)
+    {
+        bool     bOK = true;
+        uint32_t cWaits = 0;
+        double   serial    = RunSerial(usRender, usShow, seconds, bOK);
+        double   pipelined = RunPipelined(usRender, usShow, seconds, bOK, cWaits);
+        double   ideal     = 1e6 / std::max(usRender, usShow).count();
+
+        printf("render %5lldus, show %5lldus:  serial %6.1f fps, pipelined %6.1f fps (limit %6.1f), draw waited %u times%s\n",
+               (long long) usRender.count(), (long long) usShow.count(), serial, pipelined, ideal, cWaits, bOK ? "" : ", TORN OR SKIPPED FRAMES");
+
+        if (!bOK)
+            bAllOK = false;
+    }
+
+    printf(bAllOK ? "Every frame was shown whole and in order\n" : "FAILED\n");
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// powerbench.cpp
+//
+// Checks PowerEstimator against FastLED's power_mgt and times the two.  It runs on a PC,
+// with the power_mgt code it compares against copied in:
+//
+//   g++ -std=c++17 -O2 -o powerbench tools/powerbench.cpp
+//   ./powerbench
+//
+// The FastLED side is a copy of calculate_unscaled_power_mW and the brightness limit that
+// calculate_max_brightness_for_power_mW works out, used the way SendToStrip used to use them:  one pass over the
+// pixels for FastLED.show's power limit, one for g_Brite, and one for g_Watts.  PowerEstimator gets the same
+// three numbers from one pass.  It checks they agree for random frames of many sizes and alignments, and exits
+// with a non-zero status if any don't.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../include/powerestimator.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t maxPower_mW = 5 * 8 * 1000;
+
+// As FastLED has them
+
+static uint32_t calculate_unscaled_power_mW(const uint8_t * p, uint16_t numLeds)
+{
+    uint32_t red32 = 0, green32 = 0, blue32 = 0;
+    for (uint16_t count = numLeds; count; --count)
+    {
+        red32   += *p++;
+        green32 += *p++;
+        blue32  += *p++;
+    }
+    red32   = (red32   * PowerEstimator::Red_mW)   >> 8;
+    green32 = (green32 * PowerEstimator::Green_mW) >> 8;
+    blue32  = (blue32  * PowerEstimator::Blue_mW)  >> 8;
+    return red32 + green32 + blue32 + PowerEstimator::Dark_mW * numLeds;
+}
+
+static uint8_t calculate_max_brightness_for_power_mW(const uint8_t * p, uint16_t numLeds, uint8_t target_brightness, uint32_t max_power_mW)
+{
+    uint32_t total_mW = PowerEstimator::MCU_mW + calculate_unscaled_power_mW(p, numLeds);
+    uint32_t requested_power_mW = (total_mW * target_brightness) / 256;
+    if (requested_power_mW > max_power_mW)
+        return (target_brightness * max_power_mW) / requested_power_mW;
+    return target_brightness;
+}
+
+struct Result
+{
+    uint8_t  showBrightness;
+    uint8_t  limitedBrightness;
+    uint32_t mW;
+
+    bool operator==(const Result & other) const
+    {
+        return showBrightness == other.showBrightness && limitedBrightness == other.limitedBrightness && mW == other.mW;
+    }
+};
+
+static Result ThreePasses(const uint8_t * p, uint16_t count, uint8_t fader, uint8_t brightness)
+{
+    return { calculate_max_brightness_for_power_mW(p, count, fader, maxPower_mW),
+             calculate_max_brightness_for_power_mW(p, count, brightness, maxPower_mW),
+             calculate_unscaled_power_mW(p, count) };
+}
+
+static Result OnePass(const uint8_t * p, uint16_t count, uint8_t fader, uint8_t brightness)
+{
+    uint32_t mW = PowerEstimator::UnscaledPower_mW(PowerEstimator::SumColors(p, count));
+    return { PowerEstimator::LimitBrightness(fader, mW, maxPower_mW), PowerEstimator::LimitBrightness(brightness, mW, maxPower_mW), mW };
+}
+
+int main()
+{
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    int cFailures = 0;
+
+    // Agreement, including sizes that leave a partial group of four pixels and buffers that aren't word aligned
+
+    std::vector<uint8_t> buffer(3 * 5000 + 4);
+    for (int trial = 0; trial < 2000; trial++)
+    {
+        uint16_t count  = trial < 1000 ? trial : std::uniform_int_distribution<int>(0, 5000)(random);
+        size_t   offset = trial % 4;
+        int      scale  = trial % 3 == 0 ? 255 : byte(random);                 // Dim frames as well as bright ones
+        for (auto & b : buffer)
+            b = byte(random) * scale / 255;
+
+        uint8_t fader = byte(random), brightness = byte(random);
+        if (!(ThreePasses(&buffer[offset], count, fader, brightness) == OnePass(&buffer[offset], count, fader, brightness)))
+        {
+            printf("FAILED: %u pixels at offset %zu differ\n", count, offset);
+            cFailures++;
+        }
+    }
+
+    // Speed, on word-aligned buffers as the strips' are
+
+    for (uint16_t count : { 144, 1024, 2048, 4096 })
+    {
+        std::vector<uint8_t> frame(3 * count);
+        for (auto & b : frame)
+            b = byte(random);
+
+        const int passes = 20000;
+        volatile uint32_t sink = 0;
+
+        auto start = Clock::now();
+        for (int pass = 0; pass < passes; pass++)
+            sink = sink + ThreePasses(frame.data(), count, pass, 255).mW;
+        double usThree = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / passes;
+
+        start = Clock::now();
+        for (int pass = 0; pass < passes; pass++)
+            sink = sink + OnePass(frame.data(), count, pass, 255).mW;
+        double usOne = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / passes;
+
+        printf("%5u LEDs: three passes %7.2fus, one pass %7.2fus, %.1fx faster\n", count, usThree, usOne, usThree / usOne);
+    }
+
+    printf(cFailures ? "%d frames FAILED\n" : "PowerEstimator agreed with FastLED on every frame\n", cFailures);
+    return cFailures ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+// profilerbench.cpp
+//
+// Measures what FrameProfiler costs the draw loop.  On a PC, where the cycle counter is
+// stood in for by the steady clock:
+//
+//   g++ -std=c++17 -O2 -DENABLE_FRAME_PROFILER=1 -o profilerbench tools/profilerbench.cpp
+//   ./profilerbench
+//
+// It times a large number of empty PROFILE_STAGE scopes to get the cost of one, then works out what all the
+// stages the draw loop has would cost per frame as a share of a 60fps frame.  A PC reads its clock more slowly
+// than the ESP32 reads its cycle counter, so this overstates the cost on the chip.  It exits with a non-zero
+// status if the share comes to 1% or more, and prints the stats for one stage to show the p99 being worked out.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "../include/frameprofiler.h"
+
+#if !ENABLE_FRAME_PROFILER
+    #error Build profilerbench with -DENABLE_FRAME_PROFILER=1
+#endif
+
+FrameProfiler g_FrameProfiler;
+
+static volatile uint32_t g_sink;
+
+int main()
+{
+    const int      cScopes          = 10000000;
+    const int      cStagesPerFrame  = (int) ProfileStage::Count;
+    const double   nsFrame          = 1e9 / 60;
+
+    uint32_t start = FrameProfiler::Cycles();
+    for (int i = 0; i < cScopes; i++)
+        g_sink = i;
+    uint32_t baseline = FrameProfiler::Cycles() - start;
+
+    start = FrameProfiler::Cycles();
+    for (int i = 0; i < cScopes; i++)
+    {
+        PROFILE_STAGE(EffectDraw);
+        g_sink = i;
+    }
+    uint32_t profiled = FrameProfiler::Cycles() - start;
+
+    double nsPerScope = (double) (profiled - baseline) / cScopes;
+    double share      = 100.0 * nsPerScope * cStagesPerFrame / nsFrame;
+
+    printf("%.1fns per profiled stage, %.4f%% of a 60fps frame for %d stages\n", nsPerScope, share, cStagesPerFrame);
+
+    ProfileStats stats = g_FrameProfiler.GetStats(ProfileStage::EffectDraw);
+    printf("%s: runs %u, min %.3fus, avg %.3fus, p99 %.3fus, max %.3fus\n", stats.name, stats.count, stats.minUs, stats.avgUs, stats.p99Us, stats.maxUs);
+
+    if (share >= 1.0)
+    {
+        printf("FAILED: profiling costs 1%% of a frame or more\n");
+        return 1;
+    }
+    return 0;
+}
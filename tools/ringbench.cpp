@@ -0,0 +1,169 @@
+// ringbench.cpp
+//
+// Stress test and contention benchmark for SPSCRing, the index ring under LEDBufferManager.  It needs
+// threads, so build it with -pthread:
+//
+//   g++ -std=c++17 -O2 -pthread -o ringbench tools/ringbench.cpp
+//   ./ringbench [seconds] [leds] [slots] [fps]
+//
+// Two threads stand in for the socket and draw tasks.  The producer fills frames at the given rate, each
+// stamped with a sequence number and a matching byte pattern.  The consumer polls for frames the way the draw
+// loop does.  It checks every frame it gets is whole and newer than the last one, "draws" it by copying it
+// out, and hands it back.  Each run happens twice.  Once is lock-free, as with
+// LOCKFREE_BUFFER_RING.  The other holds a mutex around each side's work, as g_buffer_mutex does otherwise,
+// and drops the oldest frame when full.  The report covers throughput and how long each side spent waiting.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/spscring.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Frame
+{
+    uint64_t             sequence = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// NullMutex
+//
+// What g_buffer_mutex turns into with LOCKFREE_BUFFER_RING
+
+struct NullMutex
+{
+    void lock()   {}
+    void unlock() {}
+    bool try_lock() { return true; }
+};
+
+struct SideStats
+{
+    uint64_t            cOps = 0;
+    std::vector<double> waits;                      // Microseconds spent getting the lock, per frame
+
+    void Print(const char * name, double seconds)
+    {
+        std::sort(waits.begin(), waits.end());
+        double p99 = waits.empty() ? 0 : waits[std::min(waits.size() - 1, (size_t) (waits.size() * 0.99))];
+        double max = waits.empty() ? 0 : waits.back();
+        printf("  %-9s %10.0f frames/s   lock wait p99 %8.2fus  max %9.2fus\n", name, cOps / seconds, p99, max);
+    }
+};
+
+template <typename Mutex, bool bLockFree>
+static bool Run(const char * name, double seconds, size_t leds, size_t cSlots, double fps)
+{
+    SPSCRing            ring(cSlots);
+    std::vector<Frame>  frames(cSlots);
+    Mutex               mutex;
+    std::atomic<bool>   bStop { false };
+    std::atomic<long>   cErrors { 0 };
+    uint64_t            cDropped = 0;
+    SideStats           producer, consumer;
+
+    for (auto & frame : frames)
+        frame.pixels.resize(leds * 3);
+
+    std::thread producerThread([&]()
+    {
+        auto next = Clock::now();
+        for (uint64_t sequence = 1; !bStop; sequence++)
+        {
+            next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+            std::this_thread::sleep_until(next);
+
+            auto start = Clock::now();
+            std::lock_guard<Mutex> guard(mutex);
+            producer.waits.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+            size_t iSlot = 0;
+            if (!ring.TryReserve(iSlot))
+            {
+                cDropped++;
+                if (bLockFree)
+                    continue;
+                ring.DropOldest();
+                ring.TryReserve(iSlot);
+            }
+
+            Frame & frame = frames[iSlot];
+            frame.sequence = sequence;
+            memset(frame.pixels.data(), (uint8_t) sequence, frame.pixels.size());
+            ring.Commit();
+            producer.cOps++;
+        }
+    });
+
+    std::thread consumerThread([&]()
+    {
+        std::vector<uint8_t> leds(frames[0].pixels.size());
+        uint64_t lastSequence = 0;
+
+        while (!bStop)
+        {
+            auto start = Clock::now();
+            std::unique_lock<Mutex> guard(mutex);
+            double wait = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            size_t iSlot;
+            if (!ring.TryPeek(iSlot))
+            {
+                guard.unlock();
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            consumer.waits.push_back(wait);
+
+            const Frame & frame = frames[iSlot];
+            memcpy(leds.data(), frame.pixels.data(), leds.size());
+            uint64_t sequence = frame.sequence;
+            ring.Release();
+
+            bool bWhole = std::all_of(leds.begin(), leds.end(), [&](uint8_t b) { return b == (uint8_t) sequence; });
+            if (!bWhole || sequence <= lastSequence)
+                cErrors++;
+            lastSequence = sequence;
+            consumer.cOps++;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    bStop = true;
+    producerThread.join();
+    consumerThread.join();
+
+    printf("%s: %lu frames produced, %lu dropped, %lu drawn, %ld bad\n", name, (unsigned long) producer.cOps, (unsigned long) cDropped,
+           (unsigned long) consumer.cOps, cErrors.load());
+    producer.Print("producer", seconds);
+    consumer.Print("consumer", seconds);
+    return cErrors == 0;
+}
+
+int main(int argc, char * argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    size_t leds    = argc > 2 ? atoi(argv[2]) : 1024;
+    size_t cSlots  = argc > 3 ? atoi(argv[3]) : 24;
+    double fps     = argc > 4 ? atof(argv[4]) : 2000;
+
+    if (seconds <= 0 || leds == 0 || cSlots < 2 || fps <= 0)
+    {
+        fprintf(stderr, "Usage: ringbench [seconds] [leds] [slots] [fps]\n");
+        return 1;
+    }
+
+    bool bOK = Run<NullMutex, true>("Lock-free", seconds, leds, cSlots, fps);
+    bOK = Run<std::mutex, false>("Mutex", seconds, leds, cSlots, fps) && bOK;
+
+    printf(bOK ? "All frames arrived whole and in order\n" : "FAILED: some frames were torn or out of order\n");
+    return bOK ? 0 : 1;
+}
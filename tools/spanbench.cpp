@@ -0,0 +1,338 @@
+// spanbench.cpp
+//
+// Checks SpanKernels against FastLED's per-pixel nscale8, assignment, += and nblend, then times the bulk work ten
+// effects do every frame the way they used to do it and through GFXBase's span operations.  The FastLED
+// functions it checks against are copied in, so it builds on a PC:
+//
+//   g++ -std=c++17 -O2 -o spanbench tools/spanbench.cpp
+//   ./spanbench
+//
+// The effects themselves need the whole project, so each is reduced to the fades, fills and dims it does each
+// frame, at its usual size, on a stand-in for GFXBase whose setPixel and getPixel are virtual as they are on the
+// chip.  These are the effects that spend the most of their frame on that sort of bulk work; what they draw on top
+// of it isn't included.  It exits with a non-zero status if the two ways of doing anything leave different pixels.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../include/spankernels.h"
+
+using Clock = std::chrono::steady_clock;
+
+// CRGB
+//
+// Just the parts of FastLED's the effects use, done the way FastLED does them
+
+struct CRGB
+{
+    union
+    {
+        struct { uint8_t r, g, b; };
+        uint8_t raw[3];
+    };
+
+    CRGB() : r(0), g(0), b(0) { }
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) { }
+
+    static uint8_t qadd8(uint8_t i, uint8_t j)
+    {
+        unsigned t = i + j;
+        return t > 255 ? 255 : t;
+    }
+
+    static uint8_t scale8(uint8_t i, uint8_t scale)
+    {
+        return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+    }
+
+    static uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB)
+    {
+        uint16_t partial = (a << 8) | b;
+        partial += (b * amountOfB);
+        partial -= (a * amountOfB);
+        return partial >> 8;
+    }
+
+    CRGB & operator+=(const CRGB & rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB & nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+
+    CRGB & fadeToBlackBy(uint8_t fade)
+    {
+        return nscale8(255 - fade);
+    }
+};
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be three bytes");
+
+static void nblend(CRGB & existing, const CRGB & overlay, uint8_t amount)
+{
+    if (amount == 0)
+        return;
+    if (amount == 255)
+    {
+        existing = overlay;
+        return;
+    }
+    existing.r = CRGB::blend8(existing.r, overlay.r, amount);
+    existing.g = CRGB::blend8(existing.g, overlay.g, amount);
+    existing.b = CRGB::blend8(existing.b, overlay.b, amount);
+}
+
+// GFX
+//
+// GFXBase's pixels, with the per-pixel calls the effects used to make and the span operations they make now.  The
+// matrix is row-major, as a HUB75 panel's is; a strip is a matrix one pixel tall.
+
+class GFX
+{
+  public:
+    size_t _width, _height;
+    std::vector<CRGB> _storage;
+    CRGB * leds;
+
+    GFX(size_t w, size_t h) : _width(w), _height(h), _storage(w * h + 2)
+    {
+        leds = _storage.data();
+    }
+    virtual ~GFX() { }
+
+    uint16_t xy(uint16_t x, uint16_t y) const { return y * _width + x; }
+
+    virtual CRGB getPixel(int i) const                        { return leds[i]; }
+    virtual void setPixel(int i, CRGB c)                      { if (i >= 0 && i < (int)(_width * _height)) leds[i] = c; }
+    virtual void setPixel(int i, int r, int g, int b)         { setPixel(i, CRGB(r, g, b)); }
+    virtual void setPixel(int x, int y, CRGB c)
+    {
+        if (x >= 0 && x < (int) _width && y >= 0 && y < (int) _height)
+            leds[xy(x, y)] = c;
+    }
+
+    // As they were
+
+    void fadeAllOld(uint8_t fade)
+    {
+        for (size_t i = 0; i < _width * _height; i++)
+        {
+            CRGB c = getPixel(i);
+            c.fadeToBlackBy(fade);
+            setPixel(i, c);
+        }
+    }
+
+    void setAllOld(CRGB c)
+    {
+        for (size_t i = 0; i < _width * _height; i++)
+            setPixel(i, c.r, c.g, c.b);
+    }
+
+    void dimAllOld(uint8_t value)
+    {
+        for (size_t i = 0; i < _width * _height; i++)
+            leds[i].nscale8(value);
+    }
+
+    void fillRectOld(int x0, int y0, int x1, int y1, CRGB c)
+    {
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+                setPixel(x, y, c);
+    }
+
+    // As they are
+
+    void FadeSpan(size_t start, size_t count, uint8_t fade)  { SpanKernels::Scale(leds[start].raw, count, 255 - fade); }
+    void ScaleSpan(size_t start, size_t count, uint8_t s)    { SpanKernels::Scale(leds[start].raw, count, s); }
+    void FillSpan(size_t start, size_t count, CRGB c)        { SpanKernels::Fill(leds[start].raw, count, c.raw); }
+
+    void fillRectangle(int x0, int y0, int x1, int y1, CRGB c)
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, (int) _width);
+        y1 = std::min(y1, (int) _height);
+        for (int y = y0; y < y1; y++)
+            FillSpan(xy(x0, y), std::max(x1 - x0, 0), c);
+    }
+};
+
+// Made out of line, so the compiler can't see which GFX it is and skip the vtable as it couldn't on the chip
+
+__attribute__((noinline)) static std::unique_ptr<GFX> MakeGFX(size_t w, size_t h)
+{
+    return std::make_unique<GFX>(w, h);
+}
+
+// Effect
+//
+// The bulk work one effect does in a frame, the old way and the new
+
+struct Effect
+{
+    const char * name;
+    size_t width, height;
+    std::function<void(GFX &)> oldWay;
+    std::function<void(GFX &)> newWay;
+};
+
+static void SpectrumBars(GFX & g, bool bNew)
+{
+    const int bars = 16, barWidth = g._width / bars;
+    for (int i = 0; i < bars; i++)
+    {
+        int top = g._height - (i * 7 % g._height);
+        CRGB color(i * 16, 255 - i * 16, 64);
+        if (bNew)
+        {
+            g.fillRectangle(i * barWidth, 1, (i + 1) * barWidth, top, CRGB(0, 0, 0));
+            g.fillRectangle(i * barWidth, top, (i + 1) * barWidth, g._height, color);
+        }
+        else
+        {
+            g.fillRectOld(i * barWidth, 1, (i + 1) * barWidth, top, CRGB(0, 0, 0));
+            g.fillRectOld(i * barWidth, top, (i + 1) * barWidth, g._height, color);
+        }
+    }
+}
+
+static const std::vector<Effect> & Effects()
+{
+    static const std::vector<Effect> effects =
+    {
+        { "Spectrum analyzer",      64,   32, [](GFX & g) { g.fadeAllOld(40); SpectrumBars(g, false); },
+                                              [](GFX & g) { g.FadeSpan(0, g._width * g._height, 40); SpectrumBars(g, true); } },
+        { "Spectrum bars, no fade", 64,   32, [](GFX & g) { SpectrumBars(g, false); },
+                                              [](GFX & g) { SpectrumBars(g, true); } },
+        { "Weather (fillScreen)",   64,   32, [](GFX & g) { g.fillRectOld(0, 0, 64, 32, CRGB(0, 0, 0)); g.fillRectOld(0, 0, 64, 9, CRGB(0, 0, 128)); },
+                                              [](GFX & g) { g.FillSpan(0, 64 * 32, CRGB(0, 0, 0)); g.fillRectangle(0, 0, 64, 9, CRGB(0, 0, 128)); } },
+        { "Spin (DimAll)",          64,   32, [](GFX & g) { g.dimAllOld(190); },
+                                              [](GFX & g) { g.ScaleSpan(0, g._width * g._height, 190); } },
+        { "Noise smearing (DimAll)",64,   32, [](GFX & g) { g.dimAllOld(235); },
+                                              [](GFX & g) { g.ScaleSpan(0, g._width * g._height, 235); } },
+        { "Pulse",                  64,   32, [](GFX & g) { g.dimAllOld(245); g.fadeAllOld(10); },
+                                              [](GFX & g) { g.ScaleSpan(0, g._width * g._height, 245); g.FadeSpan(0, g._width * g._height, 10); } },
+        { "Stars",                1152,    1, [](GFX & g) { g.setAllOld(CRGB(0, 0, 8)); g.fadeAllOld(60); },
+                                              [](GFX & g) { g.FillSpan(0, g._width, CRGB(0, 0, 8)); g.FadeSpan(0, g._width, 60); } },
+        { "Color beat particles", 1152,    1, [](GFX & g) { g.setAllOld(CRGB(40, 0, 0)); },
+                                              [](GFX & g) { g.FillSpan(0, g._width, CRGB(40, 0, 0)); } },
+        { "Fan beat",             1152,    1, [](GFX & g) { g.fadeAllOld(20); },
+                                              [](GFX & g) { g.FadeSpan(0, g._width, 20); } },
+        { "Laser line",           1152,    1, [](GFX & g) { g.fadeAllOld(200); },
+                                              [](GFX & g) { g.FadeSpan(0, g._width, 200); } },
+    };
+    return effects;
+}
+
+// CheckKernels
+//
+// Every kernel against its per-pixel equivalent, for runs starting at every byte offset in a word and of every
+// length up to a few words, with random colors and amounts
+
+static int CheckKernels(std::mt19937 & random)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    int cFailures = 0;
+
+    for (int pass = 0; pass < 200; pass++)
+    {
+        for (size_t start = 0; start < 8; start++)
+        {
+            for (size_t count = 0; count < 24; count++)
+            {
+                std::vector<CRGB> frame(40);
+                for (auto & pixel : frame)
+                    pixel = CRGB(byte(random), byte(random), byte(random));
+
+                CRGB color(byte(random), byte(random), byte(random));
+                uint8_t amount = byte(random);
+                if (pass == 0) amount = 0;
+                if (pass == 1) amount = 255;
+
+                for (int op = 0; op < 4; op++)
+                {
+                    std::vector<CRGB> expected = frame, actual = frame;
+                    for (size_t i = start; i < start + count; i++)
+                    {
+                        switch (op)
+                        {
+                            case 0: expected[i].nscale8(amount);             break;
+                            case 1: expected[i] = color;                     break;
+                            case 2: expected[i] += color;                    break;
+                            case 3: nblend(expected[i], color, amount);      break;
+                        }
+                    }
+                    switch (op)
+                    {
+                        case 0: SpanKernels::Scale(actual[start].raw, count, amount);            break;
+                        case 1: SpanKernels::Fill(actual[start].raw, count, color.raw);          break;
+                        case 2: SpanKernels::Add(actual[start].raw, count, color.raw);           break;
+                        case 3: SpanKernels::Blend(actual[start].raw, count, color.raw, amount); break;
+                    }
+                    if (memcmp(expected.data(), actual.data(), sizeof(CRGB) * expected.size()))
+                    {
+                        static const char * names[] = { "Scale", "Fill", "Add", "Blend" };
+                        if (cFailures++ < 10)
+                            printf("FAILED: %s of %zu pixels from %zu, amount %d\n", names[op], count, start, amount);
+                    }
+                }
+            }
+        }
+    }
+    return cFailures;
+}
+
+int main()
+{
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    int cFailures = CheckKernels(random);
+
+    printf("%-24s %9s  %9s  %9s\n", "Effect", "Before", "After", "");
+    for (const auto & effect : Effects())
+    {
+        auto pOld = MakeGFX(effect.width, effect.height);
+        auto pNew = MakeGFX(effect.width, effect.height);
+        for (size_t i = 0; i < effect.width * effect.height; i++)
+            pOld->leds[i] = pNew->leds[i] = CRGB(byte(random), byte(random), byte(random));
+
+        const int frames = 2000;
+
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            effect.oldWay(*pOld);
+        double usOld = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / frames;
+
+        start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            effect.newWay(*pNew);
+        double usNew = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / frames;
+
+        bool bSame = !memcmp(pOld->leds, pNew->leds, sizeof(CRGB) * effect.width * effect.height);
+        if (!bSame)
+            cFailures++;
+
+        printf("%-24s %7.2fus  %7.2fus  %5.1fx faster%s\n", effect.name, usOld, usNew, usOld / usNew, bSame ? "" : ", DIFFERENT PIXELS");
+    }
+
+    printf(cFailures ? "%d checks FAILED\n" : "The span operations matched the per-pixel ones everywhere\n", cFailures);
+    return cFailures ? 1 : 0;
+}
@@ -0,0 +1,428 @@
+// streambench.cpp
+//
+// Measures what STREAMING_INFLATE buys for compressed PIXELDATA64 frames, and what it costs when a sender stalls.
+// A sender thread writes the frames down one end of a socket pair at a Wi-Fi-like rate, a segment at a time, and
+// the other end receives them the two ways SocketServer can:
+//
+//   g++ -std=c++17 -O2 -pthread -o streambench tools/streambench.cpp -lz
+//   ./streambench [frames] [kilobytes per second]
+//
+// "Buffered" reads each packet into a MAXIUMUM_PACKET_SIZE connection buffer and inflates it once the last byte
+// is in.  "Streaming" reads only the 16-byte compressed header into the buffer and lets uzlib pull the rest off
+// the socket through a 256-byte window, as StreamingSource does.  For each, it prints how long a frame takes to
+// be ready after its last byte arrives, how long after its first, and the most receive memory a connection held.
+// The last case stalls the sender partway through a packet for longer than STREAMING_WAIT_MS, and checks that
+// the streaming receiver gives up on that packet within its budget, throws the rest of it away, and inflates
+// the packets after it correctly.  It fails if any frame comes out different from what was sent.  The times
+// are measured against the PC's clock and how promptly it wakes the sender, so they're for comparison only.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+extern "C"
+{
+    #include "../src/uzlib/src/tinflate.c"
+    #include "../src/uzlib/src/tinfzlib.c"
+    #include "../src/uzlib/src/adler32.c"
+    #include "../src/uzlib/src/crc32.c"
+}
+
+using Clock = std::chrono::steady_clock;
+
+// These match socketserver.h
+
+#define WIFI_COMMAND_PIXELDATA64    3
+#define STANDARD_DATA_HEADER_SIZE   24
+#define COMPRESSED_HEADER_SIZE      16
+#define COMPRESSED_HEADER           0x44415645
+#define LED_DATA_SIZE               3
+#define STREAMING_WINDOW_SIZE       256
+#define STREAMING_WAIT_MS           10
+
+static const int    cLeds        = 64 * 32;
+static const size_t cbMaxPacket  = STANDARD_DATA_HEADER_SIZE + LED_DATA_SIZE * cLeds;      // MAXIUMUM_PACKET_SIZE
+static const size_t cbSegment    = 1460;                                                   // One TCP segment
+
+static double MicrosSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static void PutBytes(std::vector<uint8_t> & out, uint64_t value, int cb)
+{
+    for (int i = 0; i < cb; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+static uint32_t DWORDFromMemory(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+
+// Frame
+//
+// The uncompressed PIXELDATA64 packet for one frame of a moving pattern
+
+static std::vector<uint8_t> Frame(int iFrame)
+{
+    std::vector<uint8_t> packet;
+    PutBytes(packet, WIFI_COMMAND_PIXELDATA64, 2);
+    PutBytes(packet, 1, 2);
+    PutBytes(packet, cLeds, 4);
+    PutBytes(packet, 1700000000 + iFrame / 60, 8);
+    PutBytes(packet, (iFrame % 60) * 16667, 8);
+    for (int i = 0; i < cLeds; i++)
+    {
+        double t = iFrame * 0.05;
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.11 + t)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.07 - t * 1.3)));
+        packet.push_back((uint8_t) (127 + 127 * sin(i * 0.05 + t * 0.7)));
+    }
+    return packet;
+}
+
+static std::vector<uint8_t> Compress(const std::vector<uint8_t> & packet)
+{
+    uLongf cbCompressed = compressBound(packet.size());
+    std::vector<uint8_t> compressed(cbCompressed);
+    compress2(compressed.data(), &cbCompressed, packet.data(), packet.size(), Z_BEST_COMPRESSION);
+
+    std::vector<uint8_t> out;
+    PutBytes(out, COMPRESSED_HEADER, 4);
+    PutBytes(out, cbCompressed, 4);
+    PutBytes(out, packet.size(), 4);
+    PutBytes(out, 0x12345678, 4);
+    out.insert(out.end(), compressed.begin(), compressed.begin() + cbCompressed);
+    return out;
+}
+
+// Sender
+//
+// Writes the packets back to back, one segment every so often to hold the link to its rate.  If stallAt is set,
+// it stops for msStall after that many bytes of the stream.
+
+static void Sender(int socket, const std::vector<std::vector<uint8_t>> & packets, double bytesPerSecond, size_t stallAt, int msStall)
+{
+    std::vector<uint8_t> stream;
+    for (auto & packet : packets)
+        stream.insert(stream.end(), packet.begin(), packet.end());
+
+    auto next = Clock::now();
+    for (size_t offset = 0; offset < stream.size(); )
+    {
+        size_t cb = std::min(cbSegment, stream.size() - offset);
+        if (stallAt && offset < stallAt && offset + cb > stallAt)
+            cb = stallAt - offset;
+
+        std::this_thread::sleep_until(next);
+        for (size_t cbSent = 0; cbSent < cb; )
+        {
+            ssize_t res = write(socket, &stream[offset + cbSent], cb - cbSent);
+            if (res < 0)
+                return;
+            cbSent += res;
+        }
+        offset += cb;
+        next += std::chrono::microseconds((long) (cb * 1e6 / bytesPerSecond));
+
+        if (offset == stallAt)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(msStall));
+            next = Clock::now();
+        }
+    }
+}
+
+// WaitReadable
+//
+// Stands in for the select() in SocketServer's loop.  Returns false if nothing arrived within usTimeout.
+
+static bool WaitReadable(int socket, long usTimeout)
+{
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(socket, &readSet);
+    struct timeval to = { usTimeout / 1000000, usTimeout % 1000000 };
+    return select(socket + 1, &readSet, nullptr, nullptr, &to) > 0;
+}
+
+// ReadExactly
+//
+// Reads cb bytes, waiting for them as the select() loop would.  Returns the time the last of them arrived.
+
+static Clock::time_point ReadExactly(int socket, uint8_t * p, size_t cb)
+{
+    while (cb)
+    {
+        ssize_t res = read(socket, p, cb);
+        if (res > 0)
+        {
+            p  += res;
+            cb -= res;
+        }
+        else if (res == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || !WaitReadable(socket, 1000000))
+        {
+            fprintf(stderr, "Receive failed\n");
+            exit(1);
+        }
+    }
+    return Clock::now();
+}
+
+// InitDecompressor and InflateInto are SocketServer's
+
+static bool InitDecompressor(struct uzlib_uncomp & d, const uint8_t * pBuffer, size_t cBuffer, int (*pfnReadSource)(struct uzlib_uncomp *) = nullptr)
+{
+    uzlib_uncompress_init(&d, NULL, 0);
+    d.source         = pBuffer;
+    d.source_limit   = pBuffer + cBuffer;
+    d.source_read_cb = pfnReadSource;
+    return uzlib_zlib_parse_header(&d) >= 0;
+}
+
+static bool InflateInto(struct uzlib_uncomp & d, uint8_t * pStart, uint8_t * pOutput, size_t cbOutput, bool bFinal)
+{
+    d.dest_start = pStart;
+    d.dest       = pOutput;
+    d.dest_limit = pOutput + cbOutput + (bFinal ? 1 : 0);
+
+    int res = uzlib_uncompress_chksum(&d);
+    return res == (bFinal ? TINF_DONE : TINF_OK) && (size_t) (d.dest - pOutput) == cbOutput;
+}
+
+// StreamingSource
+//
+// SocketServer's, less the connection bookkeeping:  a window refilled from the socket, waiting at most
+// STREAMING_WAIT_MS with nothing arriving
+
+struct StreamingSource
+{
+    struct uzlib_uncomp d = { 0 };
+    int                 _socket = -1;
+    size_t              _cbRemaining = 0;
+    long                _usWaited = 0;
+    bool                _bStalled = false;
+    Clock::time_point   _lastByte;
+    uint8_t             _abWindow[STREAMING_WINDOW_SIZE];
+
+    static int ReadFromSocket(struct uzlib_uncomp * pd)
+    {
+        auto pSource = reinterpret_cast<StreamingSource *>(pd);
+        if (pSource->_cbRemaining == 0)
+            return -1;
+
+        for (;;)
+        {
+            int cbRead = read(pSource->_socket, pSource->_abWindow, std::min(sizeof(pSource->_abWindow), pSource->_cbRemaining));
+            if (cbRead > 0)
+            {
+                pSource->_usWaited = 0;
+                pSource->_cbRemaining -= cbRead;
+                if (pSource->_cbRemaining == 0)
+                    pSource->_lastByte = Clock::now();
+                pd->source       = pSource->_abWindow + 1;
+                pd->source_limit = pSource->_abWindow + cbRead;
+                return pSource->_abWindow[0];
+            }
+            if (cbRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                return -1;
+
+            const long usBudget = STREAMING_WAIT_MS * 1000;
+            if (pSource->_usWaited >= usBudget)
+            {
+                pSource->_bStalled = true;
+                return -1;
+            }
+            auto start = Clock::now();
+            WaitReadable(pSource->_socket, usBudget - pSource->_usWaited);
+            pSource->_usWaited += std::max(1L, (long) MicrosSince(start));
+        }
+    }
+};
+
+struct Result
+{
+    double  usAfterLast  = 0;       // Last byte in to pixels ready, summed
+    double  usAfterFirst = 0;       // First byte in to pixels ready, summed
+    double  usHeld       = 0;       // Longest the receiver went without getting back to its select() loop
+    size_t  cbPeak       = 0;       // Most receive memory held for the connection
+    int     cFrames      = 0;
+    int     cDropped     = 0;
+    int     cWrong       = 0;
+};
+
+// ReceiveBuffered
+//
+// The whole packet into the connection's buffer, then inflated
+
+static void ReceiveBuffered(int socket, const std::vector<std::vector<uint8_t>> & frames, Result & result)
+{
+    std::vector<uint8_t> buffer(cbMaxPacket), output(cbMaxPacket + 1);
+    result.cbPeak = buffer.size();
+
+    for (auto & frame : frames)
+    {
+        WaitReadable(socket, 1000000);
+        auto first = Clock::now();
+        ReadExactly(socket, buffer.data(), COMPRESSED_HEADER_SIZE);
+        uint32_t compressedSize = DWORDFromMemory(&buffer[4]);
+        uint32_t expandedSize   = DWORDFromMemory(&buffer[8]);
+        auto last = ReadExactly(socket, &buffer[COMPRESSED_HEADER_SIZE], compressedSize);
+
+        struct uzlib_uncomp d = { 0 };
+        bool bOK = InitDecompressor(d, &buffer[COMPRESSED_HEADER_SIZE], compressedSize) && InflateInto(d, output.data(), output.data(), expandedSize, true);
+        result.usAfterLast  += MicrosSince(last);
+        result.usAfterFirst += MicrosSince(first);
+        result.usHeld        = std::max(result.usHeld, MicrosSince(last));
+        result.cFrames++;
+        if (!bOK || 0 != memcmp(output.data(), frame.data(), frame.size()))
+            result.cWrong++;
+    }
+}
+
+// ReceiveStreaming
+//
+// Only the compressed header into the connection's buffer, and the rest inflated as it comes off the socket.
+// A packet that stalls is dropped and the rest of it read and thrown away.
+
+static void ReceiveStreaming(int socket, const std::vector<std::vector<uint8_t>> & frames, Result & result)
+{
+    uint8_t header[STANDARD_DATA_HEADER_SIZE];
+    std::vector<uint8_t> output(cbMaxPacket + 1);
+    result.cbPeak = sizeof(header) + sizeof(StreamingSource::_abWindow);
+
+    for (auto & frame : frames)
+    {
+        WaitReadable(socket, 1000000);
+        auto first = Clock::now();
+        ReadExactly(socket, header, COMPRESSED_HEADER_SIZE);
+        uint32_t compressedSize = DWORDFromMemory(&header[4]);
+        uint32_t expandedSize   = DWORDFromMemory(&header[8]);
+
+        StreamingSource source;
+        source._socket      = socket;
+        source._cbRemaining = compressedSize;
+
+        bool bOK = InitDecompressor(source.d, nullptr, 0, StreamingSource::ReadFromSocket) && InflateInto(source.d, output.data(), output.data(), expandedSize, true);
+        double usHeld = MicrosSince(first);
+        result.usHeld = std::max(result.usHeld, usHeld);
+
+        if (source._bStalled)
+        {
+            result.cDropped++;
+            std::vector<uint8_t> discard(source._cbRemaining);
+            ReadExactly(socket, discard.data(), discard.size());
+            continue;
+        }
+
+        result.usAfterLast  += MicrosSince(source._lastByte);
+        result.usAfterFirst += usHeld;
+        result.cFrames++;
+        if (!bOK || 0 != memcmp(output.data(), frame.data(), frame.size()))
+            result.cWrong++;
+    }
+}
+
+static Result Run(bool bStreaming, const std::vector<std::vector<uint8_t>> & frames, const std::vector<std::vector<uint8_t>> & packets,
+                  double bytesPerSecond, size_t stallAt = 0, int msStall = 0)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+
+    Result result;
+    std::thread sender(Sender, fds[1], std::cref(packets), bytesPerSecond, stallAt, msStall);
+    if (bStreaming)
+        ReceiveStreaming(fds[0], frames, result);
+    else
+        ReceiveBuffered(fds[0], frames, result);
+    sender.join();
+
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+}
+
+static void Print(const char * name, const Result & result)
+{
+    printf("  %-10s %6.0lfus after the last byte, %7.0lfus after the first, held the loop up to %6.0lfus, %5zu bytes of receive memory",
+           name, result.usAfterLast / result.cFrames, result.usAfterFirst / result.cFrames, result.usHeld, result.cbPeak);
+    if (result.cDropped)
+        printf(", %d dropped", result.cDropped);
+    printf("\n");
+}
+
+int main(int argc, char * argv[])
+{
+    int cFrames           = argc > 1 ? atoi(argv[1]) : 200;
+    double kbytesPerSecond = argc > 2 ? atof(argv[2]) : 1250;        // About 10 Mbit/s, what an ESP32 sustains over TCP
+    if (cFrames <= 1 || kbytesPerSecond <= 0)
+    {
+        fprintf(stderr, "Usage: streambench [frames] [kilobytes per second]\n");
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> frames, packets;
+    size_t cbCompressed = 0;
+    for (int i = 0; i < cFrames; i++)
+    {
+        frames.push_back(Frame(i));
+        packets.push_back(Compress(frames.back()));
+        cbCompressed += packets.back().size();
+    }
+
+    bool bAllOK = true;
+    printf("%d frames of %d LEDs, %zu bytes compressed on average\n", cFrames, cLeds, cbCompressed / cFrames);
+
+    for (double rate : { kbytesPerSecond * 1000, 1e12 })
+    {
+        if (rate < 1e12)
+            printf("At %.0lf KB/s:\n", rate / 1000);
+        else
+            printf("As fast as the socket goes:\n");
+
+        for (bool bStreaming : { false, true })
+        {
+            Result result = Run(bStreaming, frames, packets, rate);
+            Print(bStreaming ? "Streaming" : "Buffered", result);
+            if (result.cWrong || result.cDropped)
+                bAllOK = false;
+        }
+    }
+
+    // The sender stops for five times the budget partway into the middle packet
+
+    int iStall = cFrames / 2;
+    size_t stallAt = 0;
+    for (int i = 0; i < iStall; i++)
+        stallAt += packets[i].size();
+    stallAt += packets[iStall].size() / 2;
+
+    printf("With the sender stalling for %dms halfway through frame %d:\n", 5 * STREAMING_WAIT_MS, iStall);
+    Result stalled = Run(true, frames, packets, kbytesPerSecond * 1000, stallAt, 5 * STREAMING_WAIT_MS);
+    Print("Streaming", stalled);
+    if (stalled.cWrong || stalled.cDropped != 1 || stalled.cFrames != cFrames - 1)
+    {
+        printf("  Expected exactly one frame dropped and the rest intact\n");
+        bAllOK = false;
+    }
+
+    if (!bAllOK)
+        printf("Some frames came out wrong\n");
+    return bAllOK ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// timebasetest.cpp
+//
+// Checks for Timebase, the microsecond clock that frame timestamps are scheduled against.  It exits 1 if any
+// check fails:
+//
+//   g++ -std=c++17 -O2 -o timebasetest tools/timebasetest.cpp
+//   ./timebasetest
+//
+// It covers timestamps that straddle a second boundary, microsecond fields that overflow into the next second,
+// and the wall clock being stepped forwards and backwards while frames are waiting, as NTP does.  It exits with
+// a non-zero status if anything fails.
+
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+
+#include "../include/timebase.h"
+
+static int g_cFailures = 0;
+
+#define CHECK(condition)                                                    \
+    do                                                                      \
+    {                                                                       \
+        if (!(condition))                                                   \
+        {                                                                   \
+            printf("FAILED line %d: %s\n", __LINE__, #condition);           \
+            g_cFailures++;                                                  \
+        }                                                                   \
+    } while (0)
+
+static const uint64_t secondsNow = 1760000000;                              // Oct 2025, about where NTP puts the clock
+
+// A frame timestamp as the draw loop used to see it, for comparison
+
+static float FloatSeconds(uint64_t seconds, uint64_t micros)
+{
+    return seconds + micros / (float) Timebase::MicrosPerSecond;
+}
+
+static void TestSecondBoundaries()
+{
+    for (uint64_t seconds = secondsNow; seconds < secondsNow + 1000; seconds++)
+    {
+        uint64_t usLast  = Timebase::FromWire(seconds, 999999);
+        uint64_t usFirst = Timebase::FromWire(seconds + 1, 0);
+
+        CHECK(usLast < usFirst);
+        CHECK(Timebase::MicrosBetween(usLast, usFirst) == 1);
+        CHECK(Timebase::MicrosBetween(usFirst, usLast) == -1);
+        CHECK(Timebase::FromWire(seconds, 500000) < Timebase::FromWire(seconds, 500001));
+    }
+
+    // A microseconds field of a second or more carries into the seconds, the same as it always did in float
+
+    CHECK(Timebase::FromWire(secondsNow, 1500000) == Timebase::FromWire(secondsNow + 1, 500000));
+
+    // Frames 1/60th of a second apart stay in order and exactly that far apart, which float seconds can't manage
+
+    uint64_t usFrame = Timebase::FromWire(secondsNow, 990000);
+    uint64_t usNext  = usFrame + 16667;
+    CHECK(Timebase::MicrosBetween(usFrame, usNext) == 16667);
+    CHECK(FloatSeconds(secondsNow, 990000) == FloatSeconds(secondsNow + 1, 6667));
+}
+
+static void TestClockSteps()
+{
+    Timebase::SetWallClock(Timebase::FromWire(secondsNow, 0));
+
+    uint64_t usMonotonic = Timebase::MonotonicMicros();
+    uint64_t usWall      = Timebase::WallFromMonotonic(usMonotonic);
+    CHECK(Timebase::MonotonicFromWall(usWall) == usMonotonic);
+
+    // A frame due a tenth of a second from now isn't due yet
+
+    uint64_t usFrame = usWall + 100000;
+    CHECK(!(usFrame < usWall));
+
+    // Stepping the clock forward by an hour moves every wall time by exactly an hour, makes the frame overdue,
+    // and leaves monotonic time alone.  The step is made against the monotonic time we already read, as reading
+    // the clock again would make it come out a little short.
+
+    const int64_t usHour = 3600 * (int64_t) Timebase::MicrosPerSecond;
+    Timebase::SetWallClock(usWall + usHour, usMonotonic);
+    uint64_t usStepped = Timebase::WallFromMonotonic(usMonotonic);
+    CHECK(Timebase::MicrosBetween(usWall, usStepped) == usHour);
+    CHECK(Timebase::MonotonicFromWall(usStepped) == usMonotonic);
+    CHECK(usFrame < Timebase::WallMicros());
+
+    // Stepping it back past where it started makes the frame wait again
+
+    Timebase::SetWallClock(Timebase::WallMicros() - 2 * usHour);
+    CHECK(!(usFrame < Timebase::WallMicros()));
+    CHECK(Timebase::MicrosBetween(Timebase::WallMicros(), usFrame) > usHour);
+
+    // Two monotonic times keep their order and spacing through any step
+
+    uint64_t usA = Timebase::MonotonicMicros();
+    uint64_t usB = usA + 5000;
+    for (int64_t usStep : { usHour, -usHour, (int64_t) 1, (int64_t) -1 })
+    {
+        Timebase::SetWallClock(Timebase::WallMicros() + usStep);
+        CHECK(Timebase::WallFromMonotonic(usA) < Timebase::WallFromMonotonic(usB));
+        CHECK(Timebase::MicrosBetween(Timebase::WallFromMonotonic(usA), Timebase::WallFromMonotonic(usB)) == 5000);
+    }
+}
+
+static void TestMonotonic()
+{
+    Timebase::SetWallClock(Timebase::FromWire(secondsNow, 0));
+
+    uint64_t usLast     = Timebase::MonotonicMicros();
+    uint64_t usLastWall = Timebase::WallMicros();
+    for (int i = 0; i < 1000000; i++)
+    {
+        uint64_t us     = Timebase::MonotonicMicros();
+        uint64_t usWall = Timebase::WallMicros();
+        CHECK(us >= usLast);
+        CHECK(usWall >= usLastWall);
+        usLast     = us;
+        usLastWall = usWall;
+    }
+}
+
+int main()
+{
+    TestSecondBoundaries();
+    TestClockSteps();
+    TestMonotonic();
+
+    printf(g_cFailures ? "%d checks FAILED\n" : "All timebase checks passed\n", g_cFailures);
+    return g_cFailures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+
+# Sends a moving test pattern to a NightDriver built with INCOMING_UDP_ENABLED, cut into datagrams the way
+# UdpReceiver expects them, and can throw away or shuffle some of those datagrams on the way out so that the
+# loss, reorder and reassembly counters in the "stats" debug command can be checked against what was done.
+#
+# Each datagram is a sequence32, fragment index16, fragment count16 and total size32, all little-endian,
+# followed by that fragment of an ordinary PIXELDATA64 packet.
+#
+#   python tools/udpframes.py 192.168.1.50 --leds 1024 --loss 0.05 --reorder 0.1
+#   python tools/udpframes.py 239.0.0.49 --leds 1024 --frames 600
+
+import sys
+import time
+import socket
+import struct
+import random
+import argparse
+
+WIFI_COMMAND_PIXELDATA64 = 3
+FRAGMENT_HEADER_SIZE     = 12
+
+parser = argparse.ArgumentParser()
+parser.add_argument('host', help='address or multicast group to send to')
+parser.add_argument('--port', type=int, default=49152)
+parser.add_argument('--leds', type=int, default=144)
+parser.add_argument('--fps', type=float, default=30)
+parser.add_argument('--frames', type=int, default=300)
+parser.add_argument('--fragment', type=int, default=1400, help='bytes of packet per datagram')
+parser.add_argument('--lead', type=float, default=0.5, help='seconds in the future to timestamp frames')
+parser.add_argument('--loss', type=float, default=0.0, help='chance of dropping each datagram')
+parser.add_argument('--reorder', type=float, default=0.0, help='chance of holding a datagram back behind the next one')
+parser.add_argument('--duplicate', type=float, default=0.0, help='chance of sending a datagram twice')
+args = parser.parse_args()
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 2)
+
+sent = dropped = reordered = duplicated = 0
+held = None
+
+def send(datagram):
+    global sent, dropped, reordered, duplicated, held
+    if random.random() < args.loss:
+        dropped += 1
+        return
+    if held is None and random.random() < args.reorder:
+        held = datagram
+        reordered += 1
+        return
+    sock.sendto(datagram, (args.host, args.port))
+    sent += 1
+    if random.random() < args.duplicate:
+        sock.sendto(datagram, (args.host, args.port))
+        duplicated += 1
+    if held is not None:
+        sock.sendto(held, (args.host, args.port))
+        sent += 1
+        held = None
+
+for sequence in range(1, args.frames + 1):
+    when = time.time() + args.lead
+    pixels = bytearray()
+    for i in range(args.leds):
+        pixels += bytes(((i * 4 + sequence * 8) & 0xFF, (sequence * 2) & 0xFF, (255 - i) & 0xFF))
+    packet = struct.pack('<HHIQQ', WIFI_COMMAND_PIXELDATA64, 1, args.leds, int(when), int((when % 1) * 1000000)) + pixels
+
+    fragments = [packet[i:i + args.fragment] for i in range(0, len(packet), args.fragment)]
+    for index, fragment in enumerate(fragments):
+        send(struct.pack('<IHHI', sequence, index, len(fragments), len(packet)) + fragment)
+
+    time.sleep(1.0 / args.fps)
+
+if held is not None:
+    sock.sendto(held, (args.host, args.port))
+    sent += 1
+
+print('%d frames: %d datagrams sent, %d dropped, %d held back, %d duplicated' % (args.frames, sent, dropped, reordered, duplicated))
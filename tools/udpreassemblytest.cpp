@@ -0,0 +1,411 @@
+// udpreassemblytest.cpp
+//
+// Puts UdpReceiver's fragment reassembly through the kinds of trouble a lossy Wi-Fi link causes:  fragments
+// that come in out of order, twice, or not at all, packets overtaken by newer ones, and a sender that restarts
+// its sequence.  The receiver is run on a PC over a loopback socket, one datagram at a time so that the order it
+// sees them in is exactly the order they were sent in, and the packets it hands out are checked byte for byte
+// against the ones that were cut up, along with its counters.  It exits non-zero if any check fails.
+//
+//   g++ -std=c++17 -O2 -o udpreassemblytest tools/udpreassemblytest.cpp
+//   ./udpreassemblytest
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+// What udpreceiver.h would otherwise get from globals.h
+
+#define MAXIUMUM_PACKET_SIZE    (24 + 3 * 4096)
+#define debugV(...)
+#define debugI(...)
+#define debugW(...)
+
+static uint16_t WORDFromMemory(const uint8_t * p)  { return p[0] | p[1] << 8; }
+static uint32_t DWORDFromMemory(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+
+#include "../include/udpreceiver.h"
+
+static int g_cFailures = 0;
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition))                                                   \
+        {                                                                   \
+            printf("FAILED line %d: %s\n", __LINE__, #condition);           \
+            g_cFailures++;                                                  \
+        }                                                                   \
+    } while (0)
+
+using Datagram = std::vector<uint8_t>;
+
+static void PutBytes(Datagram & out, uint32_t value, int cb)
+{
+    for (int i = 0; i < cb; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+// Packet
+//
+// The contents of a packet depend on its sequence, so a packet handed out under the wrong sequence is caught
+
+static std::vector<uint8_t> Packet(uint32_t sequence, size_t cbPacket)
+{
+    std::vector<uint8_t> packet(cbPacket);
+    for (size_t i = 0; i < cbPacket; i++)
+        packet[i] = (uint8_t) (sequence * 31 + i * 7 + (i >> 8));
+    return packet;
+}
+
+// Fragments
+//
+// Cuts a packet up the way tools/udpframes.py does
+
+static std::vector<Datagram> Fragments(uint32_t sequence, const std::vector<uint8_t> & packet, size_t cbFragment = 1400)
+{
+    uint16_t cFragments = (packet.size() + cbFragment - 1) / cbFragment;
+    std::vector<Datagram> fragments;
+    for (uint16_t i = 0; i < cFragments; i++)
+    {
+        Datagram datagram;
+        PutBytes(datagram, sequence, 4);
+        PutBytes(datagram, i, 2);
+        PutBytes(datagram, cFragments, 2);
+        PutBytes(datagram, packet.size(), 4);
+        size_t start = i * cbFragment;
+        size_t end   = std::min(start + cbFragment, packet.size());
+        datagram.insert(datagram.end(), packet.begin() + start, packet.begin() + end);
+        fragments.push_back(datagram);
+    }
+    return fragments;
+}
+
+// Link
+//
+// A UdpReceiver on a loopback port and a socket to send to it.  Every datagram is read back as soon as it's
+// sent, and whatever packets come out are kept along with their sequences.
+
+class Link
+{
+    int _socket = -1;
+    struct sockaddr_in _address;
+
+public:
+
+    UdpReceiver _receiver;
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> _packets;
+
+    Link()
+    {
+        if (!_receiver.begin(0, nullptr))
+        {
+            perror("begin");
+            exit(1);
+        }
+        socklen_t cbAddress = sizeof(_address);
+        getsockname(_receiver.Socket(), (struct sockaddr *) &_address, &cbAddress);
+        _address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    }
+
+    ~Link()
+    {
+        close(_socket);
+        _receiver.release();
+    }
+
+    void Send(const Datagram & datagram)
+    {
+        if (sendto(_socket, datagram.data(), datagram.size(), 0, (struct sockaddr *) &_address, sizeof(_address)) != (ssize_t) datagram.size())
+            perror("sendto");
+
+        uint8_t * pPacket;
+        size_t cbPacket;
+        while (_receiver.ReceiveDatagram(pPacket, cbPacket))
+            if (pPacket)
+                _packets.emplace_back(DWORDFromMemory(pPacket), std::vector<uint8_t>(pPacket, pPacket + cbPacket));
+    }
+
+    void Send(const std::vector<Datagram> & datagrams, std::initializer_list<int> order)
+    {
+        for (int i : order)
+            Send(datagrams[i]);
+    }
+
+    void Send(const std::vector<Datagram> & datagrams)
+    {
+        for (auto & datagram : datagrams)
+            Send(datagram);
+    }
+};
+
+// Every packet starts with its own sequence, so Link can tell which one came out
+
+static std::vector<uint8_t> SequencedPacket(uint32_t sequence, size_t cbPacket)
+{
+    auto packet = Packet(sequence, cbPacket);
+    for (int i = 0; i < 4; i++)
+        packet[i] = (uint8_t) (sequence >> (8 * i));
+    return packet;
+}
+
+static std::vector<Datagram> SequencedFragments(uint32_t sequence, size_t cbPacket)
+{
+    return Fragments(sequence, SequencedPacket(sequence, cbPacket));
+}
+
+static bool Matches(const Link & link, std::initializer_list<uint32_t> sequences, size_t cbPacket)
+{
+    if (link._packets.size() != sequences.size())
+        return false;
+    size_t i = 0;
+    for (uint32_t sequence : sequences)
+    {
+        auto & delivered = link._packets[i++];
+        if (delivered.first != sequence || delivered.second != SequencedPacket(sequence, cbPacket))
+            return false;
+    }
+    return true;
+}
+
+const size_t cbPacket = 4000;                   // Three fragments:  two of 1400 bytes and one of 1200
+
+static void TestInOrder()
+{
+    Link link;
+    for (uint32_t sequence = 1; sequence <= 5; sequence++)
+        link.Send(SequencedFragments(sequence, cbPacket));
+
+    CHECK(Matches(link, { 1, 2, 3, 4, 5 }, cbPacket));
+    CHECK(link._receiver._cPackets == 5);
+    CHECK(link._receiver._cReassembled == 5);
+    CHECK(link._receiver._cLost == 0);
+    CHECK(link._receiver._cReordered == 0);
+
+    // A packet that fits in one datagram
+
+    Link single;
+    single.Send(SequencedFragments(1, 300));
+    CHECK(Matches(single, { 1 }, 300));
+    CHECK(single._receiver._cReassembled == 0);
+}
+
+static void TestReorderedFragments()
+{
+    // Fragments of one packet in any order put it back together the same
+
+    Link link;
+    link.Send(SequencedFragments(1, cbPacket), { 2, 0, 1 });
+    link.Send(SequencedFragments(2, cbPacket), { 1, 2, 0 });
+    link.Send(SequencedFragments(3, cbPacket), { 2, 1, 0 });
+    CHECK(Matches(link, { 1, 2, 3 }, cbPacket));
+    CHECK(link._receiver._cLost == 0);
+
+    // Two packets interleaved:  the older one's fragments arrive after the newer one has been seen
+
+    Link interleaved;
+    auto first  = SequencedFragments(2, cbPacket);
+    auto second = SequencedFragments(3, cbPacket);
+    interleaved.Send(SequencedFragments(1, cbPacket));
+    interleaved.Send(first[0]);
+    interleaved.Send(second[0]);
+    interleaved.Send(first[1]);
+    interleaved.Send(first[2]);
+    interleaved.Send(second[2]);
+    interleaved.Send(second[1]);
+    CHECK(Matches(interleaved, { 1, 2, 3 }, cbPacket));
+    CHECK(interleaved._receiver._cReordered == 2);
+    CHECK(interleaved._receiver._cLost == 0);
+}
+
+static void TestDuplicates()
+{
+    // A fragment that's repeated before its packet completes is a duplicate; one repeated after is late
+
+    Link link;
+    for (uint32_t sequence = 1; sequence <= 3; sequence++)
+        link.Send(SequencedFragments(sequence, cbPacket), { 0, 0, 1, 1, 2, 2 });
+
+    CHECK(Matches(link, { 1, 2, 3 }, cbPacket));
+    CHECK(link._receiver._cDuplicates == 6);
+    CHECK(link._receiver._cLate == 3);
+
+    // The whole packet again, after it's been handed out
+
+    link.Send(SequencedFragments(3, cbPacket));
+    CHECK(link._packets.size() == 3);
+    CHECK(link._receiver._cLate == 6);
+}
+
+static void TestDroppedFragments()
+{
+    // Sequence 2 loses a fragment, so it's never handed out and counts as lost once 3 completes
+
+    Link link;
+    link.Send(SequencedFragments(1, cbPacket));
+    link.Send(SequencedFragments(2, cbPacket), { 0, 2 });
+    link.Send(SequencedFragments(3, cbPacket));
+    CHECK(Matches(link, { 1, 3 }, cbPacket));
+    CHECK(link._receiver._cLost == 1);
+
+    // When its missing fragment finally turns up it's too late to be used
+
+    link.Send(SequencedFragments(2, cbPacket), { 1 });
+    CHECK(link._packets.size() == 2);
+    CHECK(link._receiver._cLate == 1);
+
+    // A whole run of packets missing
+
+    link.Send(SequencedFragments(10, cbPacket));
+    CHECK(Matches(link, { 1, 3, 10 }, cbPacket));
+    CHECK(link._receiver._cLost == 7);
+}
+
+static void TestSlotsExhausted()
+{
+    // With two slots, a third packet starting gives up on the oldest, and the oldest's later fragments are late
+
+    Link link;
+    auto f11 = SequencedFragments(11, cbPacket);
+    auto f12 = SequencedFragments(12, cbPacket);
+    auto f13 = SequencedFragments(13, cbPacket);
+
+    link.Send(SequencedFragments(10, cbPacket));
+    link.Send(f11[0]);
+    link.Send(f12[0]);
+    link.Send(f13[0]);
+    link.Send(f11[1]);
+    link.Send(f11[2]);
+    link.Send(f12[1]);
+    link.Send(f12[2]);
+    link.Send(f13[1]);
+    link.Send(f13[2]);
+
+    CHECK(Matches(link, { 10, 12, 13 }, cbPacket));
+    CHECK(link._receiver._cLate == 2);
+    CHECK(link._receiver._cLost == 1);
+}
+
+static void TestSenderRestart()
+{
+    Link link;
+    link.Send(SequencedFragments(5000, cbPacket));
+    link.Send(SequencedFragments(4990, cbPacket));           // Just behind:  a straggler
+    link.Send(SequencedFragments(1, cbPacket));              // Far behind:  the sender started over
+    link.Send(SequencedFragments(2, cbPacket));
+    CHECK(Matches(link, { 5000, 1, 2 }, cbPacket));
+    CHECK(link._receiver._cLate == 3);
+    CHECK(link._receiver._cLost == 0);
+}
+
+static void TestBadDatagrams()
+{
+    Link link;
+    auto fragments = SequencedFragments(1, cbPacket);
+
+    Datagram tooShort(fragments[0].begin(), fragments[0].begin() + UDP_FRAGMENT_HEADER_SIZE);
+    link.Send(tooShort);
+
+    Datagram badIndex = fragments[0];
+    badIndex[4] = 3;                                         // Fragment 3 of 3
+    link.Send(badIndex);
+
+    Datagram wrongSize = fragments[1];
+    wrongSize.pop_back();                                    // A middle fragment that isn't full size
+    link.Send(fragments[2]);
+    link.Send(wrongSize);
+
+    CHECK(link._receiver._cBadDatagrams == 3);
+    CHECK(link._packets.empty());
+
+    // The packet can still be finished by good fragments
+
+    link.Send(fragments, { 1, 0 });
+    CHECK(Matches(link, { 1 }, cbPacket));
+}
+
+// TestRandomLink
+//
+// Thousands of packets of assorted sizes through a link that drops, repeats and swaps datagrams at random.
+// Whatever comes out has to be intact, in order, and accounted for.
+
+static void TestRandomLink()
+{
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<size_t> size(100, MAXIUMUM_PACKET_SIZE);
+
+    std::map<uint32_t, std::vector<uint8_t>> sent;
+    std::vector<Datagram> datagrams;
+    for (uint32_t sequence = 1; sequence <= 3000; sequence++)
+    {
+        sent[sequence] = SequencedPacket(sequence, size(random));
+        for (auto & datagram : Fragments(sequence, sent[sequence]))
+            datagrams.push_back(datagram);
+    }
+
+    Link link;
+    int cDropped = 0, cRepeated = 0, cSwapped = 0;
+    for (size_t i = 0; i < datagrams.size(); i++)
+    {
+        if (chance(random) < 0.02)
+        {
+            cDropped++;
+            continue;
+        }
+        if (i + 1 < datagrams.size() && chance(random) < 0.05)
+        {
+            std::swap(datagrams[i], datagrams[i + 1]);
+            cSwapped++;
+        }
+        link.Send(datagrams[i]);
+        if (chance(random) < 0.02)
+        {
+            link.Send(datagrams[i]);
+            cRepeated++;
+        }
+    }
+
+    bool bIntact = true, bInOrder = true;
+    for (size_t i = 0; i < link._packets.size(); i++)
+    {
+        auto & packet = link._packets[i];
+        bIntact  &= sent.count(packet.first) && sent[packet.first] == packet.second;
+        bInOrder &= i == 0 || packet.first > link._packets[i - 1].first;
+    }
+    CHECK(bIntact);
+    CHECK(bInOrder);
+    CHECK(!link._packets.empty());
+
+    // Every sequence between the first and last packet handed out was either handed out or counted as lost
+
+    auto & receiver = link._receiver;
+    if (!link._packets.empty())
+        CHECK(receiver._cPackets + receiver._cLost == link._packets.back().first - link._packets.front().first + 1);
+    CHECK(receiver._cPackets == link._packets.size());
+    CHECK(receiver._cDatagrams == datagrams.size() - cDropped + cRepeated);
+
+    printf("Random link: %zu datagrams, %d dropped, %d repeated, %d swapped -> %u of %zu packets handed out, %u lost, "
+           "%u duplicates, %u late, %u reordered\n",
+           datagrams.size(), cDropped, cRepeated, cSwapped, receiver._cPackets, sent.size(), receiver._cLost,
+           receiver._cDuplicates, receiver._cLate, receiver._cReordered);
+}
+
+int main()
+{
+    TestInOrder();
+    TestReorderedFragments();
+    TestDuplicates();
+    TestDroppedFragments();
+    TestSlotsExhausted();
+    TestSenderRestart();
+    TestBadDatagrams();
+    TestRandomLink();
+
+    printf(g_cFailures ? "%d checks FAILED\n" : "All UDP reassembly checks passed\n", g_cFailures);
+    return g_cFailures ? 1 : 0;
+}